@@ -0,0 +1,189 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <emmintrin.h>
+#include <stdlib.h>
+#include <string.h>
+#include "blitter.h"
+#include "workerPool.h"
+
+//Below this many destination pixels a batch isn't worth spreading over threads
+#define PARALLEL_PIXELS 65536
+#define BAND_ROWS 32
+
+#define BLT_COPY -1
+
+//Source coordinates for every destination pixel along one axis
+struct Axis {
+	DWORD* a;		//nearest tap for point, first tap for linear and first pixel for box
+	DWORD* b;		//second tap for linear, one past the last pixel for box
+	BYTE* w;		//weight of the second linear tap, out of 128
+};
+
+struct Plan {
+	const BlitOp* op;
+	int filter;
+	Axis x;
+	Axis y;
+	BYTE* table;
+};
+
+struct BandJob {
+	const BlitImage* dest;
+	Plan* plans;
+	int count;
+};
+
+static bool Fits(const BlitImage* image, DWORD left, DWORD top, DWORD width, DWORD height) {
+	return width&&height&&(UINT64)left+width<=image->width&&(UINT64)top+height<=image->height;
+}
+
+static void BuildAxis(Axis& axis, DWORD start, DWORD in, DWORD out, int filter) {
+	for(DWORD i=0;i<out;i++) {
+		DWORD a, b;
+		BYTE w=0;
+		switch(filter) {
+			case BLT_POINT:
+				a=b=(DWORD)(((UINT64)i*2+1)*in/((UINT64)out*2));
+				break;
+			case BLT_LINEAR: {
+				//centre of the destination pixel in source space, with 7 fractional bits
+				INT64 pos=((INT64)(((UINT64)i*2+1)*in)-out)*128/((INT64)out*2);
+				if(pos<0) pos=0;
+				a=(DWORD)(pos>>7);
+				w=(BYTE)(pos&127);
+				if(a>=in-1) {
+					a=in-1;
+					w=0;
+				}
+				b=w?a+1:a;
+				break;
+			}
+			default:
+				a=(DWORD)((UINT64)i*in/out);
+				b=(DWORD)((UINT64)(i+1)*in/out);
+				if(b<=a) b=a+1;
+				break;
+		}
+		axis.a[i]=start+a;
+		axis.b[i]=start+b;
+		axis.w[i]=w;
+	}
+}
+
+static void PointRow(DWORD* out, const DWORD* in, const Axis& x, DWORD width) {
+	for(DWORD i=0;i<width;i++) out[i]=in[x.a[i]];
+}
+
+static void LinearRow(DWORD* out, const int* row0, const int* row1, BYTE wy, const Axis& x, DWORD width) {
+	__m128i zero=_mm_setzero_si128();
+	__m128i vy=_mm_set1_epi16(wy);
+	for(DWORD i=0;i<width;i++) {
+		//both taps of a row side by side as 16 bit channels, blended vertically then horizontally
+		__m128i p0=_mm_unpacklo_epi32(_mm_cvtsi32_si128(row0[x.a[i]]), _mm_cvtsi32_si128(row0[x.b[i]]));
+		__m128i p1=_mm_unpacklo_epi32(_mm_cvtsi32_si128(row1[x.a[i]]), _mm_cvtsi32_si128(row1[x.b[i]]));
+		p0=_mm_unpacklo_epi8(p0, zero);
+		p1=_mm_unpacklo_epi8(p1, zero);
+		__m128i v=_mm_add_epi16(p0, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(p1, p0), vy), 7));
+		__m128i h=_mm_sub_epi16(_mm_srli_si128(v, 8), v);
+		h=_mm_add_epi16(v, _mm_srai_epi16(_mm_mullo_epi16(h, _mm_set1_epi16(x.w[i])), 7));
+		out[i]=_mm_cvtsi128_si32(_mm_packus_epi16(h, h));
+	}
+}
+
+static void BoxRow(DWORD* out, const BYTE* bits, DWORD pitch, DWORD top, DWORD bottom, const Axis& x, DWORD width) {
+	__m128i zero=_mm_setzero_si128();
+	for(DWORD i=0;i<width;i++) {
+		__m128i acc=zero;
+		for(DWORD y=top;y<bottom;y++) {
+			const int* row=(const int*)(bits+(size_t)y*pitch);
+			for(DWORD s=x.a[i];s<x.b[i];s++) {
+				__m128i p=_mm_unpacklo_epi8(_mm_cvtsi32_si128(row[s]), zero);
+				acc=_mm_add_epi32(acc, _mm_unpacklo_epi16(p, zero));
+			}
+		}
+		float scale=1.0f/((bottom-top)*(x.b[i]-x.a[i]));
+		__m128 f=_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(acc), _mm_set1_ps(scale)), _mm_set1_ps(0.5f));
+		__m128i c=_mm_cvttps_epi32(f);
+		c=_mm_packs_epi32(c, c);
+		out[i]=_mm_cvtsi128_si32(_mm_packus_epi16(c, c));
+	}
+}
+
+static void RenderRow(const Plan& p, const BlitImage* dest, DWORD y) {
+	const BlitOp* op=p.op;
+	const BlitImage* src=op->source;
+	DWORD r=y-op->dT;
+	DWORD* out=(DWORD*)(dest->bits+(size_t)y*dest->pitch)+op->dL;
+	switch(p.filter) {
+		case BLT_COPY:
+			memcpy(out, src->bits+(size_t)(op->sT+r)*src->pitch+op->sL*4, op->dW*4);
+			break;
+		case BLT_POINT:
+			PointRow(out, (const DWORD*)(src->bits+(size_t)p.y.a[r]*src->pitch), p.x, op->dW);
+			break;
+		case BLT_LINEAR:
+			LinearRow(out, (const int*)(src->bits+(size_t)p.y.a[r]*src->pitch), (const int*)(src->bits+(size_t)p.y.b[r]*src->pitch),
+				p.y.w[r], p.x, op->dW);
+			break;
+		default:
+			BoxRow(out, src->bits, src->pitch, p.y.a[r], p.y.b[r], p.x, op->dW);
+			break;
+	}
+}
+
+//Each band runs every op that touches it in submission order, so overlapping ops still stack correctly
+static void BandTask(int index, void* context) {
+	BandJob* job=(BandJob*)context;
+	DWORD top=index*BAND_ROWS, bottom=top+BAND_ROWS;
+	if(bottom>job->dest->height) bottom=job->dest->height;
+	for(int i=0;i<job->count;i++) {
+		const BlitOp* op=job->plans[i].op;
+		DWORD y0=op->dT>top?op->dT:top;
+		DWORD y1=op->dT+op->dH<bottom?op->dT+op->dH:bottom;
+		for(DWORD y=y0;y<y1;y++) RenderRow(job->plans[i], job->dest, y);
+	}
+}
+
+int BlitBatch(const BlitImage* dest, const BlitOp* ops, DWORD count) {
+	Plan* plans=(Plan*)malloc(sizeof(Plan)*(count?count:1));
+	if(!plans) return -1;
+	int used=0;
+	UINT64 pixels=0;
+	bool ok=true;
+	for(DWORD i=0;i<count;i++) {
+		const BlitOp* op=&ops[i];
+		if(!Fits(op->source, op->sL, op->sT, op->sW, op->sH)||!Fits(dest, op->dL, op->dT, op->dW, op->dH)) continue;
+		Plan& p=plans[used];
+		p.op=op;
+		p.table=0;
+		p.filter=op->filter;
+		if(p.filter<BLT_POINT||p.filter>BLT_BOX) p.filter=op->dW<=op->sW&&op->dH<=op->sH?BLT_BOX:BLT_LINEAR;
+		if(op->sW==op->dW&&op->sH==op->dH) p.filter=BLT_COPY;
+		else {
+			p.table=(BYTE*)malloc((size_t)(op->dW+op->dH)*(sizeof(DWORD)*2+1));
+			if(!p.table) {
+				ok=false;
+				break;
+			}
+			p.x.a=(DWORD*)p.table;
+			p.x.b=p.x.a+op->dW;
+			p.y.a=p.x.b+op->dW;
+			p.y.b=p.y.a+op->dH;
+			p.x.w=(BYTE*)(p.y.b+op->dH);
+			p.y.w=p.x.w+op->dW;
+			BuildAxis(p.x, op->sL, op->sW, op->dW, p.filter);
+			BuildAxis(p.y, op->sT, op->sH, op->dH, p.filter);
+		}
+		used++;
+		pixels+=(UINT64)op->dW*op->dH;
+	}
+	if(ok) {
+		BandJob job={ dest, plans, used };
+		int bands=(dest->height+BAND_ROWS-1)/BAND_ROWS;
+		if(pixels>=PARALLEL_PIXELS) ParallelFor(bands, BandTask, &job);
+		else for(int i=0;i<bands;i++) BandTask(i, &job);
+	}
+	for(int i=0;i<used;i++) free(plans[i].table);
+	free(plans);
+	return ok?used:-1;
+}
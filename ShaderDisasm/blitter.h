@@ -0,0 +1,26 @@
+#pragma once
+
+//Batched rectangle copies between A8R8G8B8 images, used by ddsBltBatch
+#define BLT_DEFAULT 0		//box when shrinking on both axes, linear otherwise
+#define BLT_POINT 1
+#define BLT_LINEAR 2
+#define BLT_BOX 3
+
+struct BlitImage {
+	BYTE* bits;
+	DWORD pitch;
+	DWORD width;
+	DWORD height;
+};
+
+struct BlitOp {
+	const BlitImage* source;
+	DWORD sL, sT, sW, sH;
+	DWORD dL, dT, dW, dH;
+	DWORD filter;
+};
+
+//Runs every op into dest, spreading the work over bands of destination rows. Where ops overlap the later one wins.
+//Sources must not share memory with dest. Ops with empty rectangles or rectangles that don't fit inside their
+//image are skipped. Returns the number of ops that were run, or -1 if out of memory.
+int BlitBatch(const BlitImage* dest, const BlitOp* ops, DWORD count);
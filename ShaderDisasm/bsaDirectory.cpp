@@ -0,0 +1,105 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bsaDirectory.h"
+#include "bsaHash.h"
+
+void BsaSetDirFile(BsaDirFile* file, const char* name, int source) {
+	DWORD length=(DWORD)strlen(name);
+	DWORD folderLength=length;
+	while(folderLength&&name[folderLength-1]!='\\'&&name[folderLength-1]!='/') folderLength--;
+	if(folderLength) folderLength--;
+	const char* fileName=folderLength?name+folderLength+1:name;
+	file->name=name;
+	file->source=source;
+	file->folderLength=folderLength;
+	file->folderHash=BsaHashFolder(name, folderLength);
+	file->fileHash=BsaHashFile(fileName, length-(DWORD)(fileName-name));
+	file->recordOffset=0;
+}
+
+static bool SameFolder(const BsaDirFile* a, const BsaDirFile* b) {
+	return a->folderHash==b->folderHash&&a->folderLength==b->folderLength&&!_strnicmp(a->name, b->name, a->folderLength);
+}
+
+static const char* FileName(const BsaDirFile* f) {
+	return f->folderLength?f->name+f->folderLength+1:f->name;
+}
+
+static int CompareFiles(const void* a, const void* b) {
+	const BsaDirFile* x=(const BsaDirFile*)a;
+	const BsaDirFile* y=(const BsaDirFile*)b;
+	if(x->folderHash!=y->folderHash) return x->folderHash<y->folderHash?-1:1;
+	if(x->folderLength!=y->folderLength) return x->folderLength<y->folderLength?-1:1;
+	int folder=_strnicmp(x->name, y->name, x->folderLength);
+	if(folder) return folder;
+	if(x->fileHash!=y->fileHash) return x->fileHash<y->fileHash?-1:1;
+	//qsort isn't stable, so files sharing a path are kept in the caller's order
+	return x->source<y->source?-1:x->source>y->source;
+}
+
+void BsaSortDirFiles(BsaDirFile* files, int count) {
+	qsort(files, count, sizeof(BsaDirFile), CompareFiles);
+}
+
+bool BsaSameDirFile(const BsaDirFile* a, const BsaDirFile* b) {
+	return a->fileHash==b->fileHash&&SameFolder(a, b);
+}
+
+DWORD BsaBuildDirectory(BsaDirFile* files, int count, DWORD archiveFlags, DWORD fileFlags, BYTE** directory) {
+	DWORD folderCount=0;
+	UINT64 folderNames=0, fileNames=0, size=sizeof(BsaHeader);
+	for(int i=0;i<count;i++) {
+		if(!i||!SameFolder(&files[i-1], &files[i])) {
+			if(files[i].folderLength>254) return 0;
+			folderCount++;
+			folderNames+=files[i].folderLength+1;
+			size+=sizeof(BsaFolderRecord)+files[i].folderLength+2;
+		}
+		fileNames+=strlen(FileName(&files[i]))+1;
+		size+=sizeof(BsaFileRecord);
+	}
+	size+=fileNames;
+	if(size>0xffffffff) return 0;
+	BYTE* dir=(BYTE*)calloc((size_t)size, 1);
+	if(!dir) return 0;
+
+	BsaHeader* header=(BsaHeader*)dir;
+	header->magic=BSA_MAGIC;
+	header->version=BSA_VERSION_103;
+	header->folderRecordOffset=sizeof(BsaHeader);
+	header->archiveFlags=archiveFlags;
+	header->folderCount=folderCount;
+	header->fileCount=count;
+	header->totalFolderNameLength=(DWORD)folderNames;
+	header->totalFileNameLength=(DWORD)fileNames;
+	header->fileFlags=fileFlags;
+
+	BsaFolderRecord* folder=(BsaFolderRecord*)(dir+sizeof(BsaHeader))-1;
+	DWORD pos=sizeof(BsaHeader)+folderCount*sizeof(BsaFolderRecord);
+	for(int i=0;i<count;i++) {
+		BsaDirFile* f=&files[i];
+		if(!i||!SameFolder(&files[i-1], f)) {
+			folder++;
+			folder->hash=f->folderHash;
+			//the engine expects folder offsets to include the file name block
+			folder->offset=pos+(DWORD)fileNames;
+			dir[pos]=(BYTE)(f->folderLength+1);
+			memcpy(dir+pos+1, f->name, f->folderLength);
+			pos+=f->folderLength+2;
+		}
+		folder->count++;
+		((BsaFileRecord*)(dir+pos))->hash=f->fileHash;
+		f->recordOffset=pos;
+		pos+=sizeof(BsaFileRecord);
+	}
+	for(int i=0;i<count;i++) {
+		const char* name=FileName(&files[i]);
+		DWORD length=(DWORD)strlen(name)+1;
+		memcpy(dir+pos, name, length);
+		pos+=length;
+	}
+	*directory=dir;
+	return pos;
+}
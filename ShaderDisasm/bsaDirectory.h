@@ -0,0 +1,29 @@
+#pragma once
+
+#include "bsaFormat.h"
+
+//Lays out the directory of a new archive from a list of paths
+
+struct BsaDirFile {
+	const char* name;		//path inside the archive, such as "meshes\\armor\\helmet.nif"
+	DWORD folderLength;		//length of the folder part of name
+	UINT64 folderHash;
+	UINT64 fileHash;
+	int source;				//the caller's index for the file
+	DWORD recordOffset;		//where BsaBuildDirectory put the file's record
+};
+
+//Splits name into its folder and file name and hashes both
+void BsaSetDirFile(BsaDirFile* file, const char* name, int source);
+
+//Puts files in the order the engine expects: folders by hash and then name, and files within them by hash. Files
+//sharing a path are left in order of source.
+void BsaSortDirFiles(BsaDirFile* files, int count);
+
+//True if both files would be stored under the same folder and hash
+bool BsaSameDirFile(const BsaDirFile* a, const BsaDirFile* b);
+
+//Lays out the header, folder records, folder names with their file records and the file names of a version 103
+//archive over sorted files. File sizes and offsets are left for the caller to fill in at each recordOffset.
+//Returns the size of the directory, or 0 if it doesn't fit the format.
+DWORD BsaBuildDirectory(BsaDirFile* files, int count, DWORD archiveFlags, DWORD fileFlags, BYTE** directory);
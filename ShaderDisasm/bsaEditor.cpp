@@ -0,0 +1,422 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bsaDirectory.h"
+#include "fileUtil.h"
+#include "workerPool.h"
+#include "zlibCodec.h"
+
+//bsaEdit and bsaCompact errors. Success returns the number of files in the archive.
+#define EDIT_ERROR_READ -1
+#define EDIT_ERROR_WRITE -2
+#define EDIT_ERROR_FORMAT -3		//not an archive with folder and file names, or its directory is damaged
+#define EDIT_ERROR_SIZE -4			//a file or the whole archive is too big for the format
+
+//Size of the buffer data is moved through
+#define EDIT_COPY_CHUNK (1<<20)
+
+struct BsaEditEntry {
+	const char* name;		//path inside the archive, such as "textures\\armor\\helmet.dds"
+	const char* source;		//file to read the new data from, or 0 to remove the path
+	DWORD compress;			//nonzero to try deflating the file
+};
+
+//An archive's directory read into memory, with the full path of each file put back together
+struct EditArchive {
+	HANDLE file;
+	UINT64 size;
+	BsaHeader header;
+	BYTE* directory;
+	DWORD directoryLength;
+	DWORD* records;			//offset of each file's record in directory
+	char** fileNames;		//full path of each file, in names
+	char* names;
+};
+
+//New data for one path, read and deflated ahead of being appended
+struct EditData {
+	const BsaEditEntry* entry;
+	const char* name;		//path as it goes into the embedded name
+	DWORD recordOffset;
+	DWORD rawLength;
+	BYTE* data;
+	DWORD dataLength;
+	bool outCompressed;
+	int error;
+};
+
+struct EditJob {
+	EditData* data;
+	DWORD ratio;
+	int level;
+};
+
+static bool ReadAt(HANDLE file, UINT64 pos, void* data, DWORD length) {
+	LARGE_INTEGER seek;
+	DWORD read;
+	seek.QuadPart=pos;
+	return SetFilePointerEx(file, seek, 0, FILE_BEGIN)&&ReadFile(file, data, length, &read, 0)&&read==length;
+}
+
+static bool WriteAt(HANDLE file, UINT64 pos, const void* data, DWORD length) {
+	LARGE_INTEGER seek;
+	seek.QuadPart=pos;
+	return SetFilePointerEx(file, seek, 0, FILE_BEGIN)&&WriteAll(file, data, length);
+}
+
+//Copies length bytes from one place to another, possibly in a different file
+static bool CopyRange(HANDLE from, UINT64 fromPos, HANDLE to, UINT64 toPos, DWORD length, BYTE* buffer) {
+	while(length) {
+		DWORD chunk=length<EDIT_COPY_CHUNK?length:EDIT_COPY_CHUNK;
+		if(!ReadAt(from, fromPos, buffer, chunk)||!WriteAt(to, toPos, buffer, chunk)) return false;
+		fromPos+=chunk;
+		toPos+=chunk;
+		length-=chunk;
+	}
+	return true;
+}
+
+static void CloseEditArchive(EditArchive* archive) {
+	if(archive->file!=INVALID_HANDLE_VALUE) CloseHandle(archive->file);
+	free(archive->directory);
+	free(archive->records);
+	free(archive->fileNames);
+	free(archive->names);
+}
+
+//Reads the directory of an archive and works out the full path of every file in it
+static int OpenEditArchive(EditArchive* archive, const char* path, bool write) {
+	memset(archive, 0, sizeof(EditArchive));
+	archive->file=CreateFileA(path, write?GENERIC_READ|GENERIC_WRITE:GENERIC_READ, write?0:FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if(archive->file==INVALID_HANDLE_VALUE) return EDIT_ERROR_READ;
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(archive->file, &size)||!ReadAt(archive->file, 0, &archive->header, sizeof(BsaHeader))) return EDIT_ERROR_READ;
+	archive->size=size.QuadPart;
+	const BsaHeader* header=&archive->header;
+	if(header->magic!=BSA_MAGIC||(header->version!=BSA_VERSION_103&&header->version!=BSA_VERSION_104)||
+		header->folderRecordOffset!=sizeof(BsaHeader)||
+		(header->archiveFlags&(BSA_FLAG_FOLDERNAMES|BSA_FLAG_FILENAMES))!=(BSA_FLAG_FOLDERNAMES|BSA_FLAG_FILENAMES)) return EDIT_ERROR_FORMAT;
+	UINT64 length=sizeof(BsaHeader)+(UINT64)header->folderCount*(sizeof(BsaFolderRecord)+1)+header->totalFolderNameLength+
+		(UINT64)header->fileCount*sizeof(BsaFileRecord)+header->totalFileNameLength;
+	if(length>archive->size) return EDIT_ERROR_FORMAT;
+	archive->directoryLength=(DWORD)length;
+	archive->directory=(BYTE*)malloc(archive->directoryLength);
+	archive->records=(DWORD*)malloc(sizeof(DWORD)*(header->fileCount+1));
+	archive->fileNames=(char**)malloc(sizeof(char*)*(header->fileCount+1));
+	DWORD* folderOf=(DWORD*)malloc(sizeof(DWORD)*(header->fileCount+1));
+	if(!archive->directory||!archive->records||!archive->fileNames||!folderOf) {
+		free(folderOf);
+		return EDIT_ERROR_READ;
+	}
+	if(!ReadAt(archive->file, 0, archive->directory, archive->directoryLength)) {
+		free(folderOf);
+		return EDIT_ERROR_READ;
+	}
+
+	//folder names and file records alternate after the folder records, and the file names come last
+	const BYTE* dir=archive->directory;
+	const BsaFolderRecord* folders=(const BsaFolderRecord*)(dir+sizeof(BsaHeader));
+	DWORD pos=sizeof(BsaHeader)+header->folderCount*sizeof(BsaFolderRecord);
+	DWORD nameBlock=archive->directoryLength-header->totalFileNameLength;
+	UINT64 nameSpace=0;
+	DWORD file=0;
+	for(DWORD i=0;i<header->folderCount;i++) {
+		BYTE folderLength=dir[pos];
+		if(!folderLength||pos+1+folderLength>nameBlock||dir[pos+folderLength]) break;
+		DWORD folderPos=pos;
+		pos+=1+folderLength;
+		DWORD count=folders[i].count;
+		if(count>header->fileCount-file||pos+(UINT64)count*sizeof(BsaFileRecord)>nameBlock) break;
+		for(DWORD j=0;j<count;j++) {
+			archive->records[file]=pos;
+			folderOf[file++]=folderPos;
+			pos+=sizeof(BsaFileRecord);
+		}
+		nameSpace+=(UINT64)count*folderLength;
+	}
+	if(file!=header->fileCount||pos!=nameBlock) {
+		free(folderOf);
+		return EDIT_ERROR_FORMAT;
+	}
+	archive->names=(char*)malloc((size_t)(nameSpace+header->totalFileNameLength+1));
+	if(!archive->names) {
+		free(folderOf);
+		return EDIT_ERROR_READ;
+	}
+	char* next=archive->names;
+	for(DWORD i=0;i<header->fileCount;i++) {
+		const char* name=(const char*)dir+pos;
+		DWORD nameLength=(DWORD)strnlen(name, archive->directoryLength-pos);
+		if(pos+nameLength>=archive->directoryLength) break;
+		pos+=nameLength+1;
+		DWORD folderLength=dir[folderOf[i]]-1;
+		archive->fileNames[i]=next;
+		if(folderLength) {
+			memcpy(next, dir+folderOf[i]+1, folderLength);
+			next+=folderLength;
+			*next++='\\';
+		}
+		memcpy(next, name, nameLength+1);
+		next+=nameLength+1;
+		file=i+1;
+	}
+	free(folderOf);
+	return file==header->fileCount?0:EDIT_ERROR_FORMAT;
+}
+
+static void ReadTask(int index, void* context) {
+	EditJob* job=(EditJob*)context;
+	EditData* d=&job->data[index];
+	HANDLE file=CreateFileA(d->entry->source, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if(file==INVALID_HANDLE_VALUE) {
+		d->error=EDIT_ERROR_READ;
+		return;
+	}
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(file, &size)) d->error=EDIT_ERROR_READ;
+	else if(size.QuadPart>=BSA_SIZE_TOGGLE) d->error=EDIT_ERROR_SIZE;
+	else {
+		DWORD read;
+		d->rawLength=(DWORD)size.QuadPart;
+		d->data=(BYTE*)malloc(d->rawLength?d->rawLength:1);
+		if(!d->data||!ReadFile(file, d->data, d->rawLength, &read, 0)||read!=d->rawLength) d->error=EDIT_ERROR_READ;
+	}
+	CloseHandle(file);
+	if(d->error) return;
+	d->dataLength=d->rawLength;
+	if(!d->entry->compress) return;
+	DWORD bound=zDeflateBound(d->rawLength);
+	BYTE* packed=(BYTE*)malloc(bound);
+	DWORD length=packed?zDeflate(d->data, d->rawLength, packed, bound, job->level):0;
+	//as with bsaPack, a ratio of 0 keeps the deflated data whatever its size
+	if(length&&(!job->ratio||(UINT64)length*100<(UINT64)d->rawLength*job->ratio)) {
+		free(d->data);
+		d->data=packed;
+		d->dataLength=length;
+		d->outCompressed=true;
+	} else free(packed);
+}
+
+static DWORD StoredLength(const BsaFileRecord* record) {
+	return record->size&(BSA_SIZE_TOGGLE-1);
+}
+
+static int CompareOffsets(const void* a, const void* b) {
+	const BsaFileRecord* x=*(const BsaFileRecord* const*)a;
+	const BsaFileRecord* y=*(const BsaFileRecord* const*)b;
+	if(x->offset!=y->offset) return x->offset<y->offset?-1:1;
+	//the longest of the files starting at one place covers the others, so it goes first to be the one copied
+	if(StoredLength(x)!=StoredLength(y)) return StoredLength(x)>StoredLength(y)?-1:1;
+	return 0;
+}
+
+//Sorts records by where their data lies and adds up the data they use, counting shared data once
+static UINT64 LiveLength(BsaFileRecord** records, int count) {
+	qsort(records, count, sizeof(BsaFileRecord*), CompareOffsets);
+	UINT64 live=0;
+	for(int i=0;i<count;i++) {
+		if(!i||records[i]->offset!=records[i-1]->offset) live+=StoredLength(records[i]);
+	}
+	return live;
+}
+
+//Replaces, adds and removes files in an archive without rebuilding it. New data is appended to the end of the
+//file, and the directory at the start is rewritten. If the new directory no longer fits ahead of the data, just
+//the files in its way are moved to the end, leaving slack bytes spare past it so later edits can grow it in
+//place. An edit with no source removes its path, and later edits of a path win over earlier ones. The data of
+//replaced and removed files is left behind as unused space, which unused receives the size of; bsaCompact
+//reclaims it. The old directory stays valid until the new one is written over it in the last step.
+int _stdcall bsaEdit(const char* path, const BsaEditEntry* edits, int count, DWORD ratio, int level, DWORD slack, UINT64* unused) {
+	if(unused) *unused=0;
+	if(count<0) return EDIT_ERROR_SIZE;
+	EditArchive archive;
+	int result=OpenEditArchive(&archive, path, true);
+	if(result) {
+		CloseEditArchive(&archive);
+		return result;
+	}
+	const BsaHeader* header=&archive.header;
+	int existing=(int)header->fileCount;
+	int total=existing+count;
+	BsaDirFile* order=(BsaDirFile*)malloc(sizeof(BsaDirFile)*(total?total:1));
+	EditData* data=(EditData*)calloc(count?count:1, sizeof(EditData));
+	BsaFileRecord** live=(BsaFileRecord**)malloc(sizeof(BsaFileRecord*)*(total?total:1));
+	BYTE* buffer=(BYTE*)malloc(EDIT_COPY_CHUNK);
+	if(!order||!data||!live||!buffer) result=EDIT_ERROR_WRITE;
+
+	//Sort the old and new paths together. Among files sharing a path the highest source wins, which is the
+	//last edit of it if there are any.
+	int kept=0;
+	if(!result) {
+		for(int i=0;i<existing;i++) BsaSetDirFile(&order[i], archive.fileNames[i], i);
+		for(int i=0;i<count;i++) BsaSetDirFile(&order[existing+i], edits[i].name, existing+i);
+		BsaSortDirFiles(order, total);
+		for(int i=0;i<total;) {
+			int winner=i;
+			int end=i+1;
+			for(;end<total&&BsaSameDirFile(&order[i], &order[end]);end++) {
+				if(order[end].source>order[winner].source) winner=end;
+			}
+			int source=order[winner].source;
+			if(source<existing||edits[source-existing].source) order[kept++]=order[winner];
+			i=end;
+		}
+	}
+
+	BYTE* directory=0;
+	DWORD dataStart=0;
+	if(!result) {
+		dataStart=BsaBuildDirectory(order, kept, header->archiveFlags, header->fileFlags, &directory);
+		if(!dataStart) result=EDIT_ERROR_SIZE;
+	}
+
+	//Kept files point at their old data for now, and new data is read and deflated on all cores
+	bool defaultCompressed=(header->archiveFlags&BSA_FLAG_COMPRESSED)!=0;
+	bool embedNames=header->version==BSA_VERSION_104&&(header->archiveFlags&BSA_FLAG_EMBEDNAMES);
+	int dataCount=0, liveCount=0;
+	UINT64 firstData=0xffffffff;
+	for(int i=0;i<kept&&!result;i++) {
+		BsaFileRecord* record=(BsaFileRecord*)(directory+order[i].recordOffset);
+		if(order[i].source<existing) {
+			*record=*(const BsaFileRecord*)(archive.directory+archive.records[order[i].source]);
+			if(record->offset<archive.directoryLength||record->offset+(UINT64)StoredLength(record)>archive.size) result=EDIT_ERROR_FORMAT;
+			if(record->offset<firstData) firstData=record->offset;
+			live[liveCount++]=record;
+		} else {
+			EditData* d=&data[dataCount++];
+			d->entry=&edits[order[i].source-existing];
+			d->name=order[i].name;
+			d->recordOffset=order[i].recordOffset;
+		}
+	}
+	if(!result) {
+		((BsaHeader*)directory)->version=header->version;
+		EditJob job;
+		job.data=data;
+		job.ratio=ratio;
+		job.level=level;
+		ParallelFor(dataCount, ReadTask, &job);
+		for(int i=0;i<dataCount&&!result;i++) result=data[i].error;
+	}
+
+	UINT64 end=archive.size>dataStart?archive.size:dataStart;
+	if(!result&&firstData<dataStart) {
+		//move the files in the way of the new directory, and its slack, to the end
+		UINT64 below=(UINT64)dataStart+slack;
+		qsort(live, liveCount, sizeof(BsaFileRecord*), CompareOffsets);
+		DWORD oldOffset=0, newOffset=0;
+		for(int i=0;i<liveCount&&live[i]->offset<below&&!result;i++) {
+			BsaFileRecord* record=live[i];
+			if(!i||record->offset!=oldOffset) {
+				DWORD length=StoredLength(record);
+				if(end+length>0xffffffff) result=EDIT_ERROR_SIZE;
+				else if(!CopyRange(archive.file, record->offset, archive.file, end, length, buffer)) result=EDIT_ERROR_WRITE;
+				oldOffset=record->offset;
+				newOffset=(DWORD)end;
+				end+=length;
+			}
+			record->offset=newOffset;
+		}
+	}
+	for(int i=0;i<dataCount&&!result;i++) {
+		EditData* d=&data[i];
+		DWORD nameLength=embedNames?(DWORD)strlen(d->name):0;
+		DWORD length=(embedNames?nameLength+1:0)+(d->outCompressed?4:0)+d->dataLength;
+		if(nameLength>255||end+length>0xffffffff||length>=BSA_SIZE_TOGGLE) {
+			result=EDIT_ERROR_SIZE;
+			break;
+		}
+		BsaFileRecord* record=(BsaFileRecord*)(directory+d->recordOffset);
+		record->size=length|(d->outCompressed!=defaultCompressed?BSA_SIZE_TOGGLE:0);
+		record->offset=(DWORD)end;
+		UINT64 pos=end;
+		if(embedNames) {
+			BYTE prefix=(BYTE)nameLength;
+			if(!WriteAt(archive.file, pos, &prefix, 1)||!WriteAt(archive.file, pos+1, d->name, nameLength)) result=EDIT_ERROR_WRITE;
+			pos+=nameLength+1;
+		}
+		if(!result&&d->outCompressed) {
+			if(!WriteAt(archive.file, pos, &d->rawLength, 4)) result=EDIT_ERROR_WRITE;
+			pos+=4;
+		}
+		if(!result&&!WriteAt(archive.file, pos, d->data, d->dataLength)) result=EDIT_ERROR_WRITE;
+		end+=length;
+		live[liveCount++]=record;
+	}
+
+	//everything the new directory refers to is on disk, so it can go in last
+	if(!result) {
+		if(!FlushFileBuffers(archive.file)||!WriteAt(archive.file, 0, directory, dataStart)) result=EDIT_ERROR_WRITE;
+		//clear what is left of a longer old directory so it isn't mistaken for data
+		if(!result&&archive.directoryLength>dataStart) {
+			memset(buffer, 0, archive.directoryLength-dataStart<EDIT_COPY_CHUNK?archive.directoryLength-dataStart:EDIT_COPY_CHUNK);
+			for(UINT64 pos=dataStart;pos<archive.directoryLength&&!result;pos+=EDIT_COPY_CHUNK) {
+				DWORD chunk=archive.directoryLength-pos<EDIT_COPY_CHUNK?(DWORD)(archive.directoryLength-pos):EDIT_COPY_CHUNK;
+				if(!WriteAt(archive.file, pos, buffer, chunk)) result=EDIT_ERROR_WRITE;
+			}
+		}
+	}
+	if(!result&&unused) *unused=end-dataStart-LiveLength(live, liveCount);
+
+	for(int i=0;i<dataCount;i++) free(data[i].data);
+	free(directory);
+	free(order);
+	free(data);
+	free(live);
+	free(buffer);
+	CloseEditArchive(&archive);
+	return result?result:kept;
+}
+
+//Writes a copy of an archive to outPath with the unused space left by bsaEdit taken out. The directory is kept
+//as it is apart from the offsets, and files that share data still share it. reclaimed receives the number of
+//bytes saved. outPath must differ from path.
+int _stdcall bsaCompact(const char* path, const char* outPath, UINT64* reclaimed) {
+	if(reclaimed) *reclaimed=0;
+	EditArchive archive;
+	int result=OpenEditArchive(&archive, path, false);
+	if(result) {
+		CloseEditArchive(&archive);
+		return result;
+	}
+	int count=(int)archive.header.fileCount;
+	BsaFileRecord** records=(BsaFileRecord**)malloc(sizeof(BsaFileRecord*)*(count?count:1));
+	BYTE* buffer=(BYTE*)malloc(EDIT_COPY_CHUNK);
+	if(!records||!buffer) result=EDIT_ERROR_WRITE;
+	for(int i=0;i<count&&!result;i++) {
+		records[i]=(BsaFileRecord*)(archive.directory+archive.records[i]);
+		if(records[i]->offset<archive.directoryLength||records[i]->offset+(UINT64)StoredLength(records[i])>archive.size) result=EDIT_ERROR_FORMAT;
+	}
+	HANDLE out=INVALID_HANDLE_VALUE;
+	if(!result) {
+		out=CreateFileA(outPath, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+		if(out==INVALID_HANDLE_VALUE) result=EDIT_ERROR_WRITE;
+	}
+	UINT64 end=archive.directoryLength;
+	if(!result) {
+		qsort(records, count, sizeof(BsaFileRecord*), CompareOffsets);
+		DWORD oldOffset=0, newOffset=0;
+		for(int i=0;i<count&&!result;i++) {
+			BsaFileRecord* record=records[i];
+			if(!i||record->offset!=oldOffset) {
+				DWORD length=StoredLength(record);
+				if(!CopyRange(archive.file, record->offset, out, end, length, buffer)) result=EDIT_ERROR_WRITE;
+				oldOffset=record->offset;
+				newOffset=(DWORD)end;
+				end+=length;
+			}
+			record->offset=newOffset;
+		}
+		if(!result&&!WriteAt(out, 0, archive.directory, archive.directoryLength)) result=EDIT_ERROR_WRITE;
+	}
+	if(out!=INVALID_HANDLE_VALUE) {
+		CloseHandle(out);
+		if(result) DeleteFileA(outPath);
+	}
+	if(!result&&reclaimed) *reclaimed=archive.size-end;
+	free(records);
+	free(buffer);
+	CloseEditArchive(&archive);
+	return result?result:count;
+}
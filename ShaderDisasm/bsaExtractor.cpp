@@ -0,0 +1,185 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bsaReader.h"
+#include "fileUtil.h"
+#include "workerPool.h"
+#include "zlibCodec.h"
+
+//bsaExtract errors. Success returns the number of files written.
+#define EXTRACT_ERROR_NAMES -1
+#define EXTRACT_ERROR_WRITE -2
+#define EXTRACT_ERROR_DATA -3
+#define EXTRACT_ERROR_CANCELLED -4
+
+//Memory allowed for inflated files waiting to be written when the caller doesn't give a budget
+#define EXTRACT_DEFAULT_BUDGET (256*1024*1024)
+
+//Called on the thread that called bsaExtract. Returning FALSE cancels the extraction.
+typedef BOOL (_stdcall *ExtractProgress)(int done, int total);
+
+struct ExtractItem {
+	DWORD index;
+	BsaEntry entry;
+	BYTE* buffer;			//inflated data, or 0 to write straight from the archive
+	bool failed;
+	bool reserved;			//whether entry.size bytes of the budget are held for it
+};
+
+struct ExtractJob {
+	BsaArchive* bsa;
+	ExtractItem* items;
+	int count;
+	DWORD budget;
+
+	CRITICAL_SECTION lock;
+	CONDITION_VARIABLE space;	//signalled when buffered bytes are released
+	CONDITION_VARIABLE ready;	//signalled when an item is finished
+	int* queue;					//finished items in the order they finished
+	int queued;
+	UINT64 buffered;
+	volatile bool cancelled;
+};
+
+static int CompareItems(const void* a, const void* b) {
+	const BYTE* x=((const ExtractItem*)a)->entry.data;
+	const BYTE* y=((const ExtractItem*)b)->entry.data;
+	return x<y?-1:x>y?1:0;
+}
+
+static void ExtractTask(int index, void* context) {
+	ExtractJob* job=(ExtractJob*)context;
+	ExtractItem* item=&job->items[index];
+	if(item->entry.compressed&&!item->failed) {
+		DWORD size=item->entry.size;
+		//wait for room, but never hold back the only file in flight
+		EnterCriticalSection(&job->lock);
+		while(job->buffered&&job->buffered+size>job->budget&&!job->cancelled) SleepConditionVariableCS(&job->space, &job->lock, INFINITE);
+		job->buffered+=size;
+		item->reserved=true;
+		LeaveCriticalSection(&job->lock);
+		if(!job->cancelled) {
+			item->buffer=(BYTE*)malloc(size?size:1);
+			if(!item->buffer||!zInflate(item->entry.data, item->entry.storedSize, item->buffer, size)) item->failed=true;
+		}
+	}
+	EnterCriticalSection(&job->lock);
+	job->queue[job->queued++]=index;
+	WakeConditionVariable(&job->ready);
+	LeaveCriticalSection(&job->lock);
+}
+
+static DWORD WINAPI InflateThread(LPVOID param) {
+	ExtractJob* job=(ExtractJob*)param;
+	ParallelFor(job->count, ExtractTask, job);
+	return 0;
+}
+
+//Creates every directory leading up to the file at path
+static bool MakeDirectories(char* path) {
+	for(char* p=path;*p;p++) {
+		if(*p!='\\'||p==path||p[-1]==':') continue;
+		*p=0;
+		BOOL ok=CreateDirectoryA(path, 0)||GetLastError()==ERROR_ALREADY_EXISTS;
+		*p='\\';
+		if(!ok) return false;
+	}
+	return true;
+}
+
+static bool WriteItem(ExtractJob* job, ExtractItem* item, char* path, DWORD pathLength) {
+	int length=bsaFileName(job->bsa, item->index, path+pathLength, MAX_PATH*2-pathLength);
+	if(length<0) return false;
+	HANDLE file=CreateFileA(path, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	if(file==INVALID_HANDLE_VALUE&&GetLastError()==ERROR_PATH_NOT_FOUND&&MakeDirectories(path)) {
+		file=CreateFileA(path, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	}
+	if(file==INVALID_HANDLE_VALUE) return false;
+	const BYTE* data=item->buffer?item->buffer:item->entry.data;
+	bool ok=WriteAll(file, data, item->entry.size);
+	CloseHandle(file);
+	return ok;
+}
+
+//Writes the given files of an archive below outDir, keeping their folders. The files are read in the order
+//they are stored, and compressed ones are inflated across all cores while this thread writes out whatever is
+//finished. At most budget bytes of inflated data are held at once, or 256MB if budget is 0.
+int _stdcall bsaExtract(BsaArchive* bsa, const int* indices, int count, const char* outDir, DWORD budget, ExtractProgress progress) {
+	if(!(bsa->header->archiveFlags&BSA_FLAG_FOLDERNAMES)||!(bsa->header->archiveFlags&BSA_FLAG_FILENAMES)) return EXTRACT_ERROR_NAMES;
+	if(count<=0) return 0;
+	char path[MAX_PATH*2];
+	DWORD pathLength=(DWORD)strlen(outDir);
+	if(pathLength+2>=MAX_PATH) return EXTRACT_ERROR_WRITE;
+	memcpy(path, outDir, pathLength);
+	if(pathLength&&path[pathLength-1]!='\\'&&path[pathLength-1]!='/') path[pathLength++]='\\';
+	path[pathLength]=0;
+
+	ExtractJob job;
+	job.bsa=bsa;
+	job.count=count;
+	job.budget=budget?budget:EXTRACT_DEFAULT_BUDGET;
+	job.queued=0;
+	job.buffered=0;
+	job.cancelled=false;
+	job.items=(ExtractItem*)calloc(count, sizeof(ExtractItem));
+	job.queue=(int*)malloc(sizeof(int)*count);
+	if(!job.items||!job.queue) {
+		free(job.items);
+		free(job.queue);
+		return EXTRACT_ERROR_WRITE;
+	}
+	for(int i=0;i<count;i++) {
+		job.items[i].index=indices[i];
+		if(!bsaFileInfo(bsa, indices[i], &job.items[i].entry)) job.items[i].failed=true;
+	}
+	qsort(job.items, count, sizeof(ExtractItem), CompareItems);
+
+	InitializeCriticalSection(&job.lock);
+	InitializeConditionVariable(&job.space);
+	InitializeConditionVariable(&job.ready);
+	HANDLE thread=CreateThread(0, 0, InflateThread, &job, 0, 0);
+
+	int result=0;
+	for(int done=0;done<count;done++) {
+		//without a thread to inflate on, each file is inflated here just before it is written
+		if(!thread) ExtractTask(done, &job);
+		EnterCriticalSection(&job.lock);
+		while(job.queued==done) SleepConditionVariableCS(&job.ready, &job.lock, INFINITE);
+		ExtractItem* item=&job.items[job.queue[done]];
+		LeaveCriticalSection(&job.lock);
+
+		if(!job.cancelled) {
+			if(item->failed) {
+				if(!result) result=EXTRACT_ERROR_DATA;
+			} else if(!WriteItem(&job, item, path, pathLength)) {
+				result=EXTRACT_ERROR_WRITE;
+				job.cancelled=true;
+			}
+		}
+		if(item->buffer) {
+			free(item->buffer);
+			item->buffer=0;
+		}
+		EnterCriticalSection(&job.lock);
+		if(item->reserved) job.buffered-=item->entry.size;
+		WakeAllConditionVariable(&job.space);
+		LeaveCriticalSection(&job.lock);
+
+		if(progress&&!job.cancelled&&((done+1)%100==0||done+1==count)&&!progress(done+1, count)) {
+			result=EXTRACT_ERROR_CANCELLED;
+			job.cancelled=true;
+			EnterCriticalSection(&job.lock);
+			WakeAllConditionVariable(&job.space);
+			LeaveCriticalSection(&job.lock);
+		}
+	}
+	if(thread) {
+		WaitForSingleObject(thread, INFINITE);
+		CloseHandle(thread);
+	}
+	DeleteCriticalSection(&job.lock);
+	free(job.items);
+	free(job.queue);
+	return result?result:count;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+//On disk layout of fallout 3 / new vegas archives (versions 103 and 104)
+
+#define BSA_MAGIC 0x00415342
+#define BSA_VERSION_103 0x67
+#define BSA_VERSION_104 0x68
+
+#define BSA_FLAG_FOLDERNAMES 0x001
+#define BSA_FLAG_FILENAMES 0x002
+#define BSA_FLAG_COMPRESSED 0x004
+#define BSA_FLAG_EMBEDNAMES 0x100
+
+//Set in a file record's size to invert the archive's default compression for that file
+#define BSA_SIZE_TOGGLE (1<<30)
+
+#pragma pack(push, 1)
+struct BsaHeader {
+	DWORD magic;
+	DWORD version;
+	DWORD folderRecordOffset;
+	DWORD archiveFlags;
+	DWORD folderCount;
+	DWORD fileCount;
+	DWORD totalFolderNameLength;
+	DWORD totalFileNameLength;
+	DWORD fileFlags;
+};
+
+struct BsaFolderRecord {
+	UINT64 hash;
+	DWORD count;
+	DWORD offset;
+};
+
+struct BsaFileRecord {
+	UINT64 hash;
+	DWORD size;
+	DWORD offset;
+};
+#pragma pack(pop)
@@ -0,0 +1,113 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <emmintrin.h>
+#include <string.h>
+#include "bsaHash.h"
+#include "workerPool.h"
+
+//Batches smaller than this are hashed on the calling thread
+#define PARALLEL_PATHS 65536
+#define PATHS_PER_TASK 4096
+
+static inline BYTE Fold(char c) {
+	if(c>='A'&&c<='Z') return (BYTE)(c+('a'-'A'));
+	if(c=='/') return '\\';
+	return (BYTE)c;
+}
+
+//Applies Fold to 16 bytes at a time
+static void FoldString(BYTE* out, const char* in, DWORD length) {
+	const __m128i before=_mm_set1_epi8('A'-1), after=_mm_set1_epi8('Z'+1);
+	const __m128i slash=_mm_set1_epi8('/'), toLower=_mm_set1_epi8('a'-'A'), toBackslash=_mm_set1_epi8('\\'-'/');
+	DWORD i=0;
+	for(;i+16<=length;i+=16) {
+		__m128i v=_mm_loadu_si128((const __m128i*)(in+i));
+		__m128i upper=_mm_and_si128(_mm_cmpgt_epi8(v, before), _mm_cmplt_epi8(v, after));
+		v=_mm_add_epi8(v, _mm_and_si128(upper, toLower));
+		v=_mm_add_epi8(v, _mm_and_si128(_mm_cmpeq_epi8(v, slash), toBackslash));
+		_mm_storeu_si128((__m128i*)(out+i), v);
+	}
+	for(;i<length;i++) out[i]=Fold(in[i]);
+}
+
+static DWORD HashString(const char* s, DWORD length) {
+	BYTE buffer[256];
+	DWORD hash=0;
+	while(length) {
+		DWORD n=length<sizeof(buffer)?length:sizeof(buffer);
+		FoldString(buffer, s, n);
+		for(DWORD i=0;i<n;i++) hash=hash*0x1003f+buffer[i];
+		s+=n;
+		length-=n;
+	}
+	return hash;
+}
+
+static UINT64 HashStem(const char* s, DWORD length) {
+	if(!length) return 0;
+	DWORD low=Fold(s[length-1])+(length>2?Fold(s[length-2])<<8:0)+(length<<16)+(Fold(s[0])<<24);
+	UINT64 hash=low;
+	if(length>3) hash+=(UINT64)HashString(s+1, length-3)<<32;
+	return hash;
+}
+
+UINT64 BsaHashFolder(const char* path, DWORD length) {
+	return HashStem(path, length);
+}
+
+UINT64 BsaHashFile(const char* name, DWORD length) {
+	DWORD dot=length;
+	while(dot>0&&name[dot-1]!='.') dot--;
+	if(!dot) return HashStem(name, length);
+	dot--;
+	const char* ext=name+dot;
+	DWORD extLength=length-dot;
+	UINT64 hash=HashStem(name, dot);
+	hash+=(UINT64)HashString(ext, extLength)<<32;
+	//the engine's own types get a code mixed into the low bytes
+	DWORD code=0;
+	if(extLength==4&&!_strnicmp(ext, ".nif", 4)) code=1;
+	else if(extLength==3&&!_strnicmp(ext, ".kf", 3)) code=2;
+	else if(extLength==4&&!_strnicmp(ext, ".dds", 4)) code=3;
+	else if(extLength==4&&!_strnicmp(ext, ".wav", 4)) code=4;
+	if(code) {
+		DWORD low=(DWORD)hash;
+		BYTE a=(BYTE)(((code&0xfc)<<5)+(BYTE)(low>>24));
+		BYTE b=(BYTE)(((code&0xfe)<<6)+(BYTE)low);
+		BYTE c=(BYTE)((code<<7)+(BYTE)(low>>8));
+		hash-=low&0xff00ffff;
+		hash+=(DWORD)((a<<24)+b+(c<<8));
+	}
+	return hash;
+}
+
+struct HashJob {
+	const char** paths;
+	int count;
+	DWORD options;
+	UINT64* hashes;
+};
+
+static void HashTask(int index, void* context) {
+	HashJob* job=(HashJob*)context;
+	int end=(index+1)*PATHS_PER_TASK;
+	if(end>job->count) end=job->count;
+	for(int i=index*PATHS_PER_TASK;i<end;i++) {
+		const char* path=job->paths[i];
+		DWORD length=(DWORD)strlen(path);
+		if(job->options&BSA_HASH_FOLDERS) {
+			job->hashes[i]=BsaHashFolder(path, length);
+		} else {
+			DWORD slash=length;
+			while(slash>0&&path[slash-1]!='\\'&&path[slash-1]!='/') slash--;
+			job->hashes[i]=BsaHashFile(path+slash, length-slash);
+		}
+	}
+}
+
+void _stdcall bsaHashBatch(const char** paths, int count, DWORD options, UINT64* hashes) {
+	HashJob job={ paths, count, options, hashes };
+	int tasks=(count+PATHS_PER_TASK-1)/PATHS_PER_TASK;
+	if(count>=PARALLEL_PATHS) ParallelFor(tasks, HashTask, &job);
+	else for(int i=0;i<tasks;i++) HashTask(i, &job);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+//The hashes archives are indexed by. Names are matched without regard to case and with '/' read as '\\'.
+
+//Hash of a folder path such as "meshes\\armor"
+UINT64 BsaHashFolder(const char* path, DWORD length);
+
+//Hash of a file name without its folder, such as "helmet.nif"
+UINT64 BsaHashFile(const char* name, DWORD length);
+
+#define BSA_HASH_FOLDERS 1		//hash each path as a folder rather than by its file name
+
+//Hashes count paths into hashes. Paths are hashed by their file name, ignoring any folder, unless
+//BSA_HASH_FOLDERS is set.
+void _stdcall bsaHashBatch(const char** paths, int count, DWORD options, UINT64* hashes);
@@ -0,0 +1,146 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bsaLayout.h"
+#include "mappedFile.h"
+#include "workerPool.h"
+
+//Longest texture path picked out of a mesh, and the most textures followed up per mesh
+#define LAYOUT_MAX_PATH 260
+#define LAYOUT_MAX_TEXTURES 64
+
+struct LayoutName {
+	const char* name;
+	int file;
+};
+
+struct LayoutJob {
+	const char* const* sources;
+	LayoutName* byName;		//every file, sorted by path
+	int count;
+	int** textures;			//for each mesh, the files holding its textures ending in -1, or 0
+};
+
+static inline char Fold(char c) {
+	if(c=='/') return '\\';
+	return c>='A'&&c<='Z'?c+32:c;
+}
+
+//Compares paths ignoring case and slash direction
+static int ComparePaths(const char* a, const char* b) {
+	for(;;a++,b++) {
+		char x=Fold(*a), y=Fold(*b);
+		if(x!=y) return (BYTE)x<(BYTE)y?-1:1;
+		if(!x) return 0;
+	}
+}
+
+static int CompareNames(const void* a, const void* b) {
+	const LayoutName* x=(const LayoutName*)a;
+	const LayoutName* y=(const LayoutName*)b;
+	int result=ComparePaths(x->name, y->name);
+	return result?result:x->file-y->file;
+}
+
+static bool EndsWith(const char* data, size_t length, const char* suffix) {
+	size_t suffixLength=strlen(suffix);
+	if(length<suffixLength) return false;
+	data+=length-suffixLength;
+	for(size_t i=0;i<suffixLength;i++) if(Fold(data[i])!=suffix[i]) return false;
+	return true;
+}
+
+static int FindFile(const LayoutJob* job, const char* path) {
+	int low=0, high=job->count-1;
+	while(low<=high) {
+		int mid=(low+high)/2;
+		int result=ComparePaths(job->byName[mid].name, path);
+		if(!result) return job->byName[mid].file;
+		if(result<0) low=mid+1;
+		else high=mid-1;
+	}
+	return -1;
+}
+
+//Picks texture paths out of a mesh. Rather than parsing the nif, this looks for strings ending in .dds and
+//takes them from where "textures\" starts, which covers every block type that names a texture.
+static void ScanTask(int index, void* context) {
+	LayoutJob* job=(LayoutJob*)context;
+	int file=job->byName[index].file;
+	const char* name=job->byName[index].name;
+	if(!EndsWith(name, strlen(name), ".nif")) return;
+	MappedFile map;
+	if(!MapFile(&map, job->sources[file])) return;
+
+	const char* data=(const char*)map.data;
+	int found[LAYOUT_MAX_TEXTURES];
+	int count=0;
+	char path[LAYOUT_MAX_PATH+1];
+	for(UINT64 end=4;end<=map.size&&count<LAYOUT_MAX_TEXTURES;end++) {
+		if(data[end-1]!='s'&&data[end-1]!='S') continue;
+		if(!EndsWith(data, (size_t)end, ".dds")) continue;
+		UINT64 start=end-4;
+		while(start&&end-start<LAYOUT_MAX_PATH&&data[start-1]>=0x20&&data[start-1]<0x7f) start--;
+		DWORD length=(DWORD)(end-start);
+		memcpy(path, data+start, length);
+		path[length]=0;
+		for(DWORD i=0;i+9<length;i++) {
+			if(!EndsWith(path+i, 9, "textures\\")) continue;
+			int texture=FindFile(job, path+i);
+			bool seen=texture<0;
+			for(int j=0;j<count&&!seen;j++) seen=found[j]==texture;
+			if(!seen) found[count++]=texture;
+			break;
+		}
+	}
+	UnmapFile(&map);
+	if(!count) return;
+	int* textures=(int*)malloc(sizeof(int)*(count+1));
+	if(!textures) return;
+	memcpy(textures, found, sizeof(int)*count);
+	textures[count]=-1;
+	job->textures[file]=textures;
+}
+
+bool BsaLocalityOrder(const char* const* names, const char* const* sources, int count, int* order) {
+	LayoutJob job;
+	job.sources=sources;
+	job.count=count;
+	job.byName=(LayoutName*)malloc(sizeof(LayoutName)*(count?count:1));
+	job.textures=(int**)calloc(count?count:1, sizeof(int*));
+	bool* placed=(bool*)calloc(count?count:1, sizeof(bool));
+	if(!job.byName||!job.textures||!placed) {
+		free(job.byName);
+		free(job.textures);
+		free(placed);
+		return false;
+	}
+	for(int i=0;i<count;i++) {
+		job.byName[i].name=names[i];
+		job.byName[i].file=i;
+	}
+	qsort(job.byName, count, sizeof(LayoutName), CompareNames);
+	ParallelFor(count, ScanTask, &job);
+
+	//meshes sort ahead of textures, so each texture lands behind the first mesh using it
+	int next=0;
+	for(int i=0;i<count;i++) {
+		int file=job.byName[i].file;
+		if(!placed[file]) {
+			placed[file]=true;
+			order[next++]=file;
+		}
+		if(!job.textures[file]) continue;
+		for(const int* texture=job.textures[file];*texture>=0;texture++) {
+			if(placed[*texture]) continue;
+			placed[*texture]=true;
+			order[next++]=*texture;
+		}
+		free(job.textures[file]);
+	}
+	free(job.byName);
+	free(job.textures);
+	free(placed);
+	return true;
+}
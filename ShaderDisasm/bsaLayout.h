@@ -0,0 +1,8 @@
+#pragma once
+
+//Chooses the order file data is written to a new archive in, independent of the hash order of its directory
+
+//Fills order with the indices of count files so that files loaded together lie next to each other: files are
+//grouped by folder path, and the textures a mesh uses follow the mesh. names are paths inside the archive and
+//sources the files the data is read from. Returns false if out of memory.
+bool BsaLocalityOrder(const char* const* names, const char* const* sources, int count, int* order);
@@ -0,0 +1,320 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bsaDirectory.h"
+#include "bsaLayout.h"
+#include "contentHash.h"
+#include "fileUtil.h"
+#include "mappedFile.h"
+#include "orderedWriter.h"
+#include "workerPool.h"
+#include "zlibCodec.h"
+
+//bsaPack errors. Success returns the number of files that were stored compressed.
+#define PACK_ERROR_READ -1
+#define PACK_ERROR_WRITE -2
+#define PACK_ERROR_SIZE -3		//a file or the whole archive is too big for the format
+
+//bsaPack options
+#define PACK_DEDUPLICATE 1		//store files with identical contents once and point all their records at it
+#define PACK_LOCALITY 2			//write data grouped by folder, with each mesh's textures behind it
+#define PACK_ENTRY_ORDER 4		//write data in the order the entries are given, such as a recorded load order
+
+//Files allowed to be in flight per worker ahead of the one being written
+#define PACK_WINDOW 4
+
+typedef void (_stdcall *PackProgress)(int done, int total);
+
+struct BsaPackEntry {
+	const char* name;		//path inside the archive, such as "meshes\\armor\\helmet.nif"
+	const char* source;		//file to read the data from
+	DWORD compress;			//nonzero to try deflating the file
+};
+
+struct PackFile {
+	const BsaPackEntry* entry;
+	DWORD recordOffset;
+	int sameAs;				//earlier file whose stored data this one shares, or -1
+
+	//filled in by the worker
+	bool outCompressed;
+	DWORD rawLength;
+	BYTE* data;
+	DWORD dataLength;
+};
+
+struct PackJob {
+	PackFile* files;
+	int count;
+	DWORD ratio;
+	int level;
+	HANDLE out;
+	BYTE* directory;
+	UINT64 outPos;
+	bool defaultCompressed;
+	UINT64 saved;
+	volatile LONG compressed;
+};
+
+static int ReadSource(const char* path, BYTE** data, DWORD* length) {
+	HANDLE file=CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if(file==INVALID_HANDLE_VALUE) return PACK_ERROR_READ;
+	LARGE_INTEGER size;
+	int result=0;
+	if(!GetFileSizeEx(file, &size)) result=PACK_ERROR_READ;
+	else if(size.QuadPart>=BSA_SIZE_TOGGLE) result=PACK_ERROR_SIZE;
+	else {
+		DWORD read;
+		*length=(DWORD)size.QuadPart;
+		*data=(BYTE*)malloc(*length?*length:1);
+		if(!*data||!ReadFile(file, *data, *length, &read, 0)||read!=*length) result=PACK_ERROR_READ;
+	}
+	CloseHandle(file);
+	return result;
+}
+
+static int ProcessTask(int index, void* context) {
+	PackJob* job=(PackJob*)context;
+	PackFile* f=&job->files[index];
+	if(f->sameAs>=0) return 0;
+	int result=ReadSource(f->entry->source, &f->data, &f->rawLength);
+	if(result) return result;
+	f->dataLength=f->rawLength;
+	f->outCompressed=false;
+	if(f->entry->compress) {
+		DWORD bound=zDeflateBound(f->rawLength);
+		BYTE* packed=(BYTE*)malloc(bound);
+		DWORD length=packed?zDeflate(f->data, f->rawLength, packed, bound, job->level):0;
+		//a ratio of 0 keeps the deflated data whatever its size
+		if(length&&(!job->ratio||(UINT64)length*100<(UINT64)f->rawLength*job->ratio)) {
+			free(f->data);
+			f->data=packed;
+			f->dataLength=length;
+			f->outCompressed=true;
+			InterlockedIncrement(&job->compressed);
+		} else free(packed);
+	}
+	return 0;
+}
+
+static int WriteEntry(PackJob* job, PackFile* f) {
+	if(f->sameAs>=0) {
+		const BsaFileRecord* shared=(const BsaFileRecord*)(job->directory+job->files[f->sameAs].recordOffset);
+		BsaFileRecord* record=(BsaFileRecord*)(job->directory+f->recordOffset);
+		record->size=shared->size;
+		record->offset=shared->offset;
+		job->saved+=shared->size&~BSA_SIZE_TOGGLE;
+		if(((shared->size&BSA_SIZE_TOGGLE)!=0)!=job->defaultCompressed) InterlockedIncrement(&job->compressed);
+		return 0;
+	}
+	DWORD length=(f->outCompressed?4:0)+f->dataLength;
+	if(job->outPos+length>0xffffffff||length>=BSA_SIZE_TOGGLE) return PACK_ERROR_SIZE;
+	BsaFileRecord* record=(BsaFileRecord*)(job->directory+f->recordOffset);
+	record->size=length|(f->outCompressed!=job->defaultCompressed?BSA_SIZE_TOGGLE:0);
+	record->offset=(DWORD)job->outPos;
+	job->outPos+=length;
+	if(f->outCompressed&&!WriteAll(job->out, &f->rawLength, 4)) return PACK_ERROR_WRITE;
+	return WriteAll(job->out, f->data, f->dataLength)?0:PACK_ERROR_WRITE;
+}
+
+static int WriteTask(int index, void* context) {
+	PackJob* job=(PackJob*)context;
+	PackFile* f=&job->files[index];
+	int result=WriteEntry(job, f);
+	free(f->data);
+	f->data=0;
+	return result;
+}
+
+struct DedupKey {
+	UINT64 hash;
+	UINT64 size;
+	DWORD compress;
+	int file;				//index into PackJob::files
+	bool hashed;
+};
+
+struct DedupJob {
+	PackFile* files;
+	DedupKey* keys;
+	int* candidates;		//files thought to share the contents of files[sameAs], to be confirmed
+	int candidateCount;
+};
+
+static void HashTask(int index, void* context) {
+	DedupJob* job=(DedupJob*)context;
+	DedupKey* key=&job->keys[index];
+	MappedFile map;
+	//files that can't be mapped, including empty ones, are left to be read normally
+	if(!MapFile(&map, job->files[key->file].entry->source)) return;
+	key->size=map.size;
+	key->hash=ContentHash(map.data, (SIZE_T)map.size, 0);
+	key->hashed=true;
+	UnmapFile(&map);
+}
+
+static void CompareTask(int index, void* context) {
+	DedupJob* job=(DedupJob*)context;
+	PackFile* f=&job->files[job->candidates[index]];
+	MappedFile a, b;
+	bool same=false;
+	if(MapFile(&a, job->files[f->sameAs].entry->source)) {
+		if(MapFile(&b, f->entry->source)) {
+			same=a.size==b.size&&!memcmp(a.data, b.data, (size_t)a.size);
+			UnmapFile(&b);
+		}
+		UnmapFile(&a);
+	}
+	if(!same) f->sameAs=-1;
+}
+
+static int CompareKeys(const void* a, const void* b) {
+	const DedupKey* x=(const DedupKey*)a;
+	const DedupKey* y=(const DedupKey*)b;
+	if(x->hashed!=y->hashed) return x->hashed?-1:1;
+	if(x->size!=y->size) return x->size<y->size?-1:1;
+	if(x->compress!=y->compress) return x->compress<y->compress?-1:1;
+	if(x->hash!=y->hash) return x->hash<y->hash?-1:1;
+	return x->file-y->file;
+}
+
+//Points every file at the first file in write order with the same contents and compression setting.
+//Contents are hashed on all cores, and files whose hashes match are compared in full before being shared.
+static bool FindDuplicates(PackFile* files, int count) {
+	DedupJob job;
+	job.files=files;
+	job.keys=(DedupKey*)calloc(count?count:1, sizeof(DedupKey));
+	job.candidates=(int*)malloc(sizeof(int)*(count?count:1));
+	job.candidateCount=0;
+	if(!job.keys||!job.candidates) {
+		free(job.keys);
+		free(job.candidates);
+		return false;
+	}
+	for(int i=0;i<count;i++) {
+		job.keys[i].file=i;
+		job.keys[i].compress=files[i].entry->compress?1:0;
+	}
+	ParallelFor(count, HashTask, &job);
+	qsort(job.keys, count, sizeof(DedupKey), CompareKeys);
+	for(int i=1;i<count&&job.keys[i].hashed;i++) {
+		DedupKey* first=&job.keys[i-1];
+		DedupKey* key=&job.keys[i];
+		if(key->size!=first->size||key->compress!=first->compress||key->hash!=first->hash) continue;
+		//runs of equal keys all share the lowest file, which is written first
+		int shared=files[first->file].sameAs>=0?files[first->file].sameAs:first->file;
+		files[key->file].sameAs=shared;
+		job.candidates[job.candidateCount++]=key->file;
+	}
+	ParallelFor(job.candidateCount, CompareTask, &job);
+	free(job.keys);
+	free(job.candidates);
+	return true;
+}
+
+//Picks the order file data is written in, as indices into entries. The directory is always in hash order, but
+//the data behind it can be in any order, so it is laid out to keep files that are read together close.
+static bool PayloadOrder(const BsaPackEntry* entries, int count, DWORD options, const BsaDirFile* sorted, int* payload) {
+	if(options&PACK_ENTRY_ORDER) {
+		for(int i=0;i<count;i++) payload[i]=i;
+		return true;
+	}
+	if(!(options&PACK_LOCALITY)) {
+		for(int i=0;i<count;i++) payload[i]=sorted[i].source;
+		return true;
+	}
+	const char** names=(const char**)malloc(sizeof(char*)*(count?count:1));
+	const char** sources=(const char**)malloc(sizeof(char*)*(count?count:1));
+	bool result=names&&sources;
+	if(result) {
+		for(int i=0;i<count;i++) {
+			names[i]=entries[i].name;
+			sources[i]=entries[i].source;
+		}
+		result=BsaLocalityOrder(names, sources, count, payload);
+	}
+	free(names);
+	free(sources);
+	return result;
+}
+
+//Builds a version 103 archive at outPath from count files. Folders and files are hashed and sorted here,
+//entries are read and deflated on all cores, and the data is streamed out behind a directory laid out up
+//front. A file marked for compression is deflated at level (0-9) and stored that way if that brings it under
+//ratio percent of its size. With PACK_DEDUPLICATE, files with identical contents share their stored data and
+//saved receives the number of bytes that sharing kept out of the archive. PACK_LOCALITY and PACK_ENTRY_ORDER
+//change the order the data is written in, to cut seeking when the game loads related files.
+int _stdcall bsaPack(const char* outPath, const BsaPackEntry* entries, int count, DWORD archiveFlags, DWORD fileFlags, DWORD ratio, int level, DWORD options, UINT64* saved, PackProgress progress) {
+	if(saved) *saved=0;
+	if(count<0) return PACK_ERROR_SIZE;
+	PackFile* files=(PackFile*)calloc(count?count:1, sizeof(PackFile));
+	BsaDirFile* order=(BsaDirFile*)malloc(sizeof(BsaDirFile)*(count?count:1));
+	int* payload=(int*)malloc(sizeof(int)*(count?count:1));
+	DWORD* records=(DWORD*)malloc(sizeof(DWORD)*(count?count:1));
+	if(!files||!order||!payload||!records) {
+		free(files);
+		free(order);
+		free(payload);
+		free(records);
+		return PACK_ERROR_WRITE;
+	}
+	for(int i=0;i<count;i++) BsaSetDirFile(&order[i], entries[i].name, i);
+	BsaSortDirFiles(order, count);
+
+	PackJob job;
+	job.directory=0;
+	DWORD dataStart=BsaBuildDirectory(order, count, archiveFlags, fileFlags, &job.directory);
+	for(int i=0;i<count;i++) records[order[i].source]=order[i].recordOffset;
+	bool ordered=dataStart&&PayloadOrder(entries, count, options, order, payload);
+	free(order);
+	for(int i=0;ordered&&i<count;i++) {
+		files[i].entry=&entries[payload[i]];
+		files[i].recordOffset=records[payload[i]];
+		files[i].sameAs=-1;
+	}
+	free(payload);
+	free(records);
+	if(!ordered) {
+		free(job.directory);
+		free(files);
+		return dataStart?PACK_ERROR_WRITE:PACK_ERROR_SIZE;
+	}
+	if((options&PACK_DEDUPLICATE)&&!FindDuplicates(files, count)) {
+		free(job.directory);
+		free(files);
+		return PACK_ERROR_WRITE;
+	}
+	job.files=files;
+	job.count=count;
+	job.ratio=ratio;
+	job.level=level;
+	job.outPos=dataStart;
+	job.defaultCompressed=(archiveFlags&BSA_FLAG_COMPRESSED)!=0;
+	job.saved=0;
+	job.compressed=0;
+	job.out=CreateFileA(outPath, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	if(job.out==INVALID_HANDLE_VALUE) {
+		free(job.directory);
+		free(files);
+		return PACK_ERROR_WRITE;
+	}
+
+	//Reserve the directory, stream the data behind it in order, then fill in the records in one go
+	LARGE_INTEGER seek;
+	seek.QuadPart=dataStart;
+	int error=SetFilePointerEx(job.out, seek, 0, FILE_BEGIN)?0:PACK_ERROR_WRITE;
+	if(!error) error=OrderedFor(job.count, PACK_WINDOW, ProcessTask, WriteTask, progress, &job, PACK_ERROR_WRITE);
+	if(!error) {
+		seek.QuadPart=0;
+		if(!SetFilePointerEx(job.out, seek, 0, FILE_BEGIN)||!WriteAll(job.out, job.directory, dataStart)) error=PACK_ERROR_WRITE;
+	}
+	for(int i=0;i<job.count;i++) free(files[i].data);
+
+	CloseHandle(job.out);
+	if(error) DeleteFileA(outPath);
+	free(job.directory);
+	free(files);
+	if(saved&&!error) *saved=job.saved;
+	return error?error:job.compressed;
+}
@@ -0,0 +1,194 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bsaHash.h"
+#include "bsaReader.h"
+#include "zlibCodec.h"
+
+static void FreeArchive(BsaArchive* bsa) {
+	free(bsa->folderFirst);
+	free(bsa->folderName);
+	free(bsa->files);
+	UnmapFile(&bsa->file);
+	free(bsa);
+}
+
+//Records where every folder and file lives, checking the directory stays within the file
+static bool ReadDirectory(BsaArchive* bsa) {
+	const BsaHeader* header=bsa->header;
+	const BYTE* base=bsa->file.data;
+	UINT64 size=bsa->file.size;
+	UINT64 pos=header->folderRecordOffset+(UINT64)header->folderCount*sizeof(BsaFolderRecord);
+	if(pos>size) return false;
+	bsa->folders=(const BsaFolderRecord*)(base+header->folderRecordOffset);
+	bsa->sorted=true;
+
+	DWORD file=0;
+	for(DWORD i=0;i<header->folderCount;i++) {
+		if(i&&bsa->folders[i].hash<=bsa->folders[i-1].hash) bsa->sorted=false;
+		bsa->folderFirst[i]=file;
+		bsa->folderName[i]=0;
+		if(header->archiveFlags&BSA_FLAG_FOLDERNAMES) {
+			if(pos>=size) return false;
+			DWORD len=base[pos];
+			if(!len||pos+1+len>size) return false;
+			bsa->folderName[i]=(DWORD)pos;
+			pos+=1+len;
+		}
+		DWORD count=bsa->folders[i].count;
+		if(count>header->fileCount-file||pos+(UINT64)count*sizeof(BsaFileRecord)>size) return false;
+		for(DWORD j=0;j<count;j++,file++) {
+			const BsaFileRecord* record=(const BsaFileRecord*)(base+pos);
+			if(j&&record->hash<=record[-1].hash) bsa->sorted=false;
+			bsa->files[file].record=(DWORD)pos;
+			bsa->files[file].name=0;
+			bsa->files[file].folder=i;
+			pos+=sizeof(BsaFileRecord);
+		}
+	}
+	if(file!=header->fileCount) return false;
+	bsa->folderFirst[header->folderCount]=file;
+
+	if(header->archiveFlags&BSA_FLAG_FILENAMES) {
+		for(DWORD i=0;i<header->fileCount;i++) {
+			const char* name=(const char*)base+pos;
+			const char* end=(const char*)memchr(name, 0, (size_t)(size-pos));
+			if(!end) return false;
+			bsa->files[i].name=(DWORD)pos;
+			pos+=end-name+1;
+		}
+	}
+	return true;
+}
+
+BsaArchive* _stdcall bsaOpen(const char* path) {
+	BsaArchive* bsa=(BsaArchive*)calloc(1, sizeof(BsaArchive));
+	if(!bsa) return 0;
+	if(!MapFile(&bsa->file, path)) {
+		free(bsa);
+		return 0;
+	}
+	const BsaHeader* header=(const BsaHeader*)bsa->file.data;
+	if(bsa->file.size<sizeof(BsaHeader)||header->magic!=BSA_MAGIC||
+		(header->version!=BSA_VERSION_103&&header->version!=BSA_VERSION_104)||
+		header->folderCount>bsa->file.size/sizeof(BsaFolderRecord)||header->fileCount>bsa->file.size/sizeof(BsaFileRecord)) {
+		FreeArchive(bsa);
+		return 0;
+	}
+	bsa->header=header;
+	bsa->defaultCompressed=(header->archiveFlags&BSA_FLAG_COMPRESSED)!=0;
+	bsa->embedNames=header->version==BSA_VERSION_104&&(header->archiveFlags&BSA_FLAG_EMBEDNAMES);
+	bsa->folderFirst=(DWORD*)malloc(sizeof(DWORD)*((SIZE_T)header->folderCount+1));
+	bsa->folderName=(DWORD*)malloc(sizeof(DWORD)*((SIZE_T)header->folderCount+1));
+	bsa->files=(BsaSlot*)malloc(sizeof(BsaSlot)*((SIZE_T)header->fileCount+1));
+	if(!bsa->folderFirst||!bsa->folderName||!bsa->files||!ReadDirectory(bsa)) {
+		FreeArchive(bsa);
+		return 0;
+	}
+	return bsa;
+}
+
+void _stdcall bsaClose(BsaArchive* bsa) {
+	if(bsa) FreeArchive(bsa);
+}
+
+int _stdcall bsaFileCount(BsaArchive* bsa) {
+	return bsa->header->fileCount;
+}
+
+bool BsaGetEntry(const BsaArchive* bsa, DWORD index, BsaEntry* entry) {
+	if(index>=bsa->header->fileCount) return false;
+	const BsaFileRecord* record=(const BsaFileRecord*)(bsa->file.data+bsa->files[index].record);
+	UINT64 start=record->offset;
+	UINT64 length=record->size&(BSA_SIZE_TOGGLE-1);
+	if(start+length>bsa->file.size) return false;
+	if(bsa->embedNames) {
+		if(!length) return false;
+		DWORD skip=bsa->file.data[start]+1;
+		if(skip>length) return false;
+		start+=skip;
+		length-=skip;
+	}
+	entry->hash=record->hash;
+	entry->compressed=bsa->defaultCompressed!=((record->size&BSA_SIZE_TOGGLE)!=0);
+	entry->data=bsa->file.data+start;
+	entry->storedSize=(DWORD)length;
+	entry->size=(DWORD)length;
+	if(entry->compressed) {
+		if(length<4) return false;
+		entry->size=*(const DWORD*)entry->data;
+		entry->data+=4;
+		entry->storedSize-=4;
+	}
+	return true;
+}
+
+//Index of the first record in [first, first+count) of the array at base with the given hash, or -1
+template<class T> static int Search(const T* base, DWORD first, DWORD count, UINT64 hash, bool sorted) {
+	if(!sorted) {
+		for(DWORD i=first;i<first+count;i++) if(base[i].hash==hash) return i;
+		return -1;
+	}
+	DWORD lo=first, hi=first+count;
+	while(lo<hi) {
+		DWORD mid=lo+(hi-lo)/2;
+		if(base[mid].hash<hash) lo=mid+1;
+		else hi=mid;
+	}
+	return lo<first+count&&base[lo].hash==hash?(int)lo:-1;
+}
+
+int _stdcall bsaFind(BsaArchive* bsa, const char* path) {
+	DWORD length=(DWORD)strlen(path);
+	DWORD slash=length;
+	while(slash>0&&path[slash-1]!='\\'&&path[slash-1]!='/') slash--;
+	DWORD folderLength=slash?slash-1:0;
+	int folder=Search(bsa->folders, 0, bsa->header->folderCount, BsaHashFolder(path, folderLength), bsa->sorted);
+	if(folder<0) return -1;
+	//the records of a folder's files sit back to back, so they can be searched in place
+	DWORD first=bsa->folderFirst[folder];
+	if(first==bsa->folderFirst[folder+1]) return -1;
+	const BsaFileRecord* records=(const BsaFileRecord*)(bsa->file.data+bsa->files[first].record);
+	int file=Search(records, 0, bsa->folderFirst[folder+1]-first, BsaHashFile(path+slash, length-slash), bsa->sorted);
+	return file<0?-1:(int)first+file;
+}
+
+BOOL _stdcall bsaFileInfo(BsaArchive* bsa, int index, BsaEntry* entry) {
+	return index>=0&&BsaGetEntry(bsa, index, entry);
+}
+
+const BYTE* _stdcall bsaView(BsaArchive* bsa, int index, DWORD* length) {
+	BsaEntry entry;
+	if(index<0||!BsaGetEntry(bsa, index, &entry)||entry.compressed) return 0;
+	*length=entry.size;
+	return entry.data;
+}
+
+BOOL _stdcall bsaRead(BsaArchive* bsa, int index, BYTE* dest, DWORD length) {
+	BsaEntry entry;
+	if(index<0||!BsaGetEntry(bsa, index, &entry)||length<entry.size) return FALSE;
+	if(!entry.compressed) {
+		memcpy(dest, entry.data, entry.size);
+		return TRUE;
+	}
+	return zInflate(entry.data, entry.storedSize, dest, entry.size);
+}
+
+int _stdcall bsaFileName(BsaArchive* bsa, int index, char* buffer, int length) {
+	if(index<0||(DWORD)index>=bsa->header->fileCount) return -1;
+	const BsaSlot* slot=&bsa->files[index];
+	DWORD folderPos=bsa->folderName[slot->folder];
+	if(!slot->name||!folderPos) return -1;
+	//folder names are stored with their terminator included in the length
+	const char* folder=(const char*)bsa->file.data+folderPos+1;
+	DWORD folderLength=(DWORD)strnlen(folder, bsa->file.data[folderPos]);
+	const char* name=(const char*)bsa->file.data+slot->name;
+	DWORD nameLength=(DWORD)strlen(name);
+	DWORD total=folderLength+1+nameLength;
+	if(total+1>(DWORD)length) return -1;
+	memcpy(buffer, folder, folderLength);
+	buffer[folderLength]='\\';
+	memcpy(buffer+folderLength+1, name, nameLength+1);
+	return total;
+}
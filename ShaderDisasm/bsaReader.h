@@ -0,0 +1,50 @@
+#pragma once
+
+#include "bsaFormat.h"
+#include "mappedFile.h"
+
+//A read only archive kept mapped for as long as it is open. The directory is used where it lies on disk, and
+//since folders and the files within each folder are stored sorted by hash, lookups are binary searches. Opening
+//only records where each folder and file lives. Every call is safe from any thread once bsaOpen has returned.
+
+struct BsaSlot {
+	DWORD record;		//offset of the file record
+	DWORD name;			//offset of the file name, or 0 if the archive has no names
+	DWORD folder;
+};
+
+struct BsaArchive {
+	MappedFile file;
+	const BsaHeader* header;
+	const BsaFolderRecord* folders;
+	DWORD* folderFirst;		//index of each folder's first file, plus the file count at the end
+	DWORD* folderName;		//offset of each folder's name bstring, or 0 if the archive has no folder names
+	BsaSlot* files;
+	bool sorted;			//false if the hashes aren't in order, in which case lookups scan
+	bool embedNames;
+	bool defaultCompressed;
+};
+
+struct BsaEntry {
+	UINT64 hash;
+	const BYTE* data;		//the stored bytes, past any embedded name and the size of compressed files
+	DWORD storedSize;
+	DWORD size;				//size once decompressed
+	DWORD compressed;
+};
+
+//Fills entry for the file at index, checking its data lies within the archive
+bool BsaGetEntry(const BsaArchive* bsa, DWORD index, BsaEntry* entry);
+
+BsaArchive* _stdcall bsaOpen(const char* path);
+void _stdcall bsaClose(BsaArchive* bsa);
+int _stdcall bsaFileCount(BsaArchive* bsa);
+//Returns the index of the file with the given path, or -1
+int _stdcall bsaFind(BsaArchive* bsa, const char* path);
+BOOL _stdcall bsaFileInfo(BsaArchive* bsa, int index, BsaEntry* entry);
+//Points straight at the bytes of an uncompressed file, which stay valid until bsaClose. Returns 0 for compressed files.
+const BYTE* _stdcall bsaView(BsaArchive* bsa, int index, DWORD* length);
+//Copies or inflates a file into dest, which must hold at least the file's size
+BOOL _stdcall bsaRead(BsaArchive* bsa, int index, BYTE* dest, DWORD length);
+//Writes "folder\\name" into buffer, returning its length, or -1 if the archive has no names or buffer is too small
+int _stdcall bsaFileName(BsaArchive* bsa, int index, char* buffer, int length);
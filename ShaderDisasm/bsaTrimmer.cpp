@@ -0,0 +1,255 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bsaFormat.h"
+#include "ddsFormat.h"
+#include "fileUtil.h"
+#include "mappedFile.h"
+#include "orderedWriter.h"
+#include "zlibCodec.h"
+
+//TrimBsa options
+#define TRIM_SHRINK_TEXTURES 1
+#define TRIM_COMPRESS 2
+
+//TrimBsa errors. Success returns the number of textures that were shrunk.
+#define TRIM_ERROR_OPEN -1
+#define TRIM_ERROR_FORMAT -2
+#define TRIM_ERROR_DATA -3
+#define TRIM_ERROR_WRITE -4
+
+//Files allowed to be in flight per worker ahead of the one being written
+#define TRIM_WINDOW 4
+
+typedef void (_stdcall *TrimProgress)(int done, int total);
+
+struct TrimFile {
+	const BYTE* name;		//embedded bstring, or 0
+	const BYTE* source;
+	DWORD sourceLength;
+	DWORD recordOffset;
+	bool compressed;
+	bool shrink;
+
+	//filled in by the worker
+	bool outCompressed;
+	DWORD rawLength;
+	DdsHeader header;
+	bool hasHeader;
+	const BYTE* body;
+	DWORD bodyLength;
+	BYTE* owned[2];
+};
+
+struct TrimJob {
+	TrimFile* files;
+	int count;
+	DWORD options;
+	HANDLE out;
+	BYTE* directory;
+	UINT64 outPos;
+	bool outCompressed;
+	volatile LONG shrunk;
+};
+
+static void ReleaseFile(TrimFile* f) {
+	free(f->owned[0]);
+	free(f->owned[1]);
+	f->owned[0]=0;
+	f->owned[1]=0;
+}
+
+static bool ProcessFile(TrimJob* job, TrimFile* f) {
+	const BYTE* raw=f->source;
+	DWORD rawLength=f->sourceLength;
+	if(f->compressed) {
+		if(f->sourceLength<4) return false;
+		rawLength=*(const DWORD*)f->source;
+		f->owned[0]=(BYTE*)malloc(rawLength?rawLength:1);
+		if(!f->owned[0]||!zInflate(f->source+4, f->sourceLength-4, f->owned[0], rawLength)) return false;
+		raw=f->owned[0];
+	}
+	f->hasHeader=f->shrink&&ddsStripTopMip(raw, rawLength, &f->header, &f->body, &f->bodyLength);
+	if(f->hasHeader) {
+		InterlockedIncrement(&job->shrunk);
+		rawLength=sizeof(DdsHeader)+f->bodyLength;
+	} else {
+		f->body=raw;
+		f->bodyLength=rawLength;
+	}
+	f->rawLength=rawLength;
+	f->outCompressed=false;
+	if(job->options&TRIM_COMPRESS) {
+		const BYTE* in=f->body;
+		BYTE* joined=0;
+		if(f->hasHeader) {
+			joined=(BYTE*)malloc(rawLength);
+			if(!joined) return false;
+			memcpy(joined, &f->header, sizeof(DdsHeader));
+			memcpy(joined+sizeof(DdsHeader), f->body, f->bodyLength);
+			in=joined;
+		}
+		DWORD bound=zDeflateBound(rawLength);
+		f->owned[1]=(BYTE*)malloc(bound);
+		DWORD packed=f->owned[1]?zDeflate(in, rawLength, f->owned[1], bound, Z_LEVEL_DEFAULT):0;
+		free(joined);
+		if(packed&&packed+4<rawLength) {
+			f->hasHeader=false;
+			f->body=f->owned[1];
+			f->bodyLength=packed;
+			f->outCompressed=true;
+		} else {
+			free(f->owned[1]);
+			f->owned[1]=0;
+		}
+	}
+	return true;
+}
+
+static bool WriteEntry(TrimJob* job, TrimFile* f) {
+	DWORD nameLength=f->name?f->name[0]+1:0;
+	DWORD length=nameLength+(f->outCompressed?4:0)+(f->hasHeader?sizeof(DdsHeader):0)+f->bodyLength;
+	if(job->outPos+length>0xffffffff||length>=BSA_SIZE_TOGGLE) return false;
+	BsaFileRecord* record=(BsaFileRecord*)(job->directory+f->recordOffset);
+	record->size=length|(f->outCompressed!=job->outCompressed?BSA_SIZE_TOGGLE:0);
+	record->offset=(DWORD)job->outPos;
+	job->outPos+=length;
+	if(nameLength&&!WriteAll(job->out, f->name, nameLength)) return false;
+	if(f->outCompressed&&!WriteAll(job->out, &f->rawLength, 4)) return false;
+	if(f->hasHeader&&!WriteAll(job->out, &f->header, sizeof(DdsHeader))) return false;
+	return WriteAll(job->out, f->body, f->bodyLength);
+}
+
+static int ProcessTask(int index, void* context) {
+	TrimJob* job=(TrimJob*)context;
+	return ProcessFile(job, &job->files[index])?0:TRIM_ERROR_DATA;
+}
+
+static int WriteTask(int index, void* context) {
+	TrimJob* job=(TrimJob*)context;
+	TrimFile* f=&job->files[index];
+	bool written=WriteEntry(job, f);
+	ReleaseFile(f);
+	return written?0:TRIM_ERROR_WRITE;
+}
+
+//Walks the directory, filling in a TrimFile for each entry. Returns the offset of the first byte after
+//the directory, or 0 if the archive is malformed.
+static DWORD ReadDirectory(const MappedFile* in, const BsaHeader* header, TrimFile* files, DWORD options) {
+	const BYTE* base=in->data;
+	UINT64 size=in->size;
+	UINT64 pos=header->folderRecordOffset+(UINT64)header->folderCount*sizeof(BsaFolderRecord);
+	const BsaFolderRecord* folders=(const BsaFolderRecord*)(base+header->folderRecordOffset);
+	bool defaultCompressed=(header->archiveFlags&BSA_FLAG_COMPRESSED)!=0;
+	bool embedNames=header->version==BSA_VERSION_104&&(header->archiveFlags&BSA_FLAG_EMBEDNAMES);
+	if(pos>size) return 0;
+
+	DWORD file=0;
+	for(DWORD i=0;i<header->folderCount;i++) {
+		bool shrink=(options&TRIM_SHRINK_TEXTURES)!=0;
+		if(header->archiveFlags&BSA_FLAG_FOLDERNAMES) {
+			if(pos>=size) return 0;
+			DWORD len=base[pos];
+			if(pos+1+len>size) return 0;
+			if(len>19&&!_strnicmp((const char*)base+pos+1, "textures\\interface\\", 19)) shrink=false;
+			pos+=1+len;
+		}
+		DWORD count=folders[i].count;
+		if(count>header->fileCount-file||pos+(UINT64)count*sizeof(BsaFileRecord)>size) return 0;
+		for(DWORD j=0;j<count;j++,file++) {
+			const BsaFileRecord* record=(const BsaFileRecord*)(base+pos);
+			TrimFile* f=&files[file];
+			memset(f, 0, sizeof(TrimFile));
+			f->recordOffset=(DWORD)pos;
+			f->shrink=shrink;
+			f->compressed=defaultCompressed!=((record->size&BSA_SIZE_TOGGLE)!=0);
+			UINT64 start=record->offset;
+			UINT64 length=record->size&(BSA_SIZE_TOGGLE-1);
+			if(start+length>size) return 0;
+			if(embedNames) {
+				if(!length||base[start]+1u>length) return 0;
+				f->name=base+start;
+				length-=base[start]+1;
+				start+=base[start]+1;
+			}
+			f->source=base+start;
+			f->sourceLength=(DWORD)length;
+			pos+=sizeof(BsaFileRecord);
+		}
+	}
+	if(file!=header->fileCount) return 0;
+
+	if(header->archiveFlags&BSA_FLAG_FILENAMES) {
+		for(DWORD i=0;i<header->fileCount;i++) {
+			const char* name=(const char*)base+pos;
+			const char* end=(const char*)memchr(name, 0, (size_t)(size-pos));
+			if(!end) return 0;
+			DWORD len=(DWORD)(end-name);
+			if(len<4||_stricmp(end-4, ".dds")) files[i].shrink=false;
+			pos+=len+1;
+		}
+	} else {
+		//can't tell which entries are textures
+		for(DWORD i=0;i<header->fileCount;i++) files[i].shrink=false;
+	}
+	return (DWORD)pos;
+}
+
+int _stdcall TrimBsa(const char* inPath, const char* outPath, DWORD options, TrimProgress progress) {
+	MappedFile in;
+	if(!MapFile(&in, inPath)) return TRIM_ERROR_OPEN;
+	const BsaHeader* inHeader=(const BsaHeader*)in.data;
+	if(in.size<sizeof(BsaHeader)||inHeader->magic!=BSA_MAGIC||
+		(inHeader->version!=BSA_VERSION_103&&inHeader->version!=BSA_VERSION_104)||inHeader->fileCount>0x7fffffff) {
+		UnmapFile(&in);
+		return TRIM_ERROR_FORMAT;
+	}
+
+	TrimFile* files=(TrimFile*)calloc(inHeader->fileCount?inHeader->fileCount:1, sizeof(TrimFile));
+	DWORD dataStart=files?ReadDirectory(&in, inHeader, files, options):0;
+	if(!dataStart) {
+		free(files);
+		UnmapFile(&in);
+		return TRIM_ERROR_FORMAT;
+	}
+
+	TrimJob job;
+	job.files=files;
+	job.count=inHeader->fileCount;
+	job.options=options;
+	job.outPos=dataStart;
+	job.outCompressed=(options&TRIM_COMPRESS)!=0;
+	job.shrunk=0;
+	job.directory=(BYTE*)malloc(dataStart);
+	job.out=CreateFileA(outPath, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	if(!job.directory||job.out==INVALID_HANDLE_VALUE) {
+		if(job.out!=INVALID_HANDLE_VALUE) CloseHandle(job.out);
+		free(job.directory);
+		free(files);
+		UnmapFile(&in);
+		return TRIM_ERROR_WRITE;
+	}
+	memcpy(job.directory, in.data, dataStart);
+	BsaHeader* outHeader=(BsaHeader*)job.directory;
+	if(job.outCompressed) outHeader->archiveFlags|=BSA_FLAG_COMPRESSED;
+	else outHeader->archiveFlags&=~BSA_FLAG_COMPRESSED;
+
+	//Reserve the directory, stream the data behind it in order, then fill in the records in one go
+	LARGE_INTEGER seek;
+	seek.QuadPart=dataStart;
+	int error=SetFilePointerEx(job.out, seek, 0, FILE_BEGIN)?0:TRIM_ERROR_WRITE;
+	if(!error) error=OrderedFor(job.count, TRIM_WINDOW, ProcessTask, WriteTask, progress, &job, TRIM_ERROR_WRITE);
+	if(!error) {
+		seek.QuadPart=0;
+		if(!SetFilePointerEx(job.out, seek, 0, FILE_BEGIN)||!WriteAll(job.out, job.directory, dataStart)) error=TRIM_ERROR_WRITE;
+	}
+	for(int i=0;i<job.count;i++) ReleaseFile(&files[i]);
+
+	CloseHandle(job.out);
+	if(error) DeleteFileA(outPath);
+	free(job.directory);
+	free(files);
+	UnmapFile(&in);
+	return error?error:job.shrunk;
+}
@@ -0,0 +1,359 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bsaDirectory.h"
+#include "bsaHash.h"
+#include "fileUtil.h"
+#include "mappedFile.h"
+#include "workerPool.h"
+#include "zlibCodec.h"
+
+//bsaValidate problem kinds
+#define BSA_PROBLEM_HEADER 1			//not a supported archive, or header counts that don't match the directory
+#define BSA_PROBLEM_DIRECTORY 2			//the directory runs past the end of the file, so nothing after it is checked
+#define BSA_PROBLEM_NAME_LENGTHS 3		//the header's folder or file name totals are wrong
+#define BSA_PROBLEM_FOLDER_ORDER 4
+#define BSA_PROBLEM_FILE_ORDER 5
+#define BSA_PROBLEM_FOLDER_HASH 6		//a folder's hash doesn't match its name
+#define BSA_PROBLEM_FILE_HASH 7
+#define BSA_PROBLEM_FOLDER_OFFSET 8		//a folder record doesn't point at its file records
+#define BSA_PROBLEM_BOUNDS 9			//a file's data lies outside the archive
+#define BSA_PROBLEM_DATA 10				//compressed data that doesn't inflate to its stated size
+
+//bsaValidate and bsaRepair options
+#define VALIDATE_DATA 1					//inflate every compressed file
+
+//bsaValidate returns this if the file can't be opened
+#define VALIDATE_ERROR_READ -1
+
+//bsaRepair errors. Success returns the number of files left out.
+#define REPAIR_ERROR_READ -1
+#define REPAIR_ERROR_WRITE -2
+#define REPAIR_ERROR_NAMES -3			//the archive lacks the folder or file names the directory is rebuilt from
+#define REPAIR_ERROR_DIRECTORY -4		//the directory is cut short
+#define REPAIR_ERROR_SIZE -5
+
+//deflate can't grow data by more than this, so a larger stated size means the size is damaged
+#define INFLATE_RATIO_LIMIT 1032
+
+struct BsaProblem {
+	DWORD kind;
+	int folder;			//index of the folder involved, or -1
+	int file;			//index of the file involved, in directory order, or -1
+};
+
+//Where each folder and file of a possibly damaged archive lies. Nothing is assumed about the directory
+//beyond each piece being within the file.
+struct ScanFile {
+	DWORD record;
+	DWORD name;			//offset of the file name, or 0
+	int folder;
+	bool inBounds;
+	bool damaged;
+};
+
+struct Scan {
+	MappedFile map;
+	const BsaHeader* header;
+	DWORD* folderName;		//offset of each folder's name bstring, or 0
+	ScanFile* files;
+	DWORD fileCount;		//files actually found
+	bool complete;			//the whole directory was read
+	bool defaultCompressed;
+	bool embedNames;
+
+	BsaProblem* problems;
+	int length;
+	int count;
+};
+
+static void Report(Scan* scan, DWORD kind, int folder, int file) {
+	if(scan->count<scan->length) {
+		BsaProblem* p=&scan->problems[scan->count];
+		p->kind=kind;
+		p->folder=folder;
+		p->file=file;
+	}
+	scan->count++;
+}
+
+static void FreeScan(Scan* scan) {
+	free(scan->folderName);
+	free(scan->files);
+	UnmapFile(&scan->map);
+}
+
+//Works out where a file's stored data starts and how long it is, past any embedded name
+static bool StoredData(const Scan* scan, const ScanFile* f, UINT64* start, DWORD* length) {
+	const BsaFileRecord* record=(const BsaFileRecord*)(scan->map.data+f->record);
+	UINT64 pos=record->offset;
+	DWORD size=record->size&(BSA_SIZE_TOGGLE-1);
+	if(pos+size>scan->map.size) return false;
+	if(scan->embedNames) {
+		DWORD skip=size?scan->map.data[pos]+1:0;
+		if(!size||skip>size) return false;
+		pos+=skip;
+		size-=skip;
+	}
+	bool compressed=scan->defaultCompressed!=((record->size&BSA_SIZE_TOGGLE)!=0);
+	if(compressed&&size<4) return false;
+	*start=pos;
+	*length=size;
+	return true;
+}
+
+static bool IsCompressed(const Scan* scan, const ScanFile* f) {
+	const BsaFileRecord* record=(const BsaFileRecord*)(scan->map.data+f->record);
+	return scan->defaultCompressed!=((record->size&BSA_SIZE_TOGGLE)!=0);
+}
+
+//Walks the directory, reporting whatever doesn't add up. Stops early only where the rest can't be located.
+static void ScanDirectory(Scan* scan) {
+	const BsaHeader* header=scan->header;
+	const BYTE* base=scan->map.data;
+	UINT64 size=scan->map.size;
+	UINT64 pos=header->folderRecordOffset+(UINT64)header->folderCount*sizeof(BsaFolderRecord);
+	if(header->folderRecordOffset!=sizeof(BsaHeader)) Report(scan, BSA_PROBLEM_HEADER, -1, -1);
+	if(pos>size||(UINT64)header->fileCount*sizeof(BsaFileRecord)>size) {
+		Report(scan, BSA_PROBLEM_DIRECTORY, -1, -1);
+		return;
+	}
+	const BsaFolderRecord* folders=(const BsaFolderRecord*)(base+header->folderRecordOffset);
+	bool folderNames=(header->archiveFlags&BSA_FLAG_FOLDERNAMES)!=0;
+	bool fileNames=(header->archiveFlags&BSA_FLAG_FILENAMES)!=0;
+	UINT64 folderNameTotal=0;
+
+	DWORD file=0;
+	for(DWORD i=0;i<header->folderCount;i++) {
+		if(i&&folders[i].hash<=folders[i-1].hash) Report(scan, BSA_PROBLEM_FOLDER_ORDER, i, -1);
+		//the engine finds a folder's records by taking the file name block back off its offset
+		if((UINT64)folders[i].offset-header->totalFileNameLength!=pos) Report(scan, BSA_PROBLEM_FOLDER_OFFSET, i, -1);
+		if(folderNames) {
+			if(pos>=size) {
+				Report(scan, BSA_PROBLEM_DIRECTORY, i, -1);
+				return;
+			}
+			DWORD len=base[pos];
+			if(!len||pos+1+len>size) {
+				Report(scan, BSA_PROBLEM_DIRECTORY, i, -1);
+				return;
+			}
+			scan->folderName[i]=(DWORD)pos;
+			const char* name=(const char*)base+pos+1;
+			if(BsaHashFolder(name, (DWORD)strnlen(name, len))!=folders[i].hash) Report(scan, BSA_PROBLEM_FOLDER_HASH, i, -1);
+			folderNameTotal+=len;
+			pos+=1+len;
+		}
+		DWORD count=folders[i].count;
+		if(count>header->fileCount-file||pos+(UINT64)count*sizeof(BsaFileRecord)>size) {
+			Report(scan, count>header->fileCount-file?BSA_PROBLEM_HEADER:BSA_PROBLEM_DIRECTORY, i, -1);
+			return;
+		}
+		for(DWORD j=0;j<count;j++,file++) {
+			const BsaFileRecord* record=(const BsaFileRecord*)(base+pos);
+			if(j&&record->hash<=record[-1].hash) Report(scan, BSA_PROBLEM_FILE_ORDER, i, file);
+			scan->files[file].record=(DWORD)pos;
+			scan->files[file].folder=i;
+			pos+=sizeof(BsaFileRecord);
+		}
+		scan->fileCount=file;
+	}
+	if(file!=header->fileCount) Report(scan, BSA_PROBLEM_HEADER, -1, -1);
+	if(folderNames&&folderNameTotal!=header->totalFolderNameLength) Report(scan, BSA_PROBLEM_NAME_LENGTHS, -1, -1);
+
+	if(fileNames) {
+		UINT64 fileNameTotal=0;
+		for(DWORD i=0;i<file;i++) {
+			const char* name=(const char*)base+pos;
+			const char* end=pos<size?(const char*)memchr(name, 0, (size_t)(size-pos)):0;
+			if(!end) {
+				Report(scan, BSA_PROBLEM_DIRECTORY, -1, i);
+				return;
+			}
+			DWORD length=(DWORD)(end-name);
+			scan->files[i].name=(DWORD)pos;
+			const BsaFileRecord* record=(const BsaFileRecord*)(base+scan->files[i].record);
+			if(BsaHashFile(name, length)!=record->hash) Report(scan, BSA_PROBLEM_FILE_HASH, scan->files[i].folder, i);
+			fileNameTotal+=length+1;
+			pos+=length+1;
+		}
+		if(fileNameTotal!=header->totalFileNameLength) Report(scan, BSA_PROBLEM_NAME_LENGTHS, -1, -1);
+	}
+	scan->complete=true;
+}
+
+static void CheckTask(int index, void* context) {
+	Scan* scan=(Scan*)context;
+	ScanFile* f=&scan->files[index];
+	UINT64 start;
+	DWORD length;
+	if(!f->inBounds||!IsCompressed(scan, f)||!StoredData(scan, f, &start, &length)) return;
+	DWORD size=*(const DWORD*)(scan->map.data+start);
+	//compressed files are meant to be small enough for the 30 bit size field too
+	if(size>=BSA_SIZE_TOGGLE||size>(UINT64)(length-4)*INFLATE_RATIO_LIMIT+64) {
+		f->damaged=true;
+		return;
+	}
+	BYTE* out=(BYTE*)malloc(size?size:1);
+	if(!out) {
+		f->damaged=true;
+		return;
+	}
+	f->damaged=!zInflate(scan->map.data+start+4, length-4, out, size);
+	free(out);
+}
+
+//Opens and checks an archive, leaving the scan ready for bsaRepair. Returns false if the file couldn't be read.
+static bool OpenScan(Scan* scan, const char* path, DWORD options, BsaProblem* problems, int length) {
+	memset(scan, 0, sizeof(Scan));
+	scan->problems=problems;
+	scan->length=problems?length:0;
+	if(!MapFile(&scan->map, path)) return false;
+	const BsaHeader* header=(const BsaHeader*)scan->map.data;
+	if(scan->map.size<sizeof(BsaHeader)||header->magic!=BSA_MAGIC||
+		(header->version!=BSA_VERSION_103&&header->version!=BSA_VERSION_104)) {
+		Report(scan, BSA_PROBLEM_HEADER, -1, -1);
+		return true;
+	}
+	scan->header=header;
+	scan->defaultCompressed=(header->archiveFlags&BSA_FLAG_COMPRESSED)!=0;
+	scan->embedNames=header->version==BSA_VERSION_104&&(header->archiveFlags&BSA_FLAG_EMBEDNAMES);
+	//counts too big for the file can't be real, and would only waste memory
+	if(header->folderCount>scan->map.size/sizeof(BsaFolderRecord)||header->fileCount>scan->map.size/sizeof(BsaFileRecord)) {
+		Report(scan, BSA_PROBLEM_DIRECTORY, -1, -1);
+		return true;
+	}
+	scan->folderName=(DWORD*)calloc(header->folderCount+1, sizeof(DWORD));
+	scan->files=(ScanFile*)calloc(header->fileCount+1, sizeof(ScanFile));
+	if(!scan->folderName||!scan->files) {
+		FreeScan(scan);
+		return false;
+	}
+	ScanDirectory(scan);
+
+	for(DWORD i=0;i<scan->fileCount;i++) {
+		UINT64 start;
+		DWORD size;
+		scan->files[i].inBounds=StoredData(scan, &scan->files[i], &start, &size);
+		if(!scan->files[i].inBounds) Report(scan, BSA_PROBLEM_BOUNDS, scan->files[i].folder, i);
+	}
+	if(options&VALIDATE_DATA) {
+		ParallelFor(scan->fileCount, CheckTask, scan);
+		for(DWORD i=0;i<scan->fileCount;i++) {
+			if(scan->files[i].damaged) Report(scan, BSA_PROBLEM_DATA, scan->files[i].folder, i);
+		}
+	}
+	return true;
+}
+
+//Checks the header, the order and hashes of folders and files against their names, that every file lies
+//within the archive and, with VALIDATE_DATA, that compressed files inflate to their stated size. Up to length
+//problems are copied into problems. Returns how many problems there are in all.
+int _stdcall bsaValidate(const char* path, DWORD options, BsaProblem* problems, int length) {
+	Scan scan;
+	if(!OpenScan(&scan, path, options, problems, length)) return VALIDATE_ERROR_READ;
+	FreeScan(&scan);
+	return scan.count;
+}
+
+//Writes a copy of an archive to outPath with its directory rebuilt from the folder and file names, keeping the
+//stored data of each file as it is. Files whose data lies outside the archive are left out, as are damaged
+//ones with VALIDATE_DATA, and only the first of any files sharing a path is kept. outPath must differ from path.
+int _stdcall bsaRepair(const char* path, const char* outPath, DWORD options) {
+	Scan scan;
+	if(!OpenScan(&scan, path, options, 0, 0)) return REPAIR_ERROR_READ;
+	const BsaHeader* header=scan.header;
+	if(!header) {
+		FreeScan(&scan);
+		return REPAIR_ERROR_READ;
+	}
+	if(!scan.complete) {
+		FreeScan(&scan);
+		return REPAIR_ERROR_DIRECTORY;
+	}
+	if((header->archiveFlags&(BSA_FLAG_FOLDERNAMES|BSA_FLAG_FILENAMES))!=(BSA_FLAG_FOLDERNAMES|BSA_FLAG_FILENAMES)) {
+		FreeScan(&scan);
+		return REPAIR_ERROR_NAMES;
+	}
+
+	//put each kept file's full path together so the directory can be laid out again from scratch
+	const BYTE* base=scan.map.data;
+	UINT64 nameSpace=0;
+	for(DWORD i=0;i<scan.fileCount;i++) nameSpace+=base[scan.folderName[scan.files[i].folder]]+strlen((const char*)base+scan.files[i].name)+1;
+	char* names=(char*)malloc((size_t)nameSpace+1);
+	BsaDirFile* order=(BsaDirFile*)malloc(sizeof(BsaDirFile)*(scan.fileCount+1));
+	if(!names||!order) {
+		free(names);
+		free(order);
+		FreeScan(&scan);
+		return REPAIR_ERROR_WRITE;
+	}
+	char* next=names;
+	int kept=0;
+	for(DWORD i=0;i<scan.fileCount;i++) {
+		const ScanFile* f=&scan.files[i];
+		if(!f->inBounds||f->damaged) continue;
+		DWORD folderPos=scan.folderName[f->folder];
+		const char* folder=(const char*)base+folderPos+1;
+		DWORD folderLength=(DWORD)strnlen(folder, base[folderPos]);
+		const char* name=(const char*)base+f->name;
+		DWORD nameLength=(DWORD)strlen(name);
+		char* full=next;
+		if(folderLength) {
+			memcpy(next, folder, folderLength);
+			next+=folderLength;
+			*next++='\\';
+		}
+		memcpy(next, name, nameLength+1);
+		next+=nameLength+1;
+		BsaSetDirFile(&order[kept++], full, i);
+	}
+	BsaSortDirFiles(order, kept);
+	int unique=0;
+	for(int i=0;i<kept;i++) {
+		if(!unique||!BsaSameDirFile(&order[unique-1], &order[i])) order[unique++]=order[i];
+	}
+
+	BYTE* directory=0;
+	DWORD dataStart=BsaBuildDirectory(order, unique, header->archiveFlags, header->fileFlags, &directory);
+	int result=dataStart?0:REPAIR_ERROR_SIZE;
+	HANDLE out=INVALID_HANDLE_VALUE;
+	if(!result) {
+		((BsaHeader*)directory)->version=header->version;
+		out=CreateFileA(outPath, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+		if(out==INVALID_HANDLE_VALUE) result=REPAIR_ERROR_WRITE;
+	}
+	if(!result) {
+		//the stored bytes, embedded name and all, go across untouched, so only the offsets change
+		LARGE_INTEGER seek;
+		seek.QuadPart=dataStart;
+		if(!SetFilePointerEx(out, seek, 0, FILE_BEGIN)) result=REPAIR_ERROR_WRITE;
+		UINT64 outPos=dataStart;
+		for(int i=0;i<unique&&!result;i++) {
+			const BsaFileRecord* source=(const BsaFileRecord*)(base+scan.files[order[i].source].record);
+			DWORD length=source->size&(BSA_SIZE_TOGGLE-1);
+			if(outPos+length>0xffffffff) {
+				result=REPAIR_ERROR_SIZE;
+				break;
+			}
+			BsaFileRecord* record=(BsaFileRecord*)(directory+order[i].recordOffset);
+			record->size=source->size;
+			record->offset=(DWORD)outPos;
+			if(!WriteAll(out, base+source->offset, length)) result=REPAIR_ERROR_WRITE;
+			outPos+=length;
+		}
+		seek.QuadPart=0;
+		if(!result&&(!SetFilePointerEx(out, seek, 0, FILE_BEGIN)||!WriteAll(out, directory, dataStart))) result=REPAIR_ERROR_WRITE;
+	}
+	if(out!=INVALID_HANDLE_VALUE) {
+		CloseHandle(out);
+		if(result) DeleteFileA(outPath);
+	}
+	free(directory);
+	free(order);
+	free(names);
+	DWORD total=scan.fileCount;
+	FreeScan(&scan);
+	return result?result:(int)(total-unique);
+}
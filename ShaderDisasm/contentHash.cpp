@@ -0,0 +1,72 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <string.h>
+#include "contentHash.h"
+
+#define PRIME1 0x9E3779B185EBCA87ull
+#define PRIME2 0xC2B2AE3D27D4EB4Full
+#define PRIME3 0x165667B19E3779F9ull
+#define PRIME4 0x85EBCA77C2B2AE63ull
+#define PRIME5 0x27D4EB2F165667C5ull
+
+static inline UINT64 Rotate(UINT64 value, int bits) {
+	return (value<<bits)|(value>>(64-bits));
+}
+
+static inline UINT64 Read64(const BYTE* p) {
+	UINT64 value;
+	memcpy(&value, p, 8);
+	return value;
+}
+
+static inline DWORD Read32(const BYTE* p) {
+	DWORD value;
+	memcpy(&value, p, 4);
+	return value;
+}
+
+static inline UINT64 Round(UINT64 acc, UINT64 input) {
+	return Rotate(acc+input*PRIME2, 31)*PRIME1;
+}
+
+static inline UINT64 Merge(UINT64 acc, UINT64 value) {
+	return (acc^Round(0, value))*PRIME1+PRIME4;
+}
+
+UINT64 ContentHash(const void* data, SIZE_T length, UINT64 seed) {
+	const BYTE* p=(const BYTE*)data;
+	const BYTE* end=p+length;
+	UINT64 hash;
+	if(length>=32) {
+		//four independent lanes keep the multipliers busy
+		UINT64 v1=seed+PRIME1+PRIME2, v2=seed+PRIME2, v3=seed, v4=seed-PRIME1;
+		const BYTE* last=end-32;
+		do {
+			v1=Round(v1, Read64(p));
+			v2=Round(v2, Read64(p+8));
+			v3=Round(v3, Read64(p+16));
+			v4=Round(v4, Read64(p+24));
+			p+=32;
+		} while(p<=last);
+		hash=Rotate(v1, 1)+Rotate(v2, 7)+Rotate(v3, 12)+Rotate(v4, 18);
+		hash=Merge(hash, v1);
+		hash=Merge(hash, v2);
+		hash=Merge(hash, v3);
+		hash=Merge(hash, v4);
+	} else hash=seed+PRIME5;
+	hash+=length;
+
+	for(;p+8<=end;p+=8) hash=Rotate(hash^Round(0, Read64(p)), 27)*PRIME1+PRIME4;
+	if(p+4<=end) {
+		hash=Rotate(hash^(Read32(p)*PRIME1), 23)*PRIME2+PRIME3;
+		p+=4;
+	}
+	for(;p<end;p++) hash=Rotate(hash^(*p*PRIME5), 11)*PRIME1;
+
+	hash^=hash>>33;
+	hash*=PRIME2;
+	hash^=hash>>29;
+	hash*=PRIME3;
+	hash^=hash>>32;
+	return hash;
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+//64 bit hash of a block of data, computed as XXH64 so it matches other tools given the same seed
+UINT64 ContentHash(const void* data, SIZE_T length, UINT64 seed);
@@ -0,0 +1,216 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <string.h>
+#include "ddsFormat.h"
+
+bool IsPowOfTwo(int i) {
+	return i==32||i==64||i==128||i==256||i==512||i==1024||i==2048||i==4086;
+}
+
+//Size in bytes of one mip level, or 0 for formats that can't be handled without d3dx
+static DWORD LevelSize(const DdsPixelFormat* pf, DWORD width, DWORD height) {
+	if(width<1) width=1;
+	if(height<1) height=1;
+	if(pf->flags&DDPF_FOURCC) {
+		DWORD block;
+		switch(pf->fourCC) {
+			case DDS_FOURCC('D','X','T','1'): block=8; break;
+			case DDS_FOURCC('D','X','T','2'):
+			case DDS_FOURCC('D','X','T','3'):
+			case DDS_FOURCC('D','X','T','4'):
+			case DDS_FOURCC('D','X','T','5'): block=16; break;
+			default: return 0;
+		}
+		return ((width+3)/4)*((height+3)/4)*block;
+	}
+	if(!(pf->flags&(DDPF_RGB|DDPF_LUMINANCE|DDPF_ALPHA))||pf->rgbBitCount%8) return 0;
+	return width*height*(pf->rgbBitCount/8);
+}
+
+bool ddsStripTopMip(const BYTE* file, DWORD length, DdsHeader* header, const BYTE** body, DWORD* bodyLength) {
+	if(length<sizeof(DdsHeader)) return false;
+	const DdsHeader* src=(const DdsHeader*)file;
+	if(src->magic!=DDS_MAGIC||src->size!=124||(src->caps2&(DDSCAPS2_CUBEMAP|DDSCAPS2_VOLUME))) return false;
+	DWORD mips=(src->flags&DDSD_MIPMAPCOUNT)?src->mipMapCount:1;
+	if(mips<3||!IsPowOfTwo(src->width)||!IsPowOfTwo(src->height)) return false;
+	//no more levels than it takes to reach 1x1
+	DWORD levels=1;
+	for(DWORD side=src->width>src->height?src->width:src->height;side>1;side>>=1) levels++;
+	if(mips>levels) mips=levels;
+	UINT64 total=0;
+	for(DWORD i=0;i<mips;i++) {
+		DWORD size=LevelSize(&src->format, src->width>>i, src->height>>i);
+		if(!size) return false;
+		total+=size;
+	}
+	if(length-sizeof(DdsHeader)<total) return false;
+	DWORD top=LevelSize(&src->format, src->width, src->height);
+
+	*header=*src;
+	header->width/=2;
+	header->height/=2;
+	header->mipMapCount=mips-1;
+	if(src->flags&DDSD_LINEARSIZE) header->pitchOrLinearSize=LevelSize(&src->format, header->width, header->height);
+	else if(src->flags&DDSD_PITCH) header->pitchOrLinearSize=header->width*(src->format.rgbBitCount/8);
+	*body=file+sizeof(DdsHeader)+top;
+	*bodyLength=(DWORD)total-top;
+	return true;
+}
+
+struct MaskFormat {
+	DWORD format;
+	DWORD flags;
+	DWORD bits;
+	DWORD r, g, b, a;
+};
+
+//The uncompressed layouts d3d9 has a D3DFORMAT for
+static const MaskFormat maskFormats[] = {
+	{ 21, DDPF_RGB, 32, 0xff0000, 0xff00, 0xff, 0xff000000 },			//A8R8G8B8
+	{ 22, DDPF_RGB, 32, 0xff0000, 0xff00, 0xff, 0 },					//X8R8G8B8
+	{ 32, DDPF_RGB, 32, 0xff, 0xff00, 0xff0000, 0xff000000 },			//A8B8G8R8
+	{ 33, DDPF_RGB, 32, 0xff, 0xff00, 0xff0000, 0 },					//X8B8G8R8
+	{ 34, DDPF_RGB, 32, 0xffff, 0xffff0000, 0, 0 },					//G16R16
+	{ 35, DDPF_RGB, 32, 0x3ff00000, 0xffc00, 0x3ff, 0xc0000000 },		//A2R10G10B10
+	{ 31, DDPF_RGB, 32, 0x3ff, 0xffc00, 0x3ff00000, 0xc0000000 },		//A2B10G10R10
+	{ 20, DDPF_RGB, 24, 0xff0000, 0xff00, 0xff, 0 },					//R8G8B8
+	{ 23, DDPF_RGB, 16, 0xf800, 0x7e0, 0x1f, 0 },						//R5G6B5
+	{ 25, DDPF_RGB, 16, 0x7c00, 0x3e0, 0x1f, 0x8000 },					//A1R5G5B5
+	{ 24, DDPF_RGB, 16, 0x7c00, 0x3e0, 0x1f, 0 },						//X1R5G5B5
+	{ 26, DDPF_RGB, 16, 0xf00, 0xf0, 0xf, 0xf000 },						//A4R4G4B4
+	{ 50, DDPF_LUMINANCE, 8, 0xff, 0, 0, 0 },							//L8
+	{ 51, DDPF_LUMINANCE, 16, 0xff, 0, 0, 0xff00 },						//A8L8
+	{ 81, DDPF_LUMINANCE, 16, 0xffff, 0, 0, 0 },						//L16
+	{ 28, DDPF_ALPHA, 8, 0, 0, 0, 0xff },								//A8
+};
+
+//Bits per pixel of a D3DFORMAT stored as a numeric fourCC, or 0
+static DWORD NumericFormatBits(DWORD format) {
+	switch(format) {
+		case 111: return 16;			//R16F
+		case 112: case 114: return 32;	//G16R16F, R32F
+		case 36: case 110: case 113: case 115: return 64;
+		case 116: return 128;			//A32B32G32R32F
+		default: return 0;
+	}
+}
+
+//Bits per pixel of a dxgi format, or 0 for formats that can't be sized
+static DWORD DxgiFormatBits(DWORD format, bool* blocks) {
+	*blocks=(format>=70&&format<=84)||(format>=94&&format<=99);
+	if(format>=1&&format<=4) return 128;
+	if(format>=5&&format<=8) return 96;
+	if(format>=9&&format<=22) return 64;
+	if(format>=23&&format<=47) return 32;
+	if(format>=48&&format<=59) return 16;
+	if(format>=60&&format<=65) return 8;
+	if(format>=67&&format<=69) return 32;
+	if(format>=70&&format<=72) return 4;	//BC1
+	if(format>=73&&format<=78) return 8;	//BC2, BC3
+	if(format>=79&&format<=81) return 4;	//BC4
+	if(format>=82&&format<=84) return 8;	//BC5
+	if(format==85||format==86||format==115) return 16;
+	if(format>=87&&format<=93) return 32;
+	if(format>=94&&format<=99) return 8;	//BC6H, BC7
+	return 0;
+}
+
+static void LegacyFormat(const DdsPixelFormat* pf, DdsInfo* info, bool* blocks) {
+	*blocks=false;
+	if(pf->flags&DDPF_FOURCC) {
+		switch(pf->fourCC) {
+			case DDS_FOURCC('D','X','T','1'):
+			case DDS_FOURCC('A','T','I','1'):
+			case DDS_FOURCC('B','C','4','U'):
+			case DDS_FOURCC('B','C','4','S'):
+				info->bitsPerPixel=4;
+				*blocks=true;
+				break;
+			case DDS_FOURCC('D','X','T','2'):
+			case DDS_FOURCC('D','X','T','3'):
+			case DDS_FOURCC('D','X','T','4'):
+			case DDS_FOURCC('D','X','T','5'):
+			case DDS_FOURCC('A','T','I','2'):
+			case DDS_FOURCC('B','C','5','U'):
+			case DDS_FOURCC('B','C','5','S'):
+				info->bitsPerPixel=8;
+				*blocks=true;
+				break;
+			default:
+				info->bitsPerPixel=NumericFormatBits(pf->fourCC);
+				if(!info->bitsPerPixel) return;
+				break;
+		}
+		info->format=pf->fourCC;
+		return;
+	}
+	DWORD kind=pf->flags&(DDPF_RGB|DDPF_LUMINANCE|DDPF_ALPHA);
+	info->bitsPerPixel=kind?pf->rgbBitCount:0;
+	for(DWORD i=0;i<sizeof(maskFormats)/sizeof(MaskFormat);i++) {
+		const MaskFormat& m=maskFormats[i];
+		if(kind==m.flags&&pf->rgbBitCount==m.bits&&pf->rMask==m.r&&pf->gMask==m.g&&pf->bMask==m.b&&(pf->flags&(DDPF_ALPHAPIXELS|DDPF_ALPHA)?pf->aMask:0)==m.a) {
+			info->format=m.format;
+			return;
+		}
+	}
+}
+
+static UINT64 SurfaceSize(DWORD bits, bool blocks, DWORD width, DWORD height, DWORD depth) {
+	if(blocks) return (UINT64)((width+3)/4)*((height+3)/4)*bits*2*depth;
+	return ((UINT64)width*bits+7)/8*height*depth;
+}
+
+BOOL _stdcall ddsProbe(const BYTE* file, DWORD length, DdsInfo* info) {
+	memset(info, 0, sizeof(DdsInfo));
+	if(length<sizeof(DdsHeader)) return FALSE;
+	const DdsHeader* header=(const DdsHeader*)file;
+	if(header->magic!=DDS_MAGIC||header->size!=124||!header->width||!header->height) return FALSE;
+	info->width=header->width;
+	info->height=header->height;
+	info->depth=1;
+	info->mipCount=(header->flags&DDSD_MIPMAPCOUNT)&&header->mipMapCount?header->mipMapCount:1;
+	if(info->mipCount>32) info->mipCount=32;
+	info->arraySize=1;
+	info->dataOffset=sizeof(DdsHeader);
+	bool blocks;
+	bool volume=(header->caps2&DDSCAPS2_VOLUME)!=0;
+	if((header->format.flags&DDPF_FOURCC)&&header->format.fourCC==DDS_FOURCC('D','X','1','0')) {
+		if(length<DDS_PROBE_BYTES) return FALSE;
+		const DdsHeaderDX10* dx10=(const DdsHeaderDX10*)(file+sizeof(DdsHeader));
+		info->flags|=DDS_INFO_DX10;
+		info->dataOffset=DDS_PROBE_BYTES;
+		info->dxgiFormat=dx10->dxgiFormat;
+		info->bitsPerPixel=DxgiFormatBits(dx10->dxgiFormat, &blocks);
+		info->arraySize=dx10->arraySize?dx10->arraySize:1;
+		if(dx10->miscFlag&DDS_RESOURCE_MISC_TEXTURECUBE) {
+			info->flags|=DDS_INFO_CUBEMAP;
+			info->arraySize*=6;
+		}
+		volume=dx10->resourceDimension==DDS_DIMENSION_TEXTURE3D;
+	} else {
+		LegacyFormat(&header->format, info, &blocks);
+		if(header->caps2&DDSCAPS2_CUBEMAP) {
+			info->flags|=DDS_INFO_CUBEMAP;
+			info->arraySize=0;
+			for(DWORD face=DDSCAPS2_CUBEMAP<<1;face&DDSCAPS2_CUBEMAP_ALLFACES;face<<=1) if(header->caps2&face) info->arraySize++;
+			if(!info->arraySize) info->arraySize=6;
+		}
+	}
+	if(volume) {
+		info->flags|=DDS_INFO_VOLUME;
+		if(header->depth) info->depth=header->depth;
+	}
+	if(!info->bitsPerPixel) {
+		info->flags|=DDS_INFO_UNKNOWN_SIZE;
+		return TRUE;
+	}
+	UINT64 total=0;
+	for(DWORD i=0;i<info->mipCount;i++) {
+		DWORD w=info->width>>i, h=info->height>>i, d=info->depth>>i;
+		total+=SurfaceSize(info->bitsPerPixel, blocks, w?w:1, h?h:1, d?d:1);
+	}
+	total=total*info->arraySize+info->dataOffset;
+	info->expectedSize=total>0xffffffff?0xffffffff:(DWORD)total;
+	if(total>length) info->flags|=DDS_INFO_TRUNCATED;
+	return TRUE;
+}
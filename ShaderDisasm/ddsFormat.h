@@ -0,0 +1,96 @@
+#pragma once
+
+//Dds file parsing shared between ddsShrinker.cpp and the archive tools. Unlike the d3dx based exports
+//these only touch the file bytes, so they are safe to call from worker threads.
+
+#define DDS_FOURCC(a,b,c,d) ((DWORD)(BYTE)(a)|((DWORD)(BYTE)(b)<<8)|((DWORD)(BYTE)(c)<<16)|((DWORD)(BYTE)(d)<<24))
+#define DDS_MAGIC DDS_FOURCC('D','D','S',' ')
+
+#define DDSD_DEPTH 0x800000
+#define DDSD_PITCH 0x8
+#define DDSD_MIPMAPCOUNT 0x20000
+#define DDSD_LINEARSIZE 0x80000
+#define DDPF_ALPHAPIXELS 0x1
+#define DDPF_ALPHA 0x2
+#define DDPF_FOURCC 0x4
+#define DDPF_RGB 0x40
+#define DDPF_LUMINANCE 0x20000
+#define DDSCAPS2_CUBEMAP 0x200
+#define DDSCAPS2_VOLUME 0x200000
+#define DDSCAPS2_CUBEMAP_ALLFACES 0xfc00
+#define DDS_RESOURCE_MISC_TEXTURECUBE 0x4
+#define DDS_DIMENSION_TEXTURE3D 4
+
+#pragma pack(push, 1)
+struct DdsPixelFormat {
+	DWORD size;
+	DWORD flags;
+	DWORD fourCC;
+	DWORD rgbBitCount;
+	DWORD rMask;
+	DWORD gMask;
+	DWORD bMask;
+	DWORD aMask;
+};
+
+struct DdsHeader {
+	DWORD magic;
+	DWORD size;
+	DWORD flags;
+	DWORD height;
+	DWORD width;
+	DWORD pitchOrLinearSize;
+	DWORD depth;
+	DWORD mipMapCount;
+	DWORD reserved1[11];
+	DdsPixelFormat format;
+	DWORD caps;
+	DWORD caps2;
+	DWORD caps3;
+	DWORD caps4;
+	DWORD reserved2;
+};
+
+//Follows DdsHeader when format.fourCC is DX10
+struct DdsHeaderDX10 {
+	DWORD dxgiFormat;
+	DWORD resourceDimension;
+	DWORD miscFlag;
+	DWORD arraySize;
+	DWORD miscFlags2;
+};
+#pragma pack(pop)
+
+//ddsProbe never looks further into the file than this
+#define DDS_PROBE_BYTES (sizeof(DdsHeader)+sizeof(DdsHeaderDX10))
+
+#define DDS_INFO_CUBEMAP 0x1
+#define DDS_INFO_VOLUME 0x2
+#define DDS_INFO_DX10 0x4
+#define DDS_INFO_TRUNCATED 0x8		//the file is shorter than its header says it should be
+#define DDS_INFO_UNKNOWN_SIZE 0x10	//the format isn't known, so expectedSize and truncation weren't worked out
+
+struct DdsInfo {
+	DWORD width;
+	DWORD height;
+	DWORD depth;
+	DWORD mipCount;
+	DWORD arraySize;		//faces times array slices
+	DWORD format;			//the D3DFORMAT, or a fourCC for compressed formats; 0 if not recognised
+	DWORD dxgiFormat;		//only set for DX10 files
+	DWORD bitsPerPixel;
+	DWORD dataOffset;
+	DWORD expectedSize;		//dataOffset plus every surface
+	DWORD flags;
+};
+
+//The texture sizes ddsShrink is willing to halve
+bool IsPowOfTwo(int i);
+
+//Drops the top mip level of a dds file in the same cases ddsShrink would. On success the new header is
+//written to header, and the remaining levels are the *bodyLength bytes starting at *body.
+bool ddsStripTopMip(const BYTE* file, DWORD length, DdsHeader* header, const BYTE** body, DWORD* bodyLength);
+
+//Fills info from the headers of a dds file without decoding anything. Only the first DDS_PROBE_BYTES are read,
+//so file may hold just those as long as length is the size of the whole file. Returns false if it isn't a dds.
+BOOL _stdcall ddsProbe(const BYTE* file, DWORD length, DdsInfo* info);
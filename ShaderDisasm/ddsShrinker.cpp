@@ -2,6 +2,11 @@
 //#define D3D_DEBUG_INFO
 #include <d3d9.h>
 #include <d3dx9.h>
+#include <stdlib.h>
+#include <string.h>
+#include "blitter.h"
+#include "ddsFormat.h"
+#include "mipGenerator.h"
 
 static IDirect3DDevice9* device;
 static IDirect3D9* d3d9;
@@ -34,17 +39,121 @@ void* _stdcall ddsCreate(int width, int height) {
 	return tex;
 }
 
-void _stdcall ddsBlt(IDirect3DTexture9* source, DWORD sL, DWORD sT, DWORD sW, DWORD sH, IDirect3DTexture9* dest, DWORD dL, DWORD dT, DWORD dW, DWORD dH) {
+static void BltSurface(IDirect3DTexture9* source, const RECT* sourceRect, IDirect3DTexture9* dest, const RECT* destRect, DWORD filter) {
 	IDirect3DSurface9 *sourceSurf, *destSurf;
 	source->GetSurfaceLevel(0, &sourceSurf);
 	dest->GetSurfaceLevel(0, &destSurf);
-	RECT sourceRect = { sL, sT, sL+sW, sT+sH };
-	RECT destRect = { dL, dT, dL+dW, dT+dH };
-	D3DXLoadSurfaceFromSurface(destSurf, 0, &destRect, sourceSurf, 0, &sourceRect, D3DX_DEFAULT, 0);
+	D3DXLoadSurfaceFromSurface(destSurf, 0, destRect, sourceSurf, 0, sourceRect, filter, 0);
 	sourceSurf->Release();
 	destSurf->Release();
 }
 
+void _stdcall ddsBlt(IDirect3DTexture9* source, DWORD sL, DWORD sT, DWORD sW, DWORD sH, IDirect3DTexture9* dest, DWORD dL, DWORD dT, DWORD dW, DWORD dH) {
+	RECT sourceRect = { sL, sT, sL+sW, sT+sH };
+	RECT destRect = { dL, dT, dL+dW, dT+dH };
+	BltSurface(source, &sourceRect, dest, &destRect, D3DX_DEFAULT);
+}
+
+struct DdsBltOp {
+	IDirect3DTexture9* source;
+	DWORD sL, sT, sW, sH;
+	DWORD dL, dT, dW, dH;
+	DWORD filter;
+};
+
+//Runs the ops one at a time through d3dx, for textures the native blitter can't handle
+static int BltBatchD3DX(IDirect3DTexture9* dest, const DdsBltOp* ops, DWORD count) {
+	static const DWORD filters[] = { D3DX_DEFAULT, D3DX_FILTER_POINT, D3DX_FILTER_LINEAR, D3DX_FILTER_BOX };
+	for(DWORD i=0;i<count;i++) {
+		const DdsBltOp& op=ops[i];
+		RECT sourceRect = { op.sL, op.sT, op.sL+op.sW, op.sT+op.sH };
+		RECT destRect = { op.dL, op.dT, op.dL+op.dW, op.dT+op.dH };
+		BltSurface(op.source, &sourceRect, dest, &destRect, op.filter<=BLT_BOX?filters[op.filter]:D3DX_DEFAULT);
+	}
+	return count;
+}
+
+//Copies many rectangles into one texture, e.g. to build an atlas. Every texture is locked once and the copies
+//are done by the native blitter across all cores. Returns the number of ops that were run.
+int _stdcall ddsBltBatch(IDirect3DTexture9* dest, const DdsBltOp* ops, DWORD count) {
+	if(!count) return 0;
+	IDirect3DTexture9** textures=(IDirect3DTexture9**)malloc(sizeof(IDirect3DTexture9*)*(count+1));
+	BlitImage* images=(BlitImage*)malloc(sizeof(BlitImage)*(count+1));
+	BlitOp* blits=(BlitOp*)malloc(sizeof(BlitOp)*count);
+	D3DSURFACE_DESC desc;
+	dest->GetLevelDesc(0, &desc);
+	bool native=textures&&images&&blits&&desc.Format==D3DFMT_A8R8G8B8;
+	DWORD used=0;
+	if(native) textures[used++]=dest;
+	for(DWORD i=0;native&&i<count;i++) {
+		//a texture copying into itself would be read while it is being written
+		if(ops[i].source==dest) native=false;
+		DWORD j=1;
+		while(j<used&&textures[j]!=ops[i].source) j++;
+		if(j==used) {
+			ops[i].source->GetLevelDesc(0, &desc);
+			if(desc.Format!=D3DFMT_A8R8G8B8) native=false;
+			textures[used++]=ops[i].source;
+		}
+		BlitOp& b=blits[i];
+		b.source=&images[j];
+		b.sL=ops[i].sL; b.sT=ops[i].sT; b.sW=ops[i].sW; b.sH=ops[i].sH;
+		b.dL=ops[i].dL; b.dT=ops[i].dT; b.dW=ops[i].dW; b.dH=ops[i].dH;
+		b.filter=ops[i].filter;
+	}
+	DWORD locked=0;
+	for(;native&&locked<used;locked++) {
+		D3DLOCKED_RECT rect;
+		if(FAILED(textures[locked]->LockRect(0, &rect, 0, locked?D3DLOCK_READONLY:0))) {
+			native=false;
+			break;
+		}
+		textures[locked]->GetLevelDesc(0, &desc);
+		images[locked].bits=(BYTE*)rect.pBits;
+		images[locked].pitch=rect.Pitch;
+		images[locked].width=desc.Width;
+		images[locked].height=desc.Height;
+	}
+	int result=native?BlitBatch(&images[0], blits, count):-1;
+	for(DWORD i=0;i<locked;i++) textures[i]->UnlockRect(0);
+	free(textures);
+	free(images);
+	free(blits);
+	if(result<0) result=BltBatchD3DX(dest, ops, count);
+	return result;
+}
+
+//Fills in the lower levels of dest from the top level of tex using the native mip generator, leaving d3dx to
+//convert each level to dest's format. mipmaps is a MIP_ filter plus flags; a plain 1 is a box filter. Fails if any
+//level can't be filled, leaving the caller to have d3dx filter them all instead.
+static bool SaveMips(IDirect3DTexture9* tex, const D3DSURFACE_DESC* desc, IDirect3DTexture9* dest, DWORD mipmaps) {
+	DWORD levels=dest->GetLevelCount();
+	if(desc->Format!=D3DFMT_A8R8G8B8||levels<2) return levels<2;
+	D3DLOCKED_RECT rect;
+	if(FAILED(tex->LockRect(0, &rect, 0, D3DLOCK_READONLY))) return false;
+	BYTE* mips=GenerateMips((BYTE*)rect.pBits, desc->Width, desc->Height, rect.Pitch, levels, mipmaps);
+	tex->UnlockRect(0);
+	if(!mips) return false;
+	BYTE* level=mips;
+	bool ok=true;
+	for(DWORD i=1;i<levels&&ok;i++) {
+		DWORD width=desc->Width>>i, height=desc->Height>>i;
+		if(!width) width=1;
+		if(!height) height=1;
+		IDirect3DSurface9* surf;
+		if(FAILED(dest->GetSurfaceLevel(i, &surf))) {
+			ok=false;
+			break;
+		}
+		RECT src={ 0, 0, (LONG)width, (LONG)height };
+		ok=SUCCEEDED(D3DXLoadSurfaceFromMemory(surf, 0, 0, level, D3DFMT_A8R8G8B8, width*4, 0, &src, D3DX_FILTER_NONE, 0));
+		surf->Release();
+		level+=width*height*4;
+	}
+	free(mips);
+	return ok;
+}
+
 void* _stdcall ddsSave(IDirect3DTexture9* tex, DWORD format, DWORD mipmaps, DWORD* length) {
 	SAFERELEASE(buffer);
 	D3DSURFACE_DESC desc;
@@ -57,7 +166,7 @@ void* _stdcall ddsSave(IDirect3DTexture9* tex, DWORD format, DWORD mipmaps, DWOR
 	D3DXLoadSurfaceFromSurface(destSurf, 0, 0, sourceSurf, 0, 0, D3DX_DEFAULT, 0);
 	sourceSurf->Release();
 	destSurf->Release();
-	if(mipmaps)	D3DXFilterTexture(tex2, 0, 0, D3DX_DEFAULT);
+	if(mipmaps&&!SaveMips(tex, &desc, tex2, mipmaps)) D3DXFilterTexture(tex2, 0, 0, D3DX_DEFAULT);
 	D3DXSaveTextureToFileInMemory(&buffer, D3DXIFF_DDS, tex2, 0);
 	tex2->Release();
 	*length=buffer->GetBufferSize();
@@ -90,15 +199,59 @@ void _stdcall ddsUnlock(IDirect3DTexture9* tex) {
 }
 
 void _stdcall ddsSetData(IDirect3DTexture9* tex, BYTE* data, int length) {
+	D3DSURFACE_DESC desc;
+	tex->GetLevelDesc(0, &desc);
 	D3DLOCKED_RECT rect;
-	tex->LockRect(0, &rect, 0, 0);
-	BYTE* dest=(BYTE*)rect.pBits;
-	for(int i=0;i<length;i++) dest[i]=data[i];
+	if(FAILED(tex->LockRect(0, &rect, 0, 0))) return;
+	DWORD size=rect.Pitch*desc.Height;
+	memcpy(rect.pBits, data, (DWORD)length<size?length:size);
 	tex->UnlockRect(0);
 }
 
-static bool IsPowOfTwo(int i) {
-	return i==32||i==64||i==128||i==256||i==512||i==1024||i==2048||i==4086;
+//Copies height rows of rowBytes each between two buffers with their own pitches
+static void CopyRows(BYTE* dest, DWORD destPitch, const BYTE* src, DWORD srcPitch, DWORD rowBytes, DWORD height) {
+	if(destPitch==rowBytes&&srcPitch==rowBytes) {
+		memcpy(dest, src, rowBytes*height);
+		return;
+	}
+	for(DWORD y=0;y<height;y++) memcpy(dest+y*destPitch, src+y*srcPitch, rowBytes);
+}
+
+//Like ddsLock, but can lock for writing and reports the dimensions, so the caller can work on the texture's
+//own memory instead of a copy. Returns 0 if the texture could not be locked.
+void* _stdcall ddsLockEx(IDirect3DTexture9* tex, DWORD readOnly, DWORD* pitch, DWORD* width, DWORD* height) {
+	D3DSURFACE_DESC desc;
+	tex->GetLevelDesc(0, &desc);
+	D3DLOCKED_RECT rect;
+	if(FAILED(tex->LockRect(0, &rect, 0, readOnly?D3DLOCK_READONLY:0))) return 0;
+	*pitch=rect.Pitch;
+	*width=desc.Width;
+	*height=desc.Height;
+	return rect.pBits;
+}
+
+//Copies the top level into a caller supplied buffer laid out with the given pitch
+BOOL _stdcall ddsGetData(IDirect3DTexture9* tex, BYTE* dest, DWORD length, DWORD pitch) {
+	D3DSURFACE_DESC desc;
+	tex->GetLevelDesc(0, &desc);
+	if(pitch<desc.Width*4||(UINT64)pitch*desc.Height>length) return FALSE;
+	D3DLOCKED_RECT rect;
+	if(FAILED(tex->LockRect(0, &rect, 0, D3DLOCK_READONLY))) return FALSE;
+	CopyRows(dest, pitch, (BYTE*)rect.pBits, rect.Pitch, desc.Width*4, desc.Height);
+	tex->UnlockRect(0);
+	return TRUE;
+}
+
+//Replaces the top level from a buffer laid out with the given pitch
+BOOL _stdcall ddsSetDataPitch(IDirect3DTexture9* tex, const BYTE* data, DWORD length, DWORD pitch) {
+	D3DSURFACE_DESC desc;
+	tex->GetLevelDesc(0, &desc);
+	if(pitch<desc.Width*4||(UINT64)pitch*desc.Height>length) return FALSE;
+	D3DLOCKED_RECT rect;
+	if(FAILED(tex->LockRect(0, &rect, 0, 0))) return FALSE;
+	CopyRows((BYTE*)rect.pBits, rect.Pitch, data, pitch, desc.Width*4, desc.Height);
+	tex->UnlockRect(0);
+	return TRUE;
 }
 
 void* _stdcall ddsShrink(BYTE* file, int length, int* oLength) {
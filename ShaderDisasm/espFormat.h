@@ -0,0 +1,48 @@
+#pragma once
+
+//On disk layout of fallout 3 / new vegas plugins, which oblivion's differs from only by shorter headers
+
+//Record and subrecord types, read as little endian DWORDs
+#define ESP_TYPE_TES4 0x34534554
+#define ESP_TYPE_GRUP 0x50555247
+#define ESP_TYPE_HEDR 0x52444548
+#define ESP_TYPE_MAST 0x5453414D
+#define ESP_TYPE_DATA 0x41544144
+#define ESP_TYPE_CNAM 0x4D414E43
+#define ESP_TYPE_SNAM 0x4D414E53
+#define ESP_TYPE_ONAM 0x4D414E4F
+#define ESP_TYPE_OFST 0x5453464F
+#define ESP_TYPE_EDID 0x44494445
+#define ESP_TYPE_XXXX 0x58585858
+
+#define ESP_FLAG_MASTER 0x00000001
+#define ESP_FLAG_COMPRESSED 0x00040000
+
+//Oblivion leaves the last DWORD off record and group headers
+#define ESP_HEADER_SIZE 24
+#define ESP_OBLIVION_HEADER_SIZE 20
+
+#pragma pack(push, 1)
+struct EspRecordHeader {
+	DWORD type;
+	DWORD size;			//of the data following the header
+	DWORD flags;
+	DWORD formId;
+	DWORD revision;
+	DWORD version;
+};
+
+struct EspGroupHeader {
+	DWORD type;			//always GRUP
+	DWORD size;			//of the whole group, header included
+	DWORD label;
+	int groupType;
+	DWORD stamp;
+	DWORD unknown;
+};
+
+struct EspSubrecordHeader {
+	DWORD type;
+	WORD size;			//taken from a preceding XXXX subrecord when that is present
+};
+#pragma pack(pop)
@@ -0,0 +1,732 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "espReader.h"
+#include "espWriter.h"
+#include "fileUtil.h"
+#include "recordLayout.h"
+#include "workerPool.h"
+#include "zlibCodec.h"
+
+//Merges plugins into one. The masters the plugins don't provide to each other become the masters of the merged
+//plugin, in the order they are first listed. Records the plugins add keep their object ids where no earlier
+//plugin already took them, and are given new ones past the highest taken where one did. Every form id, in record
+//headers, group labels and the subrecord fields the record layouts mark as form ids, is then translated into the
+//merged plugin's space. Where plugins hold the same record, the last one's record is kept in the place of the
+//first. Optionally writes a mapping of each plugin's records to their new form ids.
+
+//espMerge errors. Success returns the number of records written.
+#define MERGE_ERROR_OPEN -1
+#define MERGE_ERROR_FORMAT -2	//plugins of different games, or too many masters or records for one plugin
+#define MERGE_ERROR_DATA -3
+#define MERGE_ERROR_WRITE -4
+
+//Records rewritten at once across all cores before being written out
+#define MERGE_BATCH 4096
+
+//Masters a plugin may have and still own the index after them, leaving 0xff to the game
+#define MERGE_MAX_MASTERS 254
+
+//The game keeps object ids below this for itself
+#define MERGE_FIRST_OBJECT 0x800
+
+//Group types whose label is the form id of the record they belong to
+#define GROUP_WORLD_CHILDREN 1
+#define GROUP_CELL_CHILDREN 6
+#define GROUP_TOPIC_CHILDREN 7
+#define GROUP_CELL_PERSISTENT 8
+#define GROUP_CELL_TEMPORARY 9
+#define GROUP_CELL_DISTANT 10
+
+struct MergePlugin {
+	EspFile* esp;
+	const char* name;
+	char key[MAX_PATH];		//lower case name
+	int* masters;			//index of each master in the merged plugin's masters, or -(plugin+1) for a merged one
+	int* nodes;				//node of each of the plugin's groups while it is being merged
+};
+
+struct MergeClaim {
+	int plugin;				//defining the record
+	DWORD id;				//object id within the defining plugin
+	DWORD merged;			//object id within the merged plugin
+};
+
+struct MergeNode {
+	int parent;
+	int groupType;
+	DWORD label;			//translated
+	int plugin;				//whose group header is written
+	int entry;
+	int first;				//items in the group, in order, or -1
+	int last;
+};
+
+struct MergeItem {
+	int next;
+	int parent;				//node holding the item
+	DWORD formId;			//translated form id of a record
+	int plugin;				//whose copy of the record is written
+	int entry;
+	int node;				//group the item starts, or -1 for a record
+};
+
+struct MergeJob {
+	int item;
+	BYTE* data;				//rewritten data, or 0 to copy the record as it is
+	DWORD size;
+	DWORD flags;
+	bool failed;
+};
+
+struct Merge {
+	MergePlugin* plugins;
+	int pluginCount;
+	const RecordLayouts* layouts;
+	char** masters;
+	int masterCount;
+	MergeClaim* claims;
+	int claimCount;
+	int* byClaim;			//open addressed on plugin and object id, holding claim index+1, or 0
+	int claimBits;
+	MergeNode* nodes;		//node 0 is the top level
+	int nodeCount;
+	int* byNode;			//open addressed on parent, group type and label, holding node index+1, or 0
+	int nodeBits;
+	MergeItem* items;
+	int itemCount;
+	int* byFormId;			//open addressed on translated form id, holding the record's item index+1, or 0
+	int formIdBits;
+	DWORD nextObject;
+	int* events;			//item of each group start and record in writing order, or -1 for a group end
+	int eventCount;
+	MergeJob jobs[MERGE_BATCH];
+};
+
+static inline DWORD Slot(UINT64 key, int bits) {
+	return (DWORD)((key*0x9E3779B97F4A7C15ull)>>(64-bits));
+}
+
+static int* AllocTable(int count, int* bits) {
+	*bits=4;
+	while((1<<*bits)<count*2) (*bits)++;
+	return (int*)calloc((SIZE_T)1<<*bits, sizeof(int));
+}
+
+static int FindClaim(const Merge* merge, int plugin, DWORD id) {
+	DWORD mask=(1<<merge->claimBits)-1;
+	for(DWORD slot=Slot((UINT64)plugin<<24|id, merge->claimBits);merge->byClaim[slot];slot=(slot+1)&mask) {
+		const MergeClaim* claim=&merge->claims[merge->byClaim[slot]-1];
+		if(claim->plugin==plugin&&claim->id==id) return merge->byClaim[slot]-1;
+	}
+	return -1;
+}
+
+//Translates a form id as a merged plugin refers to it into the merged plugin's space
+static DWORD Translate(const Merge* merge, int plugin, DWORD formId) {
+	if(!formId) return 0;
+	const MergePlugin* p=&merge->plugins[plugin];
+	DWORD index=formId>>24, id=formId&0xffffff;
+	//an index past the plugin's own points at no plugin at all, as 0xffffffff does, so is left as it is
+	if(index>(DWORD)p->esp->masterCount) return formId;
+	int owner=plugin;
+	if(index<(DWORD)p->esp->masterCount) {
+		if(p->masters[index]>=0) return (DWORD)p->masters[index]<<24|id;
+		owner=-p->masters[index]-1;
+	}
+	//references to records nobody defines are left pointing into the merged plugin
+	int claim=FindClaim(merge, owner, id);
+	return (DWORD)merge->masterCount<<24|(claim<0?id:merge->claims[claim].merged);
+}
+
+//Finds which plugin defines a record a plugin holds, or -1 if it isn't one of the merged plugins
+static int Definer(const Merge* merge, int plugin, DWORD formId) {
+	const MergePlugin* p=&merge->plugins[plugin];
+	DWORD index=formId>>24;
+	if(index>(DWORD)p->esp->masterCount) return -1;
+	if(index==(DWORD)p->esp->masterCount) return plugin;
+	return p->masters[index]<0?-p->masters[index]-1:-1;
+}
+
+//Lists the masters of every plugin once, leaving out the plugins being merged
+static bool ReadMasters(Merge* merge) {
+	int total=0;
+	for(int p=0;p<merge->pluginCount;p++) total+=merge->plugins[p].esp->masterCount;
+	merge->masters=(char**)calloc(total?total:1, sizeof(char*));
+	if(!merge->masters) return false;
+	for(int p=0;p<merge->pluginCount;p++) {
+		MergePlugin* plugin=&merge->plugins[p];
+		plugin->masters=(int*)malloc(sizeof(int)*(plugin->esp->masterCount?plugin->esp->masterCount:1));
+		if(!plugin->masters) return false;
+		for(int i=0;i<plugin->esp->masterCount;i++) {
+			char name[MAX_PATH];
+			if(espMasterName(plugin->esp, i, name, MAX_PATH)<0) return false;
+			char key[MAX_PATH];
+			memcpy(key, name, MAX_PATH);
+			Lower(key);
+			int merged=-1;
+			for(int q=0;q<merge->pluginCount&&merged<0;q++) if(!strcmp(merge->plugins[q].key, key)) merged=q;
+			if(merged>=0) {
+				plugin->masters[i]=-(merged+1);
+				continue;
+			}
+			int found=0;
+			while(found<merge->masterCount&&_stricmp(merge->masters[found], name)) found++;
+			if(found==merge->masterCount) {
+				merge->masters[found]=(char*)malloc(strlen(name)+1);
+				if(!merge->masters[found]) return false;
+				strcpy(merge->masters[found], name);
+				merge->masterCount++;
+			}
+			plugin->masters[i]=found;
+		}
+	}
+	return true;
+}
+
+//Gives every record the plugins define an object id in the merged plugin, keeping its own where it is free
+static int ClaimObjects(Merge* merge) {
+	int total=0;
+	for(int p=0;p<merge->pluginCount;p++) total+=merge->plugins[p].esp->recordCount;
+	merge->claims=(MergeClaim*)malloc(sizeof(MergeClaim)*(total?total:1));
+	merge->byClaim=AllocTable(total, &merge->claimBits);
+	BYTE* taken=(BYTE*)calloc(1<<21, 1);
+	if(!merge->claims||!merge->byClaim||!taken) {
+		free(taken);
+		return MERGE_ERROR_DATA;
+	}
+	DWORD mask=(1<<merge->claimBits)-1;
+	DWORD highest=MERGE_FIRST_OBJECT-1;
+	int moved=0;
+	for(int p=0;p<merge->pluginCount;p++) {
+		const EspFile* esp=merge->plugins[p].esp;
+		for(int i=1;i<esp->count;i++) {
+			const EspEntry* entry=&esp->entries[i];
+			if(entry->type==ESP_TYPE_GRUP) continue;
+			int definer=Definer(merge, p, entry->formId);
+			DWORD id=entry->formId&0xffffff;
+			if(definer<0||FindClaim(merge, definer, id)>=0) continue;
+			MergeClaim* claim=&merge->claims[merge->claimCount];
+			claim->plugin=definer;
+			claim->id=id;
+			if(taken[id>>3]&(1<<(id&7))) {
+				//placed once every plugin's own ids are known
+				claim->merged=0;
+				moved++;
+			} else {
+				claim->merged=id;
+				taken[id>>3]|=1<<(id&7);
+				if(id>highest) highest=id;
+			}
+			DWORD slot=Slot((UINT64)definer<<24|id, merge->claimBits);
+			while(merge->byClaim[slot]) slot=(slot+1)&mask;
+			merge->byClaim[slot]=++merge->claimCount;
+		}
+	}
+	free(taken);
+	if(highest+1+moved>0xffffff) return MERGE_ERROR_FORMAT;
+	for(int i=0;i<merge->claimCount;i++) {
+		if(!merge->claims[i].merged&&merge->claims[i].id) merge->claims[i].merged=++highest;
+	}
+	merge->nextObject=highest+1;
+	return 0;
+}
+
+static int AddItem(Merge* merge, int node, int after, int plugin, int entry, int group) {
+	MergeItem* item=&merge->items[merge->itemCount];
+	item->parent=node;
+	item->plugin=plugin;
+	item->entry=entry;
+	item->node=group;
+	MergeNode* parent=&merge->nodes[node];
+	if(after<0) {
+		item->next=-1;
+		if(parent->last<0) parent->first=merge->itemCount;
+		else merge->items[parent->last].next=merge->itemCount;
+		parent->last=merge->itemCount;
+	} else {
+		item->next=merge->items[after].next;
+		merge->items[after].next=merge->itemCount;
+		if(parent->last==after) parent->last=merge->itemCount;
+	}
+	return merge->itemCount++;
+}
+
+static int FindRecord(const Merge* merge, DWORD formId) {
+	DWORD mask=(1<<merge->formIdBits)-1;
+	for(DWORD slot=Slot(formId, merge->formIdBits);merge->byFormId[slot];slot=(slot+1)&mask) {
+		if(merge->items[merge->byFormId[slot]-1].formId==formId) return merge->byFormId[slot]-1;
+	}
+	return -1;
+}
+
+static int FindNode(Merge* merge, int parent, int groupType, DWORD label, int plugin, int entry) {
+	DWORD mask=(1<<merge->nodeBits)-1;
+	UINT64 key=((UINT64)(DWORD)parent<<32|label)^(UINT64)(DWORD)groupType<<59;
+	DWORD slot=Slot(key, merge->nodeBits);
+	for(;merge->byNode[slot];slot=(slot+1)&mask) {
+		const MergeNode* node=&merge->nodes[merge->byNode[slot]-1];
+		if(node->parent==parent&&node->groupType==groupType&&node->label==label) return merge->byNode[slot]-1;
+	}
+	MergeNode* node=&merge->nodes[merge->nodeCount];
+	node->parent=parent;
+	node->groupType=groupType;
+	node->label=label;
+	node->plugin=plugin;
+	node->entry=entry;
+	node->first=-1;
+	node->last=-1;
+	merge->byNode[slot]=merge->nodeCount+1;
+	//the children of a world, cell or topic have to follow it directly
+	int after=-1;
+	if(groupType==GROUP_WORLD_CHILDREN||groupType==GROUP_CELL_CHILDREN||groupType==GROUP_TOPIC_CHILDREN) {
+		int owner=FindRecord(merge, label);
+		if(owner>=0&&merge->items[owner].parent==parent) after=owner;
+	}
+	AddItem(merge, parent, after, plugin, entry, merge->nodeCount);
+	return merge->nodeCount++;
+}
+
+//Lays every plugin's groups and records into one tree, in load order
+static bool BuildTree(Merge* merge) {
+	int groups=0, records=0;
+	for(int p=0;p<merge->pluginCount;p++) {
+		groups+=merge->plugins[p].esp->count-merge->plugins[p].esp->recordCount;
+		records+=merge->plugins[p].esp->recordCount;
+	}
+	merge->nodes=(MergeNode*)malloc(sizeof(MergeNode)*(groups+1));
+	merge->items=(MergeItem*)malloc(sizeof(MergeItem)*(groups+records+1));
+	merge->byNode=AllocTable(groups+1, &merge->nodeBits);
+	merge->byFormId=AllocTable(records, &merge->formIdBits);
+	if(!merge->nodes||!merge->items||!merge->byNode||!merge->byFormId) return false;
+	merge->nodes[0].parent=-1;
+	merge->nodes[0].first=-1;
+	merge->nodes[0].last=-1;
+	merge->nodeCount=1;
+	DWORD mask=(1<<merge->formIdBits)-1;
+	for(int p=0;p<merge->pluginCount;p++) {
+		MergePlugin* plugin=&merge->plugins[p];
+		const EspFile* esp=plugin->esp;
+		plugin->nodes=(int*)malloc(sizeof(int)*esp->count);
+		if(!plugin->nodes) return false;
+		for(int i=1;i<esp->count;i++) {
+			const EspEntry* entry=&esp->entries[i];
+			int parent=entry->parent<0?0:plugin->nodes[entry->parent];
+			if(entry->type==ESP_TYPE_GRUP) {
+				DWORD label=entry->formId;
+				int groupType=(int)entry->flags;
+				if(groupType==GROUP_WORLD_CHILDREN||(groupType>=GROUP_CELL_CHILDREN&&groupType<=GROUP_CELL_DISTANT)) {
+					label=Translate(merge, p, label);
+				}
+				plugin->nodes[i]=FindNode(merge, parent, groupType, label, p, i);
+				continue;
+			}
+			DWORD formId=Translate(merge, p, entry->formId);
+			int found=FindRecord(merge, formId);
+			if(found>=0) {
+				merge->items[found].plugin=p;
+				merge->items[found].entry=i;
+				continue;
+			}
+			int item=AddItem(merge, parent, -1, p, i, -1);
+			merge->items[item].formId=formId;
+			DWORD slot=Slot(formId, merge->formIdBits);
+			while(merge->byFormId[slot]) slot=(slot+1)&mask;
+			merge->byFormId[slot]=item+1;
+		}
+		free(plugin->nodes);
+		plugin->nodes=0;
+	}
+	return true;
+}
+
+static void ListEvents(Merge* merge, int node) {
+	for(int i=merge->nodes[node].first;i>=0;i=merge->items[i].next) {
+		merge->events[merge->eventCount++]=i;
+		if(merge->items[i].node<0) continue;
+		ListEvents(merge, merge->items[i].node);
+		merge->events[merge->eventCount++]=-1;
+	}
+}
+
+//Translates the form ids inside a record, recompressing it if it was compressed and anything changed
+static void RewriteTask(int index, void* context) {
+	Merge* merge=(Merge*)context;
+	MergeJob* job=&merge->jobs[index];
+	const MergeItem* item=&merge->items[job->item];
+	const EspFile* esp=merge->plugins[item->plugin].esp;
+	const EspEntry* entry=&esp->entries[item->entry];
+	const LayoutRecord* layout=merge->layouts?LayoutFind(merge->layouts, entry->type):0;
+	if(!layout) return;
+	DWORD size;
+	BYTE* owned;
+	const BYTE* data=EspRecordData(esp, item->entry, &size, &owned);
+	int count=data?EspSplitSubrecords(data, size, 0, 0):-1;
+	if(count<0) {
+		free(owned);
+		job->failed=true;
+		return;
+	}
+	EspSubrecord* subrecords=(EspSubrecord*)malloc(sizeof(EspSubrecord)*(count?count:1));
+	int* matched=(int*)malloc(sizeof(int)*(count?count:1));
+	int capacity=size/4+1;
+	DWORD* offsets=(DWORD*)malloc(sizeof(DWORD)*capacity);
+	BYTE* patched=0;
+	if(subrecords&&matched&&offsets) {
+		EspSplitSubrecords(data, size, subrecords, count);
+		LayoutMatch(merge->layouts, layout, data, subrecords, count, matched);
+		for(int i=0;i<count&&!job->failed;i++) {
+			if(matched[i]<0) continue;
+			const EspSubrecord* sub=&subrecords[i];
+			int found=LayoutFormIds(merge->layouts, layout->firstSubrecord+matched[i], data+sub->offset, sub->size,
+				offsets, capacity);
+			for(int j=0;j<found&&j<capacity;j++) {
+				DWORD at=sub->offset+offsets[j];
+				DWORD formId=*(const DWORD*)(data+at);
+				DWORD translated=Translate(merge, item->plugin, formId);
+				if(translated==formId) continue;
+				if(!patched) {
+					patched=(BYTE*)malloc(size);
+					if(!patched) {
+						job->failed=true;
+						break;
+					}
+					memcpy(patched, data, size);
+				}
+				*(DWORD*)(patched+at)=translated;
+			}
+		}
+	} else {
+		job->failed=true;
+	}
+	free(subrecords);
+	free(matched);
+	free(offsets);
+	free(owned);
+	if(!patched||job->failed) {
+		free(patched);
+		return;
+	}
+	job->flags=entry->flags;
+	if(entry->flags&ESP_FLAG_COMPRESSED) {
+		DWORD bound=zDeflateBound(size);
+		BYTE* packed=(BYTE*)malloc(bound+4);
+		DWORD length=packed?zDeflate(patched, size, packed+4, bound, Z_LEVEL_DEFAULT):0;
+		if(length) {
+			*(DWORD*)packed=size;
+			free(patched);
+			job->data=packed;
+			job->size=length+4;
+			return;
+		}
+		free(packed);
+		job->flags&=~ESP_FLAG_COMPRESSED;
+	}
+	job->data=patched;
+	job->size=size;
+}
+
+//Bytes a subrecord takes, counting the XXXX subrecord in front of a large one
+static DWORD SubrecordSpan(DWORD size) {
+	return sizeof(EspSubrecordHeader)+size+(size>0xffff?sizeof(EspSubrecordHeader)+4:0);
+}
+
+//Splits a plugin's header record into its subrecords, or returns 0
+static EspSubrecord* HeaderSubrecords(const EspFile* esp, int* count) {
+	const BYTE* data=esp->file.data+esp->headerSize;
+	*count=EspSplitSubrecords(data, esp->entries[0].size, 0, 0);
+	if(*count<0) return 0;
+	EspSubrecord* subrecords=(EspSubrecord*)malloc(sizeof(EspSubrecord)*(*count?*count:1));
+	if(subrecords) EspSplitSubrecords(data, esp->entries[0].size, subrecords, *count);
+	return subrecords;
+}
+
+static int CompareIds(const void* a, const void* b) {
+	DWORD x=*(const DWORD*)a, y=*(const DWORD*)b;
+	return x<y?-1:x>y;
+}
+
+//Lists the master records the plugins' ONAMs say they override, translated, sorted and without repeats. Records
+//of a plugin that was merged in aren't overrides any more, so are left out.
+static bool ListOverrides(const Merge* merge, DWORD** ids, int* count) {
+	int capacity=16;
+	*count=0;
+	*ids=(DWORD*)malloc(sizeof(DWORD)*capacity);
+	if(!*ids) return false;
+	for(int p=0;p<merge->pluginCount;p++) {
+		const MergePlugin* plugin=&merge->plugins[p];
+		const BYTE* data=plugin->esp->file.data+plugin->esp->headerSize;
+		int subrecordCount;
+		EspSubrecord* subrecords=HeaderSubrecords(plugin->esp, &subrecordCount);
+		if(!subrecords) return false;
+		for(int i=0;i<subrecordCount;i++) {
+			if(subrecords[i].type!=ESP_TYPE_ONAM) continue;
+			const DWORD* listed=(const DWORD*)(data+subrecords[i].offset);
+			int listedCount=subrecords[i].size/4;
+			if(*count+listedCount>capacity) {
+				while(*count+listedCount>capacity) capacity*=2;
+				DWORD* grown=(DWORD*)realloc(*ids, sizeof(DWORD)*capacity);
+				if(!grown) {
+					free(subrecords);
+					return false;
+				}
+				*ids=grown;
+			}
+			for(int j=0;j<listedCount;j++) {
+				DWORD index=listed[j]>>24;
+				if(index>=(DWORD)plugin->esp->masterCount||plugin->masters[index]<0) continue;
+				(*ids)[(*count)++]=Translate(merge, p, listed[j]);
+			}
+		}
+		free(subrecords);
+	}
+	qsort(*ids, *count, sizeof(DWORD), CompareIds);
+	int kept=0;
+	for(int i=0;i<*count;i++) if(!kept||(*ids)[kept-1]!=(*ids)[i]) (*ids)[kept++]=(*ids)[i];
+	*count=kept;
+	return true;
+}
+
+//Whether a subrecord of the first plugin's header is carried over as it is. The rest are made for the merged
+//plugin, bar OFST, whose offsets no longer hold.
+static bool KeepHeaderSubrecord(DWORD type) {
+	return type!=ESP_TYPE_HEDR&&type!=ESP_TYPE_SNAM&&type!=ESP_TYPE_MAST&&type!=ESP_TYPE_DATA&&
+		type!=ESP_TYPE_ONAM&&type!=ESP_TYPE_OFST;
+}
+
+//Writes the header of the merged plugin, keeping the first plugin's version, author and other subrecords
+static void WriteHeader(Merge* merge, EspWriter* writer, int records) {
+	const EspFile* first=merge->plugins[0].esp;
+	EspRecordHeader header;
+	memcpy(&header, first->file.data, first->headerSize);
+	header.flags&=~ESP_FLAG_COMPRESSED;
+	bool masters=true;
+	for(int p=0;p<merge->pluginCount;p++) masters=masters&&(merge->plugins[p].esp->entries[0].flags&ESP_FLAG_MASTER);
+	if(!masters) header.flags&=~ESP_FLAG_MASTER;
+	const BYTE* data=first->file.data+first->headerSize;
+	int count;
+	EspSubrecord* subrecords=HeaderSubrecords(first, &count);
+	DWORD* overrides=0;
+	int overrideCount=0;
+	DWORD description=5+1+2*(merge->pluginCount-1);
+	for(int p=0;p<merge->pluginCount;p++) description+=(DWORD)strlen(merge->plugins[p].name);
+	char* text=(char*)malloc(description);
+	if(!subrecords||!text||!ListOverrides(merge, &overrides, &overrideCount)) {
+		free(subrecords);
+		free(text);
+		free(overrides);
+		writer->failed=true;
+		return;
+	}
+	BYTE hedr[12];
+	memset(hedr, 0, sizeof(hedr));
+	for(int i=0;i<count;i++) {
+		if(subrecords[i].type==ESP_TYPE_HEDR&&subrecords[i].size>=4) memcpy(hedr, data+subrecords[i].offset, 4);
+	}
+	*(DWORD*)(hedr+4)=records;
+	*(DWORD*)(hedr+8)=merge->nextObject;
+	memcpy(text, "From ", 5);
+	DWORD length=5;
+	for(int p=0;p<merge->pluginCount;p++) {
+		DWORD nameLength=(DWORD)strlen(merge->plugins[p].name);
+		memcpy(text+length, merge->plugins[p].name, nameLength);
+		length+=nameLength;
+		if(p<merge->pluginCount-1) {
+			memcpy(text+length, ", ", 2);
+			length+=2;
+		}
+	}
+	text[length]=0;
+	DWORD size=SubrecordSpan(sizeof(hedr))+SubrecordSpan(description);
+	for(int i=0;i<count;i++) if(KeepHeaderSubrecord(subrecords[i].type)) size+=SubrecordSpan(subrecords[i].size);
+	for(int m=0;m<merge->masterCount;m++) size+=SubrecordSpan((DWORD)strlen(merge->masters[m])+1)+SubrecordSpan(8);
+	if(overrideCount) size+=SubrecordSpan(sizeof(DWORD)*overrideCount);
+	//in the order the game writes them: the author comes before the description, and anything else after ONAM
+	EspWriteRecord(writer, &header, 0, size);
+	EspWriteSubrecord(writer, ESP_TYPE_HEDR, hedr, sizeof(hedr));
+	for(int i=0;i<count;i++) {
+		if(subrecords[i].type!=ESP_TYPE_CNAM) continue;
+		EspWriteSubrecord(writer, ESP_TYPE_CNAM, data+subrecords[i].offset, subrecords[i].size);
+	}
+	EspWriteSubrecord(writer, ESP_TYPE_SNAM, (const BYTE*)text, description);
+	BYTE zero[8];
+	memset(zero, 0, sizeof(zero));
+	for(int m=0;m<merge->masterCount;m++) {
+		EspWriteSubrecord(writer, ESP_TYPE_MAST, (const BYTE*)merge->masters[m], (DWORD)strlen(merge->masters[m])+1);
+		EspWriteSubrecord(writer, ESP_TYPE_DATA, zero, sizeof(zero));
+	}
+	if(overrideCount) EspWriteSubrecord(writer, ESP_TYPE_ONAM, (const BYTE*)overrides, sizeof(DWORD)*overrideCount);
+	for(int i=0;i<count;i++) {
+		if(subrecords[i].type==ESP_TYPE_CNAM||!KeepHeaderSubrecord(subrecords[i].type)) continue;
+		EspWriteSubrecord(writer, subrecords[i].type, data+subrecords[i].offset, subrecords[i].size);
+	}
+	free(subrecords);
+	free(text);
+	free(overrides);
+}
+
+static int WriteRecords(Merge* merge, EspWriter* writer) {
+	int written=0;
+	int e=0;
+	while(e<merge->eventCount) {
+		int jobs=0;
+		int stop=e;
+		for(;stop<merge->eventCount&&jobs<MERGE_BATCH;stop++) {
+			int item=merge->events[stop];
+			if(item<0||merge->items[item].node>=0) continue;
+			memset(&merge->jobs[jobs], 0, sizeof(MergeJob));
+			merge->jobs[jobs++].item=item;
+		}
+		ParallelFor(jobs, RewriteTask, merge);
+		jobs=0;
+		bool failed=false;
+		for(;e<stop;e++) {
+			int i=merge->events[e];
+			if(i<0) {
+				EspEndGroup(writer);
+				continue;
+			}
+			const MergeItem* item=&merge->items[i];
+			const EspFile* esp=merge->plugins[item->plugin].esp;
+			const BYTE* raw=esp->file.data+esp->entries[item->entry].offset;
+			if(item->node>=0) {
+				EspGroupHeader group;
+				memcpy(&group, raw, esp->headerSize);
+				group.label=merge->nodes[item->node].label;
+				EspBeginGroup(writer, &group);
+				continue;
+			}
+			MergeJob* job=&merge->jobs[jobs++];
+			failed=failed||job->failed;
+			EspRecordHeader header;
+			memcpy(&header, raw, esp->headerSize);
+			header.formId=Translate(merge, item->plugin, header.formId);
+			if(job->data) {
+				header.flags=job->flags;
+				EspWriteRecord(writer, &header, job->data, job->size);
+			} else {
+				EspWriteRecord(writer, &header, raw+esp->headerSize, esp->entries[item->entry].size);
+			}
+			free(job->data);
+			written++;
+		}
+		if(failed) return MERGE_ERROR_DATA;
+		if(writer->failed) return MERGE_ERROR_WRITE;
+	}
+	return written;
+}
+
+static void HexId(char* out, DWORD formId) {
+	for(int i=7;i>=0;i--) {
+		out[i]="0123456789ABCDEF"[formId&0xf];
+		formId>>=4;
+	}
+}
+
+//Writes "plugin\tform id\tmerged form id" lines for every record the plugins define, with each form id as the
+//plugin itself refers to it
+static bool WriteMapping(const Merge* merge, const char* path) {
+	UINT64 length=0;
+	for(int i=0;i<merge->claimCount;i++) length+=strlen(merge->plugins[merge->claims[i].plugin].name)+20;
+	if(length>0x7fffffff) return false;
+	char* text=(char*)malloc((SIZE_T)length+1);
+	if(!text) return false;
+	char* p=text;
+	for(int i=0;i<merge->claimCount;i++) {
+		const MergeClaim* claim=&merge->claims[i];
+		const MergePlugin* plugin=&merge->plugins[claim->plugin];
+		DWORD nameLength=(DWORD)strlen(plugin->name);
+		memcpy(p, plugin->name, nameLength);
+		p+=nameLength;
+		*p++='\t';
+		HexId(p, (DWORD)plugin->esp->masterCount<<24|claim->id);
+		p+=8;
+		*p++='\t';
+		HexId(p, (DWORD)merge->masterCount<<24|claim->merged);
+		p+=8;
+		*p++='\n';
+	}
+	HANDLE file=CreateFileA(path, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	if(file==INVALID_HANDLE_VALUE) {
+		free(text);
+		return false;
+	}
+	bool ok=WriteAll(file, text, (DWORD)(p-text));
+	CloseHandle(file);
+	free(text);
+	if(!ok) DeleteFileA(path);
+	return ok;
+}
+
+static void FreeMerge(Merge* merge) {
+	for(int p=0;p<merge->pluginCount;p++) {
+		if(merge->plugins[p].esp) espClose(merge->plugins[p].esp);
+		free(merge->plugins[p].masters);
+		free(merge->plugins[p].nodes);
+	}
+	for(int m=0;m<merge->masterCount;m++) free(merge->masters[m]);
+	free(merge->plugins);
+	free(merge->masters);
+	free(merge->claims);
+	free(merge->byClaim);
+	free(merge->nodes);
+	free(merge->byNode);
+	free(merge->items);
+	free(merge->byFormId);
+	free(merge->events);
+	free(merge);
+}
+
+static int MergePlugins(Merge* merge, const char* outPath, const char* mapPath) {
+	int result=ReadMasters(merge)?0:MERGE_ERROR_DATA;
+	if(!result&&merge->masterCount>MERGE_MAX_MASTERS) result=MERGE_ERROR_FORMAT;
+	if(!result) result=ClaimObjects(merge);
+	if(!result&&!BuildTree(merge)) result=MERGE_ERROR_DATA;
+	if(result) return result;
+	merge->events=(int*)malloc(sizeof(int)*(merge->itemCount+merge->nodeCount));
+	if(!merge->events) return MERGE_ERROR_DATA;
+	ListEvents(merge, 0);
+	EspWriter writer;
+	if(!EspWriterOpen(&writer, outPath, merge->plugins[0].esp->headerSize)) return MERGE_ERROR_WRITE;
+	WriteHeader(merge, &writer, merge->itemCount);
+	result=WriteRecords(merge, &writer);
+	if(!EspWriterClose(&writer)&&result>=0) result=MERGE_ERROR_WRITE;
+	if(result>=0&&mapPath&&!WriteMapping(merge, mapPath)) result=MERGE_ERROR_WRITE;
+	if(result<0) DeleteFileA(outPath);
+	return result;
+}
+
+int _stdcall espMerge(const char* dataPath, const char** plugins, int count, const char* outPath,
+	RecordLayouts* layouts, const char* mapPath) {
+	if(count<1) return MERGE_ERROR_OPEN;
+	Merge* merge=(Merge*)calloc(1, sizeof(Merge));
+	if(!merge) return MERGE_ERROR_DATA;
+	merge->plugins=(MergePlugin*)calloc(count, sizeof(MergePlugin));
+	if(!merge->plugins) {
+		free(merge);
+		return MERGE_ERROR_DATA;
+	}
+	merge->pluginCount=count;
+	merge->layouts=layouts;
+	int result=0;
+	for(int p=0;p<count&&!result;p++) {
+		MergePlugin* plugin=&merge->plugins[p];
+		char path[MAX_PATH*2];
+		plugin->name=plugins[p];
+		if(strlen(plugins[p])>=MAX_PATH||!DataPath(path, dataPath, plugins[p])) {
+			result=MERGE_ERROR_OPEN;
+			break;
+		}
+		strcpy(plugin->key, plugins[p]);
+		Lower(plugin->key);
+		plugin->esp=espOpen(path);
+		if(!plugin->esp) result=MERGE_ERROR_OPEN;
+		else if(plugin->esp->headerSize!=merge->plugins[0].esp->headerSize) result=MERGE_ERROR_FORMAT;
+		//every record may need reading, so inflate them all up front on every core
+		else if(layouts) espInflateAll(plugin->esp);
+	}
+	if(!result) result=MergePlugins(merge, outPath, mapPath);
+	FreeMerge(merge);
+	return result;
+}
@@ -0,0 +1,376 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "espReader.h"
+#include "zlibCodec.h"
+
+//Deepest group nesting followed; the game nests no more than about five deep
+#define ESP_MAX_DEPTH 64
+
+//Largest size a compressed record is believed to inflate to
+#define ESP_MAX_INFLATED (1<<28)
+
+//Most inflated data espInflateWindow holds at once; a larger record gets a window to itself
+#define ESP_INFLATE_WINDOW (1<<25)
+
+static void FreePlugin(EspFile* esp) {
+	free(esp->entries);
+	free(esp->masters);
+	free(esp->byFormId);
+	free(esp->inflated);
+	free(esp->arena);
+	UnmapFile(&esp->file);
+	free(esp);
+}
+
+static bool AddEntry(EspFile* esp, int* capacity, const EspEntry* entry) {
+	if(esp->count==*capacity) {
+		int grown=*capacity?*capacity*2:4096;
+		EspEntry* entries=(EspEntry*)realloc(esp->entries, sizeof(EspEntry)*grown);
+		if(!entries) return false;
+		esp->entries=entries;
+		*capacity=grown;
+	}
+	esp->entries[esp->count++]=*entry;
+	return true;
+}
+
+//Walks every group and record header in one pass, checking each lies within the file and its group
+static bool ReadEntries(EspFile* esp) {
+	const BYTE* base=esp->file.data;
+	UINT64 size=esp->file.size;
+	if(size>0xffffffff) return false;
+	int capacity=0;
+	int stack[ESP_MAX_DEPTH];
+	UINT64 ends[ESP_MAX_DEPTH];
+	int depth=0;
+	UINT64 pos=0;
+	while(pos<size) {
+		while(depth&&pos>=ends[depth-1]) depth--;
+		UINT64 limit=depth?ends[depth-1]:size;
+		if(pos+esp->headerSize>limit) return false;
+		const EspRecordHeader* header=(const EspRecordHeader*)(base+pos);
+		EspEntry entry;
+		entry.type=header->type;
+		entry.offset=(DWORD)pos;
+		entry.parent=depth?stack[depth-1]:-1;
+		if(header->type==ESP_TYPE_GRUP) {
+			const EspGroupHeader* group=(const EspGroupHeader*)header;
+			if(group->size<esp->headerSize||pos+group->size>limit||depth==ESP_MAX_DEPTH) return false;
+			entry.formId=group->label;
+			entry.flags=(DWORD)group->groupType;
+			entry.size=group->size-esp->headerSize;
+			stack[depth]=esp->count;
+			ends[depth++]=pos+group->size;
+			pos+=esp->headerSize;
+		} else {
+			if(pos+esp->headerSize+header->size>limit) return false;
+			entry.formId=header->formId;
+			entry.flags=header->flags;
+			entry.size=header->size;
+			esp->recordCount++;
+			pos+=esp->headerSize+header->size;
+		}
+		if(!AddEntry(esp, &capacity, &entry)) return false;
+	}
+	return esp->count&&esp->entries[0].type==ESP_TYPE_TES4;
+}
+
+int EspSplitSubrecords(const BYTE* data, DWORD size, EspSubrecord* subrecords, int length) {
+	int count=0;
+	DWORD pos=0;
+	DWORD nextSize=0;
+	bool overridden=false;
+	while(pos<size) {
+		if(size-pos<sizeof(EspSubrecordHeader)) return -1;
+		const EspSubrecordHeader* header=(const EspSubrecordHeader*)(data+pos);
+		DWORD subSize=overridden?nextSize:header->size;
+		pos+=sizeof(EspSubrecordHeader);
+		if(subSize>size-pos) return -1;
+		overridden=false;
+		//XXXX holds the real size of the next subrecord, whose own size field is then meaningless
+		if(header->type==ESP_TYPE_XXXX&&subSize==4) {
+			nextSize=*(const DWORD*)(data+pos);
+			overridden=true;
+		} else {
+			if(count<length) {
+				subrecords[count].type=header->type;
+				subrecords[count].offset=pos;
+				subrecords[count].size=subSize;
+			}
+			count++;
+		}
+		pos+=subSize;
+	}
+	return count;
+}
+
+static inline DWORD FormIdSlot(DWORD formId, int bits) {
+	return (formId*2654435761u)>>(32-bits);
+}
+
+//Hashes every record's form id, keeping the first record when a plugin repeats one
+static bool IndexFormIds(EspFile* esp) {
+	esp->formIdBits=4;
+	while((1<<esp->formIdBits)<esp->recordCount*2) esp->formIdBits++;
+	DWORD mask=(1<<esp->formIdBits)-1;
+	esp->byFormId=(int*)calloc(mask+1, sizeof(int));
+	if(!esp->byFormId) return false;
+	for(int i=0;i<esp->count;i++) {
+		const EspEntry* entry=&esp->entries[i];
+		if(entry->type==ESP_TYPE_GRUP) continue;
+		DWORD slot=FormIdSlot(entry->formId, esp->formIdBits);
+		while(esp->byFormId[slot]&&esp->entries[esp->byFormId[slot]-1].formId!=entry->formId) slot=(slot+1)&mask;
+		if(!esp->byFormId[slot]) esp->byFormId[slot]=i+1;
+	}
+	return true;
+}
+
+//Finds the masters listed in the TES4 record. Their names are read straight from the mapped file later, which
+//rules out a compressed TES4 record; the game never writes one.
+static bool ReadMasters(EspFile* esp) {
+	const EspEntry* header=&esp->entries[0];
+	if(header->flags&ESP_FLAG_COMPRESSED) return false;
+	const BYTE* data=esp->file.data+header->offset+esp->headerSize;
+	int count=EspSplitSubrecords(data, header->size, 0, 0);
+	if(count<0) return false;
+	esp->masters=(EspSubrecord*)malloc(sizeof(EspSubrecord)*(count?count:1));
+	if(!esp->masters) return false;
+	EspSplitSubrecords(data, header->size, esp->masters, count);
+	for(int i=0;i<count;i++) {
+		if(esp->masters[i].type==ESP_TYPE_MAST) esp->masters[esp->masterCount++]=esp->masters[i];
+	}
+	return true;
+}
+
+EspFile* _stdcall espOpen(const char* path) {
+	EspFile* esp=(EspFile*)calloc(1, sizeof(EspFile));
+	if(!esp) return 0;
+	if(!MapFile(&esp->file, path)) {
+		free(esp);
+		return 0;
+	}
+	const BYTE* base=esp->file.data;
+	if(esp->file.size<ESP_HEADER_SIZE+sizeof(EspSubrecordHeader)||*(const DWORD*)base!=ESP_TYPE_TES4) {
+		FreePlugin(esp);
+		return 0;
+	}
+	//oblivion's shorter header puts HEDR where fallout's revision field would be
+	esp->headerSize=*(const DWORD*)(base+ESP_OBLIVION_HEADER_SIZE)==ESP_TYPE_HEDR?ESP_OBLIVION_HEADER_SIZE:ESP_HEADER_SIZE;
+	if(!ReadEntries(esp)||!ReadMasters(esp)||!IndexFormIds(esp)) {
+		FreePlugin(esp);
+		return 0;
+	}
+	return esp;
+}
+
+void _stdcall espClose(EspFile* esp) {
+	if(esp) FreePlugin(esp);
+}
+
+int _stdcall espEntryCount(EspFile* esp) {
+	return esp->count;
+}
+
+int _stdcall espRecordCount(EspFile* esp) {
+	return esp->recordCount;
+}
+
+BOOL _stdcall espEntryInfo(EspFile* esp, int index, EspEntry* entry) {
+	if(index<0||index>=esp->count) return FALSE;
+	*entry=esp->entries[index];
+	return TRUE;
+}
+
+int _stdcall espMasterCount(EspFile* esp) {
+	return esp->masterCount;
+}
+
+int _stdcall espMasterName(EspFile* esp, int index, char* buffer, int length) {
+	if(index<0||index>=esp->masterCount) return -1;
+	const EspSubrecord* master=&esp->masters[index];
+	const char* name=(const char*)esp->file.data+esp->entries[0].offset+esp->headerSize+master->offset;
+	DWORD nameLength=(DWORD)strnlen(name, master->size);
+	if(nameLength+1>(DWORD)length) return -1;
+	memcpy(buffer, name, nameLength);
+	buffer[nameLength]=0;
+	return nameLength;
+}
+
+int _stdcall espFind(EspFile* esp, DWORD formId) {
+	DWORD mask=(1<<esp->formIdBits)-1;
+	for(DWORD slot=FormIdSlot(formId, esp->formIdBits);esp->byFormId[slot];slot=(slot+1)&mask) {
+		int index=esp->byFormId[slot]-1;
+		if(esp->entries[index].formId==formId) return index;
+	}
+	return -1;
+}
+
+int _stdcall espFindEditorId(EspFile* esp, DWORD type, const char* editorId) {
+	DWORD length=(DWORD)strlen(editorId)+1;
+	for(int i=0;i<esp->count;i++) {
+		if(esp->entries[i].type!=type) continue;
+		DWORD size;
+		BYTE* owned;
+		const BYTE* data=EspRecordData(esp, i, &size, &owned);
+		EspSubrecord first;
+		bool found=data&&EspSplitSubrecords(data, size, &first, 1)>0&&first.type==ESP_TYPE_EDID&&
+			first.size==length&&!memcmp(data+first.offset, editorId, length);
+		free(owned);
+		if(found) return i;
+	}
+	return -1;
+}
+
+int _stdcall espFindOffset(EspFile* esp, DWORD offset) {
+	int low=0, high=esp->count-1;
+	while(low<=high) {
+		int mid=(low+high)/2;
+		if(esp->entries[mid].offset==offset) return mid;
+		if(esp->entries[mid].offset<offset) low=mid+1;
+		else high=mid-1;
+	}
+	return -1;
+}
+
+//Gets the size a compressed record inflates to, which its data starts with. Fails if the record is too short to
+//hold it or the size is absurd.
+static bool InflatedSize(const EspFile* esp, const EspEntry* entry, DWORD* size) {
+	if(entry->size<4) return false;
+	*size=*(const DWORD*)(esp->file.data+entry->offset+esp->headerSize);
+	return *size<=ESP_MAX_INFLATED;
+}
+
+static inline bool Compressed(const EspEntry* entry) {
+	return entry->type!=ESP_TYPE_GRUP&&(entry->flags&ESP_FLAG_COMPRESSED);
+}
+
+//Inflates the compressed records among entries first to end-1 across all cores into the arena, dropping whatever
+//it held before. Records that fail are left to EspRecordData, which fails on them again.
+static int InflateEntries(EspFile* esp, int first, int end) {
+	if(!esp->inflated) {
+		esp->inflated=(const BYTE**)calloc(esp->count, sizeof(BYTE*));
+		if(!esp->inflated) return -1;
+	}
+	for(int i=esp->windowFirst;i<esp->windowEnd;i++) esp->inflated[i]=0;
+	esp->windowFirst=esp->windowEnd=0;
+	int count=0;
+	UINT64 total=0;
+	for(int i=first;i<end;i++) {
+		DWORD size;
+		if(!Compressed(&esp->entries[i])||!InflatedSize(esp, &esp->entries[i], &size)) continue;
+		count++;
+		total+=size;
+	}
+	if(total!=(SIZE_T)total) return -1;
+	if(total>esp->arenaSize) {
+		free(esp->arena);
+		esp->arena=(BYTE*)malloc((SIZE_T)total);
+		esp->arenaSize=esp->arena?(SIZE_T)total:0;
+		if(!esp->arena) return -1;
+	}
+	ZBuffer* buffers=(ZBuffer*)malloc(sizeof(ZBuffer)*(count?count:1));
+	int* indices=(int*)malloc(sizeof(int)*(count?count:1));
+	if(!buffers||!indices) {
+		free(buffers);
+		free(indices);
+		return -1;
+	}
+	count=0;
+	BYTE* out=esp->arena;
+	for(int i=first;i<end;i++) {
+		const EspEntry* entry=&esp->entries[i];
+		DWORD size;
+		if(!Compressed(entry)||!InflatedSize(esp, entry, &size)) continue;
+		ZBuffer* b=&buffers[count];
+		b->in=esp->file.data+entry->offset+esp->headerSize+4;
+		b->inLength=entry->size-4;
+		b->out=out;
+		b->outLength=size;
+		indices[count++]=i;
+		out+=size;
+	}
+	int inflated=zInflateBatch(buffers, count, Z_IGNORE_CHECKSUM);
+	for(int i=0;i<count;i++) {
+		if(buffers[i].result) esp->inflated[indices[i]]=buffers[i].out;
+	}
+	esp->windowFirst=first;
+	esp->windowEnd=end;
+	free(buffers);
+	free(indices);
+	return inflated;
+}
+
+int _stdcall espInflateAll(EspFile* esp) {
+	if(esp->windowFirst==0&&esp->windowEnd==esp->count) return 0;
+	return InflateEntries(esp, 0, esp->count);
+}
+
+int _stdcall espInflateWindow(EspFile* esp, int index) {
+	if(index<0||index>=esp->count) return -1;
+	UINT64 total=0;
+	int end=index;
+	for(;end<esp->count;end++) {
+		DWORD size;
+		if(!Compressed(&esp->entries[end])||!InflatedSize(esp, &esp->entries[end], &size)) continue;
+		if(total&&total+size>ESP_INFLATE_WINDOW) break;
+		total+=size;
+	}
+	return InflateEntries(esp, index, end)<0?-1:end;
+}
+
+const BYTE* EspRecordData(const EspFile* esp, int index, DWORD* length, BYTE** owned) {
+	*owned=0;
+	if(index<0||index>=esp->count) return 0;
+	const EspEntry* entry=&esp->entries[index];
+	if(entry->type==ESP_TYPE_GRUP) return 0;
+	const BYTE* data=esp->file.data+entry->offset+esp->headerSize;
+	if(!(entry->flags&ESP_FLAG_COMPRESSED)) {
+		*length=entry->size;
+		return data;
+	}
+	DWORD size;
+	if(!InflatedSize(esp, entry, &size)) return 0;
+	if(esp->inflated&&esp->inflated[index]) {
+		*length=size;
+		return esp->inflated[index];
+	}
+	BYTE* out=(BYTE*)malloc(size?size:1);
+	if(!out) return 0;
+	if(!zInflateBuffer(data+4, entry->size-4, out, size, Z_IGNORE_CHECKSUM)) {
+		free(out);
+		return 0;
+	}
+	*owned=out;
+	*length=size;
+	return out;
+}
+
+int _stdcall espRecordData(EspFile* esp, int index, BYTE* dest, int length) {
+	if(index<0||index>=esp->count||esp->entries[index].type==ESP_TYPE_GRUP) return -1;
+	const EspEntry* entry=&esp->entries[index];
+	const BYTE* data=esp->file.data+entry->offset+esp->headerSize;
+	if(!(entry->flags&ESP_FLAG_COMPRESSED)) {
+		if(entry->size&&entry->size<=(DWORD)length) memcpy(dest, data, entry->size);
+		return entry->size;
+	}
+	DWORD size;
+	if(!InflatedSize(esp, entry, &size)) return -1;
+	if(size>(DWORD)length) return size;
+	if(esp->inflated&&esp->inflated[index]) {
+		if(size) memcpy(dest, esp->inflated[index], size);
+		return size;
+	}
+	return zInflateBuffer(data+4, entry->size-4, dest, size, Z_IGNORE_CHECKSUM)?(int)size:-1;
+}
+
+int _stdcall espSubrecords(EspFile* esp, int index, EspSubrecord* subrecords, int length) {
+	DWORD size;
+	BYTE* owned;
+	const BYTE* data=EspRecordData(esp, index, &size, &owned);
+	if(!data) return -1;
+	int count=EspSplitSubrecords(data, size, subrecords, length);
+	free(owned);
+	return count;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "espFormat.h"
+#include "mappedFile.h"
+
+//A read only plugin kept mapped for as long as it is open. Opening walks the group and record headers once and
+//keeps a compact entry for each; nothing inside a record is looked at until it is asked for, and compressed
+//records are only inflated when their data is read, unless espInflateAll or espInflateWindow inflates them up front.
+//Every call but those two is safe from any thread once espOpen has returned, so long as neither is running.
+
+struct EspEntry {
+	DWORD type;			//record type, or ESP_TYPE_GRUP
+	DWORD formId;		//the label of a group
+	DWORD flags;		//the group type of a group
+	DWORD offset;		//of the header in the file
+	DWORD size;			//of the data following the header; for a group, of the entries inside it
+	int parent;			//index of the group holding the entry, or -1 at the top level
+};
+
+struct EspSubrecord {
+	DWORD type;
+	DWORD offset;		//of the subrecord's data within the record's data
+	DWORD size;
+};
+
+struct EspFile {
+	MappedFile file;
+	DWORD headerSize;
+	EspEntry* entries;	//in file order, so each group is followed by everything inside it
+	int count;
+	int recordCount;	//entries that aren't groups
+	EspSubrecord* masters;	//MAST subrecords of the TES4 record, located in its data
+	int masterCount;
+	int* byFormId;		//open addressed on form id, holding entry index+1 of each id's first record, or 0
+	int formIdBits;
+	const BYTE** inflated;	//data of each compressed record between windowFirst and windowEnd, or 0
+	int windowFirst;
+	int windowEnd;
+	BYTE* arena;		//reused by each window
+	SIZE_T arenaSize;
+};
+
+//Gets the data of a record, inflating it if it is compressed. Returns a pointer into the mapped file, or to a
+//buffer put in *owned for the caller to free, or 0 if the record is damaged.
+const BYTE* EspRecordData(const EspFile* esp, int index, DWORD* length, BYTE** owned);
+//Splits record data into subrecords, honouring XXXX size overrides. Fills up to length of them and returns
+//how many there are, or -1 if the data is damaged.
+int EspSplitSubrecords(const BYTE* data, DWORD size, EspSubrecord* subrecords, int length);
+
+EspFile* _stdcall espOpen(const char* path);
+void _stdcall espClose(EspFile* esp);
+int _stdcall espEntryCount(EspFile* esp);
+int _stdcall espRecordCount(EspFile* esp);
+BOOL _stdcall espEntryInfo(EspFile* esp, int index, EspEntry* entry);
+int _stdcall espMasterCount(EspFile* esp);
+//Copies the name of a master into buffer, returning its length, or -1 if buffer is too small
+int _stdcall espMasterName(EspFile* esp, int index, char* buffer, int length);
+//Returns the index of the first record with the given form id, or -1. Takes constant time.
+int _stdcall espFind(EspFile* esp, DWORD formId);
+//Returns the index of the first record of the given type whose editor id matches exactly, or -1
+int _stdcall espFindEditorId(EspFile* esp, DWORD type, const char* editorId);
+//Returns the index of the entry whose header starts at offset, or -1
+int _stdcall espFindOffset(EspFile* esp, DWORD offset);
+//Inflates every compressed record across all cores and keeps the results, so reading them later is a copy.
+//Returns how many records were inflated, or -1 if there isn't the memory to hold them.
+int _stdcall espInflateAll(EspFile* esp);
+//Inflates the compressed records from the entry at index onward across all cores, stopping at about 32MB of
+//inflated data, and keeps them in place of the previous window. Returns the index of the first entry past the
+//window, or -1 if there isn't the memory to hold it.
+int _stdcall espInflateWindow(EspFile* esp, int index);
+//Copies or inflates a record's data into dest. Returns the size of the data, which is all that happens if dest
+//is too small, or -1 if the record is damaged.
+int _stdcall espRecordData(EspFile* esp, int index, BYTE* dest, int length);
+//Fills up to length subrecords of a record and returns how many there are, or -1 if the record is damaged
+int _stdcall espSubrecords(EspFile* esp, int index, EspSubrecord* subrecords, int length);
@@ -0,0 +1,100 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "espReader.h"
+#include "espWriter.h"
+
+//TrimEsp options
+#define TRIM_STRIP_EDIDS 1
+
+//TrimEsp errors. Success returns the number of records that were changed.
+#define TRIM_ERROR_OPEN -1
+#define TRIM_ERROR_DATA -3
+#define TRIM_ERROR_WRITE -4
+
+//Entries between progress reports
+#define TRIM_PROGRESS_STEP 4096
+
+#define ESP_GROUP_GMST 0x54534D47
+
+typedef void (_stdcall *TrimProgress)(int done, int total);
+
+//Writes a record without its editor id, uncompressed. Returns false if it is damaged.
+static bool WriteStripped(EspWriter* writer, const EspRecordHeader* header, const BYTE* data, DWORD size) {
+	int count=EspSplitSubrecords(data, size, 0, 0);
+	if(count<0) return false;
+	EspSubrecord* subrecords=(EspSubrecord*)malloc(sizeof(EspSubrecord)*(count?count:1));
+	if(!subrecords) return false;
+	EspSplitSubrecords(data, size, subrecords, count);
+	DWORD outSize=0;
+	for(int i=0;i<count;i++) {
+		if(subrecords[i].type==ESP_TYPE_EDID) continue;
+		outSize+=sizeof(EspSubrecordHeader)+subrecords[i].size+(subrecords[i].size>0xffff?sizeof(EspSubrecordHeader)+4:0);
+	}
+	EspRecordHeader out;
+	memcpy(&out, header, writer->headerSize);
+	out.flags&=~ESP_FLAG_COMPRESSED;
+	EspWriteRecord(writer, &out, 0, outSize);
+	for(int i=0;i<count;i++) {
+		if(subrecords[i].type!=ESP_TYPE_EDID) EspWriteSubrecord(writer, subrecords[i].type, data+subrecords[i].offset, subrecords[i].size);
+	}
+	free(subrecords);
+	return true;
+}
+
+//Writes a copy of a plugin in one pass over the original, optionally without the editor ids the game doesn't
+//need. Game settings are looked up by editor id, so those are always kept. Records that aren't changed are copied
+//as they are, compressed or not; changed records are written uncompressed.
+int _stdcall TrimEsp(const char* inPath, const char* outPath, int options, TrimProgress progress) {
+	EspFile* esp=espOpen(inPath);
+	if(!esp) return TRIM_ERROR_OPEN;
+	//stripping has to look inside compressed records, so inflate them all up front on every core
+	if(options&TRIM_STRIP_EDIDS) espInflateAll(esp);
+	EspWriter writer;
+	if(!EspWriterOpen(&writer, outPath, esp->headerSize)) {
+		espClose(esp);
+		return TRIM_ERROR_WRITE;
+	}
+	int open[ESP_WRITER_DEPTH];
+	int changed=0;
+	int result=0;
+	for(int i=0;i<esp->count&&!result;i++) {
+		const EspEntry* entry=&esp->entries[i];
+		while(writer.depth&&open[writer.depth-1]!=entry->parent) EspEndGroup(&writer);
+		const BYTE* raw=esp->file.data+entry->offset;
+		if(entry->type==ESP_TYPE_GRUP) {
+			if(writer.depth==ESP_WRITER_DEPTH) {
+				result=TRIM_ERROR_DATA;
+				break;
+			}
+			open[writer.depth]=i;
+			EspBeginGroup(&writer, (const EspGroupHeader*)raw);
+		} else {
+			const EspRecordHeader* header=(const EspRecordHeader*)raw;
+			bool settings=writer.depth&&esp->entries[open[0]].formId==ESP_GROUP_GMST&&!esp->entries[open[0]].flags;
+			DWORD size;
+			BYTE* owned=0;
+			const BYTE* data=0;
+			if(options&TRIM_STRIP_EDIDS&&i&&!settings) {
+				data=EspRecordData(esp, i, &size, &owned);
+				if(!data) result=TRIM_ERROR_DATA;
+			}
+			EspSubrecord first;
+			if(data&&EspSplitSubrecords(data, size, &first, 1)>0&&first.type==ESP_TYPE_EDID) {
+				if(WriteStripped(&writer, header, data, size)) changed++;
+				else result=TRIM_ERROR_DATA;
+			} else if(!result) {
+				EspWrite(&writer, raw, esp->headerSize+entry->size);
+			}
+			free(owned);
+		}
+		if(writer.failed) result=TRIM_ERROR_WRITE;
+		if(progress&&i%TRIM_PROGRESS_STEP==0) progress(i, esp->count);
+	}
+	if(!EspWriterClose(&writer)&&!result) result=TRIM_ERROR_WRITE;
+	if(progress&&!result) progress(esp->count, esp->count);
+	espClose(esp);
+	if(result) DeleteFileA(outPath);
+	return result?result:changed;
+}
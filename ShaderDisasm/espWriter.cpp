@@ -0,0 +1,102 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "espWriter.h"
+#include "fileUtil.h"
+
+#define ESP_WRITER_BUFFER (1<<20)
+
+static void Flush(EspWriter* writer) {
+	if(!writer->used) return;
+	if(!WriteAll(writer->file, writer->buffer, writer->used)) writer->failed=true;
+	writer->flushed+=writer->used;
+	writer->used=0;
+}
+
+bool EspWriterOpen(EspWriter* writer, const char* path, DWORD headerSize) {
+	memset(writer, 0, sizeof(EspWriter));
+	writer->headerSize=headerSize;
+	writer->buffer=(BYTE*)malloc(ESP_WRITER_BUFFER);
+	if(!writer->buffer) return false;
+	writer->file=CreateFileA(path, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	if(writer->file==INVALID_HANDLE_VALUE) {
+		free(writer->buffer);
+		return false;
+	}
+	return true;
+}
+
+void EspWrite(EspWriter* writer, const void* data, DWORD length) {
+	if(writer->failed) return;
+	if(length>ESP_WRITER_BUFFER-writer->used) {
+		Flush(writer);
+		//large records go straight to disk
+		if(length>=ESP_WRITER_BUFFER) {
+			if(!WriteAll(writer->file, data, length)) writer->failed=true;
+			writer->flushed+=length;
+			return;
+		}
+	}
+	memcpy(writer->buffer+writer->used, data, length);
+	writer->used+=length;
+}
+
+static void Patch(EspWriter* writer, UINT64 offset, DWORD value) {
+	if(offset>=writer->flushed) {
+		memcpy(writer->buffer+(offset-writer->flushed), &value, 4);
+		return;
+	}
+	LARGE_INTEGER seek;
+	seek.QuadPart=offset;
+	bool ok=SetFilePointerEx(writer->file, seek, 0, FILE_BEGIN)&&WriteAll(writer->file, &value, 4);
+	seek.QuadPart=writer->flushed;
+	if(!ok||!SetFilePointerEx(writer->file, seek, 0, FILE_BEGIN)) writer->failed=true;
+}
+
+void EspBeginGroup(EspWriter* writer, const EspGroupHeader* header) {
+	if(writer->depth==ESP_WRITER_DEPTH) {
+		writer->failed=true;
+		return;
+	}
+	writer->groups[writer->depth++]=writer->flushed+writer->used;
+	EspWrite(writer, header, writer->headerSize);
+}
+
+void EspEndGroup(EspWriter* writer) {
+	if(!writer->depth) return;
+	UINT64 start=writer->groups[--writer->depth];
+	UINT64 size=writer->flushed+writer->used-start;
+	if(size>0xffffffff) writer->failed=true;
+	if(!writer->failed) Patch(writer, start+offsetof(EspGroupHeader, size), (DWORD)size);
+}
+
+void EspWriteRecord(EspWriter* writer, const EspRecordHeader* header, const BYTE* data, DWORD size) {
+	EspRecordHeader out;
+	memcpy(&out, header, writer->headerSize);
+	out.size=size;
+	EspWrite(writer, &out, writer->headerSize);
+	if(size&&data) EspWrite(writer, data, size);
+}
+
+void EspWriteSubrecord(EspWriter* writer, DWORD type, const BYTE* data, DWORD size) {
+	EspSubrecordHeader header;
+	if(size>0xffff) {
+		header.type=ESP_TYPE_XXXX;
+		header.size=4;
+		EspWrite(writer, &header, sizeof(header));
+		EspWrite(writer, &size, 4);
+	}
+	header.type=type;
+	header.size=size>0xffff?0:(WORD)size;
+	EspWrite(writer, &header, sizeof(header));
+	if(size) EspWrite(writer, data, size);
+}
+
+bool EspWriterClose(EspWriter* writer) {
+	while(writer->depth) EspEndGroup(writer);
+	Flush(writer);
+	CloseHandle(writer->file);
+	free(writer->buffer);
+	return !writer->failed;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "espFormat.h"
+
+//Writes a plugin front to back in one pass. Group sizes aren't known until everything inside a group has been
+//written, so each group's size is patched in when it ends, in the buffer if it is still there or on disk if not.
+
+//Deepest group nesting written
+#define ESP_WRITER_DEPTH 64
+
+struct EspWriter {
+	HANDLE file;
+	BYTE* buffer;
+	DWORD used;
+	UINT64 flushed;		//bytes already on disk, where the buffer starts
+	DWORD headerSize;
+	UINT64 groups[ESP_WRITER_DEPTH];	//where each open group's header starts
+	int depth;
+	bool failed;
+};
+
+bool EspWriterOpen(EspWriter* writer, const char* path, DWORD headerSize);
+//Ends any open groups and closes the file. Returns whether everything was written; if not, the file is left for
+//the caller to delete.
+bool EspWriterClose(EspWriter* writer);
+void EspWrite(EspWriter* writer, const void* data, DWORD length);
+//Writes a group header whose size is filled in by EspEndGroup
+void EspBeginGroup(EspWriter* writer, const EspGroupHeader* header);
+void EspEndGroup(EspWriter* writer);
+//Writes a record header with the given data size, followed by data if it isn't 0
+void EspWriteRecord(EspWriter* writer, const EspRecordHeader* header, const BYTE* data, DWORD size);
+//Writes a subrecord, preceding it with an XXXX subrecord if it is too large for its own size field
+void EspWriteSubrecord(EspWriter* writer, DWORD type, const BYTE* data, DWORD size);
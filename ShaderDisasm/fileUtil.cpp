@@ -0,0 +1,97 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <string.h>
+#include "fileUtil.h"
+
+bool DataPath(char* path, const char* dataPath, const char* name) {
+	DWORD length=(DWORD)strlen(dataPath);
+	DWORD nameLength=(DWORD)strlen(name);
+	if(length+nameLength+2>MAX_PATH*2) return false;
+	memcpy(path, dataPath, length);
+	path[length]='\\';
+	memcpy(path+length+1, name, nameLength+1);
+	return true;
+}
+
+bool DataStamp(const char* dataPath, const char* name, UINT64* size, UINT64* time) {
+	char path[MAX_PATH*2];
+	WIN32_FILE_ATTRIBUTE_DATA info;
+	if(!DataPath(path, dataPath, name)||!GetFileAttributesExA(path, GetFileExInfoStandard, &info)) return false;
+	*size=((UINT64)info.nFileSizeHigh<<32)|info.nFileSizeLow;
+	*time=FileTime(info.ftLastWriteTime);
+	return true;
+}
+
+UINT64 FileTime(const FILETIME& time) {
+	return ((UINT64)time.dwHighDateTime<<32)|time.dwLowDateTime;
+}
+
+void Lower(char* s) {
+	for(;*s;s++) if(*s>='A'&&*s<='Z') *s+='a'-'A';
+}
+
+bool WriteAll(HANDLE file, const void* data, DWORD length) {
+	DWORD written;
+	return WriteFile(file, data, length, &written, 0)&&written==length;
+}
+
+bool SnapshotOpen(SnapshotReader* reader, const char* path, DWORD magic) {
+	if(!path||!MapFile(&reader->map, path)) return false;
+	if(reader->map.size<4||*(const DWORD*)reader->map.data!=magic) {
+		UnmapFile(&reader->map);
+		return false;
+	}
+	reader->p=reader->map.data+4;
+	reader->end=reader->map.data+reader->map.size;
+	return true;
+}
+
+void SnapshotClose(SnapshotReader* reader) {
+	UnmapFile(&reader->map);
+}
+
+const BYTE* SnapshotRead(SnapshotReader* reader, UINT64 length) {
+	if((UINT64)(reader->end-reader->p)<length) return 0;
+	const BYTE* data=reader->p;
+	reader->p+=length;
+	return data;
+}
+
+bool SnapshotReadStamp(SnapshotReader* reader, const char** name, WORD* nameLength, UINT64* size, UINT64* time) {
+	const WORD* length=(const WORD*)SnapshotRead(reader, 2);
+	if(!length) return false;
+	*name=(const char*)SnapshotRead(reader, *length);
+	const UINT64* stamp=(const UINT64*)SnapshotRead(reader, 16);
+	if(!*name||!stamp) return false;
+	*nameLength=*length;
+	*size=stamp[0];
+	*time=stamp[1];
+	return true;
+}
+
+bool SnapshotCreate(SnapshotWriter* writer, const char* path, DWORD magic) {
+	writer->file=CreateFileA(path, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	if(writer->file==INVALID_HANDLE_VALUE) return false;
+	writer->path=path;
+	writer->ok=true;
+	SnapshotWrite(writer, &magic, 4);
+	return true;
+}
+
+void SnapshotWrite(SnapshotWriter* writer, const void* data, DWORD length) {
+	if(writer->ok&&length) writer->ok=WriteAll(writer->file, data, length);
+}
+
+void SnapshotWriteStamp(SnapshotWriter* writer, const char* name, UINT64 size, UINT64 time) {
+	WORD nameLength=(WORD)strlen(name);
+	UINT64 stamp[2]={ size, time };
+	SnapshotWrite(writer, &nameLength, 2);
+	SnapshotWrite(writer, name, nameLength);
+	SnapshotWrite(writer, stamp, 16);
+}
+
+bool SnapshotFinish(SnapshotWriter* writer) {
+	CloseHandle(writer->file);
+	if(!writer->ok) DeleteFileA(writer->path);
+	return writer->ok;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "mappedFile.h"
+
+//Helpers shared by the code that reads Data and writes archives, plugins and snapshots
+
+//Writes "dataPath\\name" into path, which holds MAX_PATH*2 characters
+bool DataPath(char* path, const char* dataPath, const char* name);
+
+//Gets the size and last write time of "dataPath\\name"
+bool DataStamp(const char* dataPath, const char* name, UINT64* size, UINT64* time);
+
+UINT64 FileTime(const FILETIME& time);
+
+//Lower cases A-Z in place, leaving any other character alone
+void Lower(char* s);
+
+bool WriteAll(HANDLE file, const void* data, DWORD length);
+
+//Snapshots are caches of what was read from Data, kept between runs. Each starts with a magic DWORD naming its
+//layout, and its entries start with the name, size and time of the file they were read from, so an entry is only
+//used while its file is unchanged. Anything that doesn't fit is ignored rather than trusted.
+
+struct SnapshotReader {
+	MappedFile map;
+	const BYTE* p;
+	const BYTE* end;
+};
+
+//Maps a snapshot and checks its magic. False if there is no snapshot of that layout at path.
+bool SnapshotOpen(SnapshotReader* reader, const char* path, DWORD magic);
+void SnapshotClose(SnapshotReader* reader);
+//Returns the next length bytes and moves past them, or 0 if the snapshot ends first
+const BYTE* SnapshotRead(SnapshotReader* reader, UINT64 length);
+//Reads the name length, name, size and time an entry starts with
+bool SnapshotReadStamp(SnapshotReader* reader, const char** name, WORD* nameLength, UINT64* size, UINT64* time);
+
+struct SnapshotWriter {
+	HANDLE file;
+	const char* path;
+	bool ok;
+};
+
+bool SnapshotCreate(SnapshotWriter* writer, const char* path, DWORD magic);
+//Does nothing once a write has failed
+void SnapshotWrite(SnapshotWriter* writer, const void* data, DWORD length);
+void SnapshotWriteStamp(SnapshotWriter* writer, const char* name, UINT64 size, UINT64 time);
+//Closes the snapshot, deleting it if any of it failed to be written. Returns whether it was all written.
+bool SnapshotFinish(SnapshotWriter* writer);
@@ -0,0 +1,34 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include "mappedFile.h"
+
+bool MapFile(MappedFile* map, const char* path) {
+	map->mapping=0;
+	map->data=0;
+	map->size=0;
+	map->file=CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if(map->file==INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(map->file, &size)||!size.QuadPart||(UINT64)size.QuadPart>(SIZE_T)-1) {
+		UnmapFile(map);
+		return false;
+	}
+	map->size=size.QuadPart;
+	map->mapping=CreateFileMappingA(map->file, 0, PAGE_READONLY, 0, 0, 0);
+	if(map->mapping) map->data=(const BYTE*)MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0);
+	if(!map->data) {
+		UnmapFile(map);
+		return false;
+	}
+	return true;
+}
+
+void UnmapFile(MappedFile* map) {
+	if(map->data) UnmapViewOfFile(map->data);
+	if(map->mapping) CloseHandle(map->mapping);
+	if(map->file&&map->file!=INVALID_HANDLE_VALUE) CloseHandle(map->file);
+	map->file=0;
+	map->mapping=0;
+	map->data=0;
+	map->size=0;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+//A read only view of a whole file
+struct MappedFile {
+	HANDLE file;
+	HANDLE mapping;
+	const BYTE* data;
+	UINT64 size;
+};
+
+bool MapFile(MappedFile* map, const char* path);
+void UnmapFile(MappedFile* map);
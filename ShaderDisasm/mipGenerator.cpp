@@ -0,0 +1,359 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <emmintrin.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mipGenerator.h"
+#include "workerPool.h"
+
+#define PI 3.14159265358979323846
+#define KAISER_ALPHA 4.0
+#define COVERAGE_REF 0.5f
+
+//Below this many pixels a level isn't worth spreading over threads
+#define PARALLEL_PIXELS 65536
+#define ROWS_PER_TASK 16
+
+//Images are kept as rows of float bgra, matching the byte order of A8R8G8B8
+struct Image {
+	float* pixels;
+	DWORD width;
+	DWORD height;
+};
+
+struct TapTable {
+	int maxTaps;
+	int* count;
+	int* index;
+	float* weight;
+};
+
+static double Sinc(double x) {
+	if(fabs(x)<1e-6) return 1;
+	x*=PI;
+	return sin(x)/x;
+}
+
+static double BesselI0(double x) {
+	double sum=1, term=1;
+	for(int k=1;k<50;k++) {
+		double t=x/(2*k);
+		term*=t*t;
+		sum+=term;
+		if(term<sum*1e-12) break;
+	}
+	return sum;
+}
+
+static double FilterWidth(int filter) {
+	return filter==MIP_BOX?0.5:3.0;
+}
+
+static double FilterWeight(int filter, double x) {
+	x=fabs(x);
+	switch(filter) {
+		case MIP_KAISER: {
+			if(x>=3) return 0;
+			double t=x/3;
+			return Sinc(x)*BesselI0(KAISER_ALPHA*sqrt(1-t*t))/BesselI0(KAISER_ALPHA);
+		}
+		case MIP_LANCZOS:
+			if(x>=3) return 0;
+			return Sinc(x)*Sinc(x/3);
+		default:
+			return x<=0.5?1:0;
+	}
+}
+
+static void FreeTaps(TapTable& t) {
+	free(t.count);
+	free(t.index);
+	free(t.weight);
+}
+
+//Precomputes the normalized source taps for every destination pixel along one axis
+static bool BuildTaps(TapTable& t, DWORD inSize, DWORD outSize, int filter, bool wrap) {
+	double scale=(double)inSize/outSize;
+	double support=FilterWidth(filter)*scale;
+	t.maxTaps=(int)(support*2)+3;
+	t.count=(int*)malloc(sizeof(int)*outSize);
+	t.index=(int*)malloc(sizeof(int)*t.maxTaps*outSize);
+	t.weight=(float*)malloc(sizeof(float)*t.maxTaps*outSize);
+	if(!t.count||!t.index||!t.weight) {
+		FreeTaps(t);
+		return false;
+	}
+	for(DWORD o=0;o<outSize;o++) {
+		double center=(o+0.5)*scale-0.5;
+		int first=(int)floor(center-support), last=(int)ceil(center+support);
+		int* index=t.index+o*t.maxTaps;
+		float* weight=t.weight+o*t.maxTaps;
+		double sum=0;
+		int n=0;
+		for(int j=first;j<=last&&n<t.maxTaps;j++) {
+			double w=FilterWeight(filter, (j-center)/scale);
+			if(w==0) continue;
+			int i=j;
+			if(wrap) i=((i%(int)inSize)+inSize)%inSize;
+			else if(i<0) i=0;
+			else if(i>=(int)inSize) i=inSize-1;
+			index[n]=i;
+			weight[n]=(float)w;
+			sum+=w;
+			n++;
+		}
+		if(n==0||sum==0) {
+			int i=(int)(center+0.5);
+			index[0]=i<0?0:(i>=(int)inSize?inSize-1:i);
+			weight[0]=1;
+			n=1;
+		} else {
+			for(int k=0;k<n;k++) weight[k]=(float)(weight[k]/sum);
+		}
+		t.count[o]=n;
+	}
+	return true;
+}
+
+struct RowJob;
+typedef void (*RowFunc)(RowJob* job, DWORD y);
+
+struct RowJob {
+	RowFunc func;
+	DWORD rows;
+	const Image* src;
+	Image* dst;
+	const TapTable* taps;
+	const BYTE* bytes;
+	BYTE* out;
+	DWORD pitch;
+	const float* lut;
+	DWORD options;
+	float alphaScale;
+};
+
+static void RowTask(int index, void* context) {
+	RowJob* job=(RowJob*)context;
+	DWORD end=(index+1)*ROWS_PER_TASK;
+	if(end>job->rows) end=job->rows;
+	for(DWORD y=index*ROWS_PER_TASK;y<end;y++) job->func(job, y);
+}
+
+static void RunRows(RowJob* job, DWORD rows, DWORD width) {
+	job->rows=rows;
+	int tasks=(rows+ROWS_PER_TASK-1)/ROWS_PER_TASK;
+	if((UINT64)rows*width>=PARALLEL_PIXELS) ParallelFor(tasks, RowTask, job);
+	else for(int i=0;i<tasks;i++) RowTask(i, job);
+}
+
+static void HorizontalRow(RowJob* job, DWORD y) {
+	const float* in=job->src->pixels+(size_t)y*job->src->width*4;
+	float* out=job->dst->pixels+(size_t)y*job->dst->width*4;
+	const TapTable* t=job->taps;
+	for(DWORD x=0;x<job->dst->width;x++) {
+		const int* index=t->index+x*t->maxTaps;
+		const float* weight=t->weight+x*t->maxTaps;
+		__m128 acc=_mm_setzero_ps();
+		for(int k=0;k<t->count[x];k++) acc=_mm_add_ps(acc, _mm_mul_ps(_mm_load_ps(in+index[k]*4), _mm_set1_ps(weight[k])));
+		_mm_store_ps(out+x*4, acc);
+	}
+}
+
+static void VerticalRow(RowJob* job, DWORD y) {
+	const TapTable* t=job->taps;
+	const int* index=t->index+y*t->maxTaps;
+	const float* weight=t->weight+y*t->maxTaps;
+	DWORD floats=job->dst->width*4;
+	float* out=job->dst->pixels+(size_t)y*floats;
+	memset(out, 0, floats*sizeof(float));
+	for(int k=0;k<t->count[y];k++) {
+		const float* in=job->src->pixels+(size_t)index[k]*floats;
+		__m128 w=_mm_set1_ps(weight[k]);
+		for(DWORD i=0;i<floats;i+=4) _mm_store_ps(out+i, _mm_add_ps(_mm_load_ps(out+i), _mm_mul_ps(_mm_load_ps(in+i), w)));
+	}
+}
+
+static void DecodeRow(RowJob* job, DWORD y) {
+	const BYTE* in=job->bytes+(size_t)y*job->pitch;
+	float* out=job->dst->pixels+(size_t)y*job->dst->width*4;
+	const float* lut=job->lut;
+	for(DWORD x=0;x<job->dst->width;x++,in+=4,out+=4) {
+		out[0]=lut[in[0]];
+		out[1]=lut[in[1]];
+		out[2]=lut[in[2]];
+		out[3]=in[3]*(1.0f/255);
+	}
+}
+
+static void NormalizeRow(RowJob* job, DWORD y) {
+	float* p=job->dst->pixels+(size_t)y*job->dst->width*4;
+	for(DWORD x=0;x<job->dst->width;x++,p+=4) {
+		float len=p[0]*p[0]+p[1]*p[1]+p[2]*p[2];
+		if(len<1e-12f) {
+			p[0]=1;	//b, so the normal points straight out
+			continue;
+		}
+		len=1/sqrtf(len);
+		p[0]*=len;
+		p[1]*=len;
+		p[2]*=len;
+	}
+}
+
+static BYTE Quantize(float f) {
+	if(!(f>0)) return 0;
+	if(f>=1) return 255;
+	return (BYTE)(f*255+0.5f);
+}
+
+static void EncodeRow(RowJob* job, DWORD y) {
+	const float* in=job->src->pixels+(size_t)y*job->src->width*4;
+	BYTE* out=job->out+(size_t)y*job->src->width*4;
+	DWORD options=job->options;
+	for(DWORD x=0;x<job->src->width;x++,in+=4,out+=4) {
+		for(int c=0;c<3;c++) {
+			float f=in[c];
+			if(options&MIP_NORMALMAP) {
+				f=f*0.5f+0.5f;
+			} else if(options&MIP_SRGB) {
+				//job->lut holds the 4096 entry linear to srgb table here
+				int i=f<=0?0:(f>=1?4095:(int)(f*4095+0.5f));
+				f=job->lut[i];
+			}
+			out[c]=Quantize(f);
+		}
+		out[3]=Quantize(in[3]*job->alphaScale);
+	}
+}
+
+static float Coverage(const Image& img, float scale) {
+	size_t pixels=(size_t)img.width*img.height, passed=0;
+	const float* a=img.pixels+3;
+	for(size_t i=0;i<pixels;i++,a+=4) if(*a*scale>=COVERAGE_REF) passed++;
+	return (float)passed/pixels;
+}
+
+//Finds the alpha scale that brings a level's alpha test coverage back to the top level's
+static float CoverageScale(const Image& img, float target) {
+	float lo=0, hi=4;
+	for(int i=0;i<12;i++) {
+		float mid=(lo+hi)/2;
+		if(Coverage(img, mid)<target) lo=mid;
+		else hi=mid;
+	}
+	return hi;
+}
+
+static bool AllocImage(Image& img, DWORD width, DWORD height) {
+	img.width=width;
+	img.height=height;
+	img.pixels=(float*)_aligned_malloc((size_t)width*height*4*sizeof(float), 16);
+	return img.pixels!=0;
+}
+
+static bool Downsample(const Image& src, Image& dst, DWORD width, DWORD height, int filter, bool wrap) {
+	TapTable horz, vert;
+	Image tmp;
+	if(!BuildTaps(horz, src.width, width, filter, wrap)) return false;
+	if(!BuildTaps(vert, src.height, height, filter, wrap)) {
+		FreeTaps(horz);
+		return false;
+	}
+	bool ok=AllocImage(tmp, width, src.height)&&AllocImage(dst, width, height);
+	if(ok) {
+		RowJob job={};
+		job.func=HorizontalRow;
+		job.src=&src;
+		job.dst=&tmp;
+		job.taps=&horz;
+		RunRows(&job, src.height, width);
+		job.func=VerticalRow;
+		job.src=&tmp;
+		job.dst=&dst;
+		job.taps=&vert;
+		RunRows(&job, height, width);
+	}
+	if(tmp.pixels) _aligned_free(tmp.pixels);
+	FreeTaps(horz);
+	FreeTaps(vert);
+	return ok;
+}
+
+BYTE* GenerateMips(const BYTE* top, DWORD width, DWORD height, DWORD pitch, DWORD levels, DWORD options) {
+	int filter=options&MIP_FILTER_MASK;
+	if(filter<MIP_BOX||filter>MIP_LANCZOS) filter=MIP_BOX;
+	if(options&MIP_NORMALMAP) options&=~MIP_SRGB;
+	bool wrap=(options&MIP_WRAP)!=0;
+	if(levels<2||!width||!height) return 0;
+
+	size_t total=0;
+	for(DWORD i=1;i<levels;i++) {
+		DWORD w=width>>i, h=height>>i;
+		total+=(size_t)(w?w:1)*(h?h:1)*4;
+	}
+	BYTE* result=(BYTE*)malloc(total);
+	if(!result) return 0;
+
+	float decode[256];
+	float encode[4096];
+	for(int i=0;i<256;i++) {
+		float f=i/255.0f;
+		if(options&MIP_NORMALMAP) f=f*2-1;
+		else if(options&MIP_SRGB) f=f<=0.04045f?f/12.92f:powf((f+0.055f)/1.055f, 2.4f);
+		decode[i]=f;
+	}
+	if(options&MIP_SRGB) {
+		for(int i=0;i<4096;i++) {
+			float f=i/4095.0f;
+			encode[i]=f<=0.0031308f?f*12.92f:1.055f*powf(f, 1/2.4f)-0.055f;
+		}
+	}
+
+	Image cur;
+	if(!AllocImage(cur, width, height)) {
+		free(result);
+		return 0;
+	}
+	RowJob job={};
+	job.func=DecodeRow;
+	job.dst=&cur;
+	job.bytes=top;
+	job.pitch=pitch;
+	job.lut=decode;
+	RunRows(&job, height, width);
+	float target=(options&MIP_ALPHA_COVERAGE)?Coverage(cur, 1):0;
+
+	BYTE* out=result;
+	for(DWORD i=1;i<levels;i++) {
+		DWORD w=width>>i, h=height>>i;
+		if(!w) w=1;
+		if(!h) h=1;
+		Image next;
+		//each level is filtered from the full precision level above it
+		if(!Downsample(cur, next, w, h, filter, wrap)) {
+			_aligned_free(cur.pixels);
+			free(result);
+			return 0;
+		}
+		_aligned_free(cur.pixels);
+		cur=next;
+
+		RowJob level={};
+		level.dst=&cur;
+		if(options&MIP_NORMALMAP) {
+			level.func=NormalizeRow;
+			RunRows(&level, h, w);
+		}
+		level.func=EncodeRow;
+		level.src=&cur;
+		level.out=out;
+		level.lut=encode;
+		level.options=options;
+		level.alphaScale=(options&MIP_ALPHA_COVERAGE)&&target>0?CoverageScale(cur, target):1;
+		RunRows(&level, h, w);
+		out+=(size_t)w*h*4;
+	}
+	_aligned_free(cur.pixels);
+	return result;
+}
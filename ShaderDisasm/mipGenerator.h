@@ -0,0 +1,16 @@
+#pragma once
+
+//Mip chain generation for ddsSave. The low byte of the options picks the filter, the rest are flags.
+#define MIP_FILTER_MASK 0xff
+#define MIP_BOX 1
+#define MIP_KAISER 2
+#define MIP_LANCZOS 3
+
+#define MIP_SRGB 0x100				//filter colour in linear space
+#define MIP_ALPHA_COVERAGE 0x200	//keep the fraction of pixels passing an alpha test at 0.5 constant
+#define MIP_NORMALMAP 0x400			//renormalize rgb as a tangent space normal
+#define MIP_WRAP 0x800				//sample across the edges of tiling textures instead of clamping
+
+//Builds levels 1 to levels-1 from a top level in A8R8G8B8. The levels are returned back to back in one
+//buffer, tightly packed at 4 bytes a pixel, and the caller frees it with free(). Returns 0 on failure.
+BYTE* GenerateMips(const BYTE* top, DWORD width, DWORD height, DWORD pitch, DWORD levels, DWORD options);
@@ -0,0 +1,81 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include "orderedWriter.h"
+#include "workerPool.h"
+
+struct OrderedJob {
+	int count;
+	OrderedProcess process;
+	OrderedWrite write;
+	OrderedProgress progress;
+	void* context;
+	bool* ready;
+
+	CRITICAL_SECTION lock;
+	CONDITION_VARIABLE cond;
+	int window;
+	int written;
+	bool draining;
+	volatile LONG error;
+};
+
+//Writes out every finished item that is next in order. Only one thread drains at a time, and the lock is
+//dropped around the actual writes so the other workers can keep going.
+static void Drain(OrderedJob* job) {
+	if(job->draining) return;
+	job->draining=true;
+	while(job->written<job->count&&job->ready[job->written]) {
+		int index=job->written;
+		LeaveCriticalSection(&job->lock);
+		if(!job->error) {
+			int result=job->write(index, job->context);
+			if(result) InterlockedCompareExchange(&job->error, result, 0);
+		}
+		int done=index+1;
+		if(job->progress&&(done%100==0||done==job->count)) job->progress(done, job->count);
+		EnterCriticalSection(&job->lock);
+		job->written++;
+		WakeAllConditionVariable(&job->cond);
+	}
+	job->draining=false;
+}
+
+static void OrderedTask(int index, void* context) {
+	OrderedJob* job=(OrderedJob*)context;
+	EnterCriticalSection(&job->lock);
+	while(index>=job->written+job->window) SleepConditionVariableCS(&job->cond, &job->lock, INFINITE);
+	LeaveCriticalSection(&job->lock);
+
+	if(!job->error) {
+		int result=job->process(index, job->context);
+		if(result) InterlockedCompareExchange(&job->error, result, 0);
+	}
+
+	EnterCriticalSection(&job->lock);
+	job->ready[index]=true;
+	Drain(job);
+	LeaveCriticalSection(&job->lock);
+}
+
+int OrderedFor(int count, int window, OrderedProcess process, OrderedWrite write, OrderedProgress progress,
+	void* context, int noMemory) {
+	OrderedJob job;
+	job.count=count;
+	job.process=process;
+	job.write=write;
+	job.progress=progress;
+	job.context=context;
+	job.ready=(bool*)calloc(count>0?count:1, sizeof(bool));
+	if(!job.ready) return noMemory;
+	job.window=WorkerCount()*window;
+	job.written=0;
+	job.draining=false;
+	job.error=0;
+	InitializeCriticalSection(&job.lock);
+	InitializeConditionVariable(&job.cond);
+	ParallelFor(count, OrderedTask, &job);
+	DeleteCriticalSection(&job.lock);
+	free(job.ready);
+	return job.error;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+//Processes items on every core but writes them out one at a time in index order, as an archive's data has to be.
+//Whichever worker finishes the item next due writes it, and any finished items behind it, with the lock dropped so
+//the other workers keep going. Workers only run up to window items per core ahead of the one being written, which
+//bounds how much processed data waits in memory.
+
+//Both return 0, or an error that stops any further items being processed or written
+typedef int (*OrderedProcess)(int index, void* context);
+typedef int (*OrderedWrite)(int index, void* context);
+
+typedef void (_stdcall *OrderedProgress)(int done, int total);
+
+//Runs process and then write for each of count items, calling progress, if given, every 100 items written.
+//Returns 0, the first error either returned, or noMemory if the items can't be tracked. Items that are never
+//written are left for the caller to release.
+int OrderedFor(int count, int window, OrderedProcess process, OrderedWrite write, OrderedProgress progress,
+	void* context, int noMemory);
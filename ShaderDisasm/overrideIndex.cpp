@@ -0,0 +1,515 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "espReader.h"
+#include "contentHash.h"
+#include "fileUtil.h"
+#include "workerPool.h"
+
+//Which plugins of a load order hold each record. Plugins refer to records through their own master lists, so
+//every form id is first resolved to the plugin defining the record, by name, and the id within it. The masters
+//and form ids of each plugin are kept in a snapshot file. A plugin is only reread once its size or time changes,
+//and even then its listing is reused if its contents still hash the same.
+//Each plugin can also be given a note: one subrecord of a record found by editor id, such as the critical records a
+//mod declares, kept in the snapshot alongside the listing so callers needing it don't have to open the plugin.
+
+//ovrPluginState results
+#define OVR_READ 0
+#define OVR_CACHED 1
+#define OVR_MISSING -1
+
+#define SNAPSHOT_MAGIC 0x3252564F	//"OVR2"
+#define NO_NOTE 0xffffffff
+
+struct OvrPlugin {
+	char* name;
+	char* key;			//lower case name
+	UINT64 size;
+	UINT64 time;
+	UINT64 hash;
+	char* masters;		//lower case, NUL separated
+	DWORD mastersLength;
+	int masterCount;
+	DWORD* formIds;		//of every record but the header, sorted and distinct, as the plugin refers to them
+	DWORD formIdCount;
+	BYTE* note;			//data of the note subrecord up to any NUL, or 0 if the plugin has none
+	DWORD noteLength;
+	int state;
+	bool stale;			//listing came from the snapshot under a different time and needs its hash checking
+	int* definers;		//name of each master, then of the plugin itself
+};
+
+//Where each plugin's note is found
+struct OvrNote {
+	DWORD type;
+	const char* editorId;	//or 0 for no notes
+	DWORD subrecord;
+};
+
+struct OvrIndex {
+	OvrPlugin* plugins;
+	int pluginCount;
+	const char** names;		//every plugin named by the load order or a master list
+	int nameCount;
+	DWORD recordCount;
+	UINT64* recordKey;		//defining name<<24 | id within the definer
+	DWORD* table;			//record index+1 for each slot, or 0 if empty
+	int tableBits;
+	DWORD* holderFirst;		//index of each record's first holder, plus the holder count at the end
+	int* holders;			//plugins holding each record, in load order
+	DWORD* overrideFirst;	//index of each plugin's first override, plus the override count at the end
+	DWORD* overrides;		//form ids, as each plugin refers to them, of records an earlier plugin holds too
+};
+
+struct OvrBuild {
+	const char* dataPath;
+	const OvrNote* note;
+	OvrIndex* ovr;
+	int* pending;
+};
+
+static int CompareFormIds(const void* a, const void* b) {
+	DWORD x=*(const DWORD*)a, y=*(const DWORD*)b;
+	return x<y?-1:x>y;
+}
+
+static void FreeListing(OvrPlugin* plugin) {
+	free(plugin->masters);
+	free(plugin->formIds);
+	free(plugin->note);
+	plugin->masters=0;
+	plugin->formIds=0;
+	plugin->note=0;
+	plugin->noteLength=0;
+	plugin->mastersLength=0;
+	plugin->masterCount=0;
+	plugin->formIdCount=0;
+}
+
+//Copies the first subrecord of the note's type from the record holding the note, if the plugin has one
+static bool ReadNote(OvrPlugin* plugin, EspFile* esp, const OvrNote* note) {
+	int record=note->editorId?espFindEditorId(esp, note->type, note->editorId):-1;
+	if(record<0) return true;
+	DWORD size;
+	BYTE* owned;
+	const BYTE* data=EspRecordData(esp, record, &size, &owned);
+	int count=data?EspSplitSubrecords(data, size, 0, 0):-1;
+	EspSubrecord* subrecords=count>0?(EspSubrecord*)malloc(sizeof(EspSubrecord)*count):0;
+	bool ok=count<=0||subrecords;
+	if(subrecords) {
+		EspSplitSubrecords(data, size, subrecords, count);
+		for(int i=0;i<count;i++) {
+			if(subrecords[i].type!=note->subrecord) continue;
+			const BYTE* text=data+subrecords[i].offset;
+			const BYTE* end=(const BYTE*)memchr(text, 0, subrecords[i].size);
+			DWORD length=end?(DWORD)(end-text):subrecords[i].size;
+			plugin->note=(BYTE*)malloc(length?length:1);
+			ok=plugin->note!=0;
+			if(ok) {
+				memcpy(plugin->note, text, length);
+				plugin->noteLength=length;
+			}
+			break;
+		}
+	}
+	free(subrecords);
+	free(owned);
+	return ok;
+}
+
+static bool ReadPlugin(OvrPlugin* plugin, EspFile* esp, const OvrNote* note) {
+	plugin->hash=ContentHash(esp->file.data, (SIZE_T)esp->file.size, 0);
+	char name[MAX_PATH];
+	DWORD length=0;
+	for(int i=0;i<espMasterCount(esp);i++) length+=espMasterName(esp, i, name, MAX_PATH)+1;
+	plugin->masters=(char*)malloc(length?length:1);
+	plugin->formIds=(DWORD*)malloc(sizeof(DWORD)*(esp->recordCount?esp->recordCount:1));
+	if(!plugin->masters||!plugin->formIds) return false;
+	for(int i=0;i<espMasterCount(esp);i++) {
+		int nameLength=espMasterName(esp, i, plugin->masters+plugin->mastersLength, MAX_PATH);
+		if(nameLength<0) return false;
+		Lower(plugin->masters+plugin->mastersLength);
+		plugin->mastersLength+=nameLength+1;
+		plugin->masterCount++;
+	}
+	for(int i=1;i<esp->count;i++) {
+		if(esp->entries[i].type!=ESP_TYPE_GRUP) plugin->formIds[plugin->formIdCount++]=esp->entries[i].formId;
+	}
+	qsort(plugin->formIds, plugin->formIdCount, sizeof(DWORD), CompareFormIds);
+	DWORD distinct=0;
+	for(DWORD i=0;i<plugin->formIdCount;i++) {
+		if(!distinct||plugin->formIds[distinct-1]!=plugin->formIds[i]) plugin->formIds[distinct++]=plugin->formIds[i];
+	}
+	plugin->formIdCount=distinct;
+	return ReadNote(plugin, esp, note);
+}
+
+static void ReadTask(int index, void* context) {
+	OvrBuild* build=(OvrBuild*)context;
+	OvrPlugin* plugin=&build->ovr->plugins[build->pending[index]];
+	char path[MAX_PATH*2];
+	if(!DataPath(path, build->dataPath, plugin->name)) {
+		plugin->state=OVR_MISSING;
+		return;
+	}
+	if(plugin->stale) {
+		//a plugin saved again unchanged, or copied back from a backup, keeps its listing
+		MappedFile map;
+		if(MapFile(&map, path)) {
+			bool same=ContentHash(map.data, (SIZE_T)map.size, 0)==plugin->hash;
+			UnmapFile(&map);
+			if(same) {
+				plugin->state=OVR_CACHED;
+				return;
+			}
+		}
+		FreeListing(plugin);
+	}
+	EspFile* esp=espOpen(path);
+	if(!esp) {
+		plugin->state=OVR_MISSING;
+		return;
+	}
+	plugin->state=ReadPlugin(plugin, esp, build->note)?OVR_READ:OVR_MISSING;
+	espClose(esp);
+	if(plugin->state==OVR_MISSING) FreeListing(plugin);
+}
+
+//Snapshot layout: magic, plugin count, the note's type, subrecord, editor id length and editor id, then for each
+//plugin its name length, name, size, time, hash, master count, masters length, masters, form id count, form ids,
+//note length, or NO_NOTE, and note
+static void LoadSnapshot(const char* path, OvrIndex* ovr, const OvrNote* note) {
+	SnapshotReader reader;
+	if(!SnapshotOpen(&reader, path, SNAPSHOT_MAGIC)) return;
+	DWORD editorIdLength=note->editorId?(DWORD)strlen(note->editorId):0;
+	const DWORD* header=(const DWORD*)SnapshotRead(&reader, 12);
+	const WORD* storedLength=(const WORD*)SnapshotRead(&reader, 2);
+	const BYTE* editorId=SnapshotRead(&reader, editorIdLength);
+	//notes of another record are no use
+	if(!header||!storedLength||*storedLength!=editorIdLength||!editorId||header[1]!=note->type||
+		header[2]!=note->subrecord||memcmp(editorId, note->editorId, editorIdLength)) {
+		SnapshotClose(&reader);
+		return;
+	}
+	for(DWORD i=0;i<header[0];i++) {
+		const char* name;
+		WORD nameLength;
+		UINT64 size, time;
+		if(!SnapshotReadStamp(&reader, &name, &nameLength, &size, &time)) break;
+		const UINT64* hash=(const UINT64*)SnapshotRead(&reader, 8);
+		const DWORD* counts=(const DWORD*)SnapshotRead(&reader, 8);
+		if(!hash||!counts) break;
+		DWORD masterCount=counts[0];
+		DWORD mastersLength=counts[1];
+		const char* masters=(const char*)SnapshotRead(&reader, mastersLength);
+		const DWORD* formIdCount=(const DWORD*)SnapshotRead(&reader, 4);
+		if(!masters||!formIdCount) break;
+		const DWORD* formIds=(const DWORD*)SnapshotRead(&reader, (UINT64)*formIdCount*4);
+		const DWORD* noteLength=(const DWORD*)SnapshotRead(&reader, 4);
+		if(!formIds||!noteLength) break;
+		const BYTE* noteData=*noteLength==NO_NOTE?0:SnapshotRead(&reader, *noteLength);
+		if(*noteLength!=NO_NOTE&&!noteData) break;
+		if(mastersLength&&masters[mastersLength-1]) break;
+		DWORD terminators=0;
+		for(DWORD j=0;j<mastersLength;j++) if(!masters[j]) terminators++;
+		if(terminators!=masterCount) break;
+		for(int s=0;s<ovr->pluginCount;s++) {
+			OvrPlugin* plugin=&ovr->plugins[s];
+			if(plugin->state!=OVR_READ||plugin->masters||plugin->size!=size) continue;
+			if(strlen(plugin->key)!=nameLength||memcmp(plugin->key, name, nameLength)) continue;
+			plugin->masters=(char*)malloc(mastersLength?mastersLength:1);
+			plugin->formIds=(DWORD*)malloc(*formIdCount?*formIdCount*4:1);
+			if(noteData) plugin->note=(BYTE*)malloc(*noteLength?*noteLength:1);
+			if(!plugin->masters||!plugin->formIds||(noteData&&!plugin->note)) {
+				FreeListing(plugin);
+				continue;
+			}
+			memcpy(plugin->masters, masters, mastersLength);
+			memcpy(plugin->formIds, formIds, *formIdCount*4);
+			if(plugin->note) {
+				memcpy(plugin->note, noteData, *noteLength);
+				plugin->noteLength=*noteLength;
+			}
+			plugin->mastersLength=mastersLength;
+			plugin->masterCount=masterCount;
+			plugin->formIdCount=*formIdCount;
+			plugin->hash=*hash;
+			if(plugin->time==time) plugin->state=OVR_CACHED;
+			else plugin->stale=true;
+		}
+	}
+	SnapshotClose(&reader);
+}
+
+static void SaveSnapshot(const char* path, const OvrIndex* ovr, const OvrNote* note) {
+	SnapshotWriter writer;
+	if(!SnapshotCreate(&writer, path, SNAPSHOT_MAGIC)) return;
+	DWORD header[3]={ 0, note->type, note->subrecord };
+	for(int i=0;i<ovr->pluginCount;i++) if(ovr->plugins[i].state!=OVR_MISSING) header[0]++;
+	WORD editorIdLength=note->editorId?(WORD)strlen(note->editorId):0;
+	SnapshotWrite(&writer, header, 12);
+	SnapshotWrite(&writer, &editorIdLength, 2);
+	SnapshotWrite(&writer, note->editorId, editorIdLength);
+	for(int i=0;i<ovr->pluginCount;i++) {
+		const OvrPlugin* plugin=&ovr->plugins[i];
+		if(plugin->state==OVR_MISSING) continue;
+		DWORD counts[2]={ (DWORD)plugin->masterCount, plugin->mastersLength };
+		DWORD noteLength=plugin->note?plugin->noteLength:NO_NOTE;
+		SnapshotWriteStamp(&writer, plugin->key, plugin->size, plugin->time);
+		SnapshotWrite(&writer, &plugin->hash, 8);
+		SnapshotWrite(&writer, counts, 8);
+		SnapshotWrite(&writer, plugin->masters, plugin->mastersLength);
+		SnapshotWrite(&writer, &plugin->formIdCount, 4);
+		SnapshotWrite(&writer, plugin->formIds, plugin->formIdCount*4);
+		SnapshotWrite(&writer, &noteLength, 4);
+		SnapshotWrite(&writer, plugin->note, plugin->noteLength);
+	}
+	SnapshotFinish(&writer);
+}
+
+static bool AddPlugins(OvrIndex* ovr, const char* dataPath, const char* const* plugins, int count) {
+	ovr->plugins=(OvrPlugin*)calloc(count?count:1, sizeof(OvrPlugin));
+	if(!ovr->plugins) return false;
+	for(int i=0;i<count;i++) {
+		OvrPlugin* plugin=&ovr->plugins[ovr->pluginCount++];
+		size_t length=strlen(plugins[i]);
+		plugin->name=(char*)malloc(length+1);
+		plugin->key=(char*)malloc(length+1);
+		if(!plugin->name||!plugin->key) return false;
+		memcpy(plugin->name, plugins[i], length+1);
+		memcpy(plugin->key, plugins[i], length+1);
+		Lower(plugin->key);
+		if(!DataStamp(dataPath, plugin->name, &plugin->size, &plugin->time)) plugin->state=OVR_MISSING;
+	}
+	return true;
+}
+
+static int NameIndex(OvrIndex* ovr, const char* name) {
+	for(int i=0;i<ovr->nameCount;i++) if(!strcmp(ovr->names[i], name)) return i;
+	ovr->names[ovr->nameCount]=name;
+	return ovr->nameCount++;
+}
+
+//Gives every plugin and master a name index, so a form id can be turned into the plugin defining the record
+static bool ResolveMasters(OvrIndex* ovr) {
+	int total=ovr->pluginCount;
+	for(int i=0;i<ovr->pluginCount;i++) total+=ovr->plugins[i].masterCount;
+	ovr->names=(const char**)malloc(sizeof(char*)*(total?total:1));
+	if(!ovr->names) return false;
+	for(int i=0;i<ovr->pluginCount;i++) {
+		OvrPlugin* plugin=&ovr->plugins[i];
+		plugin->definers=(int*)malloc(sizeof(int)*(plugin->masterCount+1));
+		if(!plugin->definers) return false;
+		const char* master=plugin->masters;
+		for(int m=0;m<plugin->masterCount;m++) {
+			plugin->definers[m]=NameIndex(ovr, master);
+			master+=strlen(master)+1;
+		}
+		plugin->definers[plugin->masterCount]=NameIndex(ovr, plugin->key);
+	}
+	return true;
+}
+
+static inline UINT64 RecordKey(const OvrPlugin* plugin, DWORD formId) {
+	DWORD master=formId>>24;
+	int definer=plugin->definers[master<(DWORD)plugin->masterCount?master:plugin->masterCount];
+	return ((UINT64)definer<<24)|(formId&0xffffff);
+}
+
+static inline DWORD KeySlot(UINT64 key, int bits) {
+	return (DWORD)((key*0x9e3779b97f4a7c15ull)>>(64-bits));
+}
+
+static DWORD FindRecord(const OvrIndex* ovr, UINT64 key) {
+	DWORD mask=(1u<<ovr->tableBits)-1;
+	for(DWORD slot=KeySlot(key, ovr->tableBits);ovr->table[slot];slot=(slot+1)&mask) {
+		DWORD record=ovr->table[slot]-1;
+		if(ovr->recordKey[record]==key) return record;
+	}
+	return (DWORD)-1;
+}
+
+//Gives every distinct record an index, then groups the holders of each record in load order and the overrides of
+//each plugin. A plugin listing a master twice can refer to one record by two ids, so holders are kept distinct.
+static bool BuildIndex(OvrIndex* ovr) {
+	DWORD total=0;
+	for(int i=0;i<ovr->pluginCount;i++) total+=ovr->plugins[i].formIdCount;
+	ovr->tableBits=4;
+	while((1u<<ovr->tableBits)<total*2) ovr->tableBits++;
+	DWORD mask=(1u<<ovr->tableBits)-1;
+	ovr->table=(DWORD*)calloc(mask+1, sizeof(DWORD));
+	ovr->recordKey=(UINT64*)malloc(sizeof(UINT64)*(total+1));
+	DWORD* held=(DWORD*)malloc(sizeof(DWORD)*(total+1));
+	int* lastHolder=(int*)malloc(sizeof(int)*(total+1));
+	ovr->overrideFirst=(DWORD*)calloc(ovr->pluginCount+1, sizeof(DWORD));
+	if(!ovr->table||!ovr->recordKey||!held||!lastHolder||!ovr->overrideFirst) {
+		free(held);
+		free(lastHolder);
+		return false;
+	}
+
+	DWORD count=0;
+	for(int p=0;p<ovr->pluginCount;p++) {
+		const OvrPlugin* plugin=&ovr->plugins[p];
+		for(DWORD i=0;i<plugin->formIdCount;i++) {
+			UINT64 key=RecordKey(plugin, plugin->formIds[i]);
+			DWORD record=FindRecord(ovr, key);
+			if(record==(DWORD)-1) {
+				record=ovr->recordCount++;
+				ovr->recordKey[record]=key;
+				lastHolder[record]=-1;
+				DWORD slot=KeySlot(key, ovr->tableBits);
+				while(ovr->table[slot]) slot=(slot+1)&mask;
+				ovr->table[slot]=record+1;
+			} else {
+				ovr->overrideFirst[p+1]++;
+			}
+			held[count++]=record;
+		}
+	}
+
+	ovr->holderFirst=(DWORD*)calloc(ovr->recordCount+1, sizeof(DWORD));
+	ovr->holders=(int*)malloc(sizeof(int)*(count+1));
+	for(int p=0;p<ovr->pluginCount;p++) ovr->overrideFirst[p+1]+=ovr->overrideFirst[p];
+	ovr->overrides=(DWORD*)malloc(sizeof(DWORD)*(ovr->overrideFirst[ovr->pluginCount]+1));
+	if(!ovr->holderFirst||!ovr->holders||!ovr->overrides) {
+		free(held);
+		free(lastHolder);
+		return false;
+	}
+	//counting sort keeps each record's holders in load order
+	DWORD next=0;
+	for(int p=0;p<ovr->pluginCount;p++) {
+		DWORD end=next+ovr->plugins[p].formIdCount;
+		for(;next<end;next++) {
+			if(lastHolder[held[next]]==p) continue;
+			lastHolder[held[next]]=p;
+			ovr->holderFirst[held[next]+1]++;
+		}
+	}
+	for(DWORD i=0;i<ovr->recordCount;i++) ovr->holderFirst[i+1]+=ovr->holderFirst[i];
+	for(DWORD i=0;i<ovr->recordCount;i++) lastHolder[i]=-1;
+	DWORD* fill=(DWORD*)malloc(sizeof(DWORD)*(ovr->recordCount+1));
+	if(!fill) {
+		free(held);
+		free(lastHolder);
+		return false;
+	}
+	memcpy(fill, ovr->holderFirst, sizeof(DWORD)*ovr->recordCount);
+	next=0;
+	for(int p=0;p<ovr->pluginCount;p++) {
+		const OvrPlugin* plugin=&ovr->plugins[p];
+		DWORD overrides=ovr->overrideFirst[p];
+		for(DWORD i=0;i<plugin->formIdCount;i++,next++) {
+			DWORD record=held[next];
+			//the first plugin to hold a record filled its first slot
+			if(fill[record]!=ovr->holderFirst[record]) ovr->overrides[overrides++]=plugin->formIds[i];
+			if(lastHolder[record]==p) continue;
+			lastHolder[record]=p;
+			ovr->holders[fill[record]++]=p;
+		}
+	}
+	free(fill);
+	free(held);
+	free(lastHolder);
+	return true;
+}
+
+void _stdcall ovrClose(OvrIndex* ovr) {
+	if(!ovr) return;
+	for(int i=0;i<ovr->pluginCount;i++) {
+		free(ovr->plugins[i].name);
+		free(ovr->plugins[i].key);
+		free(ovr->plugins[i].definers);
+		FreeListing(&ovr->plugins[i]);
+	}
+	free(ovr->plugins);
+	free(ovr->names);
+	free(ovr->recordKey);
+	free(ovr->table);
+	free(ovr->holderFirst);
+	free(ovr->holders);
+	free(ovr->overrideFirst);
+	free(ovr->overrides);
+	free(ovr);
+}
+
+//Indexes the records of the given plugins, in load order, reading them from dataPath across all cores. If
+//snapshot is given, unchanged plugins are listed from it and it is rewritten if any had to be read. If noteEditorId
+//isn't 0, each plugin's note is the first noteSubrecord of its noteType record with that editor id.
+OvrIndex* _stdcall ovrOpen(const char* dataPath, const char* const* plugins, int count, const char* snapshot,
+	DWORD noteType, const char* noteEditorId, DWORD noteSubrecord) {
+	OvrNote note={ noteType, noteEditorId, noteSubrecord };
+	if(note.editorId&&strlen(note.editorId)>MAX_PATH) return 0;
+	OvrIndex* ovr=(OvrIndex*)calloc(1, sizeof(OvrIndex));
+	if(!ovr) return 0;
+	OvrBuild build;
+	build.dataPath=dataPath;
+	build.note=&note;
+	build.ovr=ovr;
+	build.pending=0;
+	if(!AddPlugins(ovr, dataPath, plugins, count)||!(build.pending=(int*)malloc(sizeof(int)*(count?count:1)))) {
+		free(build.pending);
+		ovrClose(ovr);
+		return 0;
+	}
+	LoadSnapshot(snapshot, ovr, &note);
+	int pending=0;
+	for(int i=0;i<ovr->pluginCount;i++) {
+		if(ovr->plugins[i].state==OVR_READ||ovr->plugins[i].stale) build.pending[pending++]=i;
+	}
+	ParallelFor(pending, ReadTask, &build);
+	free(build.pending);
+	if(snapshot&&pending) SaveSnapshot(snapshot, ovr, &note);
+	if(!ResolveMasters(ovr)||!BuildIndex(ovr)) {
+		ovrClose(ovr);
+		return 0;
+	}
+	return ovr;
+}
+
+int _stdcall ovrPluginCount(OvrIndex* ovr) {
+	return ovr->pluginCount;
+}
+
+//Whether a plugin was read, listed from the snapshot, or couldn't be read at all
+int _stdcall ovrPluginState(OvrIndex* ovr, int plugin) {
+	if(plugin<0||plugin>=ovr->pluginCount) return OVR_MISSING;
+	return ovr->plugins[plugin].state;
+}
+
+//Copies a plugin's note into buffer, which is skipped if buffer is too small. Returns the note's length, or -1 if the
+//plugin has none or couldn't be read.
+int _stdcall ovrNote(OvrIndex* ovr, int plugin, BYTE* buffer, int length) {
+	if(plugin<0||plugin>=ovr->pluginCount||!ovr->plugins[plugin].note) return -1;
+	const OvrPlugin* p=&ovr->plugins[plugin];
+	if(length>=0&&(DWORD)length>=p->noteLength&&p->noteLength) memcpy(buffer, p->note, p->noteLength);
+	return (int)p->noteLength;
+}
+
+int _stdcall ovrRecordCount(OvrIndex* ovr) {
+	return (int)ovr->recordCount;
+}
+
+//Copies up to length plugins holding the record plugin refers to as formId into plugins, in load order,
+//returning how many there are
+int _stdcall ovrFind(OvrIndex* ovr, int plugin, DWORD formId, int* plugins, int length) {
+	if(plugin<0||plugin>=ovr->pluginCount) return -1;
+	DWORD record=FindRecord(ovr, RecordKey(&ovr->plugins[plugin], formId));
+	if(record==(DWORD)-1) return 0;
+	DWORD first=ovr->holderFirst[record];
+	int count=(int)(ovr->holderFirst[record+1]-first);
+	for(int i=0;i<count&&i<length;i++) plugins[i]=ovr->holders[first+i];
+	return count;
+}
+
+//Copies up to length form ids of the records plugin holds that an earlier plugin holds too, returning how many
+//there are
+int _stdcall ovrOverrides(OvrIndex* ovr, int plugin, DWORD* formIds, int length) {
+	if(plugin<0||plugin>=ovr->pluginCount) return -1;
+	DWORD first=ovr->overrideFirst[plugin];
+	int count=(int)(ovr->overrideFirst[plugin+1]-first);
+	for(int i=0;i<count&&i<length;i++) formIds[i]=ovr->overrides[first+i];
+	return count;
+}
@@ -0,0 +1,469 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "espReader.h"
+#include "contentHash.h"
+#include "fileUtil.h"
+#include "workerPool.h"
+
+//What the plugin list needs from the TES4 header of every plugin in Data, kept in a snapshot file so that an
+//unchanged plugin is never opened. A refresh lists Data once and only reads the headers of plugins whose size or
+//time changed. Content hashes are only worked out when they are asked for, since reordering plugins changes the
+//time of every one of them.
+
+//metaPluginInfo states
+#define META_READ 0
+#define META_CACHED 1
+#define META_DAMAGED -1
+
+#define SNAPSHOT_MAGIC 0x3141544D	//"MTA1"
+
+//Snapshot status bits
+#define SNAPSHOT_DAMAGED 1
+#define SNAPSHOT_HASHED 2
+
+struct MetaInfo {
+	UINT64 size;
+	UINT64 time;
+	DWORD flags;			//of the TES4 record
+	DWORD recordCount;		//as the plugin's HEDR declares it
+	int masterCount;
+	int state;
+};
+
+struct MetaPlugin {
+	char* name;
+	char* key;			//lower case name
+	UINT64 size;
+	UINT64 time;
+	UINT64 hash;
+	bool hashed;
+	bool seen;			//found by the current refresh
+	DWORD flags;
+	DWORD recordCount;
+	char* text;			//author, description and then each master, NUL terminated
+	DWORD textLength;
+	int masterCount;
+	int state;
+};
+
+struct MetaCache {
+	char* dataPath;
+	char* snapshot;
+	MetaPlugin* plugins;
+	int count;
+	int capacity;
+	bool dirty;			//holds something the snapshot doesn't
+};
+
+struct MetaBuild {
+	MetaCache* cache;
+	int* pending;
+};
+
+static char* Copy(const char* s, size_t length) {
+	char* copy=(char*)malloc(length+1);
+	if(!copy) return 0;
+	memcpy(copy, s, length);
+	copy[length]=0;
+	return copy;
+}
+
+static bool IsPlugin(const char* name) {
+	size_t length=strlen(name);
+	if(length<4) return false;
+	char extension[5];
+	memcpy(extension, name+length-4, 5);
+	Lower(extension);
+	return !strcmp(extension, ".esp")||!strcmp(extension, ".esm");
+}
+
+static void FreeHeader(MetaPlugin* plugin) {
+	free(plugin->text);
+	plugin->text=0;
+	plugin->textLength=0;
+	plugin->masterCount=0;
+	plugin->flags=0;
+	plugin->recordCount=0;
+}
+
+static void FreePlugin(MetaPlugin* plugin) {
+	free(plugin->name);
+	free(plugin->key);
+	FreeHeader(plugin);
+}
+
+static int FindKey(const MetaCache* cache, const char* key) {
+	for(int i=0;i<cache->count;i++) if(!strcmp(cache->plugins[i].key, key)) return i;
+	return -1;
+}
+
+static MetaPlugin* AddPlugin(MetaCache* cache, const char* name, size_t length) {
+	if(cache->count==cache->capacity) {
+		int grown=cache->capacity?cache->capacity*2:256;
+		MetaPlugin* plugins=(MetaPlugin*)realloc(cache->plugins, sizeof(MetaPlugin)*grown);
+		if(!plugins) return 0;
+		cache->plugins=plugins;
+		cache->capacity=grown;
+	}
+	MetaPlugin* plugin=&cache->plugins[cache->count];
+	memset(plugin, 0, sizeof(MetaPlugin));
+	plugin->name=Copy(name, length);
+	plugin->key=Copy(name, length);
+	if(!plugin->name||!plugin->key) {
+		FreePlugin(plugin);
+		return 0;
+	}
+	Lower(plugin->key);
+	cache->count++;
+	return plugin;
+}
+
+//Appends a string subrecord, which needn't be NUL terminated, to the header text
+static void AppendText(MetaPlugin* plugin, const BYTE* data, const EspSubrecord* subrecord) {
+	DWORD length=subrecord?(DWORD)strnlen((const char*)data+subrecord->offset, subrecord->size):0;
+	if(length) memcpy(plugin->text+plugin->textLength, data+subrecord->offset, length);
+	plugin->text[plugin->textLength+length]=0;
+	plugin->textLength+=length+1;
+}
+
+static bool ReadHeader(MetaPlugin* plugin, const MappedFile* map) {
+	const BYTE* base=map->data;
+	if(map->size<ESP_HEADER_SIZE+sizeof(EspSubrecordHeader)||*(const DWORD*)base!=ESP_TYPE_TES4) return false;
+	DWORD headerSize=*(const DWORD*)(base+ESP_OBLIVION_HEADER_SIZE)==ESP_TYPE_HEDR?ESP_OBLIVION_HEADER_SIZE:ESP_HEADER_SIZE;
+	const EspRecordHeader* header=(const EspRecordHeader*)base;
+	if(header->flags&ESP_FLAG_COMPRESSED||headerSize+(UINT64)header->size>map->size) return false;
+	const BYTE* data=base+headerSize;
+	int count=EspSplitSubrecords(data, header->size, 0, 0);
+	if(count<0) return false;
+	EspSubrecord* subrecords=(EspSubrecord*)malloc(sizeof(EspSubrecord)*(count?count:1));
+	if(!subrecords) return false;
+	EspSplitSubrecords(data, header->size, subrecords, count);
+	const EspSubrecord* author=0;
+	const EspSubrecord* description=0;
+	DWORD length=2;
+	plugin->flags=header->flags;
+	for(int i=0;i<count;i++) {
+		const EspSubrecord* subrecord=&subrecords[i];
+		switch(subrecord->type) {
+		case ESP_TYPE_HEDR:
+			//a version float, then the record count and the next free object id
+			if(subrecord->size>=8) plugin->recordCount=*(const DWORD*)(data+subrecord->offset+4);
+			break;
+		case ESP_TYPE_CNAM:
+			if(!author) author=subrecord;
+			break;
+		case ESP_TYPE_SNAM:
+			if(!description) description=subrecord;
+			break;
+		case ESP_TYPE_MAST:
+			length+=subrecord->size+1;
+			break;
+		}
+	}
+	if(author) length+=author->size;
+	if(description) length+=description->size;
+	plugin->text=(char*)malloc(length);
+	if(!plugin->text) {
+		free(subrecords);
+		return false;
+	}
+	AppendText(plugin, data, author);
+	AppendText(plugin, data, description);
+	for(int i=0;i<count;i++) {
+		if(subrecords[i].type!=ESP_TYPE_MAST) continue;
+		AppendText(plugin, data, &subrecords[i]);
+		plugin->masterCount++;
+	}
+	free(subrecords);
+	return true;
+}
+
+static void ReadTask(int index, void* context) {
+	MetaBuild* build=(MetaBuild*)context;
+	MetaPlugin* plugin=&build->cache->plugins[build->pending[index]];
+	char path[MAX_PATH*2];
+	MappedFile map;
+	plugin->state=META_DAMAGED;
+	if(!DataPath(path, build->cache->dataPath, plugin->name)||!MapFile(&map, path)) return;
+	if(ReadHeader(plugin, &map)) plugin->state=META_READ;
+	else FreeHeader(plugin);
+	UnmapFile(&map);
+}
+
+//Snapshot layout: magic, plugin count, then for each plugin its name length, name, size, time, hash, status,
+//flags, record count, master count, text length and text
+static void LoadSnapshot(MetaCache* cache) {
+	SnapshotReader reader;
+	if(!SnapshotOpen(&reader, cache->snapshot, SNAPSHOT_MAGIC)) return;
+	const DWORD* count=(const DWORD*)SnapshotRead(&reader, 4);
+	for(DWORD i=0;count&&i<*count;i++) {
+		const char* name;
+		WORD nameLength;
+		UINT64 size, time;
+		if(!SnapshotReadStamp(&reader, &name, &nameLength, &size, &time)) break;
+		const UINT64* hash=(const UINT64*)SnapshotRead(&reader, 8);
+		const DWORD* fields=(const DWORD*)SnapshotRead(&reader, 20);
+		if(!hash||!fields) break;
+		DWORD textLength=fields[4];
+		const char* text=(const char*)SnapshotRead(&reader, textLength);
+		if(!text) break;
+		DWORD terminators=0;
+		for(DWORD j=0;j<textLength;j++) if(!text[j]) terminators++;
+		bool damaged=(fields[0]&SNAPSHOT_DAMAGED)!=0;
+		if(!nameLength||memchr(name, 0, nameLength)) break;
+		if(damaged?textLength||fields[3]:(textLength&&text[textLength-1])||terminators!=fields[3]+2) break;
+		MetaPlugin* plugin=AddPlugin(cache, name, nameLength);
+		if(!plugin) break;
+		if(FindKey(cache, plugin->key)!=cache->count-1) {
+			FreePlugin(plugin);
+			cache->count--;
+			continue;
+		}
+		plugin->size=size;
+		plugin->time=time;
+		plugin->hash=*hash;
+		plugin->hashed=(fields[0]&SNAPSHOT_HASHED)!=0;
+		plugin->flags=fields[1];
+		plugin->recordCount=fields[2];
+		plugin->masterCount=(int)fields[3];
+		plugin->state=damaged?META_DAMAGED:META_CACHED;
+		if(textLength) {
+			plugin->text=Copy(text, textLength);
+			if(!plugin->text) {
+				FreePlugin(plugin);
+				cache->count--;
+				break;
+			}
+			plugin->textLength=textLength;
+		}
+	}
+	SnapshotClose(&reader);
+}
+
+static void SaveSnapshot(MetaCache* cache) {
+	SnapshotWriter writer;
+	if(!cache->snapshot||!SnapshotCreate(&writer, cache->snapshot, SNAPSHOT_MAGIC)) return;
+	SnapshotWrite(&writer, &cache->count, 4);
+	for(int i=0;i<cache->count;i++) {
+		const MetaPlugin* plugin=&cache->plugins[i];
+		DWORD fields[5]={ (DWORD)(plugin->state==META_DAMAGED?SNAPSHOT_DAMAGED:0)|(plugin->hashed?SNAPSHOT_HASHED:0),
+			plugin->flags, plugin->recordCount, (DWORD)plugin->masterCount, plugin->textLength };
+		SnapshotWriteStamp(&writer, plugin->name, plugin->size, plugin->time);
+		SnapshotWrite(&writer, &plugin->hash, 8);
+		SnapshotWrite(&writer, fields, 20);
+		SnapshotWrite(&writer, plugin->text, plugin->textLength);
+	}
+	if(SnapshotFinish(&writer)) cache->dirty=false;
+}
+
+//Matches the plugins in Data against those already known, marking new and changed ones for reading. Returns
+//how many need reading, or -1 if Data can't be listed or memory runs out.
+static int ScanData(MetaCache* cache, int** pending) {
+	char pattern[MAX_PATH*2];
+	if(!DataPath(pattern, cache->dataPath, "*")) return -1;
+	for(int i=0;i<cache->count;i++) cache->plugins[i].seen=false;
+	WIN32_FIND_DATAA fd;
+	HANDLE find=FindFirstFileA(pattern, &fd);
+	if(find==INVALID_HANDLE_VALUE) return -1;
+	int count=0;
+	int capacity=0;
+	bool ok=true;
+	do {
+		if(fd.dwFileAttributes&FILE_ATTRIBUTE_DIRECTORY||!IsPlugin(fd.cFileName)) continue;
+		UINT64 size=((UINT64)fd.nFileSizeHigh<<32)|fd.nFileSizeLow;
+		UINT64 time=FileTime(fd.ftLastWriteTime);
+		char key[MAX_PATH];
+		memcpy(key, fd.cFileName, strlen(fd.cFileName)+1);
+		Lower(key);
+		int index=FindKey(cache, key);
+		if(index>=0&&cache->plugins[index].seen) continue;
+		MetaPlugin* plugin;
+		if(index<0) {
+			plugin=AddPlugin(cache, fd.cFileName, strlen(fd.cFileName));
+			if(!plugin) {
+				ok=false;
+				break;
+			}
+			index=cache->count-1;
+		} else {
+			plugin=&cache->plugins[index];
+			//a plugin renamed to another case is the same file to windows
+			if(strcmp(plugin->name, fd.cFileName)) {
+				memcpy(plugin->name, fd.cFileName, strlen(fd.cFileName));
+				cache->dirty=true;
+			}
+		}
+		plugin->seen=true;
+		if(plugin->text||plugin->state==META_DAMAGED) {
+			if(plugin->size==size&&plugin->time==time) {
+				if(plugin->state==META_READ) plugin->state=META_CACHED;
+				continue;
+			}
+			FreeHeader(plugin);
+		}
+		plugin->size=size;
+		plugin->time=time;
+		plugin->hashed=false;
+		if(count==capacity) {
+			int grown=capacity?capacity*2:64;
+			int* list=(int*)realloc(*pending, sizeof(int)*grown);
+			if(!list) {
+				ok=false;
+				break;
+			}
+			*pending=list;
+			capacity=grown;
+		}
+		(*pending)[count++]=index;
+	} while(FindNextFileA(find, &fd));
+	FindClose(find);
+	if(!ok) return -1;
+	//plugins no longer in Data are forgotten
+	int kept=0;
+	for(int i=0;i<cache->count;i++) {
+		if(!cache->plugins[i].seen) {
+			FreePlugin(&cache->plugins[i]);
+			cache->dirty=true;
+			continue;
+		}
+		if(kept!=i) {
+			cache->plugins[kept]=cache->plugins[i];
+			for(int j=0;j<count;j++) if((*pending)[j]==i) (*pending)[j]=kept;
+		}
+		kept++;
+	}
+	cache->count=kept;
+	return count;
+}
+
+void _stdcall metaClose(MetaCache* cache) {
+	if(!cache) return;
+	if(cache->dirty) SaveSnapshot(cache);
+	for(int i=0;i<cache->count;i++) FreePlugin(&cache->plugins[i]);
+	free(cache->plugins);
+	free(cache->dataPath);
+	free(cache->snapshot);
+	free(cache);
+}
+
+//Lists the plugins in Data again, reading the headers of those that are new or changed across all cores, and
+//rewrites the snapshot if anything changed. Returns how many plugins were read, or -1 if Data couldn't be listed.
+int _stdcall metaRefresh(MetaCache* cache) {
+	MetaBuild build;
+	build.cache=cache;
+	build.pending=0;
+	int pending=ScanData(cache, &build.pending);
+	if(pending>0) {
+		ParallelFor(pending, ReadTask, &build);
+		cache->dirty=true;
+	}
+	free(build.pending);
+	if(cache->dirty) SaveSnapshot(cache);
+	return pending;
+}
+
+//Opens the header cache of the plugins in dataPath. If snapshot is given, headers are taken from it for plugins
+//that haven't changed since it was written.
+MetaCache* _stdcall metaOpen(const char* dataPath, const char* snapshot) {
+	MetaCache* cache=(MetaCache*)calloc(1, sizeof(MetaCache));
+	if(!cache) return 0;
+	cache->dataPath=Copy(dataPath, strlen(dataPath));
+	cache->snapshot=snapshot?Copy(snapshot, strlen(snapshot)):0;
+	if(!cache->dataPath||(snapshot&&!cache->snapshot)) {
+		metaClose(cache);
+		return 0;
+	}
+	LoadSnapshot(cache);
+	if(metaRefresh(cache)<0) {
+		metaClose(cache);
+		return 0;
+	}
+	return cache;
+}
+
+int _stdcall metaPluginCount(MetaCache* cache) {
+	return cache->count;
+}
+
+//Returns the index of the plugin with the given file name, ignoring case, or -1
+int _stdcall metaFind(MetaCache* cache, const char* name) {
+	char key[MAX_PATH];
+	size_t length=strlen(name);
+	if(length>=MAX_PATH) return -1;
+	memcpy(key, name, length+1);
+	Lower(key);
+	return FindKey(cache, key);
+}
+
+BOOL _stdcall metaPluginInfo(MetaCache* cache, int index, MetaInfo* info) {
+	if(index<0||index>=cache->count) return FALSE;
+	const MetaPlugin* plugin=&cache->plugins[index];
+	info->size=plugin->size;
+	info->time=plugin->time;
+	info->flags=plugin->flags;
+	info->recordCount=plugin->recordCount;
+	info->masterCount=plugin->masterCount;
+	info->state=plugin->state;
+	return TRUE;
+}
+
+static int CopyString(const char* s, char* buffer, int length) {
+	int stringLength=(int)strlen(s);
+	if(stringLength+1>length) return -1;
+	memcpy(buffer, s, stringLength+1);
+	return stringLength;
+}
+
+//Gets the string at position n of a plugin's header text, or 0 if the plugin is damaged
+static const char* HeaderText(const MetaPlugin* plugin, int n) {
+	if(!plugin->text) return 0;
+	const char* s=plugin->text;
+	for(int i=0;i<n;i++) s+=strlen(s)+1;
+	return s;
+}
+
+//Copies the file name of a plugin into buffer, returning its length, or -1 if buffer is too small
+int _stdcall metaPluginName(MetaCache* cache, int index, char* buffer, int length) {
+	if(index<0||index>=cache->count) return -1;
+	return CopyString(cache->plugins[index].name, buffer, length);
+}
+
+//Copies the CNAM of a plugin into buffer, returning its length, or -1 if buffer is too small or the plugin is damaged
+int _stdcall metaAuthor(MetaCache* cache, int index, char* buffer, int length) {
+	if(index<0||index>=cache->count) return -1;
+	const char* author=HeaderText(&cache->plugins[index], 0);
+	return author?CopyString(author, buffer, length):-1;
+}
+
+//Copies the SNAM of a plugin into buffer, returning its length, or -1 if buffer is too small or the plugin is
+//damaged
+int _stdcall metaDescription(MetaCache* cache, int index, char* buffer, int length) {
+	if(index<0||index>=cache->count) return -1;
+	const char* description=HeaderText(&cache->plugins[index], 1);
+	return description?CopyString(description, buffer, length):-1;
+}
+
+//Copies the name of one of a plugin's masters into buffer, returning its length, or -1 if buffer is too small
+int _stdcall metaMasterName(MetaCache* cache, int index, int master, char* buffer, int length) {
+	if(index<0||index>=cache->count||master<0||master>=cache->plugins[index].masterCount) return -1;
+	return CopyString(HeaderText(&cache->plugins[index], 2+master), buffer, length);
+}
+
+//Gets the content hash of a plugin, hashing it the first time it is asked for after it changes
+BOOL _stdcall metaHash(MetaCache* cache, int index, UINT64* hash) {
+	if(index<0||index>=cache->count) return FALSE;
+	MetaPlugin* plugin=&cache->plugins[index];
+	if(!plugin->hashed) {
+		char path[MAX_PATH*2];
+		MappedFile map;
+		if(!DataPath(path, cache->dataPath, plugin->name)||!MapFile(&map, path)) return FALSE;
+		plugin->hash=ContentHash(map.data, (SIZE_T)map.size, 0);
+		plugin->hashed=true;
+		cache->dirty=true;
+		UnmapFile(&map);
+	}
+	*hash=plugin->hash;
+	return TRUE;
+}
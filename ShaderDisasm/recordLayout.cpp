@@ -0,0 +1,395 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "recordLayout.h"
+
+//Distinct conditions a record can set, and blocks of repeating subrecords that can be open at once
+#define LAYOUT_MAX_CONDITIONS 32
+#define LAYOUT_MAX_DEPTH 64
+
+//Longest repeat or optional block believed
+#define LAYOUT_MAX_BLOCK 0xffff
+
+//Kinds of value a condition can hold, as the editor compares them
+#define VALUE_INT 0
+#define VALUE_FLOAT 1
+#define VALUE_STRING 2
+
+struct Conditional {
+	DWORD id;
+	int kind;
+	int i;
+	float f;
+	const BYTE* s;
+	DWORD length;
+};
+
+struct Conditionals {
+	Conditional values[LAYOUT_MAX_CONDITIONS];
+	int count;
+};
+
+static inline DWORD TypeSlot(DWORD type, int bits) {
+	return (type*2654435761u)>>(32-bits);
+}
+
+const LayoutRecord* LayoutFind(const RecordLayouts* layouts, DWORD type) {
+	DWORD mask=(1<<layouts->typeBits)-1;
+	for(DWORD slot=TypeSlot(type, layouts->typeBits);layouts->byType[slot];slot=(slot+1)&mask) {
+		const LayoutRecord* record=&layouts->records[layouts->byType[slot]-1];
+		if(record->type==type) return record;
+	}
+	return 0;
+}
+
+static Conditional* SetConditional(Conditionals* conditions, DWORD id) {
+	for(int i=0;i<conditions->count;i++) if(conditions->values[i].id==id) return &conditions->values[i];
+	if(conditions->count==LAYOUT_MAX_CONDITIONS) return 0;
+	conditions->values[conditions->count].id=id;
+	return &conditions->values[conditions->count++];
+}
+
+static const Conditional* GetConditional(const Conditionals* conditions, DWORD id) {
+	for(int i=0;i<conditions->count;i++) if(conditions->values[i].id==id) return &conditions->values[i];
+	return 0;
+}
+
+//Gets how much of a subrecord an element takes up at offset. Fails if it runs off the end, as the editor does.
+static bool ElementLength(DWORD type, const BYTE* data, DWORD size, DWORD offset, DWORD* length) {
+	switch(type) {
+	case LAYOUT_INT:
+	case LAYOUT_FORMID:
+	case LAYOUT_FLOAT:
+		*length=4;
+		return size-offset>=4;
+	case LAYOUT_SHORT:
+		*length=2;
+		return size-offset>=2;
+	case LAYOUT_BYTE:
+		*length=1;
+		return size-offset>=1;
+	case LAYOUT_STRING: {
+		const BYTE* end=(const BYTE*)memchr(data+offset, 0, size-offset);
+		if(!end) return false;
+		*length=(DWORD)(end-data)-offset+1;
+		return true;
+	}
+	default:
+		*length=size-offset;
+		return true;
+	}
+}
+
+//Reads the values of a subrecord's elements that set conditions, stopping where the editor would
+static void AddConditionals(const RecordLayouts* layouts, const LayoutSubrecord* layout, const BYTE* data,
+	DWORD size, Conditionals* conditions) {
+	DWORD offset=0;
+	for(DWORD j=0;j<layout->elementCount;j++) {
+		const LayoutElement* element=&layouts->elements[layout->firstElement+j];
+		if(element->type==LAYOUT_BLOB) return;
+		DWORD length;
+		if(element->type==LAYOUT_FSTRING) {
+			length=0;
+		} else if(!ElementLength(element->type, data, size, offset, &length)) {
+			return;
+		}
+		if(element->condId) {
+			Conditional* value=SetConditional(conditions, element->condId);
+			if(!value) return;
+			const BYTE* p=data+offset;
+			switch(element->type) {
+			case LAYOUT_INT:
+			case LAYOUT_FORMID:
+				value->kind=VALUE_INT;
+				value->i=*(const int*)p;
+				break;
+			case LAYOUT_FLOAT:
+				value->kind=VALUE_FLOAT;
+				value->f=*(const float*)p;
+				break;
+			case LAYOUT_SHORT:
+				value->kind=VALUE_INT;
+				value->i=*(const short*)p;
+				break;
+			case LAYOUT_BYTE:
+				value->kind=VALUE_INT;
+				value->i=*p;
+				break;
+			case LAYOUT_STRING:
+				value->kind=VALUE_STRING;
+				value->s=p;
+				value->length=length-1;
+				break;
+			default: {
+				//an fstring is the whole subrecord up to its first NUL
+				const BYTE* end=(const BYTE*)memchr(data, 0, size);
+				value->kind=VALUE_STRING;
+				value->s=data;
+				value->length=end?(DWORD)(end-data):size;
+				break;
+			}
+			}
+		}
+		offset+=length;
+	}
+}
+
+//Gets the size of an element type, or 0 if it varies
+static DWORD FixedLength(DWORD type) {
+	switch(type) {
+	case LAYOUT_INT:
+	case LAYOUT_FORMID:
+	case LAYOUT_FLOAT:
+		return 4;
+	case LAYOUT_SHORT:
+		return 2;
+	case LAYOUT_BYTE:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+//Works out where the form ids are in each subrecord layout whose elements all have a fixed size
+static bool FixLayouts(RecordLayouts* layouts) {
+	DWORD total=0;
+	for(DWORD i=0;i<layouts->elementCount;i++) if(layouts->elements[i].type==LAYOUT_FORMID) total++;
+	layouts->fixed=(LayoutFixed*)calloc(layouts->subrecordCount?layouts->subrecordCount:1, sizeof(LayoutFixed));
+	layouts->fixedOffsets=(DWORD*)malloc(sizeof(DWORD)*(total?total:1));
+	if(!layouts->fixed||!layouts->fixedOffsets) return false;
+	DWORD next=0;
+	for(DWORD i=0;i<layouts->subrecordCount;i++) {
+		const LayoutSubrecord* ss=&layouts->subrecords[i];
+		const LayoutElement* elements=layouts->elements+ss->firstElement;
+		LayoutFixed* fixed=&layouts->fixed[i];
+		DWORD size=0;
+		fixed->first=next;
+		for(DWORD j=0;j<ss->elementCount;j++) {
+			DWORD length=FixedLength(elements[j].type);
+			if(!length) {
+				size=0;
+				break;
+			}
+			if(elements[j].type==LAYOUT_FORMID) layouts->fixedOffsets[next++]=size;
+			size+=length;
+		}
+		if(!size) {
+			next=fixed->first;
+			continue;
+		}
+		fixed->size=size;
+		fixed->count=next-fixed->first;
+		const LayoutElement* last=&elements[ss->elementCount-1];
+		if(last->flags&LAYOUT_REPEAT&&last->type==LAYOUT_FORMID) fixed->stride=4;
+	}
+	return true;
+}
+
+static bool Compare(DWORD condition, int order) {
+	switch(condition) {
+	case LAYOUT_COND_EQUAL: return order==0;
+	case LAYOUT_COND_NOT: return order!=0;
+	case LAYOUT_COND_LESS: return order<0;
+	case LAYOUT_COND_GREATER: return order>0;
+	case LAYOUT_COND_GREATEREQUAL: return order>=0;
+	case LAYOUT_COND_LESSEQUAL: return order<=0;
+	default: return false;
+	}
+}
+
+static bool CheckCondition(const RecordLayouts* layouts, const LayoutSubrecord* layout,
+	const Conditionals* conditions) {
+	const Conditional* value=GetConditional(conditions, layout->condId);
+	if(layout->condition==LAYOUT_COND_EXISTS) return value!=0;
+	if(layout->condition==LAYOUT_COND_MISSING) return value==0;
+	if(!value) return false;
+	if(value->kind==VALUE_INT) {
+		if(!(layout->flags&LAYOUT_INT_OPERAND)) return false;
+		return Compare(layout->condition, value->i<layout->intOperand?-1:value->i>layout->intOperand);
+	}
+	if(value->kind==VALUE_FLOAT) {
+		if(!(layout->flags&LAYOUT_FLOAT_OPERAND)) return false;
+		float f=layout->floatOperand;
+		//comparisons with NaN are all false but for not equal, which is true
+		if(value->f!=value->f||f!=f) return layout->condition==LAYOUT_COND_NOT;
+		return Compare(layout->condition, value->f<f?-1:value->f>f);
+	}
+	const BYTE* operand=layouts->strings+layout->operandOffset;
+	DWORD length=layout->operandLength;
+	switch(layout->condition) {
+	case LAYOUT_COND_EQUAL:
+		return value->length==length&&!memcmp(value->s, operand, length);
+	case LAYOUT_COND_NOT:
+		return value->length!=length||memcmp(value->s, operand, length);
+	case LAYOUT_COND_STARTSWITH:
+		return value->length>=length&&!memcmp(value->s, operand, length);
+	case LAYOUT_COND_ENDSWITH:
+		return value->length>=length&&!memcmp(value->s+value->length-length, operand, length);
+	case LAYOUT_COND_CONTAINS:
+		for(DWORD i=0;i+length<=value->length;i++) if(!memcmp(value->s+i, operand, length)) return true;
+		return false;
+	default:
+		return false;
+	}
+}
+
+struct LoopBlock {
+	int start;
+	int end;
+};
+
+void LayoutMatch(const RecordLayouts* layouts, const LayoutRecord* record, const BYTE* data,
+	const EspSubrecord* subrecords, int count, int* matched) {
+	for(int i=0;i<count;i++) matched[i]=-1;
+	const LayoutSubrecord* sss=layouts->subrecords+record->firstSubrecord;
+	int length=(int)record->subrecordCount;
+	LoopBlock repeats[LAYOUT_MAX_DEPTH];
+	int depth=0;
+	Conditionals conditions;
+	conditions.count=0;
+	int subi=0, ssi=0;
+	//every step either matches a subrecord or moves through the layout, but a malformed layout could cycle
+	UINT64 steps=((UINT64)count+1)*((UINT64)length+1)*4;
+	while(subi<count&&ssi<length&&steps--) {
+		const LayoutSubrecord* ss=&sss[ssi];
+		if(ss->condition!=LAYOUT_COND_NONE&&!CheckCondition(layouts, ss, &conditions)) {
+			ssi++;
+			continue;
+		}
+		const EspSubrecord* sub=&subrecords[subi];
+		if(sub->type==ss->type&&(!ss->size||ss->size==sub->size)) {
+			matched[subi]=ssi;
+			if(ss->repeat>0&&(!depth||repeats[depth-1].start!=ssi)) {
+				if(depth==LAYOUT_MAX_DEPTH) return;
+				repeats[depth].start=ssi;
+				repeats[depth++].end=ssi+(int)ss->repeat;
+			}
+			if(ss->flags&LAYOUT_CONDITIONALS) AddConditionals(layouts, ss, data+sub->offset, sub->size, &conditions);
+			subi++;
+			ssi++;
+		} else if(depth&&repeats[depth-1].start==ssi) {
+			ssi=repeats[--depth].end;
+		} else if(ss->optional>0) {
+			ssi+=(int)ss->optional;
+		} else {
+			return;
+		}
+		if(depth&&repeats[depth-1].end==ssi) ssi=repeats[depth-1].start;
+	}
+}
+
+int LayoutFormIds(const RecordLayouts* layouts, int subrecord, const BYTE* data, DWORD size, DWORD* offsets,
+	int length) {
+	const LayoutFixed* fixed=&layouts->fixed[subrecord];
+	if(fixed->size&&size>=fixed->size) {
+		int count=0;
+		for(DWORD i=0;i<fixed->count;i++,count++) if(count<length) offsets[count]=layouts->fixedOffsets[fixed->first+i];
+		if(fixed->stride) {
+			for(DWORD at=fixed->size;size-at>=fixed->stride;at+=fixed->stride,count++) if(count<length) offsets[count]=at;
+		}
+		return count;
+	}
+	const LayoutSubrecord* layout=&layouts->subrecords[subrecord];
+	const LayoutElement* elements=layouts->elements+layout->firstElement;
+	int last=(int)layout->elementCount-1;
+	int count=0;
+	DWORD offset=0;
+	for(int j=0;j<=last;j++) {
+		if(offset==size&&j==last&&(elements[j].flags&LAYOUT_OPTIONAL)) break;
+		DWORD elementLength;
+		if(!ElementLength(elements[j].type, data, size, offset, &elementLength)) break;
+		if(elements[j].type==LAYOUT_FORMID) {
+			if(count<length) offsets[count]=offset;
+			count++;
+		}
+		offset+=elementLength;
+		if(offset<size&&j==last&&(elements[j].flags&LAYOUT_REPEAT)) j--;
+	}
+	return count;
+}
+
+int LayoutFields(const RecordLayouts* layouts, int subrecord, const BYTE* data, DWORD size, LayoutField* fields,
+	int length) {
+	const LayoutSubrecord* layout=&layouts->subrecords[subrecord];
+	const LayoutElement* elements=layouts->elements+layout->firstElement;
+	int last=(int)layout->elementCount-1;
+	int count=0;
+	DWORD offset=0;
+	for(int j=0;j<=last;j++) {
+		if(offset==size&&j==last&&(elements[j].flags&LAYOUT_OPTIONAL)) break;
+		DWORD elementLength;
+		if(!ElementLength(elements[j].type, data, size, offset, &elementLength)) break;
+		if(count<length) {
+			fields[count].element=j;
+			fields[count].offset=offset;
+			fields[count].length=elementLength;
+		}
+		count++;
+		offset+=elementLength;
+		if(offset<size&&j==last&&(elements[j].flags&LAYOUT_REPEAT)) j--;
+	}
+	return count;
+}
+
+RecordLayouts* _stdcall layoutOpen(const BYTE* blob, int length) {
+	if(!blob||length<20||*(const DWORD*)blob!=LAYOUT_MAGIC) return 0;
+	const DWORD* counts=(const DWORD*)blob;
+	UINT64 expected=20+(UINT64)counts[1]*sizeof(LayoutRecord)+(UINT64)counts[2]*sizeof(LayoutSubrecord)+
+		(UINT64)counts[3]*sizeof(LayoutElement)+counts[4];
+	if(expected!=(UINT64)length) return 0;
+	RecordLayouts* layouts=(RecordLayouts*)calloc(1, sizeof(RecordLayouts));
+	if(!layouts) return 0;
+	layouts->recordCount=counts[1];
+	layouts->subrecordCount=counts[2];
+	layouts->elementCount=counts[3];
+	layouts->typeBits=4;
+	while((1u<<layouts->typeBits)<layouts->recordCount*2) layouts->typeBits++;
+	layouts->blob=(BYTE*)malloc(length);
+	layouts->byType=(int*)calloc((SIZE_T)1<<layouts->typeBits, sizeof(int));
+	if(!layouts->blob||!layouts->byType) {
+		layoutClose(layouts);
+		return 0;
+	}
+	memcpy(layouts->blob, blob, length);
+	BYTE* p=layouts->blob+20;
+	layouts->records=(const LayoutRecord*)p;
+	p+=layouts->recordCount*sizeof(LayoutRecord);
+	layouts->subrecords=(const LayoutSubrecord*)p;
+	p+=layouts->subrecordCount*sizeof(LayoutSubrecord);
+	layouts->elements=(const LayoutElement*)p;
+	p+=layouts->elementCount*sizeof(LayoutElement);
+	layouts->strings=p;
+	bool valid=true;
+	for(DWORD i=0;i<layouts->elementCount&&valid;i++) valid=layouts->elements[i].type<=LAYOUT_BLOB;
+	for(DWORD i=0;i<layouts->subrecordCount&&valid;i++) {
+		const LayoutSubrecord* ss=&layouts->subrecords[i];
+		valid=ss->condition<=LAYOUT_COND_MISSING&&ss->repeat<=LAYOUT_MAX_BLOCK&&ss->optional<=LAYOUT_MAX_BLOCK&&
+			(UINT64)ss->firstElement+ss->elementCount<=layouts->elementCount&&
+			(UINT64)ss->operandOffset+ss->operandLength<=counts[4];
+	}
+	DWORD mask=(1<<layouts->typeBits)-1;
+	for(DWORD i=0;i<layouts->recordCount&&valid;i++) {
+		const LayoutRecord* record=&layouts->records[i];
+		valid=(UINT64)record->firstSubrecord+record->subrecordCount<=layouts->subrecordCount&&
+			record->subrecordCount<=0x7fffffff;
+		if(!valid||LayoutFind(layouts, record->type)) continue;
+		DWORD slot=TypeSlot(record->type, layouts->typeBits);
+		while(layouts->byType[slot]) slot=(slot+1)&mask;
+		layouts->byType[slot]=i+1;
+	}
+	if(!valid||!FixLayouts(layouts)) {
+		layoutClose(layouts);
+		return 0;
+	}
+	return layouts;
+}
+
+void _stdcall layoutClose(RecordLayouts* layouts) {
+	if(!layouts) return;
+	free(layouts->blob);
+	free(layouts->fixed);
+	free(layouts->fixedOffsets);
+	free(layouts->byType);
+	free(layouts);
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "espReader.h"
+
+//The record structures TESsnip's editor reads from RecordStructure.xml, compiled by the manager into a flat blob
+//so native code can find the fields inside subrecords. Matching follows TESsnip's editor exactly, so a field is
+//read here wherever the editor would show it.
+
+//Blob layout: magic, record count, subrecord count, element count and strings length, then the records, the
+//subrecords, the elements and the strings, each as laid out below
+#define LAYOUT_MAGIC 0x31594C52	//"RLY1"
+
+//Element types, in the order of TESsnip's ElementValueType
+#define LAYOUT_STRING 0
+#define LAYOUT_FLOAT 1
+#define LAYOUT_INT 2
+#define LAYOUT_SHORT 3
+#define LAYOUT_BYTE 4
+#define LAYOUT_FORMID 5
+#define LAYOUT_FSTRING 6
+#define LAYOUT_BLOB 7
+
+//Conditions, in the order of TESsnip's CondType
+#define LAYOUT_COND_NONE 0
+#define LAYOUT_COND_EQUAL 1
+#define LAYOUT_COND_NOT 2
+#define LAYOUT_COND_GREATER 3
+#define LAYOUT_COND_LESS 4
+#define LAYOUT_COND_GREATEREQUAL 5
+#define LAYOUT_COND_LESSEQUAL 6
+#define LAYOUT_COND_STARTSWITH 7
+#define LAYOUT_COND_ENDSWITH 8
+#define LAYOUT_COND_CONTAINS 9
+#define LAYOUT_COND_EXISTS 10
+#define LAYOUT_COND_MISSING 11
+
+//LayoutSubrecord flags
+#define LAYOUT_INT_OPERAND 1		//the operand parses as an int
+#define LAYOUT_FLOAT_OPERAND 2		//the operand parses as a float
+#define LAYOUT_CONDITIONALS 4		//some element sets a condition
+
+//LayoutElement flags
+#define LAYOUT_REPEAT 1
+#define LAYOUT_OPTIONAL 2
+
+struct LayoutRecord {
+	DWORD type;
+	DWORD firstSubrecord;
+	DWORD subrecordCount;
+};
+
+struct LayoutSubrecord {
+	DWORD type;
+	DWORD size;			//the only size it matches, or 0 for any
+	DWORD repeat;		//number of subrecords in the block it starts, or 0
+	DWORD optional;
+	DWORD condition;
+	DWORD condId;
+	DWORD flags;
+	int intOperand;
+	float floatOperand;
+	DWORD operandOffset;	//of the operand in the strings
+	DWORD operandLength;
+	DWORD firstElement;
+	DWORD elementCount;
+};
+
+struct LayoutElement {
+	DWORD type;
+	DWORD condId;		//condition the element's value sets, or 0
+	DWORD flags;
+};
+
+//Where the form ids are in subrecords whose elements all have a fixed size, worked out once when the layouts are
+//opened so those subrecords need no walking
+struct LayoutFixed {
+	DWORD size;			//of the elements, each read once, or 0 if the layout isn't fixed
+	DWORD stride;		//size of the final element if it repeats and is a form id, or 0
+	DWORD first;		//offsets of the form ids among the elements read once
+	DWORD count;
+};
+
+//Where an element's value is within a subrecord
+struct LayoutField {
+	DWORD element;		//index within the subrecord layout
+	DWORD offset;
+	DWORD length;
+};
+
+struct RecordLayouts {
+	BYTE* blob;
+	const LayoutRecord* records;
+	DWORD recordCount;
+	const LayoutSubrecord* subrecords;
+	DWORD subrecordCount;
+	const LayoutElement* elements;
+	DWORD elementCount;
+	const BYTE* strings;
+	LayoutFixed* fixed;		//of each subrecord
+	DWORD* fixedOffsets;
+	int* byType;		//open addressed on record type, holding record index+1, or 0
+	int typeBits;
+};
+
+//Returns the layout of a record type, or 0 if there is none
+const LayoutRecord* LayoutFind(const RecordLayouts* layouts, DWORD type);
+//Matches the subrecords of a record to its layout, setting matched[i] to the index of subrecord i's layout, or -1.
+//Like the editor, matching stops at the first subrecord that doesn't fit, leaving it and the rest unmatched.
+void LayoutMatch(const RecordLayouts* layouts, const LayoutRecord* record, const BYTE* data,
+	const EspSubrecord* subrecords, int count, int* matched);
+//Finds where the form ids of a subrecord are, reading it as the given subrecord layout. Fills up to length offsets
+//and returns how many there are; a subrecord that runs short still gives the form ids before the point it ends.
+int LayoutFormIds(const RecordLayouts* layouts, int subrecord, const BYTE* data, DWORD size, DWORD* offsets,
+	int length);
+//Splits a subrecord into the values of its elements, reading it as the given subrecord layout the way the editor
+//shows it. Fills up to length fields and returns how many there are; a repeating final element gives a field each
+//time it is read.
+int LayoutFields(const RecordLayouts* layouts, int subrecord, const BYTE* data, DWORD size, LayoutField* fields,
+	int length);
+
+//Copies and checks a compiled blob. Returns 0 if it is damaged.
+RecordLayouts* _stdcall layoutOpen(const BYTE* blob, int length);
+void _stdcall layoutClose(RecordLayouts* layouts);
@@ -0,0 +1,279 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "espReader.h"
+#include "recordLayout.h"
+#include "workerPool.h"
+
+//Chosen fields of every record of one type in a plugin, decoded across all cores into a column of values each, so
+//searching or reporting on them is a scan over arrays. A column names a subrecord of the record's layout and an
+//element of it, and holds that element's value from the first subrecord matching the layout, read the way the
+//editor shows it:
+//	int, float and form id elements hold their raw four bytes
+//	shorts are sign extended and bytes zero extended
+//	strings hold the offset of a copy in the table's strings, each ending in a NUL
+//	blobs hold their size
+
+//Records decoded by one task
+#define TABLE_BATCH 1024
+
+struct TableStrings {
+	char* data;
+	DWORD length;
+	DWORD capacity;
+	bool failed;
+};
+
+struct RecordTable {
+	int rowCount;
+	int columnCount;
+	DWORD* formIds;		//of each row
+	DWORD* values;		//of each column in turn, a row to a value
+	BYTE* present;		//likewise, whether the row has the field
+	char* strings;
+	DWORD stringsLength;
+};
+
+struct TableBuild {
+	RecordTable* table;
+	const EspFile* esp;
+	const RecordLayouts* layouts;
+	const LayoutRecord* layout;
+	const DWORD* columns;
+	const DWORD* types;	//element type of each column
+	int* entries;		//of each row in the plugin
+	TableStrings* strings;	//of each task
+};
+
+static bool AddString(TableStrings* strings, const BYTE* text, DWORD length, DWORD* offset) {
+	const BYTE* end=(const BYTE*)memchr(text, 0, length);
+	if(end) length=(DWORD)(end-text);
+	if(strings->length+length+1>strings->capacity) {
+		DWORD grown=strings->capacity?strings->capacity*2:4096;
+		while(grown<strings->length+length+1) grown*=2;
+		char* data=(char*)realloc(strings->data, grown);
+		if(!data) return false;
+		strings->data=data;
+		strings->capacity=grown;
+	}
+	*offset=strings->length;
+	memcpy(strings->data+strings->length, text, length);
+	strings->data[strings->length+length]=0;
+	strings->length+=length+1;
+	return true;
+}
+
+//Reads the value of a field into its column
+static bool DecodeField(const TableBuild* build, TableStrings* strings, int column, int row, const BYTE* data,
+	const LayoutField* field) {
+	RecordTable* table=build->table;
+	DWORD* value=&table->values[(SIZE_T)column*table->rowCount+row];
+	const BYTE* p=data+field->offset;
+	switch(build->types[column]) {
+	case LAYOUT_INT:
+	case LAYOUT_FLOAT:
+	case LAYOUT_FORMID:
+		*value=*(const DWORD*)p;
+		break;
+	case LAYOUT_SHORT:
+		*value=(DWORD)(int)*(const short*)p;
+		break;
+	case LAYOUT_BYTE:
+		*value=*p;
+		break;
+	case LAYOUT_STRING:
+	case LAYOUT_FSTRING:
+		if(!AddString(strings, p, field->length, value)) return false;
+		break;
+	default:
+		*value=field->length;
+		break;
+	}
+	table->present[(SIZE_T)column*table->rowCount+row]=1;
+	return true;
+}
+
+//Decodes the columns of one record. A damaged record has none of its fields.
+static bool DecodeRow(const TableBuild* build, TableStrings* strings, int row, int* firstMatch,
+	LayoutField* fields) {
+	const RecordLayouts* layouts=build->layouts;
+	const LayoutRecord* layout=build->layout;
+	DWORD size;
+	BYTE* owned;
+	const BYTE* data=EspRecordData(build->esp, build->entries[row], &size, &owned);
+	int count=data?EspSplitSubrecords(data, size, 0, 0):-1;
+	if(count<=0) {
+		free(owned);
+		return true;
+	}
+	EspSubrecord* subrecords=(EspSubrecord*)malloc(sizeof(EspSubrecord)*count);
+	int* matched=(int*)malloc(sizeof(int)*count);
+	bool ok=subrecords&&matched;
+	if(ok) {
+		EspSplitSubrecords(data, size, subrecords, count);
+		LayoutMatch(layouts, layout, data, subrecords, count, matched);
+		for(DWORD i=0;i<layout->subrecordCount;i++) firstMatch[i]=-1;
+		for(int i=count-1;i>=0;i--) if(matched[i]>=0) firstMatch[matched[i]]=i;
+		for(int c=0;c<build->table->columnCount&&ok;c++) {
+			DWORD subrecord=build->columns[c]>>16;
+			DWORD element=build->columns[c]&0xffff;
+			int i=firstMatch[subrecord];
+			if(i<0) continue;
+			const LayoutSubrecord* ss=&layouts->subrecords[layout->firstSubrecord+subrecord];
+			//a repeating element is read again only once every element has been, so its first value is in here
+			int found=LayoutFields(layouts, layout->firstSubrecord+subrecord, data+subrecords[i].offset,
+				subrecords[i].size, fields, ss->elementCount);
+			for(int f=0;f<found&&f<(int)ss->elementCount;f++) {
+				if(fields[f].element!=element) continue;
+				ok=DecodeField(build, strings, c, row, data+subrecords[i].offset, &fields[f]);
+				break;
+			}
+		}
+	}
+	free(subrecords);
+	free(matched);
+	free(owned);
+	return ok;
+}
+
+static void DecodeTask(int index, void* context) {
+	TableBuild* build=(TableBuild*)context;
+	TableStrings* strings=&build->strings[index];
+	DWORD most=1;
+	for(DWORD i=0;i<build->layout->subrecordCount;i++) {
+		const LayoutSubrecord* ss=&build->layouts->subrecords[build->layout->firstSubrecord+i];
+		if(ss->elementCount>most) most=ss->elementCount;
+	}
+	int* firstMatch=(int*)malloc(sizeof(int)*(build->layout->subrecordCount+1));
+	LayoutField* fields=(LayoutField*)malloc(sizeof(LayoutField)*most);
+	if(!firstMatch||!fields) strings->failed=true;
+	int end=index*TABLE_BATCH+TABLE_BATCH;
+	if(end>build->table->rowCount) end=build->table->rowCount;
+	for(int row=index*TABLE_BATCH;row<end&&!strings->failed;row++) {
+		if(!DecodeRow(build, strings, row, firstMatch, fields)) strings->failed=true;
+	}
+	free(firstMatch);
+	free(fields);
+}
+
+void _stdcall tableClose(RecordTable* table) {
+	if(!table) return;
+	free(table->formIds);
+	free(table->values);
+	free(table->present);
+	free(table->strings);
+	free(table);
+}
+
+//Joins the strings of each task into one, moving the string values of the task's rows to match
+static bool JoinStrings(TableBuild* build, int taskCount) {
+	RecordTable* table=build->table;
+	for(int t=0;t<taskCount;t++) table->stringsLength+=build->strings[t].length;
+	table->strings=(char*)malloc(table->stringsLength?table->stringsLength:1);
+	if(!table->strings) return false;
+	DWORD base=0;
+	for(int t=0;t<taskCount;t++) {
+		if(build->strings[t].length) memcpy(table->strings+base, build->strings[t].data, build->strings[t].length);
+		int end=t*TABLE_BATCH+TABLE_BATCH;
+		if(end>table->rowCount) end=table->rowCount;
+		for(int c=0;c<table->columnCount&&base;c++) {
+			if(build->types[c]!=LAYOUT_STRING&&build->types[c]!=LAYOUT_FSTRING) continue;
+			for(int row=t*TABLE_BATCH;row<end;row++) {
+				SIZE_T cell=(SIZE_T)c*table->rowCount+row;
+				if(table->present[cell]) table->values[cell]+=base;
+			}
+		}
+		base+=build->strings[t].length;
+	}
+	return true;
+}
+
+//Decodes the given columns of every record of a type in a plugin, across all cores. Each column is the index of a
+//subrecord within the record type's layout in its high word and of an element of that subrecord in its low word.
+//Returns 0 if the type has no layout, a column doesn't exist or there isn't the memory.
+RecordTable* _stdcall tableOpen(EspFile* esp, RecordLayouts* layouts, DWORD type, const DWORD* columns, int count) {
+	const LayoutRecord* layout=LayoutFind(layouts, type);
+	if(!layout||count<0) return 0;
+	DWORD* types=(DWORD*)malloc(sizeof(DWORD)*(count?count:1));
+	if(!types) return 0;
+	for(int c=0;c<count;c++) {
+		DWORD subrecord=columns[c]>>16;
+		DWORD element=columns[c]&0xffff;
+		if(subrecord>=layout->subrecordCount||
+			element>=layouts->subrecords[layout->firstSubrecord+subrecord].elementCount) {
+			free(types);
+			return 0;
+		}
+		types[c]=layouts->elements[layouts->subrecords[layout->firstSubrecord+subrecord].firstElement+element].type;
+	}
+	RecordTable* table=(RecordTable*)calloc(1, sizeof(RecordTable));
+	TableBuild build;
+	build.table=table;
+	build.esp=esp;
+	build.layouts=layouts;
+	build.layout=layout;
+	build.columns=columns;
+	build.types=types;
+	build.entries=(int*)malloc(sizeof(int)*(esp->recordCount?esp->recordCount:1));
+	build.strings=0;
+	bool ok=table&&build.entries;
+	if(ok) {
+		table->columnCount=count;
+		for(int i=0;i<esp->count;i++) if(esp->entries[i].type==type) build.entries[table->rowCount++]=i;
+		SIZE_T cells=(SIZE_T)count*table->rowCount;
+		table->formIds=(DWORD*)malloc(sizeof(DWORD)*(table->rowCount?table->rowCount:1));
+		table->values=(DWORD*)calloc(cells?cells:1, sizeof(DWORD));
+		table->present=(BYTE*)calloc(cells?cells:1, 1);
+		ok=table->formIds&&table->values&&table->present;
+	}
+	int taskCount=ok?(table->rowCount+TABLE_BATCH-1)/TABLE_BATCH:0;
+	if(ok) {
+		for(int row=0;row<table->rowCount;row++) table->formIds[row]=esp->entries[build.entries[row]].formId;
+		build.strings=(TableStrings*)calloc(taskCount?taskCount:1, sizeof(TableStrings));
+		ok=build.strings!=0;
+	}
+	if(ok) {
+		ParallelFor(taskCount, DecodeTask, &build);
+		for(int t=0;t<taskCount;t++) ok=ok&&!build.strings[t].failed;
+	}
+	ok=ok&&JoinStrings(&build, taskCount);
+	for(int t=0;build.strings&&t<taskCount;t++) free(build.strings[t].data);
+	free(build.strings);
+	free(build.entries);
+	free(types);
+	if(!ok) {
+		tableClose(table);
+		return 0;
+	}
+	return table;
+}
+
+int _stdcall tableRowCount(RecordTable* table) {
+	return table->rowCount;
+}
+
+//Fills up to length form ids of the rows, in plugin order, and returns how many rows there are
+int _stdcall tableFormIds(RecordTable* table, DWORD* formIds, int length) {
+	if(length>table->rowCount) length=table->rowCount;
+	if(length>0) memcpy(formIds, table->formIds, sizeof(DWORD)*length);
+	return table->rowCount;
+}
+
+//Fills up to length values of a column, and whether each row has the field if present isn't 0. Returns how many
+//rows there are, or -1 if there is no such column.
+int _stdcall tableColumn(RecordTable* table, int column, DWORD* values, BYTE* present, int length) {
+	if(column<0||column>=table->columnCount) return -1;
+	if(length>table->rowCount) length=table->rowCount;
+	if(length>0) {
+		memcpy(values, table->values+(SIZE_T)column*table->rowCount, sizeof(DWORD)*length);
+		if(present) memcpy(present, table->present+(SIZE_T)column*table->rowCount, length);
+	}
+	return table->rowCount;
+}
+
+//Copies the table's strings into buffer, unless it is too small, when nothing is copied. Returns their length.
+int _stdcall tableStrings(RecordTable* table, char* buffer, int length) {
+	if(length>=0&&(DWORD)length>=table->stringsLength&&table->stringsLength) memcpy(buffer, table->strings, table->stringsLength);
+	return (int)table->stringsLength;
+}
@@ -0,0 +1,348 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "espReader.h"
+#include "fileUtil.h"
+#include "recordLayout.h"
+#include "workerPool.h"
+
+//Which records of a load order refer to each record. Every subrecord field the record layouts mark as a form id is
+//read once, across all cores, and resolved through its plugin's masters to the plugin defining the record and the
+//id within it, so references are matched no matter where the plugins sit in the load order. The references are
+//kept sorted by the record they point at, so finding what uses a record is a binary search.
+
+//refPluginState results
+#define REF_READ 0
+#define REF_MISSING -1
+
+//Records read by one task
+#define REF_BATCH 1024
+
+//Called after each plugin is read, and may be 0. Returning false stops the build.
+typedef BOOL (_stdcall *RefProgress)(int done, int total);
+
+struct RefPlugin {
+	char* name;
+	char* key;			//lower case name
+	int* definers;		//name of each master, then of the plugin itself
+	int masterCount;
+	int state;
+};
+
+struct RefEdge {
+	UINT64 key;			//defining name<<24 | id within the definer, of the record referred to
+	DWORD source;
+};
+
+struct RefChunk {
+	RefEdge* edges;
+	DWORD count;
+	DWORD capacity;
+	bool failed;
+};
+
+struct RefIndex {
+	RefPlugin* plugins;
+	int pluginCount;
+	char** names;		//every plugin named by the load order or a master list
+	int nameCount;
+	int nameCapacity;
+	DWORD sourceCount;
+	int* sourcePlugin;	//plugin holding each record
+	DWORD* sourceFormId;	//of each record, as its plugin refers to it
+	RefEdge* edges;		//sorted on key, then source
+	DWORD edgeCount;
+};
+
+struct RefBuild {
+	RefIndex* ref;
+	const RecordLayouts* layouts;
+	const EspFile* esp;	//of the plugin being read
+	RefChunk* chunks;
+	DWORD first;		//first record of the plugin being read
+	int* sourceEntry;	//entry of each record of the plugin being read
+};
+
+static int NameIndex(RefIndex* ref, const char* name) {
+	for(int i=0;i<ref->nameCount;i++) if(!strcmp(ref->names[i], name)) return i;
+	if(ref->nameCount==ref->nameCapacity) {
+		int grown=ref->nameCapacity?ref->nameCapacity*2:64;
+		char** names=(char**)realloc(ref->names, sizeof(char*)*grown);
+		if(!names) return -1;
+		ref->names=names;
+		ref->nameCapacity=grown;
+	}
+	size_t length=strlen(name);
+	ref->names[ref->nameCount]=(char*)malloc(length+1);
+	if(!ref->names[ref->nameCount]) return -1;
+	memcpy(ref->names[ref->nameCount], name, length+1);
+	return ref->nameCount++;
+}
+
+static inline UINT64 RecordKey(const RefPlugin* plugin, DWORD formId) {
+	DWORD master=formId>>24;
+	int definer=plugin->definers[master<(DWORD)plugin->masterCount?master:plugin->masterCount];
+	return ((UINT64)definer<<24)|(formId&0xffffff);
+}
+
+//Gives a plugin and its masters name indices, so a form id can be turned into the plugin defining the record
+static bool ReadDefiners(RefIndex* ref, RefPlugin* plugin, EspFile* esp) {
+	plugin->masterCount=esp->masterCount;
+	plugin->definers=(int*)malloc(sizeof(int)*(plugin->masterCount+1));
+	if(!plugin->definers) return false;
+	for(int m=0;m<plugin->masterCount;m++) {
+		char name[MAX_PATH];
+		if(espMasterName(esp, m, name, MAX_PATH)<0) name[0]=0;
+		Lower(name);
+		plugin->definers[m]=NameIndex(ref, name);
+		if(plugin->definers[m]<0) return false;
+	}
+	plugin->definers[plugin->masterCount]=NameIndex(ref, plugin->key);
+	return plugin->definers[plugin->masterCount]>=0;
+}
+
+//Reads the master list of every plugin. Each is closed again straight away; BuildIndex opens them one at a time.
+static bool OpenPlugins(RefIndex* ref, const char* dataPath, const char* const* plugins, int count) {
+	ref->plugins=(RefPlugin*)calloc(count?count:1, sizeof(RefPlugin));
+	if(!ref->plugins) return false;
+	for(int i=0;i<count;i++) {
+		RefPlugin* plugin=&ref->plugins[ref->pluginCount++];
+		size_t length=strlen(plugins[i]);
+		plugin->name=(char*)malloc(length+1);
+		plugin->key=(char*)malloc(length+1);
+		if(!plugin->name||!plugin->key) return false;
+		memcpy(plugin->name, plugins[i], length+1);
+		memcpy(plugin->key, plugins[i], length+1);
+		Lower(plugin->key);
+		char path[MAX_PATH*2];
+		EspFile* esp=DataPath(path, dataPath, plugin->name)?espOpen(path):0;
+		plugin->state=esp?REF_READ:REF_MISSING;
+		if(!esp) continue;
+		bool ok=ReadDefiners(ref, plugin, esp);
+		espClose(esp);
+		if(!ok) return false;
+	}
+	return true;
+}
+
+static bool AddEdge(RefChunk* chunk, UINT64 key, DWORD source) {
+	if(chunk->count==chunk->capacity) {
+		DWORD grown=chunk->capacity?chunk->capacity*2:4096;
+		RefEdge* edges=(RefEdge*)realloc(chunk->edges, sizeof(RefEdge)*grown);
+		if(!edges) return false;
+		chunk->edges=edges;
+		chunk->capacity=grown;
+	}
+	chunk->edges[chunk->count].key=key;
+	chunk->edges[chunk->count++].source=source;
+	return true;
+}
+
+static int CompareEdges(const void* a, const void* b) {
+	const RefEdge* x=(const RefEdge*)a;
+	const RefEdge* y=(const RefEdge*)b;
+	if(x->key!=y->key) return x->key<y->key?-1:1;
+	return x->source<y->source?-1:x->source>y->source;
+}
+
+//Reads the form ids inside a record. Damaged records and those with no layout refer to nothing.
+static bool ReadReferences(const RefBuild* build, RefChunk* chunk, DWORD source) {
+	const RefIndex* ref=build->ref;
+	const RefPlugin* plugin=&ref->plugins[ref->sourcePlugin[source]];
+	int index=build->sourceEntry[source-build->first];
+	const LayoutRecord* layout=LayoutFind(build->layouts, build->esp->entries[index].type);
+	if(!layout) return true;
+	DWORD size;
+	BYTE* owned;
+	const BYTE* data=EspRecordData(build->esp, index, &size, &owned);
+	int count=data?EspSplitSubrecords(data, size, 0, 0):-1;
+	if(count<=0) {
+		free(owned);
+		return true;
+	}
+	EspSubrecord* subrecords=(EspSubrecord*)malloc(sizeof(EspSubrecord)*count);
+	int* matched=(int*)malloc(sizeof(int)*count);
+	int capacity=size/4+1;
+	DWORD* offsets=(DWORD*)malloc(sizeof(DWORD)*capacity);
+	bool ok=subrecords&&matched&&offsets;
+	if(ok) {
+		EspSplitSubrecords(data, size, subrecords, count);
+		LayoutMatch(build->layouts, layout, data, subrecords, count, matched);
+		UINT64 self=RecordKey(plugin, ref->sourceFormId[source]);
+		DWORD first=chunk->count;
+		for(int i=0;i<count&&ok;i++) {
+			if(matched[i]<0) continue;
+			const BYTE* sub=data+subrecords[i].offset;
+			int found=LayoutFormIds(build->layouts, layout->firstSubrecord+matched[i], sub, subrecords[i].size,
+				offsets, capacity);
+			for(int j=0;j<found&&j<capacity&&ok;j++) {
+				DWORD formId=*(const DWORD*)(sub+offsets[j]);
+				if(!formId) continue;
+				UINT64 key=RecordKey(plugin, formId);
+				if(key!=self) ok=AddEdge(chunk, key, source);
+			}
+		}
+		//a record listing the same form id many times, as leveled lists do, is only counted once
+		if(ok&&chunk->count-first>1) {
+			RefEdge* edges=chunk->edges+first;
+			qsort(edges, chunk->count-first, sizeof(RefEdge), CompareEdges);
+			DWORD unique=1;
+			for(DWORD k=1;k<chunk->count-first;k++) if(edges[k].key!=edges[unique-1].key) edges[unique++]=edges[k];
+			chunk->count=first+unique;
+		}
+	}
+	free(subrecords);
+	free(matched);
+	free(offsets);
+	free(owned);
+	return ok;
+}
+
+static void ReadTask(int index, void* context) {
+	RefBuild* build=(RefBuild*)context;
+	RefChunk* chunk=&build->chunks[index];
+	DWORD start=build->first+(DWORD)index*REF_BATCH;
+	DWORD end=start+REF_BATCH;
+	if(end>build->ref->sourceCount) end=build->ref->sourceCount;
+	for(DWORD source=start;source<end&&!chunk->failed;source++) {
+		if(!ReadReferences(build, chunk, source)) chunk->failed=true;
+	}
+}
+
+//Lists every record of a plugin, reads their references across all cores and adds them to the index. Only the one
+//plugin is mapped and inflated at a time, which bounds the memory used however long the load order is. A plugin
+//that can no longer be read is left out.
+static bool ReadPlugin(RefIndex* ref, RefBuild* build, const char* dataPath, int p) {
+	RefPlugin* plugin=&ref->plugins[p];
+	char path[MAX_PATH*2];
+	EspFile* esp=DataPath(path, dataPath, plugin->name)?espOpen(path):0;
+	if(!esp||esp->masterCount!=plugin->masterCount) {
+		if(esp) espClose(esp);
+		plugin->state=REF_MISSING;
+		return true;
+	}
+	//every record is read, so inflate them all up front
+	espInflateAll(esp);
+	DWORD total=ref->sourceCount+esp->recordCount;
+	int* sourcePlugin=(int*)realloc(ref->sourcePlugin, sizeof(int)*(total?total:1));
+	if(sourcePlugin) ref->sourcePlugin=sourcePlugin;
+	DWORD* sourceFormId=(DWORD*)realloc(ref->sourceFormId, sizeof(DWORD)*(total?total:1));
+	if(sourceFormId) ref->sourceFormId=sourceFormId;
+	build->esp=esp;
+	build->first=ref->sourceCount;
+	build->sourceEntry=(int*)malloc(sizeof(int)*(esp->recordCount?esp->recordCount:1));
+	bool ok=sourcePlugin&&sourceFormId&&build->sourceEntry;
+	//the TES4 record refers to nothing, so the first entry is skipped
+	for(int i=1;ok&&i<esp->count;i++) {
+		if(esp->entries[i].type==ESP_TYPE_GRUP) continue;
+		ref->sourcePlugin[ref->sourceCount]=p;
+		ref->sourceFormId[ref->sourceCount]=esp->entries[i].formId;
+		build->sourceEntry[ref->sourceCount++-build->first]=i;
+	}
+	int chunkCount=ok?(int)((ref->sourceCount-build->first+REF_BATCH-1)/REF_BATCH):0;
+	build->chunks=(RefChunk*)calloc(chunkCount?chunkCount:1, sizeof(RefChunk));
+	ok=ok&&build->chunks;
+	DWORD added=0;
+	if(ok) {
+		ParallelFor(chunkCount, ReadTask, build);
+		for(int i=0;i<chunkCount;i++) {
+			ok=ok&&!build->chunks[i].failed;
+			added+=build->chunks[i].count;
+		}
+	}
+	if(ok&&added) {
+		RefEdge* edges=(RefEdge*)realloc(ref->edges, sizeof(RefEdge)*(ref->edgeCount+added));
+		if(edges) ref->edges=edges;
+		ok=edges!=0;
+	}
+	for(int i=0;build->chunks&&i<chunkCount;i++) {
+		if(ok&&build->chunks[i].count) {
+			memcpy(ref->edges+ref->edgeCount, build->chunks[i].edges, sizeof(RefEdge)*build->chunks[i].count);
+			ref->edgeCount+=build->chunks[i].count;
+		}
+		free(build->chunks[i].edges);
+	}
+	free(build->chunks);
+	free(build->sourceEntry);
+	espClose(esp);
+	return ok;
+}
+
+//Reads the references of every readable plugin, then sorts them on the record they point at
+static bool BuildIndex(RefIndex* ref, const char* dataPath, const RecordLayouts* layouts, RefProgress progress) {
+	RefBuild build;
+	build.ref=ref;
+	build.layouts=layouts;
+	for(int p=0;p<ref->pluginCount;p++) {
+		if(ref->plugins[p].state==REF_READ&&!ReadPlugin(ref, &build, dataPath, p)) return false;
+		if(progress&&!progress(p+1, ref->pluginCount)) return false;
+	}
+	qsort(ref->edges, ref->edgeCount, sizeof(RefEdge), CompareEdges);
+	return true;
+}
+
+void _stdcall refClose(RefIndex* ref) {
+	if(!ref) return;
+	for(int i=0;i<ref->pluginCount;i++) {
+		free(ref->plugins[i].name);
+		free(ref->plugins[i].key);
+		free(ref->plugins[i].definers);
+	}
+	for(int i=0;i<ref->nameCount;i++) free(ref->names[i]);
+	free(ref->plugins);
+	free(ref->names);
+	free(ref->sourcePlugin);
+	free(ref->sourceFormId);
+	free(ref->edges);
+	free(ref);
+}
+
+//Indexes the references between the records of the given plugins, in load order, reading them from dataPath one
+//plugin at a time, each across all cores. Plugins that are missing or damaged are left out. Returns 0 if the index
+//can't be built or progress stops it.
+RefIndex* _stdcall refOpen(const char* dataPath, const char* const* plugins, int count, RecordLayouts* layouts,
+	RefProgress progress) {
+	if(!layouts) return 0;
+	RefIndex* ref=(RefIndex*)calloc(1, sizeof(RefIndex));
+	if(!ref) return 0;
+	if(!OpenPlugins(ref, dataPath, plugins, count)) {
+		refClose(ref);
+		return 0;
+	}
+	if(!BuildIndex(ref, dataPath, layouts, progress)) {
+		refClose(ref);
+		return 0;
+	}
+	return ref;
+}
+
+int _stdcall refPluginState(RefIndex* ref, int plugin) {
+	if(plugin<0||plugin>=ref->pluginCount) return REF_MISSING;
+	return ref->plugins[plugin].state;
+}
+
+int _stdcall refReferenceCount(RefIndex* ref) {
+	return (int)ref->edgeCount;
+}
+
+//Fills up to length of the records referring to a record, as the position of each one's plugin in the load order
+//and its form id as that plugin refers to it, ordered by plugin. Returns how many there are.
+int _stdcall refFind(RefIndex* ref, int plugin, DWORD formId, int* plugins, DWORD* formIds, int length) {
+	if(plugin<0||plugin>=ref->pluginCount||ref->plugins[plugin].state!=REF_READ) return 0;
+	UINT64 key=RecordKey(&ref->plugins[plugin], formId);
+	DWORD low=0, high=ref->edgeCount;
+	while(low<high) {
+		DWORD middle=(low+high)/2;
+		if(ref->edges[middle].key<key) low=middle+1;
+		else high=middle;
+	}
+	int count=0;
+	for(DWORD i=low;i<ref->edgeCount&&ref->edges[i].key==key;i++,count++) {
+		if(count>=length) continue;
+		DWORD source=ref->edges[i].source;
+		if(plugins) plugins[count]=ref->sourcePlugin[source];
+		if(formIds) formIds[count]=ref->sourceFormId[source];
+	}
+	return count;
+}
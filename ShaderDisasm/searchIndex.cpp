@@ -0,0 +1,368 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "workerPool.h"
+
+//Searches over the records of a plugin as TESsnip holds them. The editor hands over each record's form id, type,
+//editor id, full name and the string data of its subrecords once, and they are kept lower cased the way the
+//editor lower cases them. Once built, form ids and types are binary searches over sorted arrays, and editor ids and
+//full names are looked up through the trigrams they contain, so only records holding the rarest trigram of a query
+//are compared with it.
+
+//Fields srchFindText searches
+#define SEARCH_EDITOR_ID 0
+#define SEARCH_NAME 1
+#define SEARCH_TEXT 2
+
+//Trigram hash buckets of each field with a trigram index
+#define SEARCH_TRIGRAM_BITS 18
+
+//Marks a record lacking a field
+#define SEARCH_ABSENT 0xffffffff
+
+struct SearchRecord {
+	DWORD formId;
+	DWORD type;
+	DWORD fields[3];	//offset of each field in the arena, or SEARCH_ABSENT
+	DWORD lengths[3];
+};
+
+struct SearchIndex {
+	SearchRecord* records;
+	int recordCount;
+	int recordCapacity;
+	BYTE* arena;
+	DWORD arenaLength;
+	DWORD arenaCapacity;
+	int* byFormId;		//record indices, sorted on form id
+	int* byType;		//likewise, on type
+	DWORD* trigramStarts[2];	//of each bucket's records in trigramRecords, and then the end
+	int* trigramRecords[2];	//records holding a trigram of each bucket, in record order
+	bool built;
+};
+
+struct SearchBuild {
+	SearchIndex* index;
+	bool failed;
+};
+
+//Lower cases bytes read a byte to a char as the editor reads strings, so as ToLowerInvariant does for those chars
+static const BYTE* LowerTable() {
+	static BYTE table[256];
+	static bool made=false;
+	if(!made) {
+		for(int i=0;i<256;i++) table[i]=(BYTE)i;
+		for(int i='A';i<='Z';i++) table[i]=(BYTE)(i+'a'-'A');
+		for(int i=0xc0;i<=0xde;i++) if(i!=0xd7) table[i]=(BYTE)(i+0x20);
+		made=true;
+	}
+	return table;
+}
+
+static inline DWORD TrigramSlot(const BYTE* s) {
+	return ((DWORD)s[0]|(DWORD)s[1]<<8|(DWORD)s[2]<<16)*2654435761u>>(32-SEARCH_TRIGRAM_BITS);
+}
+
+static bool Contains(const BYTE* text, DWORD length, const BYTE* pattern, DWORD patternLength) {
+	if(!patternLength) return true;
+	if(patternLength>length) return false;
+	const BYTE* last=text+length-patternLength;
+	for(const BYTE* p=text;p<=last;p++) {
+		p=(const BYTE*)memchr(p, pattern[0], last-p+1);
+		if(!p) return false;
+		if(!memcmp(p, pattern, patternLength)) return true;
+	}
+	return false;
+}
+
+static bool AddField(SearchIndex* index, SearchRecord* record, int field, const BYTE* text, int length) {
+	if(!text||length<0) {
+		record->fields[field]=SEARCH_ABSENT;
+		record->lengths[field]=0;
+		return true;
+	}
+	if(index->arenaLength+(DWORD)length>index->arenaCapacity) {
+		DWORD grown=index->arenaCapacity?index->arenaCapacity*2:1<<20;
+		while(grown<index->arenaLength+(DWORD)length) grown*=2;
+		BYTE* arena=(BYTE*)realloc(index->arena, grown);
+		if(!arena) return false;
+		index->arena=arena;
+		index->arenaCapacity=grown;
+	}
+	const BYTE* lower=LowerTable();
+	BYTE* to=index->arena+index->arenaLength;
+	for(int i=0;i<length;i++) to[i]=lower[text[i]];
+	record->fields[field]=index->arenaLength;
+	record->lengths[field]=length;
+	index->arenaLength+=length;
+	return true;
+}
+
+struct SearchKey {
+	DWORD key;
+	int record;
+};
+
+static int CompareKeys(const void* a, const void* b) {
+	const SearchKey* x=(const SearchKey*)a;
+	const SearchKey* y=(const SearchKey*)b;
+	if(x->key!=y->key) return x->key<y->key?-1:1;
+	return x->record-y->record;
+}
+
+//Gets the records in order of form id or type, keeping the order they were added among equals
+static int* SortRecords(const SearchIndex* index, bool byType) {
+	SearchKey* keys=(SearchKey*)malloc(sizeof(SearchKey)*(index->recordCount?index->recordCount:1));
+	int* order=(int*)malloc(sizeof(int)*(index->recordCount?index->recordCount:1));
+	if(!keys||!order) {
+		free(keys);
+		free(order);
+		return 0;
+	}
+	for(int i=0;i<index->recordCount;i++) {
+		keys[i].key=byType?index->records[i].type:index->records[i].formId;
+		keys[i].record=i;
+	}
+	qsort(keys, index->recordCount, sizeof(SearchKey), CompareKeys);
+	for(int i=0;i<index->recordCount;i++) order[i]=keys[i].record;
+	free(keys);
+	return order;
+}
+
+//Lists the records holding each trigram bucket of a field, counting the buckets first so the lists can share one
+//array
+static bool IndexTrigrams(SearchIndex* index, int field) {
+	DWORD buckets=1<<SEARCH_TRIGRAM_BITS;
+	DWORD* starts=(DWORD*)calloc(buckets+1, sizeof(DWORD));
+	int* last=(int*)malloc(sizeof(int)*buckets);
+	if(!starts||!last) {
+		free(starts);
+		free(last);
+		return false;
+	}
+	memset(last, 0xff, sizeof(int)*buckets);
+	for(int i=0;i<index->recordCount;i++) {
+		const SearchRecord* record=&index->records[i];
+		if(record->fields[field]==SEARCH_ABSENT) continue;
+		const BYTE* text=index->arena+record->fields[field];
+		for(DWORD j=0;j+3<=record->lengths[field];j++) {
+			DWORD slot=TrigramSlot(text+j);
+			if(last[slot]==i) continue;
+			last[slot]=i;
+			starts[slot+1]++;
+		}
+	}
+	for(DWORD b=0;b<buckets;b++) starts[b+1]+=starts[b];
+	int* records=(int*)malloc(sizeof(int)*(starts[buckets]?starts[buckets]:1));
+	DWORD* next=(DWORD*)malloc(sizeof(DWORD)*buckets);
+	if(!records||!next) {
+		free(starts);
+		free(last);
+		free(records);
+		free(next);
+		return false;
+	}
+	memcpy(next, starts, sizeof(DWORD)*buckets);
+	memset(last, 0xff, sizeof(int)*buckets);
+	for(int i=0;i<index->recordCount;i++) {
+		const SearchRecord* record=&index->records[i];
+		if(record->fields[field]==SEARCH_ABSENT) continue;
+		const BYTE* text=index->arena+record->fields[field];
+		for(DWORD j=0;j+3<=record->lengths[field];j++) {
+			DWORD slot=TrigramSlot(text+j);
+			if(last[slot]==i) continue;
+			last[slot]=i;
+			records[next[slot]++]=i;
+		}
+	}
+	free(last);
+	free(next);
+	index->trigramStarts[field]=starts;
+	index->trigramRecords[field]=records;
+	return true;
+}
+
+static void BuildTask(int task, void* context) {
+	SearchBuild* build=(SearchBuild*)context;
+	SearchIndex* index=build->index;
+	bool ok;
+	switch(task) {
+	case 0:
+		ok=(index->byFormId=SortRecords(index, false))!=0;
+		break;
+	case 1:
+		ok=(index->byType=SortRecords(index, true))!=0;
+		break;
+	default:
+		ok=IndexTrigrams(index, task-2);
+		break;
+	}
+	if(!ok) build->failed=true;
+}
+
+static void FreeBuilt(SearchIndex* index) {
+	free(index->byFormId);
+	free(index->byType);
+	index->byFormId=0;
+	index->byType=0;
+	for(int f=0;f<2;f++) {
+		free(index->trigramStarts[f]);
+		free(index->trigramRecords[f]);
+		index->trigramStarts[f]=0;
+		index->trigramRecords[f]=0;
+	}
+	index->built=false;
+}
+
+SearchIndex* _stdcall srchOpen() {
+	LowerTable();
+	return (SearchIndex*)calloc(1, sizeof(SearchIndex));
+}
+
+void _stdcall srchClose(SearchIndex* index) {
+	if(!index) return;
+	FreeBuilt(index);
+	free(index->records);
+	free(index->arena);
+	free(index);
+}
+
+//Adds the next record. text is the string data of each of its subrecords in turn, each ending in a NUL. A length of
+//-1 marks a record lacking its editor id or full name. Returns FALSE if there isn't the memory.
+BOOL _stdcall srchAdd(SearchIndex* index, DWORD formId, DWORD type, const BYTE* editorId, int editorIdLength,
+	const BYTE* name, int nameLength, const BYTE* text, int textLength) {
+	if(index->built) FreeBuilt(index);
+	if(index->recordCount==index->recordCapacity) {
+		int grown=index->recordCapacity?index->recordCapacity*2:4096;
+		SearchRecord* records=(SearchRecord*)realloc(index->records, sizeof(SearchRecord)*grown);
+		if(!records) return FALSE;
+		index->records=records;
+		index->recordCapacity=grown;
+	}
+	SearchRecord* record=&index->records[index->recordCount];
+	record->formId=formId;
+	record->type=type;
+	if(!AddField(index, record, SEARCH_EDITOR_ID, editorId, editorIdLength)||
+		!AddField(index, record, SEARCH_NAME, name, nameLength)||
+		!AddField(index, record, SEARCH_TEXT, text, text?textLength:0)) return FALSE;
+	index->recordCount++;
+	return TRUE;
+}
+
+//Sorts the records on form id and type and indexes the trigrams of their editor ids and full names, all at once
+//across the cores. Returns FALSE if there isn't the memory.
+BOOL _stdcall srchBuild(SearchIndex* index) {
+	if(index->built) return TRUE;
+	SearchBuild build;
+	build.index=index;
+	build.failed=false;
+	ParallelFor(4, BuildTask, &build);
+	if(build.failed) {
+		FreeBuilt(index);
+		return FALSE;
+	}
+	index->built=true;
+	return TRUE;
+}
+
+int _stdcall srchRecordCount(SearchIndex* index) {
+	return index->recordCount;
+}
+
+//Gets the range of sorted records whose key is value
+static void Range(const SearchIndex* index, const int* order, bool byType, DWORD value, int* first, int* end) {
+	int low=0, high=index->recordCount;
+	while(low<high) {
+		int middle=(low+high)/2;
+		const SearchRecord* record=&index->records[order[middle]];
+		if((byType?record->type:record->formId)<value) low=middle+1;
+		else high=middle;
+	}
+	*first=low;
+	high=index->recordCount;
+	while(low<high) {
+		int middle=(low+high)/2;
+		const SearchRecord* record=&index->records[order[middle]];
+		if((byType?record->type:record->formId)<=value) low=middle+1;
+		else high=middle;
+	}
+	*end=low;
+}
+
+//Fills up to length records with a form id, and of the given type unless type is 0, in the order they were added.
+//Returns how many there are, or -1 if the index isn't built.
+int _stdcall srchFindFormId(SearchIndex* index, DWORD formId, DWORD type, int* records, int length) {
+	if(!index->built) return -1;
+	int first, end;
+	Range(index, index->byFormId, false, formId, &first, &end);
+	int count=0;
+	for(int i=first;i<end;i++) {
+		int record=index->byFormId[i];
+		if(type&&index->records[record].type!=type) continue;
+		if(count<length) records[count]=record;
+		count++;
+	}
+	return count;
+}
+
+//Tells whether a field of a record matches a lower cased query. Subrecord text matches if any one subrecord's does.
+static bool Matches(const SearchIndex* index, const SearchRecord* record, int field, const BYTE* query,
+	DWORD length, BOOL partial) {
+	if(record->fields[field]==SEARCH_ABSENT) return false;
+	const BYTE* text=index->arena+record->fields[field];
+	DWORD textLength=record->lengths[field];
+	if(field!=SEARCH_TEXT) {
+		if(partial) return Contains(text, textLength, query, length);
+		return textLength==length&&(!length||!memcmp(text, query, length));
+	}
+	if(partial) {
+		if(!textLength) return false;
+		return Contains(text, textLength, query, length);
+	}
+	for(DWORD at=0;at<textLength;) {
+		const BYTE* end=(const BYTE*)memchr(text+at, 0, textLength-at);
+		DWORD stringLength=end?(DWORD)(end-text)-at:textLength-at;
+		if(stringLength==length&&!memcmp(text+at, query, length)) return true;
+		at+=stringLength+1;
+	}
+	return false;
+}
+
+//Fills up to length records whose editor id, full name or subrecord text contains or, unless partial, is the
+//query, ignoring case, and that are of the given type unless type is 0. Records are given in the order they were
+//added. Returns how many there are, or -1 if the index isn't built or the query is too long.
+int _stdcall srchFindText(SearchIndex* index, int field, const BYTE* text, int textLength, BOOL partial, DWORD type,
+	int* records, int length) {
+	if(!index->built||field<SEARCH_EDITOR_ID||field>SEARCH_TEXT||textLength<0||textLength>MAX_PATH*4) return -1;
+	BYTE query[MAX_PATH*4];
+	const BYTE* lower=LowerTable();
+	for(int i=0;i<textLength;i++) query[i]=lower[text[i]];
+	//the candidates are the records holding the query's rarest trigram, or those of the type, or else all of them
+	const int* candidates=0;
+	int first=0, end=index->recordCount;
+	if(field!=SEARCH_TEXT&&textLength>=3) {
+		const DWORD* starts=index->trigramStarts[field];
+		DWORD best=TrigramSlot(query);
+		for(int i=1;i+3<=textLength;i++) {
+			DWORD slot=TrigramSlot(query+i);
+			if(starts[slot+1]-starts[slot]<starts[best+1]-starts[best]) best=slot;
+		}
+		candidates=index->trigramRecords[field];
+		first=(int)starts[best];
+		end=(int)starts[best+1];
+	} else if(type) {
+		candidates=index->byType;
+		Range(index, index->byType, true, type, &first, &end);
+	}
+	int count=0;
+	for(int i=first;i<end;i++) {
+		int record=candidates?candidates[i]:i;
+		const SearchRecord* r=&index->records[record];
+		if(type&&r->type!=type) continue;
+		if(!Matches(index, r, field, query, textLength, partial)) continue;
+		if(count<length) records[count]=record;
+		count++;
+	}
+	return count;
+}
@@ -0,0 +1,456 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bsaReader.h"
+#include "fileUtil.h"
+#include "vfsIndex.h"
+#include "workerPool.h"
+
+#define SNAPSHOT_MAGIC 0x31534656	//"VFS1"
+#define MAX_VFS_PATH 1024
+
+//Every path a source provides, lower case and NUL separated
+struct VfsListing {
+	char* names;
+	DWORD length;
+	DWORD capacity;
+	DWORD count;
+	UINT64* times;		//write time of each loose file
+	DWORD timeCapacity;
+};
+
+struct VfsSource {
+	char* name;			//archive name, or 0 for the loose files
+	UINT64 size;
+	UINT64 time;
+	VfsListing list;
+	bool cached;		//list came from the snapshot
+	bool failed;		//the archive couldn't be read, so its empty list isn't kept in the snapshot
+};
+
+struct VfsIndex {
+	VfsSource* sources;
+	int sourceCount;
+	DWORD pathCount;
+	const char** pathName;
+	UINT64* pathHash;
+	DWORD* table;			//path index+1 for each slot, or 0 if empty
+	DWORD tableMask;
+	DWORD* providerFirst;	//index of each path's first provider, plus the provider count at the end
+	DWORD* providers;		//sources of each path, in load order
+	DWORD* winner;
+	DWORD* overrideFirst;	//the same for the paths each source overrides
+	DWORD* overrides;
+};
+
+struct VfsBuild {
+	const char* dataPath;
+	VfsIndex* vfs;
+	int* pending;
+};
+
+static UINT64 HashPath(const char* path, DWORD length) {
+	UINT64 hash=0xcbf29ce484222325ull;
+	for(DWORD i=0;i<length;i++) {
+		hash^=(BYTE)path[i];
+		hash*=0x100000001b3ull;
+	}
+	return hash;
+}
+
+//Lower cases path into buffer with '\\' separators and no leading separator, returning its length or -1
+static int NormalizePath(const char* path, char* buffer) {
+	while(*path=='\\'||*path=='/') path++;
+	int length=0;
+	for(;*path;path++) {
+		if(length==MAX_VFS_PATH-1) return -1;
+		char c=*path;
+		if(c=='/') c='\\';
+		else if(c>='A'&&c<='Z') c+='a'-'A';
+		buffer[length++]=c;
+	}
+	buffer[length]=0;
+	return length;
+}
+
+static bool Append(VfsListing* list, const char* path, UINT64 time, bool timed) {
+	char name[MAX_VFS_PATH];
+	int length=NormalizePath(path, name);
+	if(length<=0) return true;
+	if(list->length+length+1>list->capacity) {
+		DWORD capacity=list->capacity?list->capacity*2:0x10000;
+		while(capacity<list->length+length+1) capacity*=2;
+		char* names=(char*)realloc(list->names, capacity);
+		if(!names) return false;
+		list->names=names;
+		list->capacity=capacity;
+	}
+	if(timed&&list->count==list->timeCapacity) {
+		DWORD capacity=list->timeCapacity?list->timeCapacity*2:1024;
+		UINT64* times=(UINT64*)realloc(list->times, capacity*sizeof(UINT64));
+		if(!times) return false;
+		list->times=times;
+		list->timeCapacity=capacity;
+	}
+	memcpy(list->names+list->length, name, length+1);
+	list->length+=length+1;
+	if(timed) list->times[list->count]=time;
+	list->count++;
+	return true;
+}
+
+static void FreeListing(VfsListing* list) {
+	free(list->names);
+	free(list->times);
+	memset(list, 0, sizeof(VfsListing));
+}
+
+
+static bool ListArchive(const char* dataPath, VfsSource* source) {
+	char path[MAX_PATH*2];
+	if(!DataPath(path, dataPath, source->name)) {
+		source->failed=true;
+		return true;
+	}
+	BsaArchive* bsa=bsaOpen(path);
+	if(!bsa) {
+		source->failed=true;
+		return true;
+	}
+	char name[MAX_VFS_PATH];
+	bool ok=true;
+	int count=bsaFileCount(bsa);
+	for(int i=0;i<count&&ok;i++) {
+		if(bsaFileName(bsa, i, name, MAX_VFS_PATH)>0) ok=Append(&source->list, name, 0, false);
+	}
+	bsaClose(bsa);
+	return ok;
+}
+
+//Walks every folder below Data. Files in Data itself are plugins and archives rather than resources.
+static bool ListLoose(const char* dataPath, char* relative, int relativeLength, VfsListing* list) {
+	char pattern[MAX_PATH*2];
+	DWORD length=(DWORD)strlen(dataPath)+1+relativeLength;
+	if(length+3>MAX_PATH*2||!DataPath(pattern, dataPath, relative)) return true;
+	memcpy(pattern+length, relativeLength?"\\*":"*", relativeLength?3:2);
+	WIN32_FIND_DATAA fd;
+	HANDLE find=FindFirstFileA(pattern, &fd);
+	if(find==INVALID_HANDLE_VALUE) return true;
+	bool ok=true;
+	do {
+		if(!strcmp(fd.cFileName, ".")||!strcmp(fd.cFileName, "..")) continue;
+		int nameLength=(int)strlen(fd.cFileName);
+		if(relativeLength+nameLength+2>=MAX_VFS_PATH) continue;
+		int start=relativeLength;
+		if(start) relative[start++]='\\';
+		memcpy(relative+start, fd.cFileName, nameLength+1);
+		if(fd.dwFileAttributes&FILE_ATTRIBUTE_DIRECTORY) ok=ListLoose(dataPath, relative, start+nameLength, list);
+		else if(relativeLength) ok=Append(list, relative, FileTime(fd.ftLastWriteTime), true);
+		relative[relativeLength]=0;
+	} while(ok&&FindNextFileA(find, &fd));
+	FindClose(find);
+	return ok;
+}
+
+static void ListTask(int index, void* context) {
+	VfsBuild* build=(VfsBuild*)context;
+	VfsSource* source=&build->vfs->sources[build->pending[index]];
+	bool ok;
+	if(source->name) {
+		ok=ListArchive(build->dataPath, source);
+	} else {
+		char relative[MAX_VFS_PATH];
+		relative[0]=0;
+		ok=ListLoose(build->dataPath, relative, 0, &source->list);
+	}
+	if(!ok) {
+		FreeListing(&source->list);
+		source->failed=true;
+	}
+}
+
+//Snapshot layout: magic, archive count, then for each archive its name length, name, size, time, path count,
+//listing length and the listing itself
+static void LoadSnapshot(const char* path, VfsIndex* vfs) {
+	SnapshotReader reader;
+	if(!SnapshotOpen(&reader, path, SNAPSHOT_MAGIC)) return;
+	const DWORD* count=(const DWORD*)SnapshotRead(&reader, 4);
+	for(DWORD i=0;count&&i<*count;i++) {
+		const char* name;
+		WORD nameLength;
+		UINT64 size, time;
+		if(!SnapshotReadStamp(&reader, &name, &nameLength, &size, &time)) break;
+		const DWORD* counts=(const DWORD*)SnapshotRead(&reader, 8);
+		if(!counts) break;
+		DWORD paths=counts[0];
+		DWORD length=counts[1];
+		const char* names=(const char*)SnapshotRead(&reader, length);
+		if(!names||(length&&names[length-1])) break;
+		DWORD terminators=0;
+		for(DWORD j=0;j<length;j++) if(!names[j]) terminators++;
+		if(terminators!=paths) break;
+		for(int s=0;s<vfs->sourceCount;s++) {
+			VfsSource* source=&vfs->sources[s];
+			if(!source->name||source->cached||source->size!=size||source->time!=time) continue;
+			if(strlen(source->name)!=nameLength||_strnicmp(source->name, name, nameLength)) continue;
+			source->list.names=(char*)malloc(length?length:1);
+			if(!source->list.names) continue;
+			memcpy(source->list.names, names, length);
+			source->list.length=source->list.capacity=length;
+			source->list.count=paths;
+			source->cached=true;
+		}
+	}
+	SnapshotClose(&reader);
+}
+
+static void SaveSnapshot(const char* path, const VfsIndex* vfs) {
+	SnapshotWriter writer;
+	if(!SnapshotCreate(&writer, path, SNAPSHOT_MAGIC)) return;
+	DWORD count=0;
+	for(int i=0;i<vfs->sourceCount;i++) if(vfs->sources[i].name&&!vfs->sources[i].failed) count++;
+	SnapshotWrite(&writer, &count, 4);
+	for(int i=0;i<vfs->sourceCount;i++) {
+		const VfsSource* source=&vfs->sources[i];
+		if(!source->name||source->failed) continue;
+		DWORD counts[2]={ source->list.count, source->list.length };
+		SnapshotWriteStamp(&writer, source->name, source->size, source->time);
+		SnapshotWrite(&writer, counts, 8);
+		SnapshotWrite(&writer, source->list.names, source->list.length);
+	}
+	SnapshotFinish(&writer);
+}
+
+//Splits a comma separated archive list, as in SArchiveList, into sources followed by the loose files
+static bool AddSources(VfsIndex* vfs, const char* dataPath, const char* archives) {
+	int count=1;
+	for(const char* c=archives;c&&*c;c++) if(*c==',') count++;
+	vfs->sources=(VfsSource*)calloc(count+1, sizeof(VfsSource));
+	if(!vfs->sources) return false;
+	const char* p=archives;
+	while(p&&*p) {
+		const char* end=strchr(p, ',');
+		if(!end) end=p+strlen(p);
+		const char* last=end;
+		while(p<last&&(*p==' '||*p=='\t')) p++;
+		while(last>p&&(last[-1]==' '||last[-1]=='\t')) last--;
+		if(last>p&&last-p<MAX_PATH) {
+			VfsSource* source=&vfs->sources[vfs->sourceCount++];
+			source->name=(char*)malloc(last-p+1);
+			if(!source->name) return false;
+			memcpy(source->name, p, last-p);
+			source->name[last-p]=0;
+			DataStamp(dataPath, source->name, &source->size, &source->time);
+		}
+		p=*end?end+1:end;
+	}
+	vfs->sourceCount++;
+	return true;
+}
+
+static DWORD FindPath(const VfsIndex* vfs, const char* name, UINT64 hash) {
+	for(DWORD slot=(DWORD)hash&vfs->tableMask;vfs->table[slot];slot=(slot+1)&vfs->tableMask) {
+		DWORD path=vfs->table[slot]-1;
+		if(vfs->pathHash[path]==hash&&!strcmp(vfs->pathName[path], name)) return path;
+	}
+	return (DWORD)-1;
+}
+
+//Gives every distinct path an index, then groups the providers of each path and picks its winner
+static bool BuildIndex(VfsIndex* vfs, DWORD flags) {
+	DWORD total=0;
+	for(int i=0;i<vfs->sourceCount;i++) total+=vfs->sources[i].list.count;
+	DWORD tableSize=16;
+	while(tableSize<total*2) tableSize*=2;
+	vfs->tableMask=tableSize-1;
+	vfs->table=(DWORD*)calloc(tableSize, sizeof(DWORD));
+	vfs->pathName=(const char**)malloc(sizeof(char*)*(total+1));
+	vfs->pathHash=(UINT64*)malloc(sizeof(UINT64)*(total+1));
+	DWORD* provided=(DWORD*)malloc(sizeof(DWORD)*(total+1));
+	DWORD* providedBy=(DWORD*)malloc(sizeof(DWORD)*(total+1));
+	UINT64* providedTime=(UINT64*)malloc(sizeof(UINT64)*(total+1));
+	vfs->providers=(DWORD*)malloc(sizeof(DWORD)*(total+1));
+	vfs->overrideFirst=(DWORD*)calloc(vfs->sourceCount+1, sizeof(DWORD));
+	if(!vfs->table||!vfs->pathName||!vfs->pathHash||!provided||!providedBy||!providedTime||!vfs->providers||!vfs->overrideFirst) {
+		free(provided);
+		free(providedBy);
+		free(providedTime);
+		return false;
+	}
+
+	DWORD count=0;
+	for(int s=0;s<vfs->sourceCount;s++) {
+		const VfsListing* list=&vfs->sources[s].list;
+		const char* name=list->names;
+		for(DWORD i=0;i<list->count;i++) {
+			DWORD length=(DWORD)strlen(name);
+			UINT64 hash=HashPath(name, length);
+			DWORD path=FindPath(vfs, name, hash);
+			if(path==(DWORD)-1) {
+				path=vfs->pathCount++;
+				vfs->pathName[path]=name;
+				vfs->pathHash[path]=hash;
+				DWORD slot=(DWORD)hash&vfs->tableMask;
+				while(vfs->table[slot]) slot=(slot+1)&vfs->tableMask;
+				vfs->table[slot]=path+1;
+			}
+			provided[count]=path;
+			providedBy[count]=s;
+			providedTime[count]=list->times?list->times[i]:vfs->sources[s].time;
+			count++;
+			name+=length+1;
+		}
+	}
+
+	vfs->providerFirst=(DWORD*)calloc(vfs->pathCount+1, sizeof(DWORD));
+	vfs->winner=(DWORD*)malloc(sizeof(DWORD)*(vfs->pathCount+1));
+	UINT64* times=(UINT64*)malloc(sizeof(UINT64)*(count+1));
+	if(!vfs->providerFirst||!vfs->winner||!times) {
+		free(provided);
+		free(providedBy);
+		free(providedTime);
+		free(times);
+		return false;
+	}
+	//counting sort keeps each path's providers in load order
+	for(DWORD i=0;i<count;i++) vfs->providerFirst[provided[i]+1]++;
+	for(DWORD i=0;i<vfs->pathCount;i++) vfs->providerFirst[i+1]+=vfs->providerFirst[i];
+	for(DWORD i=0;i<count;i++) {
+		DWORD slot=vfs->providerFirst[provided[i]]++;
+		vfs->providers[slot]=providedBy[i];
+		times[slot]=providedTime[i];
+	}
+	for(DWORD i=vfs->pathCount;i>0;i--) vfs->providerFirst[i]=vfs->providerFirst[i-1];
+	vfs->providerFirst[0]=0;
+	free(provided);
+	free(providedBy);
+	free(providedTime);
+
+	for(DWORD i=0;i<vfs->pathCount;i++) {
+		DWORD first=vfs->providerFirst[i];
+		DWORD win=first;
+		for(DWORD j=first+1;j<vfs->providerFirst[i+1];j++) {
+			vfs->overrideFirst[vfs->providers[j]+1]++;
+			if(!vfs->sources[vfs->providers[j]].name) {
+				if(flags&VFS_ARCHIVES_FIRST) continue;
+				if((flags&VFS_LOOSE_NEWER_ONLY)&&times[j]<=times[win]) continue;
+			}
+			win=j;
+		}
+		vfs->winner[i]=vfs->providers[win];
+	}
+	free(times);
+
+	for(int s=0;s<vfs->sourceCount;s++) vfs->overrideFirst[s+1]+=vfs->overrideFirst[s];
+	vfs->overrides=(DWORD*)malloc(sizeof(DWORD)*(vfs->overrideFirst[vfs->sourceCount]+1));
+	if(!vfs->overrides) return false;
+	DWORD* fill=(DWORD*)malloc(sizeof(DWORD)*vfs->sourceCount);
+	if(!fill) return false;
+	memcpy(fill, vfs->overrideFirst, sizeof(DWORD)*vfs->sourceCount);
+	for(DWORD i=0;i<vfs->pathCount;i++) {
+		for(DWORD j=vfs->providerFirst[i]+1;j<vfs->providerFirst[i+1];j++) vfs->overrides[fill[vfs->providers[j]]++]=i;
+	}
+	free(fill);
+	return true;
+}
+
+void _stdcall vfsClose(VfsIndex* vfs) {
+	if(!vfs) return;
+	for(int i=0;i<vfs->sourceCount;i++) {
+		free(vfs->sources[i].name);
+		FreeListing(&vfs->sources[i].list);
+	}
+	free(vfs->sources);
+	free(vfs->pathName);
+	free(vfs->pathHash);
+	free(vfs->table);
+	free(vfs->providerFirst);
+	free(vfs->providers);
+	free(vfs->winner);
+	free(vfs->overrideFirst);
+	free(vfs->overrides);
+	free(vfs);
+}
+
+VfsIndex* _stdcall vfsOpen(const char* dataPath, const char* archives, const char* snapshot, DWORD flags) {
+	VfsIndex* vfs=(VfsIndex*)calloc(1, sizeof(VfsIndex));
+	if(!vfs) return 0;
+	VfsBuild build;
+	build.dataPath=dataPath;
+	build.vfs=vfs;
+	build.pending=0;
+	if(!AddSources(vfs, dataPath, archives)||!(build.pending=(int*)malloc(sizeof(int)*vfs->sourceCount))) {
+		vfsClose(vfs);
+		return 0;
+	}
+	LoadSnapshot(snapshot, vfs);
+	int pending=0;
+	for(int i=0;i<vfs->sourceCount;i++) if(!vfs->sources[i].cached) build.pending[pending++]=i;
+	ParallelFor(pending, ListTask, &build);
+	//only archives that were read change the snapshot, as failed ones are left out of it
+	bool read=false;
+	for(int i=0;i<pending;i++) if(vfs->sources[build.pending[i]].name&&!vfs->sources[build.pending[i]].failed) read=true;
+	free(build.pending);
+	if(snapshot&&read) SaveSnapshot(snapshot, vfs);
+	if(!BuildIndex(vfs, flags)) {
+		vfsClose(vfs);
+		return 0;
+	}
+	return vfs;
+}
+
+int _stdcall vfsSourceCount(VfsIndex* vfs) {
+	return vfs->sourceCount;
+}
+
+int _stdcall vfsSourceName(VfsIndex* vfs, int source, char* buffer, int length) {
+	if(source<0||source>=vfs->sourceCount||!length) return -1;
+	buffer[0]=0;
+	const char* name=vfs->sources[source].name;
+	if(!name) return 0;
+	int nameLength=(int)strlen(name);
+	if(nameLength+1>length) return -1;
+	memcpy(buffer, name, nameLength+1);
+	return nameLength;
+}
+
+int _stdcall vfsPathCount(VfsIndex* vfs) {
+	return (int)vfs->pathCount;
+}
+
+int _stdcall vfsFind(VfsIndex* vfs, const char* path) {
+	char name[MAX_VFS_PATH];
+	int length=NormalizePath(path, name);
+	if(length<=0) return -1;
+	return (int)FindPath(vfs, name, HashPath(name, length));
+}
+
+int _stdcall vfsPathName(VfsIndex* vfs, int path, char* buffer, int length) {
+	if(path<0||(DWORD)path>=vfs->pathCount) return -1;
+	int nameLength=(int)strlen(vfs->pathName[path]);
+	if(nameLength+1>length) return -1;
+	memcpy(buffer, vfs->pathName[path], nameLength+1);
+	return nameLength;
+}
+
+int _stdcall vfsWinner(VfsIndex* vfs, int path) {
+	if(path<0||(DWORD)path>=vfs->pathCount) return -1;
+	return (int)vfs->winner[path];
+}
+
+int _stdcall vfsProviders(VfsIndex* vfs, int path, int* sources, int length) {
+	if(path<0||(DWORD)path>=vfs->pathCount) return -1;
+	DWORD first=vfs->providerFirst[path];
+	int count=(int)(vfs->providerFirst[path+1]-first);
+	for(int i=0;i<count&&i<length;i++) sources[i]=(int)vfs->providers[first+i];
+	return count;
+}
+
+int _stdcall vfsOverrides(VfsIndex* vfs, int source, int* paths, int length) {
+	if(source<0||source>=vfs->sourceCount) return -1;
+	DWORD first=vfs->overrideFirst[source];
+	int count=(int)(vfs->overrideFirst[source+1]-first);
+	for(int i=0;i<count&&i<length;i++) paths[i]=(int)vfs->overrides[first+i];
+	return count;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+//Which archive or loose file the game would load for each path under Data. Sources are the archives in the
+//order given, followed by the loose files, and a later source replaces an earlier one. Archive listings are
+//kept in a snapshot file and only reread once an archive's size or time changes. The loose files are rescanned
+//every time, as a directory walk already returns everything the snapshot would hold.
+
+//vfsOpen flags
+#define VFS_LOOSE_NEWER_ONLY 1		//loose files only replace archived ones older than them, as with bInvalidateOlderFiles
+#define VFS_ARCHIVES_FIRST 2		//loose files never replace archived ones
+
+struct VfsIndex;
+
+//Indexes the archives in the comma separated list, in load order, and the loose files under dataPath. If
+//snapshot is given, unchanged archives are listed from it and it is rewritten if any had to be read. Archives that
+//can't be opened are left out of it, so they are tried again next time.
+VfsIndex* _stdcall vfsOpen(const char* dataPath, const char* archives, const char* snapshot, DWORD flags);
+void _stdcall vfsClose(VfsIndex* vfs);
+int _stdcall vfsSourceCount(VfsIndex* vfs);
+//Writes the archive name of a source into buffer, returning its length, or 0 for the loose files
+int _stdcall vfsSourceName(VfsIndex* vfs, int source, char* buffer, int length);
+int _stdcall vfsPathCount(VfsIndex* vfs);
+//Returns the index of path, relative to Data, or -1 if nothing provides it
+int _stdcall vfsFind(VfsIndex* vfs, const char* path);
+int _stdcall vfsPathName(VfsIndex* vfs, int path, char* buffer, int length);
+//The source the game loads path from
+int _stdcall vfsWinner(VfsIndex* vfs, int path);
+//Copies up to length sources of path into sources, in load order, returning how many there are
+int _stdcall vfsProviders(VfsIndex* vfs, int path, int* sources, int length);
+//Copies up to length of the paths source provides that an earlier source provides too, returning how many there are
+int _stdcall vfsOverrides(VfsIndex* vfs, int source, int* paths, int length);
@@ -0,0 +1,44 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include "workerPool.h"
+
+struct ParallelJob {
+	ParallelTask task;
+	void* context;
+	int count;
+	volatile LONG next;
+};
+
+static DWORD WINAPI WorkerProc(LPVOID param) {
+	ParallelJob* job=(ParallelJob*)param;
+	for(;;) {
+		int i=InterlockedIncrement(&job->next)-1;
+		if(i>=job->count) break;
+		job->task(i, job->context);
+	}
+	return 0;
+}
+
+int WorkerCount() {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	if(info.dwNumberOfProcessors<1) return 1;
+	if(info.dwNumberOfProcessors>MAXIMUM_WAIT_OBJECTS) return MAXIMUM_WAIT_OBJECTS;
+	return info.dwNumberOfProcessors;
+}
+
+void ParallelFor(int count, ParallelTask task, void* context) {
+	if(count<=0) return;
+	ParallelJob job={ task, context, count, 0 };
+	int threads=WorkerCount();
+	if(threads>count) threads=count;
+	HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+	int started=0;
+	for(int i=1;i<threads;i++) {
+		handles[started]=CreateThread(0, 0, WorkerProc, &job, 0, 0);
+		if(handles[started]) started++;
+	}
+	WorkerProc(&job);
+	if(started) WaitForMultipleObjects(started, handles, TRUE, INFINITE);
+	for(int i=0;i<started;i++) CloseHandle(handles[i]);
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+//Runs task(index, context) for every index in [0, count) across all cores. The calling thread takes part
+//and the call returns once every index has been processed. Indices are handed out in increasing order.
+typedef void (*ParallelTask)(int index, void* context);
+
+int WorkerCount();
+void ParallelFor(int count, ParallelTask task, void* context);
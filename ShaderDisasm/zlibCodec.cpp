@@ -0,0 +1,865 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <emmintrin.h>
+#include <intrin.h>
+#include <stdlib.h>
+#include <string.h>
+#include "zlibCodec.h"
+#include "workerPool.h"
+
+//Batches with less data than this are run on the calling thread
+#define PARALLEL_BYTES 262144
+
+static const WORD lengthBase[29]={ 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+static const BYTE lengthExtra[29]={ 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+static const WORD distBase[30]={ 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+static const BYTE distExtra[30]={ 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+static const BYTE codeLengthOrder[19]={ 16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 };
+
+//Most bytes that can be summed before b could overflow, a whole number of 16 byte blocks
+#define ADLER_RUN 5552
+
+DWORD zAdler32(DWORD adler, const BYTE* data, DWORD length) {
+	DWORD a=adler&0xffff;
+	DWORD b=adler>>16;
+	const __m128i zero=_mm_setzero_si128();
+	const __m128i weightsLow=_mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+	const __m128i weightsHigh=_mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+	while(length>=16) {
+		DWORD n=(length<ADLER_RUN?length:ADLER_RUN)&~15;
+		length-=n;
+		//over a run b gains a for every byte, 16 times the sum of every earlier block, and each byte weighted
+		//by its distance from the end of its own block
+		__m128i sum=zero, earlier=zero, weighted=zero;
+		for(DWORD i=0;i<n;i+=16) {
+			__m128i v=_mm_loadu_si128((const __m128i*)(data+i));
+			earlier=_mm_add_epi32(earlier, sum);
+			sum=_mm_add_epi32(sum, _mm_sad_epu8(v, zero));
+			weighted=_mm_add_epi32(weighted, _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), weightsLow));
+			weighted=_mm_add_epi32(weighted, _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), weightsHigh));
+		}
+		data+=n;
+		sum=_mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+		earlier=_mm_add_epi32(earlier, _mm_srli_si128(earlier, 8));
+		weighted=_mm_add_epi32(weighted, _mm_srli_si128(weighted, 8));
+		weighted=_mm_add_epi32(weighted, _mm_srli_si128(weighted, 4));
+		UINT64 total=b+(UINT64)n*a+(UINT64)(DWORD)_mm_cvtsi128_si32(earlier)*16+(DWORD)_mm_cvtsi128_si32(weighted);
+		a=(a+(DWORD)_mm_cvtsi128_si32(sum))%65521;
+		b=(DWORD)(total%65521);
+	}
+	while(length--) {
+		a+=*data++;
+		b+=a;
+	}
+	return ((b%65521)<<16)|(a%65521);
+}
+
+/*
+ * Inflate
+ */
+
+//Codes up to this long are decoded with a single table lookup
+#define FAST_BITS 10
+
+struct Huffman {
+	WORD fast[1<<FAST_BITS];	//symbol<<4|length indexed by the next FAST_BITS bits of input, or 0 for longer codes
+	short count[16];
+	short symbol[288];
+};
+
+struct InflateState {
+	const BYTE* in;
+	const BYTE* inEnd;
+	BYTE* out;
+	DWORD outPos;
+	DWORD outLength;
+	UINT64 bitBuf;
+	int bitCount;
+	int overrun;		//zero bytes fed in past the end of the input
+	bool error;
+};
+
+//Tops the bit buffer up to at least 56 bits, with zeroes once the input runs out
+static __forceinline void Refill(InflateState& s) {
+	if(s.inEnd-s.in>=8) {
+		UINT64 v;
+		memcpy(&v, s.in, 8);
+		s.bitBuf|=v<<s.bitCount;
+		s.in+=(63-s.bitCount)>>3;
+		s.bitCount|=56;
+	} else {
+		while(s.bitCount<=56) {
+			if(s.in<s.inEnd) s.bitBuf|=(UINT64)*s.in++<<s.bitCount;
+			else if(++s.overrun>8) s.error=true;
+			s.bitCount+=8;
+		}
+	}
+}
+
+static __forceinline int GetBits(InflateState& s, int need) {
+	if(s.bitCount<need) Refill(s);
+	int val=(int)(s.bitBuf&((1u<<need)-1));
+	s.bitBuf>>=need;
+	s.bitCount-=need;
+	return val;
+}
+
+//Drops to the next byte boundary and hands the whole bytes left in the bit buffer back to the input.
+//Fails if any of the zeroes fed in past the end were used.
+static bool AlignInput(InflateState& s) {
+	int bytes=(s.bitCount>>3)-s.overrun;
+	if(bytes<0) return false;
+	s.in-=bytes;
+	s.bitBuf=0;
+	s.bitCount=0;
+	s.overrun=0;
+	return true;
+}
+
+//Returns 0 for a complete code, >0 if incomplete and <0 if oversubscribed
+static int BuildHuffman(Huffman& h, const BYTE* lengths, int n) {
+	memset(h.count, 0, sizeof(h.count));
+	memset(h.fast, 0, sizeof(h.fast));
+	for(int i=0;i<n;i++) h.count[lengths[i]]++;
+	if(h.count[0]==n) return 1;
+	int left=1;
+	for(int len=1;len<16;len++) {
+		left<<=1;
+		left-=h.count[len];
+		if(left<0) return left;
+	}
+	short offs[16];
+	offs[1]=0;
+	for(int len=1;len<15;len++) offs[len+1]=offs[len]+h.count[len];
+	for(int i=0;i<n;i++) if(lengths[i]) h.symbol[offs[lengths[i]]++]=(short)i;
+
+	//codes arrive msb first, so the table is indexed by them reversed
+	WORD next[16];
+	WORD code=0;
+	next[1]=0;
+	for(int len=2;len<16;len++) {
+		code=(code+h.count[len-1])<<1;
+		next[len]=code;
+	}
+	for(int i=0;i<n;i++) {
+		int len=lengths[i];
+		if(!len||len>FAST_BITS) continue;
+		WORD c=next[len]++, r=0;
+		for(int b=0;b<len;b++) {
+			r=(r<<1)|(c&1);
+			c>>=1;
+		}
+		for(int j=r;j<(1<<FAST_BITS);j+=1<<len) h.fast[j]=(WORD)((i<<4)|len);
+	}
+	return left;
+}
+
+static __forceinline int Decode(InflateState& s, const Huffman& h) {
+	if(s.bitCount<15) Refill(s);
+	WORD e=h.fast[s.bitBuf&((1<<FAST_BITS)-1)];
+	if(e) {
+		s.bitBuf>>=e&15;
+		s.bitCount-=e&15;
+		return e>>4;
+	}
+	//longer codes are walked a bit at a time
+	UINT64 bits=s.bitBuf;
+	int code=0, first=0, index=0;
+	for(int len=1;len<16;len++) {
+		code|=(int)(bits&1);
+		bits>>=1;
+		int count=h.count[len];
+		if(code-count<first) {
+			s.bitBuf>>=len;
+			s.bitCount-=len;
+			return h.symbol[index+(code-first)];
+		}
+		index+=count;
+		first+=count;
+		first<<=1;
+		code<<=1;
+	}
+	return -1;
+}
+
+static bool InflateCodes(InflateState& s, const Huffman& lencode, const Huffman& distcode) {
+	for(;;) {
+		int sym=Decode(s, lencode);
+		if(sym<256) {
+			if(sym<0||s.outPos==s.outLength) return false;
+			s.out[s.outPos++]=(BYTE)sym;
+		} else if(sym==256) {
+			return !s.error;
+		} else {
+			sym-=257;
+			if(sym>=29) return false;
+			DWORD len=lengthBase[sym]+GetBits(s, lengthExtra[sym]);
+			int dsym=Decode(s, distcode);
+			if(dsym<0||dsym>=30) return false;
+			DWORD dist=distBase[dsym]+GetBits(s, distExtra[dsym]);
+			if(s.error||dist>s.outPos||len>s.outLength-s.outPos) return false;
+			BYTE* dest=s.out+s.outPos;
+			const BYTE* src=dest-dist;
+			if(dist>=8&&s.outLength-s.outPos-len>=8) {
+				//whole words, running up to 7 bytes past the match into space that gets written later anyway
+				for(DWORD i=0;i<len;i+=8) {
+					UINT64 v;
+					memcpy(&v, src+i, 8);
+					memcpy(dest+i, &v, 8);
+				}
+			} else if(dist==1) {
+				memset(dest, src[0], len);
+			} else {
+				for(DWORD i=0;i<len;i++) dest[i]=src[i];
+			}
+			s.outPos+=len;
+		}
+	}
+}
+
+static bool InflateStored(InflateState& s) {
+	if(!AlignInput(s)||s.inEnd-s.in<4) return false;
+	DWORD len=s.in[0]|(s.in[1]<<8);
+	if(s.in[2]!=(BYTE)~s.in[0]||s.in[3]!=(BYTE)~s.in[1]) return false;
+	s.in+=4;
+	if((DWORD)(s.inEnd-s.in)<len||len>s.outLength-s.outPos) return false;
+	memcpy(s.out+s.outPos, s.in, len);
+	s.in+=len;
+	s.outPos+=len;
+	return true;
+}
+
+static bool InflateFixed(InflateState& s) {
+	BYTE lengths[288];
+	Huffman lencode, distcode;
+	int i=0;
+	for(;i<144;i++) lengths[i]=8;
+	for(;i<256;i++) lengths[i]=9;
+	for(;i<280;i++) lengths[i]=7;
+	for(;i<288;i++) lengths[i]=8;
+	BuildHuffman(lencode, lengths, 288);
+	for(i=0;i<30;i++) lengths[i]=5;
+	BuildHuffman(distcode, lengths, 30);
+	return InflateCodes(s, lencode, distcode);
+}
+
+static bool InflateDynamic(InflateState& s) {
+	BYTE lengths[316];
+	Huffman lencode, distcode;
+	int nlen=GetBits(s, 5)+257;
+	int ndist=GetBits(s, 5)+1;
+	int ncode=GetBits(s, 4)+4;
+	if(s.error||nlen>286||ndist>30) return false;
+	int index;
+	for(index=0;index<ncode;index++) lengths[codeLengthOrder[index]]=(BYTE)GetBits(s, 3);
+	for(;index<19;index++) lengths[codeLengthOrder[index]]=0;
+	if(s.error||BuildHuffman(lencode, lengths, 19)!=0) return false;
+	index=0;
+	while(index<nlen+ndist) {
+		int sym=Decode(s, lencode);
+		if(sym<0) return false;
+		if(sym<16) {
+			lengths[index++]=(BYTE)sym;
+		} else {
+			BYTE len=0;
+			int rep;
+			if(sym==16) {
+				if(!index) return false;
+				len=lengths[index-1];
+				rep=3+GetBits(s, 2);
+			} else if(sym==17) {
+				rep=3+GetBits(s, 3);
+			} else {
+				rep=11+GetBits(s, 7);
+			}
+			if(index+rep>nlen+ndist) return false;
+			while(rep--) lengths[index++]=len;
+		}
+	}
+	if(s.error||!lengths[256]) return false;
+	if(BuildHuffman(lencode, lengths, nlen)<0) return false;
+	if(BuildHuffman(distcode, lengths+nlen, ndist)<0) return false;
+	return InflateCodes(s, lencode, distcode);
+}
+
+static bool Inflate(const BYTE* in, DWORD inLength, BYTE* out, DWORD outLength, DWORD flags) {
+	if(inLength<6) return false;
+	if((in[0]&0x0f)!=8||(in[0]>>4)>7||((in[0]<<8)|in[1])%31||(in[1]&0x20)) return false;
+	InflateState s={ in+2, in+inLength, out, 0, outLength, 0, 0, 0, false };
+	int last;
+	do {
+		last=GetBits(s, 1);
+		bool ok;
+		switch(GetBits(s, 2)) {
+			case 0: ok=InflateStored(s); break;
+			case 1: ok=InflateFixed(s); break;
+			case 2: ok=InflateDynamic(s); break;
+			default: ok=false; break;
+		}
+		if(!ok||s.error) return false;
+	} while(!last);
+	if(s.outPos!=outLength||!AlignInput(s)) return false;
+	if(flags&Z_IGNORE_CHECKSUM) return true;
+	if(s.inEnd-s.in<4) return false;
+	DWORD adler=(s.in[0]<<24)|(s.in[1]<<16)|(s.in[2]<<8)|s.in[3];
+	return adler==zAdler32(1, out, outLength);
+}
+
+bool zInflate(const BYTE* in, DWORD inLength, BYTE* out, DWORD outLength) {
+	return Inflate(in, inLength, out, outLength, 0);
+}
+
+/*
+ * Deflate
+ */
+
+#define WINDOW_SIZE 32768
+#define HASH_BITS 15
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+#define TOO_FAR 4096
+#define BLOCK_SYMBOLS 16384
+
+//How hard each level looks for matches, as in zlib. Levels 1-3 take the first match found and only index the
+//inside of matches up to lazy bytes long. Higher levels also check whether the next byte starts a longer match,
+//unless the current one is already lazy bytes long, and search a quarter as far once a match reaches good.
+struct DeflateConfig {
+	WORD good;
+	WORD lazy;
+	WORD nice;		//stop searching once a match is this long
+	WORD chain;		//most candidates tried per position
+};
+
+static const DeflateConfig deflateLevels[10]={
+	{ 0, 0, 0, 0 },
+	{ 4, 4, 8, 4 },
+	{ 4, 5, 16, 8 },
+	{ 4, 6, 32, 32 },
+	{ 4, 4, 16, 16 },
+	{ 8, 16, 32, 32 },
+	{ 8, 16, 128, 128 },
+	{ 8, 32, 128, 256 },
+	{ 32, 128, 258, 1024 },
+	{ 32, 258, 258, 4096 }
+};
+
+struct BitWriter {
+	BYTE* out;
+	DWORD pos;
+	DWORD length;
+	UINT64 bitBuf;
+	int bitCount;
+	bool overflow;
+};
+
+//Writes out every whole byte in the bit buffer
+static void FlushBits(BitWriter& w) {
+	while(w.bitCount>=8) {
+		if(w.pos<w.length) w.out[w.pos++]=(BYTE)w.bitBuf;
+		else w.overflow=true;
+		w.bitBuf>>=8;
+		w.bitCount-=8;
+	}
+}
+
+static __forceinline void PutBits(BitWriter& w, DWORD bits, int count) {
+	w.bitBuf|=(UINT64)bits<<w.bitCount;
+	w.bitCount+=count;
+	if(w.bitCount>=32) {
+		if(w.length-w.pos>=4) {
+			DWORD v=(DWORD)w.bitBuf;
+			memcpy(w.out+w.pos, &v, 4);
+			w.pos+=4;
+			w.bitBuf>>=32;
+			w.bitCount-=32;
+		} else {
+			FlushBits(w);
+		}
+	}
+}
+
+static void AlignBits(BitWriter& w) {
+	if(w.bitCount&7) PutBits(w, 0, 8-(w.bitCount&7));
+	FlushBits(w);
+}
+
+//A literal when dist is 0, otherwise a match of length lit
+struct LzSymbol {
+	WORD lit;
+	WORD dist;
+};
+
+struct HuffmanCode {
+	WORD code[286];
+	BYTE length[286];
+};
+
+static __forceinline BYTE LengthCode(DWORD len) {
+	if(len==MAX_MATCH) return 28;
+	DWORD x=len-MIN_MATCH;
+	if(x<8) return (BYTE)x;
+	unsigned long top;
+	_BitScanReverse(&top, x);
+	return (BYTE)(4*(top-1)+((x>>(top-2))&3));
+}
+
+static __forceinline BYTE DistCode(DWORD dist) {
+	DWORD x=dist-1;
+	if(x<4) return (BYTE)x;
+	unsigned long top;
+	_BitScanReverse(&top, x);
+	return (BYTE)(2*top+((x>>(top-1))&1));
+}
+
+//Builds huffman code lengths limited to maxBits. Frequencies are flattened until the tree fits.
+static void BuildLengths(const DWORD* freq, int n, int maxBits, BYTE* lengths) {
+	DWORD weight[286];
+	int leaves[286];
+	DWORD nodeWeight[2*286];
+	int parent[2*286];
+	BYTE depth[2*286];
+	int count=0;
+	memset(lengths, 0, n);
+	for(int i=0;i<n;i++) {
+		if(freq[i]) {
+			weight[i]=freq[i];
+			leaves[count++]=i;
+		}
+	}
+	if(count==0) return;
+	if(count==1) {
+		//a lone code would be incomplete, which inflaters reject for code length codes
+		lengths[leaves[0]]=1;
+		lengths[leaves[0]?0:1]=1;
+		return;
+	}
+	for(;;) {
+		//insertion sort, n is small
+		for(int i=1;i<count;i++) {
+			int leaf=leaves[i], j=i;
+			while(j>0&&weight[leaves[j-1]]>weight[leaf]) {
+				leaves[j]=leaves[j-1];
+				j--;
+			}
+			leaves[j]=leaf;
+		}
+		//two queue construction: nodes [0, count) are leaves, [count, 2*count-1) are internal
+		for(int i=0;i<count;i++) nodeWeight[i]=weight[leaves[i]];
+		int nextLeaf=0, nextNode=count, made=count;
+		for(int k=0;k<count-1;k++) {
+			int pick[2];
+			for(int j=0;j<2;j++) {
+				if(nextLeaf<count&&(nextNode>=made||nodeWeight[nextLeaf]<=nodeWeight[nextNode])) pick[j]=nextLeaf++;
+				else pick[j]=nextNode++;
+			}
+			nodeWeight[made]=nodeWeight[pick[0]]+nodeWeight[pick[1]];
+			parent[pick[0]]=made;
+			parent[pick[1]]=made;
+			made++;
+		}
+		depth[made-1]=0;
+		int maxDepth=0;
+		for(int i=made-2;i>=0;i--) {
+			depth[i]=depth[parent[i]]+1;
+			if(i<count&&depth[i]>maxDepth) maxDepth=depth[i];
+		}
+		if(maxDepth<=maxBits) {
+			for(int i=0;i<count;i++) lengths[leaves[i]]=depth[i];
+			return;
+		}
+		for(int i=0;i<count;i++) weight[leaves[i]]=(weight[leaves[i]]+1)>>1;
+	}
+}
+
+static void BuildCodes(HuffmanCode& h, int n) {
+	WORD blCount[16]={ 0 };
+	WORD next[16];
+	for(int i=0;i<n;i++) blCount[h.length[i]]++;
+	blCount[0]=0;
+	WORD code=0;
+	for(int bits=1;bits<16;bits++) {
+		code=(code+blCount[bits-1])<<1;
+		next[bits]=code;
+	}
+	for(int i=0;i<n;i++) {
+		int len=h.length[i];
+		if(!len) continue;
+		//deflate sends codes msb first, so store them reversed
+		WORD c=next[len]++, r=0;
+		for(int b=0;b<len;b++) {
+			r=(r<<1)|(c&1);
+			c>>=1;
+		}
+		h.code[i]=r;
+	}
+}
+
+//Run length encodes the combined literal/length and distance code lengths. Symbols 16-18 carry their
+//repeat count in the upper byte.
+static int EncodeCodeLengths(const BYTE* lengths, int n, WORD* out) {
+	int count=0;
+	for(int i=0;i<n;) {
+		BYTE len=lengths[i];
+		int run=1;
+		while(i+run<n&&lengths[i+run]==len) run++;
+		i+=run;
+		if(!len) {
+			while(run>=11) {
+				int r=run>138?138:run;
+				out[count++]=18|((r-11)<<8);
+				run-=r;
+			}
+			if(run>=3) {
+				out[count++]=17|((run-3)<<8);
+				run=0;
+			}
+		} else {
+			out[count++]=len;
+			run--;
+			while(run>=3) {
+				int r=run>6?6:run;
+				out[count++]=16|((r-3)<<8);
+				run-=r;
+			}
+		}
+		while(run-->0) out[count++]=len;
+	}
+	return count;
+}
+
+struct DeflateState {
+	const BYTE* in;
+	DWORD inLength;
+	BitWriter w;
+	LzSymbol* symbols;
+	int symbolCount;
+	DWORD blockStart;
+	DWORD emitted;		//input covered by the symbols so far
+	int* head;			//latest position for each hash
+	int* prev;			//previous position with the same hash, by position within the window
+};
+
+static void WriteStored(DeflateState& s, DWORD start, DWORD end, bool last) {
+	do {
+		DWORD len=end-start;
+		if(len>0xffff) len=0xffff;
+		bool final=last&&start+len==end;
+		PutBits(s.w, final?1:0, 3);
+		AlignBits(s.w);
+		PutBits(s.w, len, 16);
+		PutBits(s.w, ~len&0xffff, 16);
+		FlushBits(s.w);
+		if(s.w.length-s.w.pos>=len) {
+			memcpy(s.w.out+s.w.pos, s.in+start, len);
+			s.w.pos+=len;
+		} else {
+			s.w.overflow=true;
+		}
+		start+=len;
+	} while(start<end);
+}
+
+static void FlushBlock(DeflateState& s, DWORD blockEnd, bool last) {
+	DWORD litFreq[286]={ 0 };
+	DWORD distFreq[30]={ 0 };
+	for(int i=0;i<s.symbolCount;i++) {
+		const LzSymbol& sym=s.symbols[i];
+		if(!sym.dist) {
+			litFreq[sym.lit]++;
+		} else {
+			litFreq[257+LengthCode(sym.lit)]++;
+			distFreq[DistCode(sym.dist)]++;
+		}
+	}
+	litFreq[256]=1;
+
+	HuffmanCode lit, dist, cl;
+	BuildLengths(litFreq, 286, 15, lit.length);
+	BuildLengths(distFreq, 30, 15, dist.length);
+	int nlit=286, ndist=30;
+	while(nlit>257&&!lit.length[nlit-1]) nlit--;
+	while(ndist>1&&!dist.length[ndist-1]) ndist--;
+	if(!dist.length[0]&&ndist==1) dist.length[0]=1;
+	BuildCodes(lit, nlit);
+	BuildCodes(dist, ndist);
+
+	BYTE all[316];
+	memcpy(all, lit.length, nlit);
+	memcpy(all+nlit, dist.length, ndist);
+	WORD rle[316];
+	int nrle=EncodeCodeLengths(all, nlit+ndist, rle);
+	DWORD clFreq[19]={ 0 };
+	for(int i=0;i<nrle;i++) clFreq[rle[i]&0xff]++;
+	BuildLengths(clFreq, 19, 7, cl.length);
+	BuildCodes(cl, 19);
+	int ncl=19;
+	while(ncl>4&&!cl.length[codeLengthOrder[ncl-1]]) ncl--;
+
+	//compare against storing the block raw
+	UINT64 bits=3+5+5+4+3*ncl;
+	for(int i=0;i<nrle;i++) {
+		int sym=rle[i]&0xff;
+		bits+=cl.length[sym]+(sym==16?2:sym==17?3:sym==18?7:0);
+	}
+	for(int i=0;i<nlit;i++) {
+		if(i>=257) bits+=(UINT64)litFreq[i]*lengthExtra[i-257];
+		bits+=(UINT64)litFreq[i]*lit.length[i];
+	}
+	for(int i=0;i<ndist;i++) bits+=(UINT64)distFreq[i]*(dist.length[i]+distExtra[i]);
+	DWORD raw=blockEnd-s.blockStart;
+	if(bits/8+1>=(UINT64)raw+5*(raw/0xffff+1)) {
+		WriteStored(s, s.blockStart, blockEnd, last);
+	} else {
+		PutBits(s.w, last?1:0, 1);
+		PutBits(s.w, 2, 2);
+		PutBits(s.w, nlit-257, 5);
+		PutBits(s.w, ndist-1, 5);
+		PutBits(s.w, ncl-4, 4);
+		for(int i=0;i<ncl;i++) PutBits(s.w, cl.length[codeLengthOrder[i]], 3);
+		for(int i=0;i<nrle;i++) {
+			int sym=rle[i]&0xff;
+			PutBits(s.w, cl.code[sym], cl.length[sym]);
+			if(sym==16) PutBits(s.w, rle[i]>>8, 2);
+			else if(sym==17) PutBits(s.w, rle[i]>>8, 3);
+			else if(sym==18) PutBits(s.w, rle[i]>>8, 7);
+		}
+		for(int i=0;i<s.symbolCount;i++) {
+			const LzSymbol& sym=s.symbols[i];
+			if(!sym.dist) {
+				PutBits(s.w, lit.code[sym.lit], lit.length[sym.lit]);
+			} else {
+				BYTE lc=LengthCode(sym.lit);
+				PutBits(s.w, lit.code[257+lc], lit.length[257+lc]);
+				PutBits(s.w, sym.lit-lengthBase[lc], lengthExtra[lc]);
+				BYTE dc=DistCode(sym.dist);
+				PutBits(s.w, dist.code[dc], dist.length[dc]);
+				PutBits(s.w, sym.dist-distBase[dc], distExtra[dc]);
+			}
+		}
+		PutBits(s.w, lit.code[256], lit.length[256]);
+	}
+	s.symbolCount=0;
+	s.blockStart=blockEnd;
+}
+
+static __forceinline DWORD Hash3(const BYTE* p) {
+	return (((DWORD)p[0]|((DWORD)p[1]<<8)|((DWORD)p[2]<<16))*2654435761u)>>(32-HASH_BITS);
+}
+
+static __forceinline void Insert(DeflateState& s, DWORD pos) {
+	DWORD h=Hash3(s.in+pos);
+	s.prev[pos&(WINDOW_SIZE-1)]=s.head[h];
+	s.head[h]=pos;
+}
+
+static __forceinline DWORD MatchLength(const BYTE* a, const BYTE* b, DWORD maxLen) {
+	DWORD len=0;
+	while(len+4<=maxLen) {
+		DWORD x, y;
+		memcpy(&x, a+len, 4);
+		memcpy(&y, b+len, 4);
+		if(x!=y) {
+			unsigned long bit;
+			_BitScanForward(&bit, x^y);
+			return len+(bit>>3);
+		}
+		len+=4;
+	}
+	while(len<maxLen&&a[len]==b[len]) len++;
+	return len;
+}
+
+//Finds the longest earlier match for the bytes at pos that beats best, trying at most chain candidates.
+//Must be called before pos is inserted.
+static DWORD LongestMatch(const DeflateState& s, DWORD pos, DWORD best, DWORD chain, DWORD nice, DWORD* dist) {
+	DWORD maxLen=s.inLength-pos;
+	if(maxLen>MAX_MATCH) maxLen=MAX_MATCH;
+	if(nice>maxLen) nice=maxLen;
+	if(best>=maxLen) return 0;
+	const BYTE* b=s.in+pos;
+	int limit=pos>WINDOW_SIZE?(int)(pos-WINDOW_SIZE):0;
+	DWORD found=0;
+	for(int cand=s.head[Hash3(b)];cand>=limit&&chain>0;cand=s.prev[cand&(WINDOW_SIZE-1)],chain--) {
+		const BYTE* a=s.in+cand;
+		if(a[best]!=b[best]||a[0]!=b[0]) continue;
+		DWORD len=MatchLength(a, b, maxLen);
+		if(len>best) {
+			best=found=len;
+			*dist=pos-cand;
+			if(len>=nice) break;
+		}
+	}
+	return found;
+}
+
+static __forceinline bool Worthwhile(DWORD len, DWORD dist) {
+	return len>MIN_MATCH||(len==MIN_MATCH&&dist<=TOO_FAR);
+}
+
+static __forceinline void Emit(DeflateState& s, DWORD lit, DWORD dist, DWORD length) {
+	s.symbols[s.symbolCount].lit=(WORD)lit;
+	s.symbols[s.symbolCount].dist=(WORD)dist;
+	s.emitted+=length;
+	if(++s.symbolCount==BLOCK_SYMBOLS) FlushBlock(s, s.emitted, s.emitted==s.inLength);
+}
+
+//Takes the first match found at each position
+static void DeflateGreedy(DeflateState& s, const DeflateConfig& cfg) {
+	DWORD pos=0;
+	while(pos<s.inLength&&!s.w.overflow) {
+		DWORD len=0, dist=0;
+		if(pos+MIN_MATCH<=s.inLength) {
+			len=LongestMatch(s, pos, 0, cfg.chain, cfg.nice, &dist);
+			Insert(s, pos);
+		}
+		if(Worthwhile(len, dist)) {
+			Emit(s, len, dist, len);
+			if(len<=cfg.lazy) {
+				for(DWORD i=1;i<len&&pos+i+MIN_MATCH<=s.inLength;i++) Insert(s, pos+i);
+			}
+			pos+=len;
+		} else {
+			Emit(s, s.in[pos], 0, 1);
+			pos++;
+		}
+	}
+}
+
+//Holds each match back by a byte in case the next position starts a longer one
+static void DeflateLazy(DeflateState& s, const DeflateConfig& cfg) {
+	DWORD pos=0, prevLen=0, prevDist=0;
+	while(pos<s.inLength&&!s.w.overflow) {
+		DWORD len=0, dist=0;
+		if(pos+MIN_MATCH<=s.inLength) {
+			if(prevLen<cfg.lazy) len=LongestMatch(s, pos, prevLen, prevLen>=cfg.good?cfg.chain>>2:cfg.chain, cfg.nice, &dist);
+			Insert(s, pos);
+		}
+		if(prevLen) {
+			if(len>prevLen) {
+				//the longer match wins and the byte before it goes out as a literal
+				Emit(s, s.in[pos-1], 0, 1);
+				prevLen=len;
+				prevDist=dist;
+				pos++;
+				continue;
+			}
+			Emit(s, prevLen, prevDist, prevLen);
+			DWORD end=pos-1+prevLen;
+			for(DWORD i=pos+1;i<end&&i+MIN_MATCH<=s.inLength;i++) Insert(s, i);
+			pos=end;
+			prevLen=0;
+		} else if(Worthwhile(len, dist)) {
+			prevLen=len;
+			prevDist=dist;
+			pos++;
+		} else {
+			Emit(s, s.in[pos], 0, 1);
+			pos++;
+		}
+	}
+	if(prevLen) Emit(s, prevLen, prevDist, prevLen);
+}
+
+DWORD zDeflateBound(DWORD length) {
+	return length+(length/0xffff)*5+(length/BLOCK_SYMBOLS+1)*6+16;
+}
+
+DWORD zDeflate(const BYTE* in, DWORD inLength, BYTE* out, DWORD outLength, int level) {
+	if(outLength<6) return 0;
+	if(level<0||level>9) level=Z_LEVEL_DEFAULT;
+	DeflateState s;
+	s.in=in;
+	s.inLength=inLength;
+	s.w.out=out;
+	s.w.pos=0;
+	s.w.length=outLength-4;
+	s.w.bitBuf=0;
+	s.w.bitCount=0;
+	s.w.overflow=false;
+	s.symbolCount=0;
+	s.blockStart=0;
+	s.emitted=0;
+	//the header's level hint: 0 fastest, 1 fast, 2 default, 3 smallest
+	int hint=level<2?0:level<6?1:level==6?2:3;
+	DWORD header=(0x78<<8)|(hint<<6);
+	header+=31-header%31;
+	PutBits(s.w, header>>8, 8);
+	PutBits(s.w, header&0xff, 8);
+	if(!inLength||!level) {
+		WriteStored(s, 0, inLength, true);
+	} else {
+		s.head=(int*)malloc(sizeof(int)*(1<<HASH_BITS));
+		s.prev=(int*)malloc(sizeof(int)*WINDOW_SIZE);
+		s.symbols=(LzSymbol*)malloc(sizeof(LzSymbol)*BLOCK_SYMBOLS);
+		if(!s.head||!s.prev||!s.symbols) {
+			free(s.head);
+			free(s.prev);
+			free(s.symbols);
+			return 0;
+		}
+		memset(s.head, 0xff, sizeof(int)*(1<<HASH_BITS));
+		if(level<4) DeflateGreedy(s, deflateLevels[level]);
+		else DeflateLazy(s, deflateLevels[level]);
+		if(s.symbolCount) FlushBlock(s, s.emitted, true);
+		free(s.head);
+		free(s.prev);
+		free(s.symbols);
+	}
+	AlignBits(s.w);
+	if(s.w.overflow) return 0;
+	DWORD adler=zAdler32(1, in, inLength);
+	out[s.w.pos++]=(BYTE)(adler>>24);
+	out[s.w.pos++]=(BYTE)(adler>>16);
+	out[s.w.pos++]=(BYTE)(adler>>8);
+	out[s.w.pos++]=(BYTE)adler;
+	return s.w.pos;
+}
+
+/*
+ * Exports
+ */
+
+BOOL _stdcall zInflateBuffer(const BYTE* in, DWORD inLength, BYTE* out, DWORD outLength, DWORD flags) {
+	return Inflate(in, inLength, out, outLength, flags);
+}
+
+DWORD _stdcall zDeflateBuffer(const BYTE* in, DWORD inLength, BYTE* out, DWORD outLength, int level) {
+	return zDeflate(in, inLength, out, outLength, level);
+}
+
+struct BatchJob {
+	ZBuffer* buffers;
+	DWORD option;
+	volatile LONG done;
+};
+
+static void InflateTask(int index, void* context) {
+	BatchJob* job=(BatchJob*)context;
+	ZBuffer* b=&job->buffers[index];
+	b->result=Inflate(b->in, b->inLength, b->out, b->outLength, job->option);
+	if(b->result) InterlockedIncrement(&job->done);
+}
+
+static void DeflateTask(int index, void* context) {
+	BatchJob* job=(BatchJob*)context;
+	ZBuffer* b=&job->buffers[index];
+	b->result=zDeflate(b->in, b->inLength, b->out, b->outLength, (int)job->option);
+	if(b->result) InterlockedIncrement(&job->done);
+}
+
+static int RunBatch(ZBuffer* buffers, int count, DWORD option, ParallelTask task) {
+	BatchJob job={ buffers, option, 0 };
+	UINT64 bytes=0;
+	for(int i=0;i<count;i++) bytes+=buffers[i].inLength+(UINT64)buffers[i].outLength;
+	if(count>1&&bytes>=PARALLEL_BYTES) ParallelFor(count, task, &job);
+	else for(int i=0;i<count;i++) task(i, &job);
+	return job.done;
+}
+
+int _stdcall zInflateBatch(ZBuffer* buffers, int count, DWORD flags) {
+	return RunBatch(buffers, count, flags, InflateTask);
+}
+
+int _stdcall zDeflateBatch(ZBuffer* buffers, int count, int level) {
+	return RunBatch(buffers, count, (DWORD)level, DeflateTask);
+}
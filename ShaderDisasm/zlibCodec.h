@@ -0,0 +1,36 @@
+#pragma once
+
+//Whole buffer zlib streams, as stored in compressed bsa entries and plugin records. Both directions are
+//reentrant, so they can be called from worker threads.
+
+#define Z_LEVEL_DEFAULT 6
+
+//zInflateBuffer and zInflateBatch flags
+#define Z_IGNORE_CHECKSUM 1		//some plugins store records with a bad adler32
+
+DWORD zAdler32(DWORD adler, const BYTE* data, DWORD length);
+
+//Inflates a zlib stream whose uncompressed size is known up front. Fails unless exactly outLength bytes
+//are produced and the checksum matches.
+bool zInflate(const BYTE* in, DWORD inLength, BYTE* out, DWORD outLength);
+
+//Upper bound on the size of zDeflate's output
+DWORD zDeflateBound(DWORD length);
+
+//Compresses at level 0 (stored) to 9 (smallest). Returns the compressed length, or 0 if the output buffer was too small.
+DWORD zDeflate(const BYTE* in, DWORD inLength, BYTE* out, DWORD outLength, int level);
+
+//One buffer of a batch. result is set to 1 or 0 when inflating, or to the compressed length when deflating.
+struct ZBuffer {
+	const BYTE* in;
+	DWORD inLength;
+	BYTE* out;
+	DWORD outLength;
+	DWORD result;
+};
+
+BOOL _stdcall zInflateBuffer(const BYTE* in, DWORD inLength, BYTE* out, DWORD outLength, DWORD flags);
+DWORD _stdcall zDeflateBuffer(const BYTE* in, DWORD inLength, BYTE* out, DWORD outLength, int level);
+//Run every buffer of a batch across all cores, returning how many succeeded
+int _stdcall zInflateBatch(ZBuffer* buffers, int count, DWORD flags);
+int _stdcall zDeflateBatch(ZBuffer* buffers, int count, int level);
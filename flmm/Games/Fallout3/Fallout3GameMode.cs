@@ -663,6 +663,8 @@ namespace Fomm.Games.Fallout3
                                                      LaunchTESsnipToolWithSelectedPlugins));
       m_lstRightClickTools.Add(new Command<MainForm>("Open in CREditor...", "Open the selected plugins in TESsnip.",
                                                      LaunchCREditorToolWithSelectedPlugins));
+      m_lstRightClickTools.Add(new Command<MainForm>("Merge Plugins...", "Merges the selected plugins into one.",
+                                                     LaunchMergeToolWithSelectedPlugins));
 
       m_lstLoadOrderTools.Add(new Command<MainForm>("Load Order Report...",
                                                     "Generates a report on the current load order, as compared to the BOSS recomendation.",
@@ -683,6 +685,7 @@ namespace Fomm.Games.Fallout3
       int i;
 
       // Do checks
+      PluginHeaderCache.Current.Refresh();
       List<string> keys = new List<string>(fullModList.Keys);
       for (i = 0; i < keys.Count; i++)
       {
@@ -989,35 +992,23 @@ namespace Fomm.Games.Fallout3
       var active = new bool[plugins.Length];
       var corrupt = new bool[plugins.Length];
       var masters = new string[plugins.Length][];
-      var mlist = new List<string>();
+      var phcHeaders = PluginHeaderCache.Current;
+      phcHeaders.Refresh();
       for (var i = 0; i < plugins.Length; i++)
       {
         active[i] = PluginManager.IsPluginActive(plugins[i]);
         plugins[i] = Path.GetFileName(plugins[i]);
-        Plugin p;
-        try
+        var phdHeader = phcHeaders.GetHeader(plugins[i]);
+        if (phdHeader == null)
         {
-          p = new Plugin(Path.Combine(PluginsPath, plugins[i]), true);
-        }
-        catch
-        {
-          p = null;
           corrupt[i] = true;
         }
-        if (p != null)
+        else if (phdHeader.Masters.Length > 0)
         {
-          foreach (var sr in ((Record) p.Records[0]).SubRecords)
-          {
-            if (sr.Name != "MAST")
-            {
-              continue;
-            }
-            mlist.Add(sr.GetStrData().ToLowerInvariant());
-          }
-          if (mlist.Count > 0)
+          masters[i] = new string[phdHeader.Masters.Length];
+          for (var j = 0; j < masters[i].Length; j++)
           {
-            masters[i] = mlist.ToArray();
-            mlist.Clear();
+            masters[i][j] = phdHeader.Masters[j].ToLowerInvariant();
           }
         }
       }
@@ -1088,6 +1079,60 @@ namespace Fomm.Games.Fallout3
       crfEditor.Show();
     }
 
+    /// <summary>
+    ///   Merges the selected plugins into a new plugin, in load order.
+    /// </summary>
+    /// <remarks>
+    ///   A mapping of the plugins' records to their new form ids is written next to the merged plugin.
+    /// </remarks>
+    /// <param name="p_objCommand">The command that is executing.</param>
+    /// <param name="p_eeaArguments">
+    ///   An <see cref="ExecutedEventArgs
+    ///   
+    ///   <MainForm>
+    ///     "/> containing the
+    ///     main mod management form.
+    /// </param>
+    public void LaunchMergeToolWithSelectedPlugins(object p_objCommand, ExecutedEventArgs<MainForm> p_eeaArguments)
+    {
+      var lstPlugins = p_eeaArguments.Argument.SelectedPlugins;
+      if (lstPlugins.Count < 2)
+      {
+        MessageBox.Show("Select at least two plugins to merge.", "Error");
+        return;
+      }
+      var sfdMerged = new SaveFileDialog();
+      sfdMerged.Filter = "Plugin (*.esp)|*.esp";
+      sfdMerged.AddExtension = true;
+      sfdMerged.RestoreDirectory = true;
+      sfdMerged.InitialDirectory = Path.GetFullPath(PluginsPath);
+      sfdMerged.FileName = "Merged.esp";
+      if (sfdMerged.ShowDialog() != DialogResult.OK)
+      {
+        return;
+      }
+      foreach (var strPlugin in lstPlugins)
+      {
+        if (Path.GetFileName(sfdMerged.FileName).Equals(strPlugin, StringComparison.InvariantCultureIgnoreCase))
+        {
+          MessageBox.Show("A plugin can't be merged into itself.", "Error");
+          return;
+        }
+      }
+      try
+      {
+        var intRecords = PluginMerger.Merge(lstPlugins, sfdMerged.FileName,
+                                            Path.ChangeExtension(sfdMerged.FileName, ".txt"));
+        MessageBox.Show("Merged " + intRecords + " records into " + Path.GetFileName(sfdMerged.FileName) + ".",
+                        "Merge Plugins");
+      }
+      catch (Exception ex)
+      {
+        MessageBox.Show("Unable to merge the plugins.\n" + ex.Message, "Error");
+      }
+      p_eeaArguments.Argument.RefreshPluginList();
+    }
+
     #endregion
 
     #region Game Settings Menu
@@ -99,13 +99,15 @@ namespace Fomm.Games.Fallout3
         var lstPlugins = new List<FileInfo>(Program.GetFiles(difPluginsDirectory, "*.esp"));
         lstPlugins.AddRange(Program.GetFiles(difPluginsDirectory, "*.esm"));
 
+        var phcHeaders = PluginHeaderCache.Current;
+        phcHeaders.Refresh();
         lstPlugins.Sort(delegate(FileInfo a, FileInfo b)
         {
-          if (Plugin.GetIsEsm(a.FullName) == Plugin.GetIsEsm(b.FullName))
+          if (phcHeaders.IsMaster(a.FullName) == phcHeaders.IsMaster(b.FullName))
           {
             return a.LastWriteTime.CompareTo(b.LastWriteTime);
           }
-          return Plugin.GetIsEsm(a.FullName) ? -1 : 1;
+          return phcHeaders.IsMaster(a.FullName) ? -1 : 1;
         });
 
         var lstPluginPaths = new List<string>();
@@ -142,13 +144,15 @@ namespace Fomm.Games.Fallout3
           lstPlugins.Add(new FileInfo(strPlugin));
         }
       }
+      var phcHeaders = PluginHeaderCache.Current;
+      phcHeaders.Refresh();
       lstPlugins.Sort(delegate(FileInfo a, FileInfo b)
       {
-        if (Plugin.GetIsEsm(a.FullName) == Plugin.GetIsEsm(b.FullName))
+        if (phcHeaders.IsMaster(a.FullName) == phcHeaders.IsMaster(b.FullName))
         {
           return a.LastWriteTime.CompareTo(b.LastWriteTime);
         }
-        return Plugin.GetIsEsm(a.FullName) ? -1 : 1;
+        return phcHeaders.IsMaster(a.FullName) ? -1 : 1;
       });
       var lstPluginPaths = new List<string>();
       foreach (var fifPlugin in lstPlugins)
@@ -36,7 +36,7 @@ namespace Fomm.Games.Fallout3.PluginFormatProviders
     public virtual bool HasFormat(string p_strPluginName)
     {
       return Properties.Settings.Default.fallout3BoldifyESMs &&
-             Plugin.GetIsEsm(Path.Combine(Program.GameMode.PluginsPath, p_strPluginName));
+             PluginHeaderCache.Current.IsMaster(Path.Combine(Program.GameMode.PluginsPath, p_strPluginName));
     }
 
     /// <summary>
@@ -0,0 +1,55 @@
+using System;
+
+namespace Fomm.Games.Fallout3.Script
+{
+  /// <summary>
+  ///   Controls how <see cref="TextureManager.SaveTexture(IntPtr, int, MipmapOptions)" /> builds mipmaps.
+  /// </summary>
+  /// <remarks>
+  ///   Exactly one of the filters should be combined with any of the flags.
+  /// </remarks>
+  [Flags]
+  public enum MipmapOptions
+  {
+    /// <summary>
+    ///   Save only the top level.
+    /// </summary>
+    None = 0,
+
+    /// <summary>
+    ///   Average each 2x2 block.
+    /// </summary>
+    Box = 1,
+
+    /// <summary>
+    ///   Kaiser windowed sinc; sharper than a box filter without visible ringing.
+    /// </summary>
+    Kaiser = 2,
+
+    /// <summary>
+    ///   Lanczos-3; the sharpest filter, but may ring around hard edges.
+    /// </summary>
+    Lanczos = 3,
+
+    /// <summary>
+    ///   Filter the colour channels in linear space, for textures authored in sRGB.
+    /// </summary>
+    Srgb = 0x100,
+
+    /// <summary>
+    ///   Rescale alpha in each level so the same fraction of pixels passes an alpha test at 0.5, which keeps
+    ///   cutout textures such as foliage from thinning out in the distance.
+    /// </summary>
+    AlphaCoverage = 0x200,
+
+    /// <summary>
+    ///   Treat RGB as a tangent space normal and renormalize it in each level.
+    /// </summary>
+    NormalMap = 0x400,
+
+    /// <summary>
+    ///   Filter across the texture's edges, for textures that tile.
+    /// </summary>
+    Wrap = 0x800
+  }
+}
@@ -0,0 +1,48 @@
+using System;
+using System.Drawing;
+
+namespace Fomm.Games.Fallout3.Script
+{
+  /// <summary>
+  ///   Describes one rectangle to copy in a call to
+  ///   <see cref="TextureManager.CopyTextures(IntPtr, System.Collections.Generic.IList{TextureCopy})" />.
+  /// </summary>
+  public struct TextureCopy
+  {
+    /// <summary>
+    ///   A pointer to the texture from which to make the copy.
+    /// </summary>
+    public IntPtr Source;
+
+    /// <summary>
+    ///   The area of the source texture from which to make the copy.
+    /// </summary>
+    public Rectangle SourceRect;
+
+    /// <summary>
+    ///   The area of the destination texture to which to make the copy.
+    /// </summary>
+    public Rectangle DestinationRect;
+
+    /// <summary>
+    ///   The filter used if the two areas differ in size.
+    /// </summary>
+    public TextureFilter Filter;
+
+    /// <summary>
+    ///   A simple constructor that initializes the object with the given values.
+    /// </summary>
+    /// <param name="p_ptrSource">A pointer to the texture from which to make the copy.</param>
+    /// <param name="p_rctSourceRect">The area of the source texture from which to make the copy.</param>
+    /// <param name="p_rctDestinationRect">The area of the destination texture to which to make the copy.</param>
+    /// <param name="p_tflFilter">The filter used if the two areas differ in size.</param>
+    public TextureCopy(IntPtr p_ptrSource, Rectangle p_rctSourceRect, Rectangle p_rctDestinationRect,
+                       TextureFilter p_tflFilter)
+    {
+      Source = p_ptrSource;
+      SourceRect = p_rctSourceRect;
+      DestinationRect = p_rctDestinationRect;
+      Filter = p_tflFilter;
+    }
+  }
+}
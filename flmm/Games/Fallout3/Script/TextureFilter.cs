@@ -0,0 +1,28 @@
+namespace Fomm.Games.Fallout3.Script
+{
+  /// <summary>
+  ///   The filters that can be used to scale a <see cref="TextureCopy" />.
+  /// </summary>
+  public enum TextureFilter
+  {
+    /// <summary>
+    ///   Use <see cref="Box" /> when shrinking on both axes, and <see cref="Linear" /> otherwise.
+    /// </summary>
+    Default = 0,
+
+    /// <summary>
+    ///   Take the nearest source pixel.
+    /// </summary>
+    Point = 1,
+
+    /// <summary>
+    ///   Blend the four nearest source pixels.
+    /// </summary>
+    Linear = 2,
+
+    /// <summary>
+    ///   Average every source pixel covered by the destination pixel.
+    /// </summary>
+    Box = 3
+  }
+}
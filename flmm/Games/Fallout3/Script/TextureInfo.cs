@@ -0,0 +1,283 @@
+using System;
+using System.Text;
+
+namespace Fomm.Games.Fallout3.Script
+{
+  /// <summary>
+  ///   Describes a DDS texture, as read from its header.
+  /// </summary>
+  /// <remarks>
+  ///   Probing a texture only parses its header, so it is cheap enough to run over every texture in an archive.
+  /// </remarks>
+  public class TextureInfo
+  {
+    /// <summary>
+    ///   The number of bytes at the start of a texture that <see cref="Probe(byte[], int)" /> needs.
+    /// </summary>
+    public const int HeaderSize = 148;
+
+    private const int DDS_INFO_CUBEMAP = 0x1;
+    private const int DDS_INFO_VOLUME = 0x2;
+    private const int DDS_INFO_DX10 = 0x4;
+    private const int DDS_INFO_TRUNCATED = 0x8;
+    private const int DDS_INFO_UNKNOWN_SIZE = 0x10;
+
+    private NativeMethods.DdsInfo m_dinInfo;
+
+    #region Properties
+
+    /// <summary>
+    ///   Gets the width of the top level.
+    /// </summary>
+    /// <value>The width of the top level.</value>
+    public int Width
+    {
+      get
+      {
+        return m_dinInfo.width;
+      }
+    }
+
+    /// <summary>
+    ///   Gets the height of the top level.
+    /// </summary>
+    /// <value>The height of the top level.</value>
+    public int Height
+    {
+      get
+      {
+        return m_dinInfo.height;
+      }
+    }
+
+    /// <summary>
+    ///   Gets the depth of the top level.
+    /// </summary>
+    /// <value>The depth of the top level, which is 1 for anything but a volume texture.</value>
+    public int Depth
+    {
+      get
+      {
+        return m_dinInfo.depth;
+      }
+    }
+
+    /// <summary>
+    ///   Gets the number of mip levels.
+    /// </summary>
+    /// <value>The number of mip levels, including the top level.</value>
+    public int MipCount
+    {
+      get
+      {
+        return m_dinInfo.mipCount;
+      }
+    }
+
+    /// <summary>
+    ///   Gets the number of surfaces, each with its own mip chain.
+    /// </summary>
+    /// <value>The number of cubemap faces times the number of array slices.</value>
+    public int ArraySize
+    {
+      get
+      {
+        return m_dinInfo.arraySize;
+      }
+    }
+
+    /// <summary>
+    ///   Gets the Direct3D 9 format of the texture.
+    /// </summary>
+    /// <value>The D3DFORMAT value, which for compressed formats is a FourCC code, or 0 if it isn't recognized.</value>
+    public int Format
+    {
+      get
+      {
+        return m_dinInfo.format;
+      }
+    }
+
+    /// <summary>
+    ///   Gets the DXGI format of the texture.
+    /// </summary>
+    /// <value>The DXGI format, or 0 if the texture doesn't have a DX10 header.</value>
+    public int DxgiFormat
+    {
+      get
+      {
+        return m_dinInfo.dxgiFormat;
+      }
+    }
+
+    /// <summary>
+    ///   Gets a readable name for the texture's format.
+    /// </summary>
+    /// <value>A readable name for the texture's format.</value>
+    public string FormatName
+    {
+      get
+      {
+        if ((m_dinInfo.flags & DDS_INFO_DX10) != 0)
+        {
+          return "DXGI format " + m_dinInfo.dxgiFormat;
+        }
+        if (m_dinInfo.format > 0xff)
+        {
+          return Encoding.ASCII.GetString(BitConverter.GetBytes(m_dinInfo.format));
+        }
+        switch (m_dinInfo.format)
+        {
+          case 0:
+            return "Unknown";
+          case 20:
+            return "R8G8B8";
+          case 21:
+            return "A8R8G8B8";
+          case 22:
+            return "X8R8G8B8";
+          case 23:
+            return "R5G6B5";
+          case 25:
+            return "A1R5G5B5";
+          case 26:
+            return "A4R4G4B4";
+          case 28:
+            return "A8";
+          case 50:
+            return "L8";
+          case 51:
+            return "A8L8";
+          default:
+            return "D3DFORMAT " + m_dinInfo.format;
+        }
+      }
+    }
+
+    /// <summary>
+    ///   Gets the number of bits used for each pixel.
+    /// </summary>
+    /// <value>The number of bits used for each pixel, or 0 if the format isn't known.</value>
+    public int BitsPerPixel
+    {
+      get
+      {
+        return m_dinInfo.bitsPerPixel;
+      }
+    }
+
+    /// <summary>
+    ///   Gets the size the file should be, according to its header.
+    /// </summary>
+    /// <value>The size the file should be, or 0 if the format isn't known.</value>
+    public long ExpectedSize
+    {
+      get
+      {
+        return m_dinInfo.expectedSize;
+      }
+    }
+
+    /// <summary>
+    ///   Gets whether the texture is a cubemap.
+    /// </summary>
+    /// <value>Whether the texture is a cubemap.</value>
+    public bool IsCubemap
+    {
+      get
+      {
+        return (m_dinInfo.flags & DDS_INFO_CUBEMAP) != 0;
+      }
+    }
+
+    /// <summary>
+    ///   Gets whether the texture is a volume texture.
+    /// </summary>
+    /// <value>Whether the texture is a volume texture.</value>
+    public bool IsVolume
+    {
+      get
+      {
+        return (m_dinInfo.flags & DDS_INFO_VOLUME) != 0;
+      }
+    }
+
+    /// <summary>
+    ///   Gets whether the file is shorter than its header says it should be.
+    /// </summary>
+    /// <value>Whether the file is shorter than its header says it should be.</value>
+    public bool IsTruncated
+    {
+      get
+      {
+        return (m_dinInfo.flags & DDS_INFO_TRUNCATED) != 0;
+      }
+    }
+
+    /// <summary>
+    ///   Gets whether the texture's format is known.
+    /// </summary>
+    /// <value>Whether the texture's format is known. If not, <see cref="ExpectedSize" /> is 0 and the file
+    ///   isn't checked for truncation.</value>
+    public bool IsSizeKnown
+    {
+      get
+      {
+        return (m_dinInfo.flags & DDS_INFO_UNKNOWN_SIZE) == 0;
+      }
+    }
+
+    #endregion
+
+    #region Constructors
+
+    private TextureInfo(NativeMethods.DdsInfo p_dinInfo)
+    {
+      m_dinInfo = p_dinInfo;
+    }
+
+    #endregion
+
+    /// <summary>
+    ///   Reads the header of the given texture.
+    /// </summary>
+    /// <param name="p_bteTexture">The texture file.</param>
+    /// <returns>The texture's description, or <lang langref="null"/> if the data isn't a DDS texture.</returns>
+    public static TextureInfo Probe(byte[] p_bteTexture)
+    {
+      return Probe(p_bteTexture, p_bteTexture.Length);
+    }
+
+    /// <summary>
+    ///   Reads the header of a texture.
+    /// </summary>
+    /// <remarks>
+    ///   This allows a texture to be described from the start of the file alone, which is useful when the
+    ///   texture would have to be decompressed to be read in full.
+    /// </remarks>
+    /// <param name="p_bteHeader">The first <see cref="HeaderSize" /> bytes of the texture file, or the whole
+    ///   file if it is shorter.</param>
+    /// <param name="p_intFileLength">The length of the whole texture file. This can only be larger than the header
+    ///   if the header holds all <see cref="HeaderSize" /> bytes.</param>
+    /// <returns>The texture's description, or <lang langref="null"/> if the data isn't a DDS texture.</returns>
+    /// <exception cref="ArgumentOutOfRangeException">Thrown if <paramref name="p_intFileLength"/> is negative, or
+    ///   is larger than the header when the header is shorter than <see cref="HeaderSize" />.</exception>
+    public static TextureInfo Probe(byte[] p_bteHeader, int p_intFileLength)
+    {
+      //the native probe reads up to HeaderSize bytes, bounded by the file length it is given, so that length must
+      //never let it read past the end of the array
+      if ((p_intFileLength < 0) ||
+          ((p_intFileLength > p_bteHeader.Length) && (p_bteHeader.Length < HeaderSize)))
+      {
+        throw new ArgumentOutOfRangeException("p_intFileLength", p_intFileLength,
+                                              "The file length doesn't fit the header that was given.");
+      }
+      NativeMethods.DdsInfo dinInfo;
+      if (!NativeMethods.ddsProbe(p_bteHeader, p_intFileLength, out dinInfo))
+      {
+        return null;
+      }
+      return new TextureInfo(dinInfo);
+    }
+  }
+}
@@ -81,6 +81,18 @@ namespace Fomm.Games.Fallout3.Script
     /// </param>
     /// <returns>The saved texture.</returns>
     public byte[] SaveTexture(IntPtr p_ptrTexture, int p_intFormat, bool p_booMipmaps)
+    {
+      return SaveTexture(p_ptrTexture, p_intFormat, p_booMipmaps ? MipmapOptions.Box : MipmapOptions.None);
+    }
+
+    /// <summary>
+    ///   Saves the specified texture, generating mipmaps with the given filter.
+    /// </summary>
+    /// <param name="p_ptrTexture">The pointer to the texture to save.</param>
+    /// <param name="p_intFormat">The format in which to save the texture.</param>
+    /// <param name="p_mpoMipmaps">How to build the mipmaps, or <see cref="MipmapOptions.None" /> for none.</param>
+    /// <returns>The saved texture.</returns>
+    public byte[] SaveTexture(IntPtr p_ptrTexture, int p_intFormat, MipmapOptions p_mpoMipmaps)
     {
       if (!m_booDdsParserInited || !m_lstTextures.Contains(p_ptrTexture))
       {
@@ -88,7 +100,7 @@ namespace Fomm.Games.Fallout3.Script
       }
       PermissionsManager.CurrentPermissions.Assert();
       int length;
-      var data = NativeMethods.ddsSave(p_ptrTexture, p_intFormat, p_booMipmaps ? 1 : 0, out length);
+      var data = NativeMethods.ddsSave(p_ptrTexture, p_intFormat, (int) p_mpoMipmaps, out length);
       if (data == IntPtr.Zero)
       {
         return null;
@@ -118,6 +130,62 @@ namespace Fomm.Games.Fallout3.Script
                            p_rctDestinationRect.Top, p_rctDestinationRect.Width, p_rctDestinationRect.Height);
     }
 
+    /// <summary>
+    ///   Copies many areas of textures into one texture in a single operation.
+    /// </summary>
+    /// <remarks>
+    ///   This is much faster than calling <see cref="CopyTexture"/> for each area, and is meant for building
+    ///   texture atlases. Where destination areas overlap, later copies are drawn over earlier ones.
+    ///   Copies from textures this manager didn't create, or from areas outside either texture, are skipped.
+    /// </remarks>
+    /// <param name="p_ptrDestination">A pointer to the texture to which to make the copies.</param>
+    /// <param name="p_lstCopies">The copies to make.</param>
+    /// <returns>The number of copies that were made.</returns>
+    public int CopyTextures(IntPtr p_ptrDestination, IList<TextureCopy> p_lstCopies)
+    {
+      if (!m_booDdsParserInited || !m_lstTextures.Contains(p_ptrDestination))
+      {
+        return 0;
+      }
+      var lstOps = new List<NativeMethods.BltOperation>(p_lstCopies.Count);
+      foreach (var tcpCopy in p_lstCopies)
+      {
+        if (!m_lstTextures.Contains(tcpCopy.Source))
+        {
+          continue;
+        }
+        var bopOp = new NativeMethods.BltOperation();
+        bopOp.source = tcpCopy.Source;
+        bopOp.sL = tcpCopy.SourceRect.Left;
+        bopOp.sT = tcpCopy.SourceRect.Top;
+        bopOp.sW = tcpCopy.SourceRect.Width;
+        bopOp.sH = tcpCopy.SourceRect.Height;
+        bopOp.dL = tcpCopy.DestinationRect.Left;
+        bopOp.dT = tcpCopy.DestinationRect.Top;
+        bopOp.dW = tcpCopy.DestinationRect.Width;
+        bopOp.dH = tcpCopy.DestinationRect.Height;
+        bopOp.filter = (int) tcpCopy.Filter;
+        lstOps.Add(bopOp);
+      }
+      if (lstOps.Count == 0)
+      {
+        return 0;
+      }
+      PermissionsManager.CurrentPermissions.Assert();
+      return NativeMethods.ddsBltBatch(p_ptrDestination, lstOps.ToArray(), lstOps.Count);
+    }
+
+    /// <summary>
+    ///   Describes the given texture without loading it.
+    /// </summary>
+    /// <param name="p_bteTexture">The texture file to describe.</param>
+    /// <returns>The texture's description, or <lang langref="null"/> if the data isn't a DDS texture.</returns>
+    public TextureInfo GetTextureInfo(byte[] p_bteTexture)
+    {
+      PermissionsManager.CurrentPermissions.Assert();
+      return TextureInfo.Probe(p_bteTexture);
+    }
+
     /// <summary>
     ///   Gets the dimensions of the specified texture.
     /// </summary>
@@ -177,6 +245,84 @@ namespace Fomm.Games.Fallout3.Script
       NativeMethods.ddsSetData(p_ptrTexture, p_bteData, p_bteData.Length);
     }
 
+    /// <summary>
+    ///   Copies the texture data for the specified texture into the given buffer.
+    /// </summary>
+    /// <remarks>
+    ///   The buffer can be reused between calls, so repeatedly reading a texture doesn't allocate.
+    ///   The buffer must hold at least <paramref name="p_intPitch"/> times the texture's height bytes.
+    /// </remarks>
+    /// <param name="p_ptrTexture">A pointer to the texture whose data is to be retrieved.</param>
+    /// <param name="p_bteBuffer">The buffer into which to copy the texture data.</param>
+    /// <param name="p_intPitch">The number of bytes between the starts of two rows in the buffer.</param>
+    /// <returns><lang langref="true"/> if the data was copied; <lang langref="false"/> otherwise.</returns>
+    public bool GetTextureData(IntPtr p_ptrTexture, byte[] p_bteBuffer, int p_intPitch)
+    {
+      if (!m_booDdsParserInited || !m_lstTextures.Contains(p_ptrTexture))
+      {
+        return false;
+      }
+      PermissionsManager.CurrentPermissions.Assert();
+      return NativeMethods.ddsGetData(p_ptrTexture, p_bteBuffer, p_bteBuffer.Length, p_intPitch);
+    }
+
+    /// <summary>
+    ///   Sets the data for the specified texture from a buffer with the given pitch.
+    /// </summary>
+    /// <param name="p_ptrTexture">A pointer to the texture whose data is to be set.</param>
+    /// <param name="p_bteData">The data to which to set the texture.</param>
+    /// <param name="p_intPitch">The number of bytes between the starts of two rows in the data.</param>
+    /// <returns><lang langref="true"/> if the data was set; <lang langref="false"/> otherwise.</returns>
+    public bool SetTextureData(IntPtr p_ptrTexture, byte[] p_bteData, int p_intPitch)
+    {
+      if (!m_booDdsParserInited || !m_lstTextures.Contains(p_ptrTexture))
+      {
+        return false;
+      }
+      PermissionsManager.CurrentPermissions.Assert();
+      return NativeMethods.ddsSetDataPitch(p_ptrTexture, p_bteData, p_bteData.Length, p_intPitch);
+    }
+
+    /// <summary>
+    ///   Locks the specified texture, giving direct access to its memory.
+    /// </summary>
+    /// <remarks>
+    ///   The returned pointer stays valid until <see cref="UnlockTexture"/> is called.
+    /// </remarks>
+    /// <param name="p_ptrTexture">A pointer to the texture to lock.</param>
+    /// <param name="p_booReadOnly">Whether the texture will only be read.</param>
+    /// <param name="p_intPitch">The out parameter that will contain the texture's pitch.</param>
+    /// <param name="p_intWidth">The out parameter that will contain the width of the texture.</param>
+    /// <param name="p_intHeight">The out parameter that will contain the height of the texture.</param>
+    /// <returns>A pointer to the texture's pixels, or <see cref="IntPtr.Zero"/> if the texture could not be locked.</returns>
+    public IntPtr LockTexture(IntPtr p_ptrTexture, bool p_booReadOnly, out int p_intPitch, out int p_intWidth,
+                              out int p_intHeight)
+    {
+      p_intPitch = 0;
+      p_intWidth = 0;
+      p_intHeight = 0;
+      if (!m_booDdsParserInited || !m_lstTextures.Contains(p_ptrTexture))
+      {
+        return IntPtr.Zero;
+      }
+      PermissionsManager.CurrentPermissions.Assert();
+      return NativeMethods.ddsLockEx(p_ptrTexture, p_booReadOnly, out p_intPitch, out p_intWidth, out p_intHeight);
+    }
+
+    /// <summary>
+    ///   Unlocks a texture locked by <see cref="LockTexture"/>.
+    /// </summary>
+    /// <param name="p_ptrTexture">A pointer to the texture to unlock.</param>
+    public void UnlockTexture(IntPtr p_ptrTexture)
+    {
+      if (!m_booDdsParserInited || !m_lstTextures.Contains(p_ptrTexture))
+      {
+        return;
+      }
+      PermissionsManager.CurrentPermissions.Assert();
+      NativeMethods.ddsUnlock(p_ptrTexture);
+    }
+
     /// <summary>
     ///   Releases the specified texture.
     /// </summary>
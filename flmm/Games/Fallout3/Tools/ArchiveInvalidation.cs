@@ -2,6 +2,7 @@ using System;
 using System.Collections.Generic;
 using System.IO;
 using System.Windows.Forms;
+using Fomm.Games.Fallout3.Tools.BSA;
 
 namespace Fomm.Games.Fallout3.Tools
 {
@@ -80,6 +81,81 @@ namespace Fomm.Games.Fallout3.Tools
                                                  .FOIniPath);
     }
 
+    private static List<string> m_lstHiddenFiles;
+
+    /// <summary>
+    ///   Tells the user about loose files that archives still win over once invalidation is applied.
+    /// </summary>
+    /// <remarks>
+    ///   Invalidation only lets loose files replace archived ones older than them, so a loose file older than the
+    ///   archive providing the same path is still not loaded. Which source wins each path comes from the
+    ///   <see cref="DataFileIndex" />. Applying invalidation can change the times of the game's archives, so the index
+    ///   may have to read them again, which is done on a background thread behind a progress dialog.
+    /// </remarks>
+    private static void ReportHiddenFiles()
+    {
+      Exception error;
+      using (var bwdProgress = new BackgroundWorkerProgressDialog(FindHiddenFiles))
+      {
+        bwdProgress.Text = "Archive Invalidation";
+        bwdProgress.ShowItemProgress = false;
+        bwdProgress.OverallMessage = "Reading archives...";
+        bwdProgress.OverallProgressMarquee = true;
+        if (bwdProgress.ShowDialog() == DialogResult.Cancel)
+        {
+          m_lstHiddenFiles = null;
+          return;
+        }
+        error = bwdProgress.Error;
+      }
+      var lstHidden = m_lstHiddenFiles;
+      m_lstHiddenFiles = null;
+      if (error != null)
+      {
+        throw new fommException(error.Message);
+      }
+      if (lstHidden.Count == 0)
+      {
+        return;
+      }
+      var strList = string.Join(Environment.NewLine, lstHidden.GetRange(0, Math.Min(lstHidden.Count, 10)).ToArray());
+      if (lstHidden.Count > 10)
+      {
+        strList += Environment.NewLine + "...";
+      }
+      MessageBox.Show(
+        lstHidden.Count + " loose files are older than the archived files they replace, so the game will still load " +
+        "the archived ones:" + Environment.NewLine + strList, "Archive Invalidation", MessageBoxButtons.OK,
+        MessageBoxIcon.Information);
+    }
+
+    /// <summary>
+    ///   Lists the loose files an archive wins over.
+    /// </summary>
+    /// <remarks>
+    ///   This method is used by the background worker.
+    /// </remarks>
+    private static void FindHiddenFiles()
+    {
+      var dfiIndex = DataFileIndex.ForCurrentGame();
+      var lstHidden = new List<string>();
+      try
+      {
+        foreach (var strPath in dfiIndex.GetOverrides(""))
+        {
+          if (dfiIndex.GetProvider(strPath) != "")
+          {
+            lstHidden.Add(strPath);
+          }
+        }
+      }
+      finally
+      {
+        dfiIndex.Dispose();
+      }
+      m_lstHiddenFiles = lstHidden;
+    }
+
     private static void RemoveAI()
     {
       NativeMethods.WritePrivateProfileIntA("Archive", "bInvalidateOlderFiles", 0,
@@ -113,6 +189,7 @@ namespace Fomm.Games.Fallout3.Tools
         if (MessageBox.Show("Apply archive invalidation?", "", MessageBoxButtons.YesNo) == DialogResult.Yes)
         {
           ApplyAI();
+          ReportHiddenFiles();
           return true;
         }
       }
@@ -1,11 +1,8 @@
 using System;
 using System.IO;
 using System.Text;
-using Fomm.Properties;
 using Fomm.SharpZipLib.Checksums;
-using Fomm.SharpZipLib.Zip.Compression;
 using StringList = System.Collections.Generic.List<string>;
-using HashTable = System.Collections.Generic.Dictionary<ulong, Fomm.Games.Fallout3.Tools.BSA.BSAArchive.BSAFileInfo>;
 
 namespace Fomm.Games.Fallout3.Tools.BSA
 {
@@ -13,273 +10,63 @@ namespace Fomm.Games.Fallout3.Tools.BSA
   {
     internal class BSALoadException : Exception {}
 
-    [Flags]
-    private enum FileFlags
-    {
-      [UsedImplicitly]
-      Meshes = 1,
-
-      [UsedImplicitly]
-      Textures = 2
-    }
+    private IntPtr m_ptrArchive;
+    private string[] m_strFileNames;
 
-    internal struct BSAFileInfo
+    public string[] FileNames
     {
-      internal readonly BSAArchive bsa;
-      internal readonly int offset;
-      internal readonly int size;
-      internal readonly bool compressed;
-
-      internal BSAFileInfo(BSAArchive _bsa, int _offset, int _size)
-      {
-        bsa = _bsa;
-        offset = _offset;
-        size = _size;
-
-        if ((size & (1 << 30)) != 0)
-        {
-          size ^= 1 << 30;
-          compressed = !bsa.defaultCompressed;
-        }
-        else
-        {
-          compressed = bsa.defaultCompressed;
-        }
-      }
-
-      internal byte[] GetRawData()
+      get
       {
-        bsa.br.BaseStream.Seek(offset, SeekOrigin.Begin);
-        if (bsa.SkipNames)
-        {
-          bsa.br.BaseStream.Position += bsa.br.ReadByte() + 1;
-        }
-        if (compressed)
+        if (m_strFileNames == null)
         {
-          var b = new byte[size - 4];
-          var output = new byte[bsa.br.ReadUInt32()];
-          bsa.br.Read(b, 0, size - 4);
-
-          var inf = new Inflater();
-          inf.SetInput(b, 0, b.Length);
-          inf.Inflate(output);
-
-          return output;
+          var lstNames = new StringList(NativeMethods.bsaFileCount(m_ptrArchive));
+          var sbdName = new StringBuilder(512);
+          for (var i = 0; i < lstNames.Capacity; i++)
+          {
+            if (NativeMethods.bsaFileName(m_ptrArchive, i, sbdName, sbdName.Capacity) >= 0)
+            {
+              lstNames.Add(sbdName.ToString());
+            }
+          }
+          m_strFileNames = lstNames.ToArray();
+          Array.Sort(m_strFileNames);
         }
-        return bsa.br.ReadBytes(size);
+        return m_strFileNames;
       }
     }
 
-    private struct BSAFileInfo4
-    {
-      internal string path;
-      internal readonly ulong hash;
-      internal readonly int size;
-      internal readonly uint offset;
-
-      internal BSAFileInfo4(BinaryReader br)
-      {
-        path = null;
-
-        hash = br.ReadUInt64();
-        size = br.ReadInt32();
-        offset = br.ReadUInt32();
-      }
-    }
-
-    private struct BSAFolderInfo4
-    {
-      internal string path;
-      internal readonly ulong hash;
-      internal readonly int count;
-      internal int offset;
-
-      internal BSAFolderInfo4(BinaryReader br)
-      {
-        path = null;
-        offset = 0;
-
-        hash = br.ReadUInt64();
-        count = br.ReadInt32();
-        //offset=br.ReadInt32();
-        br.BaseStream.Position += 4; //Don't need the offset here
-      }
-    }
-
-    private struct BSAHeader4
-    {
-      internal readonly uint bsaVersion;
-      internal readonly int directorySize;
-      internal readonly int archiveFlags;
-      internal readonly int folderCount;
-      internal readonly int fileCount;
-      internal readonly int totalFolderNameLength;
-      internal readonly int totalFileNameLength;
-      internal readonly FileFlags fileFlags;
-
-      internal BSAHeader4(BinaryReader br)
-      {
-        br.BaseStream.Position += 4;
-        bsaVersion = br.ReadUInt32();
-        directorySize = br.ReadInt32();
-        archiveFlags = br.ReadInt32();
-        folderCount = br.ReadInt32();
-        fileCount = br.ReadInt32();
-        totalFolderNameLength = br.ReadInt32();
-        totalFileNameLength = br.ReadInt32();
-        fileFlags = (FileFlags) br.ReadInt32();
-      }
-    }
-
-    private BinaryReader br;
-    private bool defaultCompressed;
-    private bool SkipNames;
-    private HashTable files;
-
-    public string[] FileNames { get; private set; }
-
     internal BSAArchive(string path)
     {
-      br = new BinaryReader(File.OpenRead(path), Encoding.Default);
-      var header = new BSAHeader4(br);
-      if (header.bsaVersion != 0x68 && header.bsaVersion != 0x67)
+      m_ptrArchive = NativeMethods.bsaOpen(path);
+      if (m_ptrArchive == IntPtr.Zero)
       {
         throw new BSALoadException();
       }
-      defaultCompressed = (header.archiveFlags & 4) > 0;
-      SkipNames = (header.archiveFlags & 0x100) > 0 && header.bsaVersion == 0x68;
-      files = new HashTable();
-
-      //Read folder info
-      var folderInfo = new BSAFolderInfo4[header.folderCount];
-      var fileInfo = new BSAFileInfo4[header.fileCount];
-      FileNames = new string[header.fileCount];
-      for (var i = 0; i < header.folderCount; i++)
-      {
-        folderInfo[i] = new BSAFolderInfo4(br);
-      }
-      var count = 0;
-      for (uint i = 0; i < header.folderCount; i++)
-      {
-        folderInfo[i].path = new string(br.ReadChars(br.ReadByte() - 1));
-        br.BaseStream.Position++;
-        folderInfo[i].offset = count;
-        for (var j = 0; j < folderInfo[i].count; j++)
-        {
-          fileInfo[count + j] = new BSAFileInfo4(br);
-        }
-        count += folderInfo[i].count;
-      }
-      for (uint i = 0; i < header.fileCount; i++)
-      {
-        fileInfo[i].path = "";
-        char c;
-        while ((c = br.ReadChar()) != '\0')
-        {
-          fileInfo[i].path += c;
-        }
-      }
-
-      for (var i = 0; i < header.folderCount; i++)
-      {
-        for (var j = 0; j < folderInfo[i].count; j++)
-        {
-          var fi4 = fileInfo[folderInfo[i].offset + j];
-          var ext = Path.GetExtension(fi4.path);
-          var fi = new BSAFileInfo(this, (int) fi4.offset, fi4.size);
-          var fpath = Path.Combine(folderInfo[i].path, Path.GetFileNameWithoutExtension(fi4.path));
-          var hash = GenHash(fpath, ext);
-          files[hash] = fi;
-          FileNames[folderInfo[i].offset + j] = fpath + ext;
-        }
-      }
-
-      Array.Sort(FileNames);
-    }
-
-    private static ulong GenHash(string file)
-    {
-      file = file.ToLowerInvariant().Replace('/', '\\');
-      return GenHash(Path.ChangeExtension(file, null), Path.GetExtension(file));
-    }
-
-    private static ulong GenHash(string file, string ext)
-    {
-      file = file.ToLower();
-      ext = ext.ToLower();
-      ulong hash = 0;
-      if (file.Length > 0)
-      {
-        hash = (ulong) (
-          (((byte) file[file.Length - 1])*0x1) +
-          ((file.Length > 2 ? (byte) file[file.Length - 2] : 0)*0x100) +
-          (file.Length*0x10000) +
-          (((byte) file[0])*0x1000000)
-          );
-      }
-      if (file.Length > 3)
-      {
-        hash += (ulong) (GenHash2(file.Substring(1, file.Length - 3))*0x100000000);
-      }
-      if (ext.Length > 0)
-      {
-        hash += (ulong) (GenHash2(ext)*0x100000000);
-        byte i = 0;
-        switch (ext)
-        {
-          case ".nif":
-            i = 1;
-            break;
-            //case ".kf": i=2; break;
-          case ".dds":
-            i = 3;
-            break;
-            //case ".wav": i=4; break;
-        }
-        if (i != 0)
-        {
-          var a = (byte) (((i & 0xfc) << 5) + (byte) ((hash & 0xff000000) >> 24));
-          var b = (byte) (((i & 0xfe) << 6) + (byte) (hash & 0xff));
-          var c = (byte) ((i << 7) + (byte) ((hash & 0xff00) >> 8));
-          hash -= hash & 0xFF00FFFF;
-          hash += (uint) ((a << 24) + b + (c << 8));
-        }
-      }
-      return hash;
-    }
-
-    private static uint GenHash2(string s)
-    {
-      uint hash = 0;
-      foreach (var c in s)
-      {
-        hash *= 0x1003f;
-        hash += (byte) c;
-      }
-      return hash;
     }
 
     internal void Dispose()
     {
-      if (files != null)
+      if (m_ptrArchive != IntPtr.Zero)
       {
-        files.Clear();
-      }
-      if (br != null)
-      {
-        br.Close();
-        br = null;
+        NativeMethods.bsaClose(m_ptrArchive);
+        m_ptrArchive = IntPtr.Zero;
       }
     }
 
     internal byte[] GetFile(string path)
     {
-      var hash = GenHash(path);
-      if (!files.ContainsKey(hash))
+      var index = NativeMethods.bsaFind(m_ptrArchive, path);
+      NativeMethods.BsaEntry entry;
+      if (index < 0 || !NativeMethods.bsaFileInfo(m_ptrArchive, index, out entry))
+      {
+        return null;
+      }
+      var data = new byte[entry.size];
+      if (!NativeMethods.bsaRead(m_ptrArchive, index, data, data.Length))
       {
         return null;
       }
-      return files[hash].GetRawData();
+      return data;
     }
   }
 
@@ -42,14 +42,22 @@ namespace Fomm.Games.Fallout3.Tools.BSA
       this.tvFolders = new System.Windows.Forms.TreeView();
       this.splitContainer1 = new System.Windows.Forms.SplitContainer();
       this.cbRegex = new System.Windows.Forms.CheckBox();
+      this.bValidate = new System.Windows.Forms.Button();
+      this.cmsFiles = new System.Windows.Forms.ContextMenuStrip(this.components);
+      this.tsmiReplace = new System.Windows.Forms.ToolStripMenuItem();
+      this.tsmiRemove = new System.Windows.Forms.ToolStripMenuItem();
+      this.tssCompact = new System.Windows.Forms.ToolStripSeparator();
+      this.tsmiCompact = new System.Windows.Forms.ToolStripMenuItem();
       this.splitContainer1.Panel1.SuspendLayout();
       this.splitContainer1.Panel2.SuspendLayout();
       this.splitContainer1.SuspendLayout();
+      this.cmsFiles.SuspendLayout();
       this.SuspendLayout();
       // 
       // lvFiles
       // 
       this.lvFiles.AutoArrange = false;
+      this.lvFiles.ContextMenuStrip = this.cmsFiles;
       this.lvFiles.Columns.AddRange(new System.Windows.Forms.ColumnHeader[] {
             this.columnHeader1});
       this.lvFiles.Dock = System.Windows.Forms.DockStyle.Fill;
@@ -229,11 +237,61 @@ namespace Fomm.Games.Fallout3.Tools.BSA
       this.cbRegex.UseVisualStyleBackColor = true;
       this.cbRegex.CheckedChanged += new System.EventHandler(this.tbSearch_TextChanged);
       // 
+      // bValidate
+      // 
+      this.bValidate.Anchor = ((System.Windows.Forms.AnchorStyles)((System.Windows.Forms.AnchorStyles.Bottom | System.Windows.Forms.AnchorStyles.Right)));
+      this.bValidate.Enabled = false;
+      this.bValidate.Location = new System.Drawing.Point(508, 366);
+      this.bValidate.Name = "bValidate";
+      this.bValidate.Size = new System.Drawing.Size(62, 23);
+      this.bValidate.TabIndex = 9;
+      this.bValidate.Text = "Validate";
+      this.bValidate.UseVisualStyleBackColor = true;
+      this.bValidate.Click += new System.EventHandler(this.bValidate_Click);
+      // 
+      // cmsFiles
+      // 
+      this.cmsFiles.Items.AddRange(new System.Windows.Forms.ToolStripItem[] {
+            this.tsmiReplace,
+            this.tsmiRemove,
+            this.tssCompact,
+            this.tsmiCompact});
+      this.cmsFiles.Name = "cmsFiles";
+      this.cmsFiles.Size = new System.Drawing.Size(153, 76);
+      this.cmsFiles.Opening += new System.ComponentModel.CancelEventHandler(this.cmsFiles_Opening);
+      // 
+      // tsmiReplace
+      // 
+      this.tsmiReplace.Name = "tsmiReplace";
+      this.tsmiReplace.Size = new System.Drawing.Size(152, 22);
+      this.tsmiReplace.Text = "Replace with...";
+      this.tsmiReplace.Click += new System.EventHandler(this.tsmiReplace_Click);
+      // 
+      // tsmiRemove
+      // 
+      this.tsmiRemove.Name = "tsmiRemove";
+      this.tsmiRemove.Size = new System.Drawing.Size(152, 22);
+      this.tsmiRemove.Text = "Remove";
+      this.tsmiRemove.Click += new System.EventHandler(this.tsmiRemove_Click);
+      // 
+      // tssCompact
+      // 
+      this.tssCompact.Name = "tssCompact";
+      this.tssCompact.Size = new System.Drawing.Size(149, 6);
+      // 
+      // tsmiCompact
+      // 
+      this.tsmiCompact.Name = "tsmiCompact";
+      this.tsmiCompact.Size = new System.Drawing.Size(152, 22);
+      this.tsmiCompact.Text = "Compact...";
+      this.tsmiCompact.Click += new System.EventHandler(this.tsmiCompact_Click);
+      // 
       // BSABrowser
       // 
       this.AutoScaleDimensions = new System.Drawing.SizeF(6F, 13F);
       this.AutoScaleMode = System.Windows.Forms.AutoScaleMode.Font;
       this.ClientSize = new System.Drawing.Size(582, 400);
+      this.Controls.Add(this.bValidate);
       this.Controls.Add(this.cbRegex);
       this.Controls.Add(this.splitContainer1);
       this.Controls.Add(this.label1);
@@ -252,6 +310,7 @@ namespace Fomm.Games.Fallout3.Tools.BSA
       this.splitContainer1.Panel1.ResumeLayout(false);
       this.splitContainer1.Panel2.ResumeLayout(false);
       this.splitContainer1.ResumeLayout(false);
+      this.cmsFiles.ResumeLayout(false);
       this.ResumeLayout(false);
       this.PerformLayout();
 
@@ -276,5 +335,11 @@ namespace Fomm.Games.Fallout3.Tools.BSA
         private System.Windows.Forms.TreeView tvFolders;
         private System.Windows.Forms.SplitContainer splitContainer1;
         private System.Windows.Forms.CheckBox cbRegex;
+        private System.Windows.Forms.Button bValidate;
+        private System.Windows.Forms.ContextMenuStrip cmsFiles;
+        private System.Windows.Forms.ToolStripMenuItem tsmiReplace;
+        private System.Windows.Forms.ToolStripMenuItem tsmiRemove;
+        private System.Windows.Forms.ToolStripSeparator tssCompact;
+        private System.Windows.Forms.ToolStripMenuItem tsmiCompact;
     }
 }
@@ -2,11 +2,13 @@ using System;
 using System.Collections;
 using System.Collections.Generic;
 using System.Collections.Specialized;
+using System.ComponentModel;
 using System.Diagnostics;
 using System.IO;
 using System.Text;
 using System.Text.RegularExpressions;
 using System.Windows.Forms;
+using Fomm.Games.Fallout3.Script;
 using Fomm.Properties;
 using Fomm.SharpZipLib.Zip.Compression;
 
@@ -74,6 +76,7 @@ namespace Fomm.Games.Fallout3.Tools.BSA
       internal readonly uint Offset;
       internal readonly uint Size;
       internal readonly uint RealSize;
+      internal int Index = -1;
 
       internal BSAFileEntry(bool compressed, string folder, uint offset, uint size)
       {
@@ -128,13 +131,43 @@ namespace Fomm.Games.Fallout3.Tools.BSA
           var uncompressed = RealSize == 0 ? new byte[br.ReadUInt32()] : new byte[RealSize];
           var compressed = new byte[Size - 4];
           br.Read(compressed, 0, (int) (Size - 4));
-          inf.Reset();
-          inf.SetInput(compressed);
-          inf.Inflate(uncompressed);
+          if (!NativeMethods.zInflateBuffer(compressed, compressed.Length, uncompressed, uncompressed.Length, 0))
+          {
+            fs.Close();
+            throw new fommException("The file " + FileName + " is damaged.");
+          }
           fs.Write(uncompressed, 0, uncompressed.Length);
         }
         fs.Close();
       }
+
+      internal TextureInfo ProbeTexture(BinaryReader br, bool SkipName)
+      {
+        br.BaseStream.Position = Offset;
+        var size = (int) Size;
+        if (SkipName)
+        {
+          var nameLength = br.ReadByte() + 1;
+          br.BaseStream.Position += nameLength - 1;
+          size -= nameLength;
+        }
+        byte[] header;
+        if (!Compressed)
+        {
+          header = br.ReadBytes(Math.Min(size, TextureInfo.HeaderSize));
+        }
+        else
+        {
+          //only the start of the file is inflated
+          size = RealSize == 0 ? (int) br.ReadUInt32() : (int) RealSize;
+          var compressed = br.ReadBytes((int) (Size - 4));
+          header = new byte[Math.Min(size, TextureInfo.HeaderSize)];
+          inf.Reset();
+          inf.SetInput(compressed);
+          inf.Inflate(header);
+        }
+        return TextureInfo.Probe(header, size);
+      }
     }
 
     private bool ArchiveOpen;
@@ -142,6 +175,12 @@ namespace Fomm.Games.Fallout3.Tools.BSA
     private bool Compressed;
     private bool ContainsFileNameBlobs;
     private BSAFileEntry[] Files;
+    private IntPtr NativeArchive;
+    private bool NativeFormat;
+    private string ArchivePath;
+
+    //bytes kept spare behind the directory when an edit has to move files to make room for it
+    private const int EditSlack = 64 * 1024;
     private ListViewItem[] lvItems;
     private ListViewItem[] lvAllItems;
 
@@ -192,15 +231,24 @@ namespace Fomm.Games.Fallout3.Tools.BSA
       bExtract.Enabled = false;
       bExtractAll.Enabled = false;
       bPreview.Enabled = false;
+      bValidate.Enabled = false;
+      NativeFormat = false;
+      ArchivePath = null;
       if (br != null)
       {
         br.Close();
       }
       br = null;
+      if (NativeArchive != IntPtr.Zero)
+      {
+        NativeMethods.bsaClose(NativeArchive);
+        NativeArchive = IntPtr.Zero;
+      }
     }
 
     private void OpenArchive(string path)
     {
+      NativeFormat = false;
       try
       {
         br = new BinaryReader(File.OpenRead(path), Encoding.Default);
@@ -275,6 +323,7 @@ namespace Fomm.Games.Fallout3.Tools.BSA
         else
         {
           var version = br.ReadInt32();
+          NativeFormat = version == 0x67 || version == 0x68;
           if (version != 0x67 && version != 0x68)
           {
             if (MessageBox.Show("This BSA archive has an unknown version number.\n" +
@@ -327,7 +376,9 @@ namespace Fomm.Games.Fallout3.Tools.BSA
                 comp = !comp;
                 size ^= 1 << 30;
               }
-              Files[filecount++] = new BSAFileEntry(comp, folder, br.ReadUInt32(), size);
+              Files[filecount] = new BSAFileEntry(comp, folder, br.ReadUInt32(), size);
+              Files[filecount].Index = filecount;
+              filecount++;
             }
             sb.Length = 0;
           }
@@ -345,6 +396,8 @@ namespace Fomm.Games.Fallout3.Tools.BSA
             Files[i].FileName = sb.ToString();
             sb.Length = 0;
           }
+          //the native reader lists files in the same order, so Index can be handed straight to it
+          NativeArchive = NativeMethods.bsaOpen(path);
         }
       }
       catch (Exception ex)
@@ -354,7 +407,20 @@ namespace Fomm.Games.Fallout3.Tools.BSA
           br.Close();
         }
         br = null;
-        MessageBox.Show("An error occured trying to open the archive.\n" + ex.Message);
+        Files = null;
+        if (!NativeFormat)
+        {
+          MessageBox.Show("An error occured trying to open the archive.\n" + ex.Message);
+          return;
+        }
+        //the validator reads the archive by path, so damaged archives can still be checked and repaired
+        NativeFormat = false;
+        if (MessageBox.Show("An error occured trying to open the archive.\n" + ex.Message + "\n\n" +
+                            "Validate the archive and try to repair it?", "Error", MessageBoxButtons.YesNo) ==
+            DialogResult.Yes)
+        {
+          ValidateArchive(path);
+        }
         return;
       }
 
@@ -371,6 +437,16 @@ namespace Fomm.Games.Fallout3.Tools.BSA
       ArchiveOpen = true;
       bExtractAll.Enabled = true;
       bPreview.Enabled = true;
+      ArchivePath = path;
+      //the validator reads the archive by path, so it can check archives the native reader rejects
+      bValidate.Enabled = NativeFormat;
+      if (NativeFormat && NativeArchive == IntPtr.Zero &&
+          MessageBox.Show("The archive's directory appears to be damaged.\n" +
+                          "Validate the archive and try to repair it?", "Warning", MessageBoxButtons.YesNo) ==
+          DialogResult.Yes)
+      {
+        ValidateArchive(path);
+      }
     }
 
     private void UpdateFileList()
@@ -427,23 +503,16 @@ namespace Fomm.Games.Fallout3.Tools.BSA
       {
         if (SaveAllDialog.ShowDialog() == DialogResult.OK)
         {
-          var pf = new ProgressForm(false);
-          pf.Text = "Unpacking archive";
-          pf.EnableCancel();
-          pf.SetProgressRange(lvFiles.SelectedItems.Count);
-          pf.Show();
-          var count = 0;
           try
           {
+            var lstEntries = new List<BSAFileEntry>();
             foreach (ListViewItem lvi in lvFiles.SelectedItems)
             {
-              var fe = (BSAFileEntry) lvi.Tag;
-              fe.Extract(SaveAllDialog.SelectedPath, true, br, ContainsFileNameBlobs);
-              pf.UpdateProgress(count++);
-              Application.DoEvents();
+              lstEntries.Add((BSAFileEntry) lvi.Tag);
             }
+            ExtractFiles(lstEntries, SaveAllDialog.SelectedPath);
           }
-          catch (fommException)
+          catch (fommCancelException)
           {
             MessageBox.Show("Operation cancelled", "Message");
           }
@@ -451,30 +520,117 @@ namespace Fomm.Games.Fallout3.Tools.BSA
           {
             MessageBox.Show(ex.Message, "Error");
           }
-          pf.Unblock();
-          pf.Close();
         }
       }
     }
 
+    /// <summary>
+    ///   Extracts the given files into their folders below the given path.
+    /// </summary>
+    /// <remarks>
+    ///   Archives the native reader could open are extracted on all cores, with the files read in the order
+    ///   they are stored, on a background thread behind a modal progress dialog. Anything else is extracted one
+    ///   file at a time.
+    /// </remarks>
+    /// <param name="entries">The files to extract.</param>
+    /// <param name="path">The folder to extract to.</param>
+    /// <exception cref="fommCancelException">Thrown if the user cancels.</exception>
+    private void ExtractFiles(IList<BSAFileEntry> entries, string path)
+    {
+      if (NativeArchive != IntPtr.Zero)
+      {
+        ExtractNative(entries, path);
+        return;
+      }
+
+      var pf = new ProgressForm(false);
+      pf.Text = "Unpacking archive";
+      pf.EnableCancel();
+      pf.SetProgressRange(entries.Count);
+      pf.Show();
+      try
+      {
+        var count = 0;
+        foreach (var fe in entries)
+        {
+          fe.Extract(path, true, br, ContainsFileNameBlobs);
+          pf.UpdateProgress(count++);
+          Application.DoEvents();
+        }
+      }
+      finally
+      {
+        pf.Unblock();
+        pf.Close();
+      }
+    }
+
+    private BackgroundWorkerProgressDialog ExtractProgress;
+    private int[] ExtractIndices;
+    private string ExtractPath;
+    private int ExtractResult;
+
+    private void ExtractNative(IList<BSAFileEntry> entries, string path)
+    {
+      ExtractIndices = new int[entries.Count];
+      for (var i = 0; i < ExtractIndices.Length; i++)
+      {
+        ExtractIndices[i] = entries[i].Index;
+      }
+      ExtractPath = path;
+      Exception error;
+      using (ExtractProgress = new BackgroundWorkerProgressDialog(ExtractNativeWork))
+      {
+        ExtractProgress.Text = "Unpacking archive";
+        ExtractProgress.ShowItemProgress = false;
+        ExtractProgress.OverallMessage = "Extracting files...";
+        ExtractProgress.OverallProgressMaximum = ExtractIndices.Length;
+        ExtractProgress.ShowDialog(this);
+        error = ExtractProgress.Error;
+      }
+      ExtractProgress = null;
+      ExtractIndices = null;
+      if (error != null)
+      {
+        throw new fommException(error.Message);
+      }
+      switch (ExtractResult)
+      {
+        case -1:
+          throw new fommException("The archive doesn't contain file names.");
+        case -2:
+          throw new fommException("A file could not be written.");
+        case -3:
+          throw new fommException("The archive contains damaged files. The rest were extracted.");
+        case -4:
+          throw new fommCancelException("");
+      }
+    }
+
+    /// <summary>
+    ///   Runs bsaExtract on the progress dialog's background thread.
+    /// </summary>
+    private void ExtractNativeWork()
+    {
+      NativeMethods.ExtractProgressDelegate progress = ExtractNativeProgress;
+      ExtractResult = NativeMethods.bsaExtract(NativeArchive, ExtractIndices, ExtractIndices.Length, ExtractPath, 0,
+                                               progress);
+      GC.KeepAlive(progress);
+    }
+
+    private bool ExtractNativeProgress(int done, int total)
+    {
+      ExtractProgress.OverallProgress = done;
+      return !ExtractProgress.Cancelled();
+    }
+
     private void bExtractAll_Click(object sender, EventArgs e)
     {
       if (SaveAllDialog.ShowDialog() == DialogResult.OK)
       {
-        var pf = new ProgressForm(false);
-        pf.Text = "Unpacking archive";
-        pf.EnableCancel();
-        pf.SetProgressRange(Files.Length);
-        pf.Show();
-        var count = 0;
         try
         {
-          foreach (var fe in Files)
-          {
-            fe.Extract(SaveAllDialog.SelectedPath, true, br, ContainsFileNameBlobs);
-            pf.UpdateProgress(count++);
-            Application.DoEvents();
-          }
+          ExtractFiles(Files, SaveAllDialog.SelectedPath);
         }
         catch (fommCancelException)
         {
@@ -484,11 +640,254 @@ namespace Fomm.Games.Fallout3.Tools.BSA
         {
           MessageBox.Show(ex.Message, "Error");
         }
-        pf.Unblock();
-        pf.Close();
       }
     }
 
+    private static string DescribeProblem(int kind)
+    {
+      switch (kind)
+      {
+        case 1:
+          return "The header is invalid";
+        case 2:
+          return "The directory runs past the end of the file";
+        case 3:
+          return "The name lengths in the header are wrong";
+        case 4:
+          return "Folders are out of order";
+        case 5:
+          return "Files are out of order";
+        case 6:
+          return "A folder hash doesn't match its name";
+        case 7:
+          return "A file hash doesn't match its name";
+        case 8:
+          return "A folder record points to the wrong place";
+        case 9:
+          return "A file's data lies outside the archive";
+        case 10:
+          return "A file's data is damaged";
+        default:
+          return "Unknown problem";
+      }
+    }
+
+    private void bValidate_Click(object sender, EventArgs e)
+    {
+      ValidateArchive(ArchivePath);
+    }
+
+    /// <summary>
+    ///   Reports the problems in an archive, and offers to rebuild its directory into a new file.
+    /// </summary>
+    /// <param name="archivePath">The path of the archive, which need not be open.</param>
+    private void ValidateArchive(string archivePath)
+    {
+      var problems = new NativeMethods.BsaProblem[100];
+      int count;
+      Cursor = Cursors.WaitCursor;
+      try
+      {
+        count = NativeMethods.bsaValidate(archivePath, 1, problems, problems.Length);
+      }
+      finally
+      {
+        Cursor = Cursors.Default;
+      }
+      if (count < 0)
+      {
+        MessageBox.Show("The archive could not be read.", "Error");
+        return;
+      }
+      if (count == 0)
+      {
+        MessageBox.Show("No problems were found.", "Validate");
+        return;
+      }
+
+      var sbdReport = new StringBuilder();
+      sbdReport.AppendLine(count + " problems were found:");
+      for (var i = 0; i < count && i < problems.Length; i++)
+      {
+        sbdReport.Append(DescribeProblem(problems[i].kind));
+        if (Files != null && problems[i].file >= 0 && problems[i].file < Files.Length)
+        {
+          sbdReport.Append(": " + Path.Combine(Files[problems[i].file].Folder, Files[problems[i].file].FileName));
+        }
+        sbdReport.AppendLine();
+      }
+      if (count > problems.Length)
+      {
+        sbdReport.AppendLine("...");
+      }
+      sbdReport.AppendLine();
+      sbdReport.Append("Rebuild the archive's directory into a new file?");
+      if (MessageBox.Show(sbdReport.ToString(), "Validate", MessageBoxButtons.YesNo) != DialogResult.Yes)
+      {
+        return;
+      }
+
+      SaveSingleDialog.FileName = Path.GetFileNameWithoutExtension(archivePath) + " (repaired).bsa";
+      if (SaveSingleDialog.ShowDialog() != DialogResult.OK)
+      {
+        return;
+      }
+      if (Path.GetFullPath(SaveSingleDialog.FileName).ToLowerInvariant() ==
+          Path.GetFullPath(archivePath).ToLowerInvariant())
+      {
+        MessageBox.Show("The repaired archive can't replace the open one.", "Error");
+        return;
+      }
+      int result;
+      Cursor = Cursors.WaitCursor;
+      try
+      {
+        result = NativeMethods.bsaRepair(archivePath, SaveSingleDialog.FileName, 1);
+      }
+      finally
+      {
+        Cursor = Cursors.Default;
+      }
+      switch (result)
+      {
+        case -1:
+          MessageBox.Show("The archive could not be read.", "Error");
+          break;
+        case -2:
+          MessageBox.Show("The repaired archive could not be written.", "Error");
+          break;
+        case -3:
+          MessageBox.Show("The archive doesn't contain file names.", "Error");
+          break;
+        case -4:
+          MessageBox.Show("The archive's directory is too damaged to rebuild.", "Error");
+          break;
+        case -5:
+          MessageBox.Show("The repaired archive would be too big.", "Error");
+          break;
+        default:
+          MessageBox.Show("The archive was rebuilt. " + result + " files were left out.", "Validate");
+          break;
+      }
+    }
+
+    private void cmsFiles_Opening(object sender, CancelEventArgs e)
+    {
+      //only archives the native reader could open can be edited
+      e.Cancel = NativeArchive == IntPtr.Zero;
+      tsmiReplace.Enabled = lvFiles.SelectedItems.Count == 1;
+      tsmiRemove.Enabled = lvFiles.SelectedItems.Count > 0;
+    }
+
+    /// <summary>
+    ///   Applies edits to the open archive in place, then opens it again to show the result.
+    /// </summary>
+    /// <param name="edits">The files to replace or add, and the files to remove, which have no source.</param>
+    private void EditArchive(NativeMethods.BsaEditEntry[] edits)
+    {
+      var path = ArchivePath;
+      CloseArchive();
+      long unused;
+      int result;
+      Cursor = Cursors.WaitCursor;
+      try
+      {
+        result = NativeMethods.bsaEdit(path, edits, edits.Length, 0, 6, EditSlack, out unused);
+      }
+      finally
+      {
+        Cursor = Cursors.Default;
+      }
+      OpenArchive(path);
+      switch (result)
+      {
+        case -1:
+          MessageBox.Show("The archive or one of the files could not be read.", "Error");
+          break;
+        case -2:
+          MessageBox.Show("The archive could not be written.", "Error");
+          break;
+        case -3:
+          MessageBox.Show("The archive doesn't contain file names, or its directory is damaged.", "Error");
+          break;
+        case -4:
+          MessageBox.Show("The archive would be too big.", "Error");
+          break;
+        default:
+          if (unused > 0)
+          {
+            MessageBox.Show("The archive now holds " + (unused / 1024) +
+                            " KB of replaced data. Compact it to reclaim the space.", "Message");
+          }
+          break;
+      }
+    }
+
+    private void tsmiReplace_Click(object sender, EventArgs e)
+    {
+      var fe = (BSAFileEntry) lvFiles.SelectedItems[0].Tag;
+      var ofdReplacement = new OpenFileDialog();
+      ofdReplacement.Title = "Replace " + fe.FileName + " with";
+      ofdReplacement.Filter = "All files|*.*";
+      if (ofdReplacement.ShowDialog() != DialogResult.OK)
+      {
+        return;
+      }
+      var edit = new NativeMethods.BsaEditEntry();
+      edit.name = Path.Combine(fe.Folder, fe.FileName);
+      edit.source = ofdReplacement.FileName;
+      edit.compress = fe.Compressed;
+      EditArchive(new[] {edit});
+    }
+
+    private void tsmiRemove_Click(object sender, EventArgs e)
+    {
+      if (MessageBox.Show("Remove " + lvFiles.SelectedItems.Count + " files from the archive?", "Remove",
+                          MessageBoxButtons.YesNo) != DialogResult.Yes)
+      {
+        return;
+      }
+      var edits = new NativeMethods.BsaEditEntry[lvFiles.SelectedItems.Count];
+      for (var i = 0; i < edits.Length; i++)
+      {
+        var fe = (BSAFileEntry) lvFiles.SelectedItems[i].Tag;
+        edits[i].name = Path.Combine(fe.Folder, fe.FileName);
+      }
+      EditArchive(edits);
+    }
+
+    private void tsmiCompact_Click(object sender, EventArgs e)
+    {
+      SaveSingleDialog.FileName = Path.GetFileNameWithoutExtension(ArchivePath) + " (compacted).bsa";
+      if (SaveSingleDialog.ShowDialog() != DialogResult.OK)
+      {
+        return;
+      }
+      if (Path.GetFullPath(SaveSingleDialog.FileName).ToLowerInvariant() ==
+          Path.GetFullPath(ArchivePath).ToLowerInvariant())
+      {
+        MessageBox.Show("The compacted archive can't replace the open one.", "Error");
+        return;
+      }
+      long reclaimed;
+      int result;
+      Cursor = Cursors.WaitCursor;
+      try
+      {
+        result = NativeMethods.bsaCompact(ArchivePath, SaveSingleDialog.FileName, out reclaimed);
+      }
+      finally
+      {
+        Cursor = Cursors.Default;
+      }
+      if (result < 0)
+      {
+        MessageBox.Show("The archive could not be compacted.", "Error");
+        return;
+      }
+      MessageBox.Show("Compacting reclaimed " + (reclaimed / 1024) + " KB.", "Message");
+    }
+
     private void cmbSortOrder_SelectedIndexChanged(object sender, EventArgs e)
     {
       BSASorter.order = (BSASortOrder) cmbSortOrder.SelectedIndex;
@@ -544,9 +943,35 @@ namespace Fomm.Games.Fallout3.Tools.BSA
             fe.Extract(Path.Combine(path, fe.FileName), false, br, ContainsFileNameBlobs);
             Process.Start(Path.Combine(path, fe.FileName));
             break;
+          case ".dds":
+            var tinInfo = fe.ProbeTexture(br, ContainsFileNameBlobs);
+            if (tinInfo == null)
+            {
+              MessageBox.Show("The file is not a valid DDS texture.", "Error");
+              break;
+            }
+            var sbdInfo = new StringBuilder();
+            sbdInfo.AppendFormat("Size: {0}x{1}", tinInfo.Width, tinInfo.Height);
+            if (tinInfo.IsVolume)
+            {
+              sbdInfo.AppendFormat("x{0}", tinInfo.Depth);
+            }
+            sbdInfo.AppendLine();
+            sbdInfo.AppendLine("Format: " + tinInfo.FormatName);
+            sbdInfo.AppendLine("Mipmaps: " + tinInfo.MipCount);
+            if (tinInfo.IsCubemap)
+            {
+              sbdInfo.AppendLine("Cubemap with " + tinInfo.ArraySize + " faces");
+            }
+            if (tinInfo.IsTruncated)
+            {
+              sbdInfo.AppendLine("The file is truncated: " + tinInfo.ExpectedSize + " bytes were expected.");
+            }
+            MessageBox.Show(sbdInfo.ToString(), fe.FileName);
+            break;
           default:
             MessageBox.Show("Filetype not supported.\n" +
-                            "Currently only txt or xml files can be previewed", "Error");
+                            "Currently only txt, xml or dds files can be previewed", "Error");
             break;
         }
       }
@@ -37,6 +37,8 @@ namespace Fomm.Games.Fallout3.Tools.BSA
             this.bAddFolder = new System.Windows.Forms.Button();
             this.folderBrowserDialog1 = new System.Windows.Forms.FolderBrowserDialog();
             this.cmbCompLevel = new System.Windows.Forms.ComboBox();
+            this.cbDeduplicate = new System.Windows.Forms.CheckBox();
+            this.cbLocality = new System.Windows.Forms.CheckBox();
             this.SuspendLayout();
             // 
             // saveFileDialog1
@@ -158,11 +160,35 @@ namespace Fomm.Games.Fallout3.Tools.BSA
             this.cmbCompLevel.Size = new System.Drawing.Size(121, 21);
             this.cmbCompLevel.TabIndex = 2;
             // 
+            // cbDeduplicate
+            // 
+            this.cbDeduplicate.Anchor = ((System.Windows.Forms.AnchorStyles)((System.Windows.Forms.AnchorStyles.Bottom | System.Windows.Forms.AnchorStyles.Left)));
+            this.cbDeduplicate.AutoSize = true;
+            this.cbDeduplicate.Location = new System.Drawing.Point(12, 366);
+            this.cbDeduplicate.Name = "cbDeduplicate";
+            this.cbDeduplicate.Size = new System.Drawing.Size(186, 17);
+            this.cbDeduplicate.TabIndex = 6;
+            this.cbDeduplicate.Text = "Store identical files only once";
+            this.cbDeduplicate.UseVisualStyleBackColor = true;
+            // 
+            // cbLocality
+            // 
+            this.cbLocality.Anchor = ((System.Windows.Forms.AnchorStyles)((System.Windows.Forms.AnchorStyles.Bottom | System.Windows.Forms.AnchorStyles.Left)));
+            this.cbLocality.AutoSize = true;
+            this.cbLocality.Location = new System.Drawing.Point(210, 366);
+            this.cbLocality.Name = "cbLocality";
+            this.cbLocality.Size = new System.Drawing.Size(200, 17);
+            this.cbLocality.TabIndex = 7;
+            this.cbLocality.Text = "Keep files loaded together close";
+            this.cbLocality.UseVisualStyleBackColor = true;
+            // 
             // BSACreator
             // 
             this.AutoScaleDimensions = new System.Drawing.SizeF(6F, 13F);
             this.AutoScaleMode = System.Windows.Forms.AutoScaleMode.Font;
-            this.ClientSize = new System.Drawing.Size(531, 371);
+            this.ClientSize = new System.Drawing.Size(531, 394);
+            this.Controls.Add(this.cbLocality);
+            this.Controls.Add(this.cbDeduplicate);
             this.Controls.Add(this.cmbCompLevel);
             this.Controls.Add(this.lvFiles);
             this.Controls.Add(this.bAddFile);
@@ -173,6 +199,7 @@ namespace Fomm.Games.Fallout3.Tools.BSA
             this.Name = "BSACreator";
             this.Text = "BSA Creator";
             this.ResumeLayout(false);
+            this.PerformLayout();
 
         }
 
@@ -190,5 +217,7 @@ namespace Fomm.Games.Fallout3.Tools.BSA
         private System.Windows.Forms.Button bAddFolder;
         private System.Windows.Forms.FolderBrowserDialog folderBrowserDialog1;
         private System.Windows.Forms.ComboBox cmbCompLevel;
+        private System.Windows.Forms.CheckBox cbDeduplicate;
+        private System.Windows.Forms.CheckBox cbLocality;
     }
 }
\ No newline at end of file
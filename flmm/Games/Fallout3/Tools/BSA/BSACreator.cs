@@ -4,152 +4,11 @@ using System.Collections.Generic;
 using System.IO;
 using System.Windows.Forms;
 using Fomm.Properties;
-using Fomm.SharpZipLib.Zip.Compression;
 
 namespace Fomm.Games.Fallout3.Tools.BSA
 {
   internal partial class BSACreator : Form
   {
-    internal static ulong GenHash(string s)
-    {
-      var extension = "";
-      var i = s.LastIndexOf('.');
-      if (i != -1)
-      {
-        extension = s.Substring(i);
-        s = s.Remove(i);
-      }
-      return GenHash(s, extension);
-    }
-
-    internal static ulong GenHash(string file, string ext)
-    {
-      file = file.ToLower();
-      ext = ext.ToLower();
-      ulong hash = 0;
-      if (file.Length > 0)
-      {
-        hash = (ulong) (
-          (((byte) file[file.Length - 1])*0x1) +
-          ((file.Length > 2 ? (byte) file[file.Length - 2] : 0)*0x100) +
-          (file.Length*0x10000) +
-          (((byte) file[0])*0x1000000)
-          );
-      }
-      if (file.Length > 3)
-      {
-        hash += (ulong) (GenHashInternal(file.Substring(1, file.Length - 3))*0x100000000);
-      }
-      if (ext.Length > 0)
-      {
-        hash += (ulong) (GenHashInternal(ext)*0x100000000);
-        byte i = 0;
-        switch (ext)
-        {
-          case ".nif":
-            i = 1;
-            break;
-          case ".kf":
-            i = 2;
-            break;
-          case ".dds":
-            i = 3;
-            break;
-          case ".wav":
-            i = 4;
-            break;
-        }
-        if (i != 0)
-        {
-          var a = (byte) (((i & 0xfc) << 5) + (byte) ((hash & 0xff000000) >> 24));
-          var b = (byte) (((i & 0xfe) << 6) + (byte) (hash & 0xff));
-          var c = (byte) ((i << 7) + (byte) ((hash & 0xff00) >> 8));
-          hash -= hash & 0xFF00FFFF;
-          hash += (uint) ((a << 24) + b + (c << 8));
-        }
-      }
-      return hash;
-    }
-
-    private static uint GenHashInternal(string s)
-    {
-      uint hash = 0;
-      foreach (var c in s)
-      {
-        hash *= 0x1003f;
-        hash += (byte) c;
-      }
-      return hash;
-    }
-
-    private class FolderRecord
-    {
-      internal readonly List<FileRecord> files;
-      internal readonly string name;
-      internal readonly ulong hash;
-      internal long offsetpos;
-
-      internal FolderRecord(string _name)
-      {
-        name = _name;
-        hash = GenHash(name, "");
-        files = new List<FileRecord>();
-      }
-
-      //internal override string ToString() { return name; }
-    }
-
-    private class FileRecord
-    {
-      internal readonly string filepath;
-      internal readonly uint size;
-      internal readonly string name;
-      internal readonly ulong hash;
-      internal long offsetpos;
-      internal bool DoCompress;
-
-      internal FileRecord(ListViewItem lvi)
-      {
-        name = Path.GetFileName(lvi.Text);
-        hash = GenHash(name);
-        filepath = lvi.SubItems[1].Text;
-        size = (uint) (new FileInfo(filepath)).Length;
-        DoCompress = lvi.Checked;
-      }
-    }
-
-    private class FolderRecordComparer : IComparer<FolderRecord>
-    {
-      public int Compare(FolderRecord a, FolderRecord b)
-      {
-        if (a.hash == b.hash)
-        {
-          return 0;
-        }
-        if (a.hash > b.hash)
-        {
-          return 1;
-        }
-        return -1;
-      }
-    }
-
-    private class FileRecordComparer : IComparer<FileRecord>
-    {
-      public int Compare(FileRecord a, FileRecord b)
-      {
-        if (a.hash == b.hash)
-        {
-          return 0;
-        }
-        if (a.hash > b.hash)
-        {
-          return 1;
-        }
-        return -1;
-      }
-    }
-
     private class ListViewSorter : IComparer
     {
       public int Compare(object oa, object ob)
@@ -165,43 +24,8 @@ namespace Fomm.Games.Fallout3.Tools.BSA
       }
     }
 
-    private List<FolderRecord> folders;
-    private List<FileRecord> files;
     private readonly ListViewSorter sorter = new ListViewSorter();
 
-    private void CreateFileRecords()
-    {
-      folders = new List<FolderRecord>();
-      files = new List<FileRecord>();
-      string folder = null;
-      FolderRecord currentfolder = null;
-      foreach (ListViewItem lvi in lvFiles.Items)
-      {
-        var newfolder = Path.GetDirectoryName(lvi.Text);
-        if (newfolder != folder)
-        {
-          currentfolder = new FolderRecord(newfolder);
-          folders.Add(currentfolder);
-          folder = newfolder;
-        }
-        var fr = new FileRecord(lvi);
-        if (fr.size >= (1 << 30))
-        {
-          MessageBox.Show("Error: File '" + fr.filepath + "' is too big to store in a BSA archive");
-          continue;
-        }
-        files.Add(fr);
-        currentfolder.files.Add(fr);
-      }
-      var frc1 = new FolderRecordComparer();
-      var frc2 = new FileRecordComparer();
-      folders.Sort(frc1);
-      foreach (var fr in folders)
-      {
-        fr.files.Sort(frc2);
-      }
-    }
-
     internal BSACreator()
     {
       InitializeComponent();
@@ -318,29 +142,14 @@ namespace Fomm.Games.Fallout3.Tools.BSA
         lvi.Text = lvi.Text.ToLower();
       }
       lvFiles.Sort();
-      CreateFileRecords();
-      BinaryWriter bw;
-      try
-      {
-        bw = new BinaryWriter(File.Create(saveFileDialog1.FileName));
-      }
-      catch (Exception ex)
-      {
-        MessageBox.Show("BSA creation failed\n" + ex.Message, "Error");
-        return;
-      }
       try
       {
-        GenerateBSA(bw);
+        GenerateBSA(saveFileDialog1.FileName);
       }
       catch (Exception ex)
       {
         MessageBox.Show("An error occured during BSA generation\n" + ex.Message, "Error");
       }
-      finally
-      {
-        bw.Close();
-      }
     }
 
     private uint CheckFileTypes()
@@ -388,123 +197,45 @@ namespace Fomm.Games.Fallout3.Tools.BSA
       return result;
     }
 
-    private uint GetTotalFolderNameLength()
-    {
-      var i = 0;
-      foreach (var fr in folders)
-      {
-        i += fr.name.Length + 1;
-      }
-      return (uint) i;
-    }
-
-    private uint GetTotalFileNameLength()
-    {
-      var i = 0;
-      foreach (var fr in files)
-      {
-        i += fr.name.Length + 1;
-      }
-      return (uint) i;
-    }
-
-    private void GenerateBSA(BinaryWriter bw)
+    /// <summary>
+    ///   Builds the archive from the listed files.
+    /// </summary>
+    /// <remarks>
+    ///   The work is done by the native bsaPack, which hashes and sorts the files, deflates them on all cores and
+    ///   writes the archive in a single pass. If sharing is turned on, files with identical contents are stored once,
+    ///   and the space saved is reported. Keeping related files close writes the data grouped by folder, with each
+    ///   mesh's textures right behind it, so loading them takes fewer seeks.
+    /// </remarks>
+    /// <param name="path">The path of the archive to create.</param>
+    private void GenerateBSA(string path)
     {
-      bw.Write((byte) 'B');
-      bw.Write((byte) 'S');
-      bw.Write((byte) 'A');
-      bw.Write((byte) 0);
-      bw.Write((uint) 0x67);
-      bw.Write((uint) 36);
-      uint flags;
-      bool Compressed;
+      int flags;
       if (cmbCompression.SelectedIndex == 4 || cmbCompression.SelectedIndex == 5)
       {
         flags = 7 + 1792;
-        Compressed = true;
       }
       else
       {
         flags = 3 + 1792;
-        Compressed = false;
-      }
-      bw.Write(flags);
-      bw.Write((uint) folders.Count);
-      bw.Write((uint) lvFiles.Items.Count);
-      bw.Write(GetTotalFolderNameLength());
-      bw.Write(GetTotalFileNameLength());
-      bw.Write(CheckFileTypes());
-      //folder records
-      foreach (var fr in folders)
-      {
-        bw.Write(fr.hash);
-        bw.Write(fr.files.Count);
-        fr.offsetpos = bw.BaseStream.Position;
-        bw.Write((uint) 0);
-      }
-      //File Records
-      foreach (var fr in folders)
-      {
-        bw.BaseStream.Position = fr.offsetpos;
-        bw.Write((uint) (bw.BaseStream.Length + GetTotalFileNameLength()));
-        bw.BaseStream.Position = bw.BaseStream.Length;
-        bw.Write((byte) (fr.name.Length + 1));
-        foreach (var c in fr.name)
-        {
-          bw.Write((byte) c);
-        }
-        bw.Write((byte) 0);
-        foreach (var fr2 in fr.files)
-        {
-          bw.Write(fr2.hash);
-          fr2.offsetpos = bw.BaseStream.Position;
-          bw.Write((ulong) 0); //size and data offset
-        }
       }
-      //Filenames
-      foreach (var fr in folders)
-      {
-        foreach (var fr2 in fr.files)
-        {
-          foreach (var c in fr2.name)
-          {
-            bw.Write((byte) c);
-          }
-          bw.Write((byte) 0);
-        }
-      }
-      //raw data
-      foreach (var fr in folders)
+      //files are kept deflated if that brings them under this percentage of their size, or always if 0
+      var ratio = 0;
+      switch (cmbCompression.SelectedIndex)
       {
-        foreach (var fr2 in fr.files)
-        {
-          byte[] comp;
-          if (cmbCompression.SelectedIndex != 0 && (cmbCompression.SelectedIndex != 6 || fr2.DoCompress) &&
-              ((comp = CompressRecord(fr2.filepath)) != null))
-          {
-            bw.BaseStream.Position = fr2.offsetpos;
-            bw.Write((uint) (comp.Length + 4) | (uint) (Compressed ? 0 : (1 << 30)));
-            bw.Write((uint) bw.BaseStream.Length);
-            bw.BaseStream.Position = bw.BaseStream.Length;
-            bw.Write(fr2.size);
-            bw.Write(comp);
-          }
-          else
-          {
-            bw.BaseStream.Position = fr2.offsetpos;
-            bw.Write(fr2.size | (uint) (Compressed ? (1 << 30) : 0));
-            bw.Write((uint) bw.BaseStream.Length);
-            bw.BaseStream.Position = bw.BaseStream.Length;
-            bw.Write(File.ReadAllBytes(fr2.filepath));
-          }
-        }
+        case 4:
+          ratio = 80;
+          break;
+        case 3:
+          ratio = 60;
+          break;
+        case 2:
+          ratio = 40;
+          break;
+        case 1:
+          ratio = 20;
+          break;
       }
-    }
-
-    private byte[] CompressRecord(string path)
-    {
-      var len = (int) ((new FileInfo(path)).Length);
-      var level = 5;
+      int level;
       switch (cmbCompLevel.SelectedIndex)
       {
         case 0:
@@ -513,49 +244,55 @@ namespace Fomm.Games.Fallout3.Tools.BSA
         case 1:
           level = 7;
           break;
-        case 2:
-          level = 5;
-          break;
         case 3:
           level = 3;
           break;
         case 4:
           level = 1;
           break;
+        default:
+          level = 5;
+          break;
       }
-      var def = new Deflater(level);
-      var In = File.ReadAllBytes(path);
-      var Out = new byte[In.Length + 64];
-      def.SetInput(In);
-      def.Finish();
-      var size = def.Deflate(Out);
-      Array.Resize(ref Out, size);
-
-      float mul = 0;
-      switch (cmbCompression.SelectedIndex)
+      var entries = new List<NativeMethods.BsaPackEntry>();
+      foreach (ListViewItem lvi in lvFiles.Items)
       {
-        case 6:
-        case 5:
-          return Out;
-        case 4:
-          mul = 0.8f;
-          break;
-        case 3:
-          mul = 0.6f;
-          break;
-        case 2:
-          mul = 0.4f;
-          break;
-        case 1:
-          mul = 0.2f;
-          break;
+        var entry = new NativeMethods.BsaPackEntry();
+        entry.name = lvi.Text;
+        entry.source = lvi.SubItems[1].Text;
+        if ((new FileInfo(entry.source)).Length >= (1 << 30))
+        {
+          MessageBox.Show("Error: File '" + entry.source + "' is too big to store in a BSA archive");
+          continue;
+        }
+        entry.compress = cmbCompression.SelectedIndex != 0 && (cmbCompression.SelectedIndex != 6 || lvi.Checked);
+        entries.Add(entry);
+      }
+      var options = 0;
+      if (cbDeduplicate.Checked)
+      {
+        options |= 1;
+      }
+      if (cbLocality.Checked)
+      {
+        options |= 2;
+      }
+      long saved;
+      var result = NativeMethods.bsaPack(path, entries.ToArray(), entries.Count, flags, (int) CheckFileTypes(), ratio,
+                                         level, options, out saved, null);
+      switch (result)
+      {
+        case -1:
+          throw new IOException("Unable to read one of the files");
+        case -2:
+          throw new IOException("Unable to write " + path);
+        case -3:
+          throw new Exception("The files are too big to fit in a BSA archive");
       }
-      var f = size/(float) len;
-      if (f < mul)
+      if (saved > 0)
       {
-        return Out;
+        MessageBox.Show("Storing identical files once saved " + (saved / 1024) + " KB.", "Message");
       }
-      return null;
     }
 
     private void cmbCompression_SelectedIndexChanged(object sender, EventArgs e)
@@ -0,0 +1,166 @@
+using System;
+using System.IO;
+using System.Text;
+using StringList = System.Collections.Generic.List<string>;
+
+namespace Fomm.Games.Fallout3.Tools.BSA
+{
+  /// <summary>
+  ///   Tells which archive, or the loose files, the game loads each file under Data from.
+  /// </summary>
+  /// <remarks>
+  ///   Archive contents are cached in a snapshot between runs, so only archives that changed since the last
+  ///   index are read again.
+  /// </remarks>
+  internal class DataFileIndex
+  {
+    private const int LooseNewerOnly = 1;
+    private const int ArchivesFirst = 2;
+
+    private IntPtr m_ptrIndex;
+    private readonly string[] m_strSources;
+
+    /// <summary>
+    ///   Gets the archives in load order, followed by an empty string standing for the loose files.
+    /// </summary>
+    /// <value>The sources of the indexed files.</value>
+    public string[] Sources
+    {
+      get
+      {
+        return m_strSources;
+      }
+    }
+
+    /// <summary>
+    ///   Gets the number of distinct files provided by all sources.
+    /// </summary>
+    /// <value>The number of distinct files provided by all sources.</value>
+    public int FileCount
+    {
+      get
+      {
+        return NativeMethods.vfsPathCount(m_ptrIndex);
+      }
+    }
+
+    /// <summary>
+    ///   Indexes the given archives and the loose files under a Data folder.
+    /// </summary>
+    /// <param name="dataPath">The Data folder.</param>
+    /// <param name="archiveList">The comma separated archives, in load order, as in SArchiveList.</param>
+    /// <param name="snapshotPath">The file caching archive contents between runs, or <c>null</c>.</param>
+    /// <param name="invalidateOlderFiles">
+    ///   Whether loose files replace archived ones that are older than them. Otherwise loose files never
+    ///   replace archived ones.
+    /// </param>
+    internal DataFileIndex(string dataPath, string archiveList, string snapshotPath, bool invalidateOlderFiles)
+    {
+      m_ptrIndex = NativeMethods.vfsOpen(dataPath, archiveList, snapshotPath,
+                                         invalidateOlderFiles ? LooseNewerOnly : ArchivesFirst);
+      if (m_ptrIndex == IntPtr.Zero)
+      {
+        throw new fommException("Unable to index the files in " + dataPath);
+      }
+      m_strSources = new string[NativeMethods.vfsSourceCount(m_ptrIndex)];
+      var sbdName = new StringBuilder(512);
+      for (var i = 0; i < m_strSources.Length; i++)
+      {
+        m_strSources[i] = NativeMethods.vfsSourceName(m_ptrIndex, i, sbdName, sbdName.Capacity) > 0
+                            ? sbdName.ToString()
+                            : "";
+      }
+    }
+
+    /// <summary>
+    ///   Indexes the current game's Data folder using the archives and invalidation setting from its ini.
+    /// </summary>
+    /// <returns>The index of the current game's Data folder.</returns>
+    internal static DataFileIndex ForCurrentGame()
+    {
+      var strIni = ((Fallout3GameMode.SettingsFilesSet) Program.GameMode.SettingsFiles).FOIniPath;
+      var strArchives = NativeMethods.GetPrivateProfileString("Archive", "SArchiveList", null, strIni);
+      var booInvalidate = NativeMethods.GetPrivateProfileIntA("Archive", "bInvalidateOlderFiles", 0, strIni) != 0;
+      return new DataFileIndex(Program.GameMode.PluginsPath, strArchives,
+                               Path.Combine(Program.LocalApplicationDataPath, "dataindex.bin"), booInvalidate);
+    }
+
+    internal void Dispose()
+    {
+      if (m_ptrIndex != IntPtr.Zero)
+      {
+        NativeMethods.vfsClose(m_ptrIndex);
+        m_ptrIndex = IntPtr.Zero;
+      }
+    }
+
+    /// <summary>
+    ///   Gets the source the game loads a file from.
+    /// </summary>
+    /// <param name="path">The path of the file, relative to Data.</param>
+    /// <returns>
+    ///   The archive providing the file, an empty string if it is loaded loose, or <c>null</c> if no
+    ///   source provides it.
+    /// </returns>
+    internal string GetProvider(string path)
+    {
+      var index = NativeMethods.vfsFind(m_ptrIndex, path);
+      return index < 0 ? null : m_strSources[NativeMethods.vfsWinner(m_ptrIndex, index)];
+    }
+
+    /// <summary>
+    ///   Gets every source providing a file.
+    /// </summary>
+    /// <param name="path">The path of the file, relative to Data.</param>
+    /// <returns>The sources providing the file, in load order.</returns>
+    internal string[] GetProviders(string path)
+    {
+      var index = NativeMethods.vfsFind(m_ptrIndex, path);
+      if (index < 0)
+      {
+        return new string[0];
+      }
+      var sources = new int[m_strSources.Length];
+      var count = NativeMethods.vfsProviders(m_ptrIndex, index, sources, sources.Length);
+      var names = new string[count];
+      for (var i = 0; i < count; i++)
+      {
+        names[i] = m_strSources[sources[i]];
+      }
+      return names;
+    }
+
+    /// <summary>
+    ///   Gets the files a source provides that an earlier source provides too.
+    /// </summary>
+    /// <param name="source">The archive, or an empty string for the loose files.</param>
+    /// <returns>The paths of the overridden files, relative to Data.</returns>
+    internal string[] GetOverrides(string source)
+    {
+      var lstPaths = new StringList();
+      var intSource = -1;
+      for (var i = 0; i < m_strSources.Length && intSource < 0; i++)
+      {
+        if (m_strSources[i].ToLowerInvariant() == source.ToLowerInvariant())
+        {
+          intSource = i;
+        }
+      }
+      if (intSource < 0)
+      {
+        return lstPaths.ToArray();
+      }
+      var paths = new int[NativeMethods.vfsOverrides(m_ptrIndex, intSource, null, 0)];
+      NativeMethods.vfsOverrides(m_ptrIndex, intSource, paths, paths.Length);
+      var sbdName = new StringBuilder(1024);
+      foreach (var path in paths)
+      {
+        if (NativeMethods.vfsPathName(m_ptrIndex, path, sbdName, sbdName.Capacity) >= 0)
+        {
+          lstPaths.Add(sbdName.ToString());
+        }
+      }
+      return lstPaths.ToArray();
+    }
+  }
+}
\ No newline at end of file
@@ -1,6 +1,5 @@
 ﻿using System;
 using System.Collections.Generic;
-using System.IO;
 using Fomm.Games.Fallout3.Tools.TESsnip;
 
 namespace Fomm.Games.Fallout3.Tools.CriticalRecords
@@ -41,16 +40,16 @@ namespace Fomm.Games.Fallout3.Tools.CriticalRecords
     #region Properties
 
     /// <summary>
-    ///   Gets the conflicted plugin.
+    ///   Gets the file name of the conflicted plugin.
     /// </summary>
-    /// <value>The conflicted plugin.</value>
-    public Plugin ConflictedPlugin { get; protected set; }
+    /// <value>The file name of the conflicted plugin.</value>
+    public string ConflictedPlugin { get; protected set; }
 
     /// <summary>
-    ///   Gets the conflicting plugin.
+    ///   Gets the file name of the conflicting plugin.
     /// </summary>
-    /// <value>The conflicting plugin.</value>
-    public Plugin ConflictingPlugin { get; protected set; }
+    /// <value>The file name of the conflicting plugin.</value>
+    public string ConflictingPlugin { get; protected set; }
 
     /// <summary>
     ///   Gets the overridden form id.
@@ -71,15 +70,15 @@ namespace Fomm.Games.Fallout3.Tools.CriticalRecords
     /// <summary>
     ///   A simple constructor that initializes the object with the given values.
     /// </summary>
-    /// <param name="p_plgConflictedPlugin">The plugin that is conflicted.</param>
-    /// <param name="p_plgConflictingPlugin">The plugin that is conflicting.</param>
+    /// <param name="p_strConflictedPlugin">The file name of the plugin that is conflicted.</param>
+    /// <param name="p_strConflictingPlugin">The file name of the plugin that is conflicting.</param>
     /// <param name="p_uintFormId">The form id that is overridden.</param>
     /// <param name="p_criInfo">The <see cref="CriticalRecordInfo" /> describing the conflict.</param>
-    public ConflictDetectedEventArgs(Plugin p_plgConflictedPlugin, Plugin p_plgConflictingPlugin, UInt32 p_uintFormId,
+    public ConflictDetectedEventArgs(string p_strConflictedPlugin, string p_strConflictingPlugin, UInt32 p_uintFormId,
                                      CriticalRecordInfo p_criInfo)
     {
-      ConflictedPlugin = p_plgConflictedPlugin;
-      ConflictingPlugin = p_plgConflictingPlugin;
+      ConflictedPlugin = p_strConflictedPlugin;
+      ConflictingPlugin = p_strConflictingPlugin;
       FormId = p_uintFormId;
       ConflictInfo = p_criInfo;
     }
@@ -133,16 +132,16 @@ namespace Fomm.Games.Fallout3.Tools.CriticalRecords
     /// <summary>
     ///   Raises the <see cref="ConflictDetected" /> event.
     /// </summary>
-    /// <param name="p_plgConflictedPlugin">The plugin that is conflicted.</param>
-    /// <param name="p_plgConflictingPlugin">The plugin that is conflicting.</param>
+    /// <param name="p_strConflictedPlugin">The file name of the plugin that is conflicted.</param>
+    /// <param name="p_strConflictingPlugin">The file name of the plugin that is conflicting.</param>
     /// <param name="p_uintFormId">The form id that is overridden.</param>
     /// <param name="p_criInfo">The <see cref="CriticalRecordInfo" /> describing the conflict.</param>
-    protected void OnConflictDetected(Plugin p_plgConflictedPlugin, Plugin p_plgConflictingPlugin, UInt32 p_uintFormId,
+    protected void OnConflictDetected(string p_strConflictedPlugin, string p_strConflictingPlugin, UInt32 p_uintFormId,
                                       CriticalRecordInfo p_criInfo)
     {
       if (ConflictDetected != null)
       {
-        var cdaArgs = new ConflictDetectedEventArgs(p_plgConflictedPlugin, p_plgConflictingPlugin,
+        var cdaArgs = new ConflictDetectedEventArgs(p_strConflictedPlugin, p_strConflictingPlugin,
                                                     p_uintFormId, p_criInfo);
         ConflictDetected(this, cdaArgs);
       }
@@ -155,49 +154,52 @@ namespace Fomm.Games.Fallout3.Tools.CriticalRecords
     /// <summary>
     ///   Checks for conflicts with mod-author specified critical records. Used by background worker dialog.
     /// </summary>
+    /// <remarks>
+    ///   Every plugin is read once, through an <see cref="OverrideIndex" />, to find which plugins hold each record
+    ///   and the critical record data it declares. Both are kept in the index's snapshot, so plugins that haven't
+    ///   changed since the last check aren't opened at all.
+    /// </remarks>
     public void DetectConflicts(IList<string> p_lstOrderedPlugins)
     {
       m_booCancelled = false;
-      for (var intIndex = 0; intIndex < p_lstOrderedPlugins.Count; intIndex++)
+      var oixIndex = OverrideIndex.ForLoadOrder(p_lstOrderedPlugins, "MESG",
+                                                CriticalRecordPlugin.CRITICAL_DATA_RECORD_EDID, "DESC");
+      try
       {
-        var strBasePlugin = p_lstOrderedPlugins[intIndex];
-        if (m_booCancelled)
+        for (var intIndex = 0; intIndex < p_lstOrderedPlugins.Count; intIndex++)
         {
-          return;
-        }
+          var strBasePlugin = p_lstOrderedPlugins[intIndex];
+          if (m_booCancelled)
+          {
+            return;
+          }
 
-        OnPluginProcessed();
+          OnPluginProcessed();
 
-        if (SKIP_PLUGINS.Contains(strBasePlugin.ToLowerInvariant()))
-        {
-          continue;
-        }
+          if (SKIP_PLUGINS.Contains(strBasePlugin.ToLowerInvariant()) || !oixIndex.IsReadable(intIndex))
+          {
+            continue;
+          }
 
-        var crpBasePlugin = new CriticalRecordPlugin(Path.Combine(Program.GameMode.PluginsPath, strBasePlugin), false);
-        if (!crpBasePlugin.HasCriticalRecordData)
-        {
-          continue;
-        }
-        for (var i = intIndex + 1; i < p_lstOrderedPlugins.Count; i++)
-        {
-          var strPlugin = p_lstOrderedPlugins[i];
-          var plgPlugin = new Plugin(Path.Combine(Program.GameMode.PluginsPath, strPlugin), false);
-          foreach (var uintFormId in crpBasePlugin.CriticalRecordFormIds)
+          var dicCriticalRecords = CriticalRecordPlugin.ReadCriticalData(oixIndex.GetNote(intIndex));
+          foreach (var kvpCriticalRecord in dicCriticalRecords)
           {
-            var strMasterPlugin = crpBasePlugin.GetMaster((Int32) uintFormId >> 24) ?? strBasePlugin;
-            if (plgPlugin.GetMasterIndex(strMasterPlugin) < 0)
+            //the index resolves the form id through each plugin's masters, so any later holder overrides it
+            foreach (var intPlugin in oixIndex.GetHolders(intIndex, kvpCriticalRecord.Key))
             {
-              continue;
-            }
-            var uintAdjustedFormId = ((UInt32) plgPlugin.GetMasterIndex(strMasterPlugin) << 24);
-            uintAdjustedFormId = uintAdjustedFormId + (uintFormId & 0x00ffffff);
-            if (plgPlugin.ContainsFormId(uintAdjustedFormId))
-            {
-              OnConflictDetected(crpBasePlugin, plgPlugin, uintFormId, crpBasePlugin.GetCriticalRecordInfo(uintFormId));
+              if (intPlugin > intIndex)
+              {
+                OnConflictDetected(strBasePlugin, p_lstOrderedPlugins[intPlugin], kvpCriticalRecord.Key,
+                                   kvpCriticalRecord.Value);
+              }
             }
           }
         }
       }
+      finally
+      {
+        oixIndex.Dispose();
+      }
     }
   }
 }
\ No newline at end of file
@@ -19,7 +19,7 @@ namespace Fomm.Games.Fallout3.Tools.CriticalRecords
     /// <summary>
     ///   The well-known name of the MESG record that contains the critical record data.
     /// </summary>
-    private const string CRITICAL_DATA_RECORD_EDID = "fommCriticalRecords";
+    internal const string CRITICAL_DATA_RECORD_EDID = "fommCriticalRecords";
 
     private Dictionary<UInt32, CriticalRecordInfo> m_dicCriticalRecords = new Dictionary<UInt32, CriticalRecordInfo>();
 
@@ -78,8 +78,41 @@ namespace Fomm.Games.Fallout3.Tools.CriticalRecords
     /// </summary>
     protected void loadCriticalData()
     {
-      var srcCriticalData = getCriticalRecordData();
-      var strCriticalData = srcCriticalData.GetStrData().Trim().Replace("\r\n", "\n").Replace("\n\r", "\n");
+      m_dicCriticalRecords = ParseCriticalData(getCriticalRecordData().GetStrData());
+    }
+
+    /// <summary>
+    ///   Reads critical record data taken from the well-known record without loading the plugin.
+    /// </summary>
+    /// <param name="p_bteData">The DESC subrecord of the well-known record, or <c>null</c> if the plugin has none.</param>
+    /// <returns>The plugin's critical records, by form id. The dictionary is empty if the plugin has none.</returns>
+    internal static Dictionary<UInt32, CriticalRecordInfo> ReadCriticalData(byte[] p_bteData)
+    {
+      if (p_bteData == null)
+      {
+        return new Dictionary<UInt32, CriticalRecordInfo>();
+      }
+      var sbdData = new StringBuilder(p_bteData.Length);
+      foreach (var b in p_bteData)
+      {
+        if (b == 0)
+        {
+          break;
+        }
+        sbdData.Append((char) b);
+      }
+      return ParseCriticalData(sbdData.ToString());
+    }
+
+    /// <summary>
+    ///   Parses the critical record data stored in the well-known record.
+    /// </summary>
+    /// <param name="p_strCriticalData">The text of the well-known record's DESC subrecord.</param>
+    /// <returns>The critical records, by form id.</returns>
+    private static Dictionary<UInt32, CriticalRecordInfo> ParseCriticalData(string p_strCriticalData)
+    {
+      var dicCriticalRecords = new Dictionary<UInt32, CriticalRecordInfo>();
+      var strCriticalData = p_strCriticalData.Trim().Replace("\r\n", "\n").Replace("\n\r", "\n");
       var strCriticalRecords = strCriticalData.Split(new[]
       {
         '\n'
@@ -98,8 +131,9 @@ namespace Fomm.Games.Fallout3.Tools.CriticalRecords
           (CriticalRecordInfo.ConflictSeverity)
             Int32.Parse(strCriticalRecord[9].ToString(), NumberStyles.HexNumber);
         criInfo.Reason = strCriticalRecord.Substring(11);
-        m_dicCriticalRecords[uintFormId] = criInfo;
+        dicCriticalRecords[uintFormId] = criInfo;
       }
+      return dicCriticalRecords;
     }
 
     /// <summary>
@@ -160,7 +194,8 @@ namespace Fomm.Games.Fallout3.Tools.CriticalRecords
       recCriticalRecords.Name = "MESG";
       var uintMastersCount = (UInt32) Masters.Count << 24;
       var uintFormId = uintMastersCount + 1;
-      while (ContainsFormId(uintFormId))
+      var dicFormIds = IndexFormIds();
+      while (dicFormIds.ContainsKey(uintFormId))
       {
         uintFormId++;
       }
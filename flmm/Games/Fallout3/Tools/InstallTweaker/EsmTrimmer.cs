@@ -1,47 +1,37 @@
-﻿using System.Collections.Generic;
+﻿using System;
 using System.IO;
-using Fomm.Games.Fallout3.Tools.TESsnip;
 
 namespace Fomm.Games.Fallout3.Tools.InstallTweaker
 {
   internal static class EsmTrimmer
   {
+    private const int StripEdids = 1;
+
+    /// <summary>
+    ///   Writes a copy of the given plugin, optionally without the editor ids the game doesn't need.
+    /// </summary>
+    /// <remarks>
+    ///   The work is done by the native TrimEsp, which streams the plugin out in one pass without loading its
+    ///   records. Records that aren't changed are copied as they are, so compressed records are never inflated
+    ///   unless their editor ids are stripped. Game settings keep their editor ids, as the game looks them up by
+    ///   name. Nothing is done for <paramref name="stripRefs" /> yet.
+    /// </remarks>
     internal static void Trim(bool stripEdids, bool stripRefs, string In, string Out, ReportProgressDelegate del)
     {
-      var p = new Plugin(In, false);
-
-      del("Editing plugin");
-
-      var queue = new Queue<Rec>(p.Records);
-      while (queue.Count > 0)
+      NativeMethods.TrimProgressDelegate progress =
+        (done, total) => del("Writing record " + done + " of " + total);
+      var result = NativeMethods.TrimEsp(In, Out, stripEdids ? StripEdids : 0, progress);
+      GC.KeepAlive(progress);
+      switch (result)
       {
-        if (queue.Peek() is Record)
-        {
-          queue.Dequeue();
-        }
-        else
-        {
-          var gr = (GroupRecord) queue.Dequeue();
-          if (gr.ContentsType != "GMST")
-          {
-            foreach (var r in gr.Records)
-            {
-              queue.Enqueue(r);
-            }
-          }
-        }
+        case -1:
+          throw new IOException("Unable to read the plugin " + In);
+        case -3:
+          throw new Exception("Corrupt record data in " + In);
+        case -4:
+          throw new IOException("Unable to write " + Out);
       }
-
-      del("Generating new esm");
-
-      //deflater=new ICSharpCode.SharpZipLib.Zip.Compression.Deflater(9);
-      var bw = new BinaryWriter(File.Create(Out));
-      p.SaveData(bw);
-      /*foreach(Rec r in p.Records) {
-                if(r is GroupRecord) WriteGroup(bw, (GroupRecord)r);
-                else WriteRecord(bw, (Record)r);
-            }*/
-      bw.Close();
+      del("Stripped " + result + " editor ids");
     }
   }
 }
\ No newline at end of file
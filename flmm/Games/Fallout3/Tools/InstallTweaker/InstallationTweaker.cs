@@ -54,7 +54,6 @@ namespace Fomm.Games.Fallout3.Tools.InstallTweaker
       //args.stripedids=cbStripGeck.Checked;
       //args.striprefs=cbRemoveClutter.Checked;
       args.trimbsa = cbShrinkTextures.Checked;
-      args.hwnd = Handle;
       tbDescription.Text = "";
       bApply.Enabled = false;
       bReset.Enabled = true;
@@ -98,7 +97,6 @@ namespace Fomm.Games.Fallout3.Tools.InstallTweaker
       //public bool stripedids;
       //public bool striprefs;
       public bool trimbsa;
-      public IntPtr hwnd;
     }
 
     private void ReportProgress(string msg)
@@ -123,7 +121,7 @@ namespace Fomm.Games.Fallout3.Tools.InstallTweaker
       {
         backgroundWorker1.ReportProgress(0, "Parsing Fallout - Textures.bsa");
         File.Move("data\\Fallout - Textures.bsa", bsaBackup);
-        BsaTrimmer.Trim(args.hwnd, bsaBackup, "data\\Fallout - Textures.bsa", ReportProgress);
+        BsaTrimmer.Trim(bsaBackup, "data\\Fallout - Textures.bsa", ReportProgress);
       }
       backgroundWorker1.ReportProgress(0, "Complete");
     }
@@ -116,31 +116,31 @@ namespace Fomm.Games.Fallout3.Tools
           break;
       }
       var clrHighlight = lstBackgroundColours[intColourIndex];
-      if (m_pfpFormatProvider.HasFormat(e.ConflictedPlugin.Name))
+      if (m_pfpFormatProvider.HasFormat(e.ConflictedPlugin))
       {
-        var pftFormat = m_pfpFormatProvider.GetFormat(e.ConflictedPlugin.Name);
+        var pftFormat = m_pfpFormatProvider.GetFormat(e.ConflictedPlugin);
         if (pftFormat.Highlight.HasValue && (lstBackgroundColours.IndexOf(pftFormat.Highlight.Value) > intColourIndex))
         {
           clrHighlight = pftFormat.Highlight.Value;
         }
       }
 
-      if (InstallLog.Current.GetCurrentFileOwnerName(e.ConflictingPlugin.Name) == null)
+      if (InstallLog.Current.GetCurrentFileOwnerName(e.ConflictingPlugin) == null)
       {
         stbMessage.AppendFormat(
           "Form Id \\b {0:x8}\\b0  is overridden by \\b {1}\\b0 .\\par \\pard\\li720\\sl240\\slmult1 {2}\\par \\pard\\sl240\\slmult1 ",
-          e.FormId, e.ConflictingPlugin.Name, e.ConflictInfo.Reason);
+          e.FormId, e.ConflictingPlugin, e.ConflictInfo.Reason);
       }
       else
       {
         var fomodMod =
           new fomod(Path.Combine(Program.GameMode.ModDirectory,
-                                 InstallLog.Current.GetCurrentFileOwnerName(e.ConflictingPlugin.Name) + ".fomod"));
+                                 InstallLog.Current.GetCurrentFileOwnerName(e.ConflictingPlugin) + ".fomod"));
         stbMessage.AppendFormat(
           "Form Id \\b {0:x8}\\b0  is overridden by \\b {1}\\b0  in \\b {2}\\b0 .\\par \\pard\\li720\\sl240\\slmult1 {3}\\par \\pard\\sl240\\slmult1 ",
-          e.FormId, e.ConflictingPlugin.Name, fomodMod.ModName, e.ConflictInfo.Reason);
+          e.FormId, e.ConflictingPlugin, fomodMod.ModName, e.ConflictInfo.Reason);
       }
-      m_pfpFormatProvider.AddFormat(e.ConflictedPlugin.Name, clrHighlight, stbMessage.ToString());
+      m_pfpFormatProvider.AddFormat(e.ConflictedPlugin, clrHighlight, stbMessage.ToString());
     }
   }
 }
\ No newline at end of file
@@ -0,0 +1,146 @@
+using System;
+using System.Collections.Generic;
+using System.IO;
+
+namespace Fomm.Games.Fallout3.Tools.TESsnip
+{
+  /// <summary>
+  ///   Tells which plugins of a load order hold each record.
+  /// </summary>
+  /// <remarks>
+  ///   Every plugin is read once, across all cores, and only its record headers are looked at. Form ids are
+  ///   resolved through each plugin's masters, so records are matched no matter where their masters sit in the load
+  ///   order. The records of each plugin are cached in a snapshot between runs, so only plugins that changed since
+  ///   the last index are read again. A note, one subrecord of a record found by editor id, can be kept for each
+  ///   plugin in the same snapshot.
+  /// </remarks>
+  internal class OverrideIndex
+  {
+    private IntPtr m_ptrIndex;
+    private readonly string[] m_strPlugins;
+
+    /// <summary>
+    ///   Gets the indexed plugins.
+    /// </summary>
+    /// <value>The indexed plugins, in load order.</value>
+    public string[] Plugins
+    {
+      get
+      {
+        return m_strPlugins;
+      }
+    }
+
+    /// <summary>
+    ///   Gets the number of distinct records held by all plugins.
+    /// </summary>
+    /// <value>The number of distinct records held by all plugins.</value>
+    public int RecordCount
+    {
+      get
+      {
+        return NativeMethods.ovrRecordCount(m_ptrIndex);
+      }
+    }
+
+    /// <summary>
+    ///   Indexes the given plugins.
+    /// </summary>
+    /// <param name="dataPath">The Data folder holding the plugins.</param>
+    /// <param name="plugins">The file names of the plugins, in load order.</param>
+    /// <param name="snapshotPath">The file caching plugin contents between runs, or <c>null</c>.</param>
+    /// <param name="noteType">The type of the record holding each plugin's note.</param>
+    /// <param name="noteEditorId">The editor id of the record holding each plugin's note, or <c>null</c> for none.</param>
+    /// <param name="noteSubrecord">The type of the subrecord that is each plugin's note.</param>
+    internal OverrideIndex(string dataPath, IList<string> plugins, string snapshotPath, string noteType,
+                           string noteEditorId, string noteSubrecord)
+    {
+      m_strPlugins = new string[plugins.Count];
+      plugins.CopyTo(m_strPlugins, 0);
+      m_ptrIndex = NativeMethods.ovrOpen(dataPath, m_strPlugins, m_strPlugins.Length, snapshotPath,
+                                         RecordLayout.TypeOf(noteType), noteEditorId,
+                                         RecordLayout.TypeOf(noteSubrecord));
+      if (m_ptrIndex == IntPtr.Zero)
+      {
+        throw new fommException("Unable to index the records in " + dataPath);
+      }
+    }
+
+    /// <summary>
+    ///   Indexes the given plugins in the current game's Data folder.
+    /// </summary>
+    /// <param name="plugins">The file names of the plugins, in load order.</param>
+    /// <param name="noteType">The type of the record holding each plugin's note.</param>
+    /// <param name="noteEditorId">The editor id of the record holding each plugin's note, or <c>null</c> for none.</param>
+    /// <param name="noteSubrecord">The type of the subrecord that is each plugin's note.</param>
+    /// <returns>The index of the given plugins.</returns>
+    internal static OverrideIndex ForLoadOrder(IList<string> plugins, string noteType, string noteEditorId,
+                                               string noteSubrecord)
+    {
+      return new OverrideIndex(Program.GameMode.PluginsPath, plugins,
+                               Path.Combine(Program.LocalApplicationDataPath, "overrideindex.bin"), noteType,
+                               noteEditorId, noteSubrecord);
+    }
+
+    internal void Dispose()
+    {
+      if (m_ptrIndex != IntPtr.Zero)
+      {
+        NativeMethods.ovrClose(m_ptrIndex);
+        m_ptrIndex = IntPtr.Zero;
+      }
+    }
+
+    /// <summary>
+    ///   Determines whether a plugin could be read.
+    /// </summary>
+    /// <param name="plugin">The position of the plugin in the load order.</param>
+    /// <returns><c>true</c> if the plugin's records are indexed; <c>false</c> if it is missing or damaged.</returns>
+    internal bool IsReadable(int plugin)
+    {
+      return NativeMethods.ovrPluginState(m_ptrIndex, plugin) >= 0;
+    }
+
+    /// <summary>
+    ///   Gets a plugin's note.
+    /// </summary>
+    /// <param name="plugin">The position of the plugin in the load order.</param>
+    /// <returns>The note's data, up to any NUL, or <c>null</c> if the plugin has no note or couldn't be read.</returns>
+    internal byte[] GetNote(int plugin)
+    {
+      var length = NativeMethods.ovrNote(m_ptrIndex, plugin, null, 0);
+      if (length < 0)
+      {
+        return null;
+      }
+      var note = new byte[length];
+      NativeMethods.ovrNote(m_ptrIndex, plugin, note, note.Length);
+      return note;
+    }
+
+    /// <summary>
+    ///   Gets every plugin holding a record.
+    /// </summary>
+    /// <param name="plugin">The position in the load order of the plugin referring to the record.</param>
+    /// <param name="formId">The form id of the record, as that plugin refers to it.</param>
+    /// <returns>The positions of the plugins holding the record, in load order.</returns>
+    internal int[] GetHolders(int plugin, UInt32 formId)
+    {
+      var holders = new int[NativeMethods.ovrFind(m_ptrIndex, plugin, formId, null, 0)];
+      NativeMethods.ovrFind(m_ptrIndex, plugin, formId, holders, holders.Length);
+      return holders;
+    }
+
+    /// <summary>
+    ///   Gets the records of a plugin that an earlier plugin holds too.
+    /// </summary>
+    /// <param name="plugin">The position of the plugin in the load order.</param>
+    /// <returns>The form ids of the overriding records, as the plugin refers to them.</returns>
+    internal UInt32[] GetOverrides(int plugin)
+    {
+      var overrides = new UInt32[NativeMethods.ovrOverrides(m_ptrIndex, plugin, null, 0)];
+      NativeMethods.ovrOverrides(m_ptrIndex, plugin, overrides, overrides.Length);
+      return overrides;
+    }
+  }
+}
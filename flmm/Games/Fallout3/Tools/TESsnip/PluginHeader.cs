@@ -0,0 +1,66 @@
+using System;
+
+namespace Fomm.Games.Fallout3.Tools.TESsnip
+{
+  /// <summary>
+  ///   What the TES4 header of a plugin says about it.
+  /// </summary>
+  public class PluginHeader
+  {
+    /// <summary>
+    ///   Gets the file name of the plugin.
+    /// </summary>
+    /// <value>The file name of the plugin.</value>
+    public string Name { get; private set; }
+
+    /// <summary>
+    ///   Gets whether the plugin's header marks it as a master.
+    /// </summary>
+    /// <value>Whether the plugin's header marks it as a master.</value>
+    public bool IsMaster { get; private set; }
+
+    /// <summary>
+    ///   Gets the author of the plugin.
+    /// </summary>
+    /// <value>The author of the plugin, or <c>null</c> if the plugin doesn't say.</value>
+    public string Author { get; private set; }
+
+    /// <summary>
+    ///   Gets the description of the plugin.
+    /// </summary>
+    /// <value>The description of the plugin, or <c>null</c> if the plugin doesn't say.</value>
+    public string Description { get; private set; }
+
+    /// <summary>
+    ///   Gets the masters of the plugin.
+    /// </summary>
+    /// <value>The masters of the plugin, in the order form ids refer to them.</value>
+    public string[] Masters { get; private set; }
+
+    /// <summary>
+    ///   Gets the number of records in the plugin.
+    /// </summary>
+    /// <value>The number of records in the plugin, as its header declares it.</value>
+    public UInt32 RecordCount { get; private set; }
+
+    /// <summary>
+    ///   A simple constructor that initializes the object with the given values.
+    /// </summary>
+    /// <param name="p_strName">The file name of the plugin.</param>
+    /// <param name="p_booIsMaster">Whether the plugin's header marks it as a master.</param>
+    /// <param name="p_strAuthor">The author of the plugin.</param>
+    /// <param name="p_strDescription">The description of the plugin.</param>
+    /// <param name="p_strMasters">The masters of the plugin.</param>
+    /// <param name="p_uintRecordCount">The number of records in the plugin.</param>
+    internal PluginHeader(string p_strName, bool p_booIsMaster, string p_strAuthor, string p_strDescription,
+                          string[] p_strMasters, UInt32 p_uintRecordCount)
+    {
+      Name = p_strName;
+      IsMaster = p_booIsMaster;
+      Author = p_strAuthor;
+      Description = p_strDescription;
+      Masters = p_strMasters;
+      RecordCount = p_uintRecordCount;
+    }
+  }
+}
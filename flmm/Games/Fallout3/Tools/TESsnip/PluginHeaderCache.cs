@@ -0,0 +1,165 @@
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+
+namespace Fomm.Games.Fallout3.Tools.TESsnip
+{
+  /// <summary>
+  ///   The headers of every plugin in the Data folder.
+  /// </summary>
+  /// <remarks>
+  ///   Headers are kept in a snapshot between runs. Refreshing the cache only lists the Data folder, and reads the
+  ///   headers of the plugins that were added or changed since, so an unchanged plugin is never opened. Lookups are
+  ///   served from memory, so anything needing the current state of the Data folder refreshes the cache once first.
+  /// </remarks>
+  public class PluginHeaderCache
+  {
+    private static PluginHeaderCache m_phcCurrent;
+
+    private IntPtr m_ptrCache;
+    private readonly string m_strDataPath;
+    private Dictionary<string, PluginHeader> m_dicHeaders;
+
+    /// <summary>
+    ///   Gets the header cache of the current game's Data folder.
+    /// </summary>
+    /// <value>The header cache of the current game's Data folder.</value>
+    public static PluginHeaderCache Current
+    {
+      get
+      {
+        if ((m_phcCurrent == null) || !m_phcCurrent.m_strDataPath.Equals(Program.GameMode.PluginsPath))
+        {
+          if (m_phcCurrent != null)
+          {
+            m_phcCurrent.Dispose();
+          }
+          m_phcCurrent = new PluginHeaderCache(Program.GameMode.PluginsPath,
+                                               Path.Combine(Program.LocalApplicationDataPath, "pluginheaders.bin"));
+        }
+        return m_phcCurrent;
+      }
+    }
+
+    /// <summary>
+    ///   Opens the header cache of the given Data folder.
+    /// </summary>
+    /// <param name="dataPath">The Data folder holding the plugins.</param>
+    /// <param name="snapshotPath">The file caching plugin headers between runs, or <c>null</c>.</param>
+    internal PluginHeaderCache(string dataPath, string snapshotPath)
+    {
+      m_strDataPath = dataPath;
+      m_ptrCache = NativeMethods.metaOpen(dataPath, snapshotPath);
+      if (m_ptrCache == IntPtr.Zero)
+      {
+        throw new fommException("Unable to read the plugin headers in " + dataPath);
+      }
+      LoadHeaders();
+    }
+
+    internal void Dispose()
+    {
+      if (m_ptrCache != IntPtr.Zero)
+      {
+        NativeMethods.metaClose(m_ptrCache);
+        m_ptrCache = IntPtr.Zero;
+      }
+    }
+
+    /// <summary>
+    ///   Lists the Data folder again, reading the headers of plugins that were added or changed.
+    /// </summary>
+    public void Refresh()
+    {
+      if (NativeMethods.metaRefresh(m_ptrCache) < 0)
+      {
+        throw new fommException("Unable to read the plugin headers in " + m_strDataPath);
+      }
+      LoadHeaders();
+    }
+
+    /// <summary>
+    ///   Gets the header of a plugin, as of the last refresh.
+    /// </summary>
+    /// <param name="p_strPlugin">The file name or path of the plugin.</param>
+    /// <returns>
+    ///   The header of the plugin, or <c>null</c> if the plugin wasn't in the Data folder at the last refresh or is
+    ///   damaged.
+    /// </returns>
+    public PluginHeader GetHeader(string p_strPlugin)
+    {
+      PluginHeader phdHeader;
+      return m_dicHeaders.TryGetValue(Path.GetFileName(p_strPlugin), out phdHeader) ? phdHeader : null;
+    }
+
+    /// <summary>
+    ///   Determines whether a plugin's header marks it as a master.
+    /// </summary>
+    /// <remarks>
+    ///   Plugins the cache didn't hold at the last refresh are read directly.
+    /// </remarks>
+    /// <param name="p_strPluginPath">The path of the plugin.</param>
+    /// <returns><c>true</c> if the plugin is marked as a master; <c>false</c> otherwise.</returns>
+    public bool IsMaster(string p_strPluginPath)
+    {
+      var phdHeader = GetHeader(p_strPluginPath);
+      return phdHeader == null ? Plugin.GetIsEsm(p_strPluginPath) : phdHeader.IsMaster;
+    }
+
+    /// <summary>
+    ///   Gets the hash of a plugin's contents.
+    /// </summary>
+    /// <remarks>
+    ///   A plugin is only hashed the first time this is asked for after it changes.
+    /// </remarks>
+    /// <param name="p_strPlugin">The file name or path of the plugin.</param>
+    /// <returns>The hash of the plugin's contents, or <c>null</c> if the plugin isn't in the Data folder.</returns>
+    public UInt64? GetHash(string p_strPlugin)
+    {
+      var intIndex = NativeMethods.metaFind(m_ptrCache, Path.GetFileName(p_strPlugin));
+      UInt64 ulgHash;
+      if ((intIndex < 0) || !NativeMethods.metaHash(m_ptrCache, intIndex, out ulgHash))
+      {
+        return null;
+      }
+      return ulgHash;
+    }
+
+    private void LoadHeaders()
+    {
+      m_dicHeaders = new Dictionary<string, PluginHeader>(StringComparer.InvariantCultureIgnoreCase);
+      var sbdText = new StringBuilder(0x10000);
+      var intCount = NativeMethods.metaPluginCount(m_ptrCache);
+      for (var i = 0; i < intCount; i++)
+      {
+        NativeMethods.MetaInfo mifInfo;
+        if (!NativeMethods.metaPluginInfo(m_ptrCache, i, out mifInfo))
+        {
+          continue;
+        }
+        NativeMethods.metaPluginName(m_ptrCache, i, sbdText, sbdText.Capacity);
+        var strName = sbdText.ToString();
+        if (mifInfo.state < 0)
+        {
+          continue;
+        }
+        var strAuthor = NativeMethods.metaAuthor(m_ptrCache, i, sbdText, sbdText.Capacity) > 0
+                          ? sbdText.ToString()
+                          : null;
+        var strDescription = NativeMethods.metaDescription(m_ptrCache, i, sbdText, sbdText.Capacity) > 0
+                               ? sbdText.ToString()
+                               : null;
+        var strMasters = new string[mifInfo.masterCount];
+        for (var j = 0; j < strMasters.Length; j++)
+        {
+          strMasters[j] = NativeMethods.metaMasterName(m_ptrCache, i, j, sbdText, sbdText.Capacity) >= 0
+                            ? sbdText.ToString()
+                            : "";
+        }
+        m_dicHeaders[strName] = new PluginHeader(strName, (mifInfo.flags & 1) != 0, strAuthor, strDescription,
+                                                 strMasters, mifInfo.recordCount);
+      }
+    }
+  }
+}
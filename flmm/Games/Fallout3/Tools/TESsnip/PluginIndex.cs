@@ -0,0 +1,224 @@
+using System;
+using System.IO;
+using System.Text;
+
+namespace Fomm.Games.Fallout3.Tools.TESsnip
+{
+  /// <summary>
+  ///   A read only view of a plugin that doesn't load its records.
+  /// </summary>
+  /// <remarks>
+  ///   The plugin is mapped and only its group and record headers are read when it is opened. A record's data is
+  ///   only read, and inflated if it is compressed, when it is asked for. Use <see cref="Plugin" /> to edit a
+  ///   plugin.
+  /// </remarks>
+  public class PluginIndex
+  {
+    private IntPtr m_ptrPlugin;
+    private readonly string[] m_strMasters;
+    private int m_intWindowFirst;
+    private int m_intWindowEnd;
+
+    /// <summary>
+    ///   Gets the file name of the plugin.
+    /// </summary>
+    /// <value>The file name of the plugin.</value>
+    public string Name { get; private set; }
+
+    /// <summary>
+    ///   Gets the masters of the plugin.
+    /// </summary>
+    /// <value>The masters of the plugin, in the order form ids refer to them.</value>
+    public string[] Masters
+    {
+      get
+      {
+        return m_strMasters;
+      }
+    }
+
+    /// <summary>
+    ///   Gets the number of records in the plugin, not counting groups.
+    /// </summary>
+    /// <value>The number of records in the plugin.</value>
+    public int RecordCount
+    {
+      get
+      {
+        return NativeMethods.espRecordCount(m_ptrPlugin);
+      }
+    }
+
+    /// <summary>
+    ///   Gets the native handle of the plugin.
+    /// </summary>
+    /// <value>The native handle of the plugin.</value>
+    internal IntPtr Handle
+    {
+      get
+      {
+        return m_ptrPlugin;
+      }
+    }
+
+    /// <summary>
+    ///   Opens the given plugin.
+    /// </summary>
+    /// <param name="path">The path of the plugin.</param>
+    internal PluginIndex(string path)
+    {
+      Name = Path.GetFileName(path);
+      m_ptrPlugin = NativeMethods.espOpen(path);
+      if (m_ptrPlugin == IntPtr.Zero)
+      {
+        throw new TESParserException("Unable to read the plugin " + path);
+      }
+      m_strMasters = new string[NativeMethods.espMasterCount(m_ptrPlugin)];
+      var sbdName = new StringBuilder(512);
+      for (var i = 0; i < m_strMasters.Length; i++)
+      {
+        m_strMasters[i] = NativeMethods.espMasterName(m_ptrPlugin, i, sbdName, sbdName.Capacity) >= 0
+                            ? sbdName.ToString()
+                            : "";
+      }
+    }
+
+    internal void Dispose()
+    {
+      if (m_ptrPlugin != IntPtr.Zero)
+      {
+        NativeMethods.espClose(m_ptrPlugin);
+        m_ptrPlugin = IntPtr.Zero;
+      }
+    }
+
+    /// <summary>
+    ///   Gets the position of a master in the plugin's master list.
+    /// </summary>
+    /// <param name="p_strPluginName">The file name of the master.</param>
+    /// <returns>The index of the master, or -1 if the plugin doesn't depend on it.</returns>
+    public Int32 GetMasterIndex(string p_strPluginName)
+    {
+      for (var i = 0; i < m_strMasters.Length; i++)
+      {
+        if (m_strMasters[i].ToLowerInvariant().Equals(p_strPluginName.ToLowerInvariant()))
+        {
+          return i;
+        }
+      }
+      return -1;
+    }
+
+    /// <summary>
+    ///   Determines whether the plugin has a record with the given form id.
+    /// </summary>
+    /// <param name="p_uintFormId">The form id, as the plugin refers to it.</param>
+    /// <returns><c>true</c> if the plugin has the record; <c>false</c> otherwise.</returns>
+    public bool ContainsFormId(UInt32 p_uintFormId)
+    {
+      return NativeMethods.espFind(m_ptrPlugin, p_uintFormId) >= 0;
+    }
+
+    /// <summary>
+    ///   Reads the data of the record with the given form id, inflating it if it is compressed.
+    /// </summary>
+    /// <param name="p_uintFormId">The form id, as the plugin refers to it.</param>
+    /// <returns>The record's subrecords, or <c>null</c> if the plugin has no such record.</returns>
+    public byte[] GetRecordData(UInt32 p_uintFormId)
+    {
+      var intIndex = NativeMethods.espFind(m_ptrPlugin, p_uintFormId);
+      return intIndex < 0 ? null : ReadRecord(intIndex);
+    }
+
+    /// <summary>
+    ///   Reads the data of a subrecord of the record of the given type with the given editor id.
+    /// </summary>
+    /// <param name="p_strType">The type of the record, such as MESG.</param>
+    /// <param name="p_strEditorId">The editor id of the record, matched exactly.</param>
+    /// <param name="p_strSubrecord">The type of the subrecord.</param>
+    /// <returns>
+    ///   The data of the first subrecord of the given type, or <c>null</c> if the plugin has no such record or the
+    ///   record has no such subrecord.
+    /// </returns>
+    public byte[] GetSubrecordData(string p_strType, string p_strEditorId, string p_strSubrecord)
+    {
+      var intIndex = NativeMethods.espFindEditorId(m_ptrPlugin, TypeCode(p_strType), p_strEditorId);
+      if (intIndex < 0)
+      {
+        return null;
+      }
+      var bteData = ReadRecord(intIndex);
+      var intCount = NativeMethods.espSubrecords(m_ptrPlugin, intIndex, null, 0);
+      if (intCount < 0)
+      {
+        throw new TESParserException("The " + p_strEditorId + " record in " + Name + " is damaged");
+      }
+      var subSubrecords = new NativeMethods.EspSubrecord[intCount];
+      NativeMethods.espSubrecords(m_ptrPlugin, intIndex, subSubrecords, subSubrecords.Length);
+      var uintType = TypeCode(p_strSubrecord);
+      foreach (var subSubrecord in subSubrecords)
+      {
+        if (subSubrecord.type == uintType)
+        {
+          var bteSubrecord = new byte[subSubrecord.size];
+          Array.Copy(bteData, subSubrecord.offset, bteSubrecord, 0, subSubrecord.size);
+          return bteSubrecord;
+        }
+      }
+      return null;
+    }
+
+    /// <summary>
+    ///   Copies the data of a compressed record into the given buffer.
+    /// </summary>
+    /// <remarks>
+    ///   Records are inflated across all cores a window at a time, starting with the first record asked for that
+    ///   is outside the current window, so reading the records in file order only inflates each once. Only one
+    ///   window is held at a time, which keeps the memory used bounded however large the plugin is.
+    /// </remarks>
+    /// <param name="p_intIndex">The index of the record among the plugin's groups and records, in file order.</param>
+    /// <param name="p_lngOffset">The position of the record's header in the plugin.</param>
+    /// <param name="p_bteBuffer">The buffer to fill.</param>
+    /// <param name="p_intLength">The size the record is expected to inflate to.</param>
+    /// <returns>
+    ///   <c>true</c> if the record's data was copied; <c>false</c> if the record at the given index doesn't start at
+    ///   the given position, doesn't inflate to the expected size or is damaged.
+    /// </returns>
+    internal bool ReadInflated(int p_intIndex, long p_lngOffset, byte[] p_bteBuffer, int p_intLength)
+    {
+      NativeMethods.EspEntry espEntry;
+      if (!NativeMethods.espEntryInfo(m_ptrPlugin, p_intIndex, out espEntry) || (espEntry.offset != p_lngOffset))
+      {
+        return false;
+      }
+      if ((p_intIndex < m_intWindowFirst) || (p_intIndex >= m_intWindowEnd))
+      {
+        //if there isn't the memory for a window, the record is inflated on its own
+        m_intWindowFirst = p_intIndex;
+        m_intWindowEnd = Math.Max(NativeMethods.espInflateWindow(m_ptrPlugin, p_intIndex), p_intIndex + 1);
+      }
+      return NativeMethods.espRecordData(m_ptrPlugin, p_intIndex, p_bteBuffer, p_intLength) == p_intLength;
+    }
+
+    private byte[] ReadRecord(int p_intIndex)
+    {
+      var intLength = NativeMethods.espRecordData(m_ptrPlugin, p_intIndex, null, 0);
+      if (intLength < 0)
+      {
+        throw new TESParserException("A record in " + Name + " is damaged");
+      }
+      var bteData = new byte[intLength];
+      if (NativeMethods.espRecordData(m_ptrPlugin, p_intIndex, bteData, intLength) < 0)
+      {
+        throw new TESParserException("A record in " + Name + " is damaged");
+      }
+      return bteData;
+    }
+
+    //record and subrecord types are stored as four characters, read here as a little endian number
+    private static UInt32 TypeCode(string p_strType)
+    {
+      return BitConverter.ToUInt32(Encoding.ASCII.GetBytes(p_strType), 0);
+    }
+  }
+}
@@ -0,0 +1,58 @@
+using System;
+using System.Collections.Generic;
+using System.IO;
+
+namespace Fomm.Games.Fallout3.Tools.TESsnip
+{
+  /// <summary>
+  ///   Merges plugins into one, so they take up a single place in the load order.
+  /// </summary>
+  /// <remarks>
+  ///   The work is done by the native espMerge, which reads the plugins without loading them. Records the plugins
+  ///   add are renumbered into the merged plugin, keeping their object ids where they don't clash, and every form id
+  ///   the record structures know of is rewritten to match. Masters the plugins share are listed once. Where the
+  ///   plugins hold the same record, the last one's is kept.
+  /// </remarks>
+  public static class PluginMerger
+  {
+    /// <summary>
+    ///   Merges plugins in the Data folder.
+    /// </summary>
+    /// <param name="p_lstPlugins">The file names of the plugins to merge, in load order.</param>
+    /// <param name="p_strMergedPath">The path of the merged plugin to write.</param>
+    /// <param name="p_strMappingPath">
+    ///   The path of a file to write the new form id of each of the plugins' records to, as tab separated plugin,
+    ///   form id and merged form id lines, or <c>null</c>.
+    /// </param>
+    /// <returns>The number of records written.</returns>
+    public static int Merge(IList<string> p_lstPlugins, string p_strMergedPath, string p_strMappingPath)
+    {
+      var strPlugins = new string[p_lstPlugins.Count];
+      p_lstPlugins.CopyTo(strPlugins, 0);
+      var rlyLayout = new RecordLayout();
+      int intResult;
+      try
+      {
+        intResult = NativeMethods.espMerge(Program.GameMode.PluginsPath, strPlugins, strPlugins.Length,
+                                           p_strMergedPath, rlyLayout.Handle, p_strMappingPath);
+      }
+      finally
+      {
+        rlyLayout.Dispose();
+      }
+      switch (intResult)
+      {
+        case -1:
+          throw new IOException("Unable to read the plugins " + String.Join(", ", strPlugins));
+        case -2:
+          throw new fommException(
+            "The plugins are for different games, or have too many masters or records to fit in one plugin.");
+        case -3:
+          throw new fommException("Corrupt record data in the plugins " + String.Join(", ", strPlugins));
+        case -4:
+          throw new IOException("Unable to write " + p_strMergedPath);
+      }
+      return intResult;
+    }
+  }
+}
@@ -0,0 +1,167 @@
+using System;
+using System.Collections.Generic;
+using System.IO;
+
+namespace Fomm.Games.Fallout3.Tools.TESsnip
+{
+  /// <summary>
+  ///   The record structures of <see cref="RecordStructure" />, compiled for the native plugin tools.
+  /// </summary>
+  /// <remarks>
+  ///   The structures are flattened into one blob that native code reads the fields of subrecords with, matching
+  ///   subrecords to structures the way TESsnip's editor does.
+  /// </remarks>
+  internal class RecordLayout
+  {
+    private const uint Magic = 0x31594C52;
+    private const uint IntOperand = 1;
+    private const uint FloatOperand = 2;
+    private const uint HasConditionals = 4;
+    private const uint Repeat = 1;
+    private const uint Optional = 2;
+
+    private IntPtr m_ptrLayouts;
+
+    /// <summary>
+    ///   Gets the native handle of the compiled layouts.
+    /// </summary>
+    /// <value>The native handle of the compiled layouts.</value>
+    internal IntPtr Handle
+    {
+      get
+      {
+        return m_ptrLayouts;
+      }
+    }
+
+    /// <summary>
+    ///   Compiles the record structures, loading them first if need be.
+    /// </summary>
+    internal RecordLayout()
+    {
+      if (!RecordStructure.Loaded)
+      {
+        RecordStructure.Load();
+      }
+      var bteBlob = Compile(RecordStructure.Records);
+      m_ptrLayouts = NativeMethods.layoutOpen(bteBlob, bteBlob.Length);
+      if (m_ptrLayouts == IntPtr.Zero)
+      {
+        throw new fommException("Unable to compile the record structures.");
+      }
+    }
+
+    internal void Dispose()
+    {
+      if (m_ptrLayouts != IntPtr.Zero)
+      {
+        NativeMethods.layoutClose(m_ptrLayouts);
+        m_ptrLayouts = IntPtr.Zero;
+      }
+    }
+
+    /// <summary>
+    ///   Flattens record structures into the blob read by the native layoutOpen.
+    /// </summary>
+    /// <param name="p_dicRecords">The record structures, by record type.</param>
+    /// <returns>The compiled blob.</returns>
+    internal static byte[] Compile(Dictionary<string, RecordStructure> p_dicRecords)
+    {
+      var mstRecords = new MemoryStream();
+      var mstSubrecords = new MemoryStream();
+      var mstElements = new MemoryStream();
+      var mstStrings = new MemoryStream();
+      var bwrRecords = new BinaryWriter(mstRecords);
+      var bwrSubrecords = new BinaryWriter(mstSubrecords);
+      var bwrElements = new BinaryWriter(mstElements);
+      uint uintSubrecordCount = 0;
+      uint uintElementCount = 0;
+      foreach (var kvpRecord in p_dicRecords)
+      {
+        bwrRecords.Write(TypeOf(kvpRecord.Key));
+        bwrRecords.Write(uintSubrecordCount);
+        bwrRecords.Write((uint) kvpRecord.Value.subrecords.Length);
+        foreach (var ssrSubrecord in kvpRecord.Value.subrecords)
+        {
+          uint uintFlags = 0;
+          int intOperand;
+          float fltOperand;
+          if (!int.TryParse(ssrSubrecord.CondOperand, out intOperand))
+          {
+            intOperand = 0;
+          }
+          else
+          {
+            uintFlags |= IntOperand;
+          }
+          if (!float.TryParse(ssrSubrecord.CondOperand, out fltOperand))
+          {
+            fltOperand = 0;
+          }
+          else
+          {
+            uintFlags |= FloatOperand;
+          }
+          if (ssrSubrecord.ContaintsConditionals)
+          {
+            uintFlags |= HasConditionals;
+          }
+          var strOperand = ssrSubrecord.CondOperand ?? "";
+          bwrSubrecords.Write(TypeOf(ssrSubrecord.name));
+          bwrSubrecords.Write((uint) ssrSubrecord.size);
+          bwrSubrecords.Write((uint) ssrSubrecord.repeat);
+          bwrSubrecords.Write((uint) ssrSubrecord.optional);
+          bwrSubrecords.Write((uint) ssrSubrecord.Condition);
+          bwrSubrecords.Write((uint) ssrSubrecord.CondID);
+          bwrSubrecords.Write(uintFlags);
+          bwrSubrecords.Write(intOperand);
+          bwrSubrecords.Write(fltOperand);
+          bwrSubrecords.Write((uint) mstStrings.Length);
+          bwrSubrecords.Write((uint) strOperand.Length);
+          bwrSubrecords.Write(uintElementCount);
+          bwrSubrecords.Write((uint) ssrSubrecord.elements.Length);
+          //the editor compares the operand with strings read a byte to a char
+          foreach (var chrOperand in strOperand)
+          {
+            mstStrings.WriteByte((byte) chrOperand);
+          }
+          foreach (var elsElement in ssrSubrecord.elements)
+          {
+            bwrElements.Write((uint) elsElement.type);
+            bwrElements.Write((uint) elsElement.CondID);
+            bwrElements.Write((elsElement.repeat ? Repeat : 0) | (elsElement.optional ? Optional : 0));
+          }
+          uintElementCount += (uint) ssrSubrecord.elements.Length;
+          uintSubrecordCount++;
+        }
+      }
+      var mstBlob = new MemoryStream();
+      var bwrBlob = new BinaryWriter(mstBlob);
+      bwrBlob.Write(Magic);
+      bwrBlob.Write((uint) p_dicRecords.Count);
+      bwrBlob.Write(uintSubrecordCount);
+      bwrBlob.Write(uintElementCount);
+      bwrBlob.Write((uint) mstStrings.Length);
+      bwrBlob.Write(mstRecords.ToArray());
+      bwrBlob.Write(mstSubrecords.ToArray());
+      bwrBlob.Write(mstElements.ToArray());
+      bwrBlob.Write(mstStrings.ToArray());
+      return mstBlob.ToArray();
+    }
+
+    /// <summary>
+    ///   Packs a record or subrecord type into the number native code compares types as.
+    /// </summary>
+    /// <param name="p_strName">The four character type.</param>
+    /// <returns>The packed type, or 0 if the type isn't four characters long.</returns>
+    internal static uint TypeOf(string p_strName)
+    {
+      if (p_strName.Length != 4)
+      {
+        return 0;
+      }
+      return (uint) ((byte) p_strName[0] | (byte) p_strName[1] << 8 | (byte) p_strName[2] << 16 |
+                     (byte) p_strName[3] << 24);
+    }
+  }
+}
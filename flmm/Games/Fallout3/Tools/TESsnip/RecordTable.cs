@@ -0,0 +1,177 @@
+using System;
+using System.Collections.Generic;
+
+namespace Fomm.Games.Fallout3.Tools.TESsnip
+{
+  /// <summary>
+  ///   Chosen fields of every record of one type in a plugin, decoded into an array each.
+  /// </summary>
+  /// <remarks>
+  ///   The records are decoded by the native tableOpen, across all cores, using the compiled record structures in
+  ///   place of <see cref="SubRecord.GetFormattedData" />. Each column holds one element of one subrecord structure,
+  ///   taken from the first subrecord matching the structure, so searching or reporting on the records is a scan
+  ///   over arrays.
+  /// </remarks>
+  internal class RecordTable
+  {
+    private IntPtr m_ptrTable;
+    private readonly UInt32[] m_uintFormIds;
+    private byte[] m_bteStrings;
+
+    /// <summary>
+    ///   Gets the form ids of the records.
+    /// </summary>
+    /// <value>The form ids of the records, in the order the plugin holds them.</value>
+    public UInt32[] FormIds
+    {
+      get
+      {
+        return m_uintFormIds;
+      }
+    }
+
+    /// <summary>
+    ///   Decodes the given fields of every record of a type.
+    /// </summary>
+    /// <param name="p_pdxPlugin">The plugin holding the records.</param>
+    /// <param name="p_rlyLayout">The compiled record structures.</param>
+    /// <param name="p_strType">The type of the records to decode.</param>
+    /// <param name="p_uintColumns">The fields to decode, each made by <see cref="Column" />.</param>
+    internal RecordTable(PluginIndex p_pdxPlugin, RecordLayout p_rlyLayout, string p_strType,
+                         IList<UInt32> p_uintColumns)
+    {
+      var uintColumns = new UInt32[p_uintColumns.Count];
+      p_uintColumns.CopyTo(uintColumns, 0);
+      m_ptrTable = NativeMethods.tableOpen(p_pdxPlugin.Handle, p_rlyLayout.Handle, RecordLayout.TypeOf(p_strType),
+                                           uintColumns, uintColumns.Length);
+      if (m_ptrTable == IntPtr.Zero)
+      {
+        throw new fommException("Unable to decode the " + p_strType + " records of " + p_pdxPlugin.Name);
+      }
+      m_uintFormIds = new UInt32[NativeMethods.tableRowCount(m_ptrTable)];
+      NativeMethods.tableFormIds(m_ptrTable, m_uintFormIds, m_uintFormIds.Length);
+    }
+
+    internal void Dispose()
+    {
+      if (m_ptrTable != IntPtr.Zero)
+      {
+        NativeMethods.tableClose(m_ptrTable);
+        m_ptrTable = IntPtr.Zero;
+      }
+    }
+
+    /// <summary>
+    ///   Names a field of a record type.
+    /// </summary>
+    /// <param name="p_intSubrecord">
+    ///   The index of the subrecord in the record type's <see cref="RecordStructure.subrecords" />.
+    /// </param>
+    /// <param name="p_intElement">The index of the element in the subrecord's elements.</param>
+    /// <returns>The column holding the field.</returns>
+    internal static UInt32 Column(int p_intSubrecord, int p_intElement)
+    {
+      return (UInt32) (p_intSubrecord << 16 | p_intElement);
+    }
+
+    /// <summary>
+    ///   Gets the raw values of a column.
+    /// </summary>
+    /// <remarks>
+    ///   Ints, floats and form ids are their four bytes, shorts are sign extended, bytes are zero extended, strings
+    ///   are their offsets in the table's strings and blobs are their sizes. Records lacking the field hold 0.
+    /// </remarks>
+    /// <param name="p_intColumn">The position of the column in those the table was made with.</param>
+    /// <returns>The values of the column, one for each record.</returns>
+    internal UInt32[] GetValues(int p_intColumn)
+    {
+      var uintValues = new UInt32[m_uintFormIds.Length];
+      NativeMethods.tableColumn(m_ptrTable, p_intColumn, uintValues, null, uintValues.Length);
+      return uintValues;
+    }
+
+    /// <summary>
+    ///   Gets which records have a column's field.
+    /// </summary>
+    /// <param name="p_intColumn">The position of the column in those the table was made with.</param>
+    /// <returns>Whether each record has the field.</returns>
+    internal bool[] GetPresent(int p_intColumn)
+    {
+      var uintValues = new UInt32[m_uintFormIds.Length];
+      var btePresent = new byte[m_uintFormIds.Length];
+      NativeMethods.tableColumn(m_ptrTable, p_intColumn, uintValues, btePresent, uintValues.Length);
+      var booPresent = new bool[btePresent.Length];
+      for (var i = 0; i < btePresent.Length; i++)
+      {
+        booPresent[i] = btePresent[i] != 0;
+      }
+      return booPresent;
+    }
+
+    /// <summary>
+    ///   Gets the values of an int, short or byte column.
+    /// </summary>
+    /// <param name="p_intColumn">The position of the column in those the table was made with.</param>
+    /// <returns>The values of the column, one for each record.</returns>
+    internal int[] GetInts(int p_intColumn)
+    {
+      var uintValues = GetValues(p_intColumn);
+      var intValues = new int[uintValues.Length];
+      for (var i = 0; i < uintValues.Length; i++)
+      {
+        intValues[i] = (int) uintValues[i];
+      }
+      return intValues;
+    }
+
+    /// <summary>
+    ///   Gets the values of a float column.
+    /// </summary>
+    /// <param name="p_intColumn">The position of the column in those the table was made with.</param>
+    /// <returns>The values of the column, one for each record.</returns>
+    internal float[] GetFloats(int p_intColumn)
+    {
+      var uintValues = GetValues(p_intColumn);
+      var fltValues = new float[uintValues.Length];
+      for (var i = 0; i < uintValues.Length; i++)
+      {
+        fltValues[i] = BitConverter.ToSingle(BitConverter.GetBytes(uintValues[i]), 0);
+      }
+      return fltValues;
+    }
+
+    /// <summary>
+    ///   Gets the values of a string column.
+    /// </summary>
+    /// <param name="p_intColumn">The position of the column in those the table was made with.</param>
+    /// <returns>The values of the column, one for each record, or <c>null</c> where a record lacks the field.</returns>
+    internal string[] GetStrings(int p_intColumn)
+    {
+      if (m_bteStrings == null)
+      {
+        m_bteStrings = new byte[NativeMethods.tableStrings(m_ptrTable, null, 0)];
+        NativeMethods.tableStrings(m_ptrTable, m_bteStrings, m_bteStrings.Length);
+      }
+      var uintValues = new UInt32[m_uintFormIds.Length];
+      var btePresent = new byte[m_uintFormIds.Length];
+      NativeMethods.tableColumn(m_ptrTable, p_intColumn, uintValues, btePresent, uintValues.Length);
+      var strValues = new string[uintValues.Length];
+      for (var i = 0; i < uintValues.Length; i++)
+      {
+        if (btePresent[i] == 0)
+        {
+          continue;
+        }
+        //strings are read a byte to a char, as the editor reads them
+        var intEnd = Array.IndexOf(m_bteStrings, (byte) 0, (int) uintValues[i]);
+        var chrValue = new char[intEnd - (int) uintValues[i]];
+        for (var j = 0; j < chrValue.Length; j++)
+        {
+          chrValue[j] = (char) m_bteStrings[uintValues[i] + j];
+        }
+        strValues[i] = new string(chrValue);
+      }
+      return strValues;
+    }
+  }
+}
@@ -0,0 +1,190 @@
+using System;
+using System.Collections.Generic;
+using System.IO;
+
+namespace Fomm.Games.Fallout3.Tools.TESsnip
+{
+  /// <summary>
+  ///   Tells which records of a load order refer to each record.
+  /// </summary>
+  /// <remarks>
+  ///   Every field the record structures mark as a form id is read once by the native refOpen, one plugin at a time,
+  ///   each across all cores.
+  ///   Form ids are resolved through each plugin's masters, so references are found no matter where the plugins sit
+  ///   in the load order.
+  ///
+  ///   The index is meant to be kept and queried many times. <see cref="IsCurrent"/> tells when the load order or one
+  ///   of the plugins has changed, and so when it has to be built again.
+  /// </remarks>
+  internal class ReferenceIndex
+  {
+    /// <summary>
+    ///   A record referring to another.
+    /// </summary>
+    internal struct Reference
+    {
+      /// <summary>
+      ///   The position in the load order of the plugin holding the referring record.
+      /// </summary>
+      public int Plugin;
+
+      /// <summary>
+      ///   The form id of the referring record, as its plugin refers to it.
+      /// </summary>
+      public UInt32 FormId;
+    }
+
+    private IntPtr m_ptrIndex;
+    private readonly string m_strDataPath;
+    private readonly string[] m_strPlugins;
+    private readonly DateTime[] m_dtmStamps;
+
+    /// <summary>
+    ///   Gets the indexed plugins.
+    /// </summary>
+    /// <value>The indexed plugins, in load order.</value>
+    public string[] Plugins
+    {
+      get
+      {
+        return m_strPlugins;
+      }
+    }
+
+    /// <summary>
+    ///   Gets the number of references between the records of all plugins.
+    /// </summary>
+    /// <value>The number of references between the records of all plugins.</value>
+    public int ReferenceCount
+    {
+      get
+      {
+        return NativeMethods.refReferenceCount(m_ptrIndex);
+      }
+    }
+
+    /// <summary>
+    ///   Indexes the given plugins.
+    /// </summary>
+    /// <param name="dataPath">The Data folder holding the plugins.</param>
+    /// <param name="plugins">The file names of the plugins, in load order.</param>
+    /// <param name="layouts">The compiled record structures to find form ids with.</param>
+    /// <param name="progress">Told after each plugin is read; returning <c>false</c> stops the indexing.</param>
+    internal ReferenceIndex(string dataPath, IList<string> plugins, RecordLayout layouts,
+                            NativeMethods.RefProgressDelegate progress)
+    {
+      m_strDataPath = dataPath;
+      m_strPlugins = new string[plugins.Count];
+      plugins.CopyTo(m_strPlugins, 0);
+      //the stamps are taken before the plugins are read, so a plugin written while they are is read again next time
+      m_dtmStamps = new DateTime[m_strPlugins.Length];
+      for (var i = 0; i < m_strPlugins.Length; i++)
+      {
+        m_dtmStamps[i] = GetStamp(i);
+      }
+      m_ptrIndex = NativeMethods.refOpen(dataPath, m_strPlugins, m_strPlugins.Length, layouts.Handle, progress);
+      if (m_ptrIndex == IntPtr.Zero)
+      {
+        throw new fommException("Unable to index the references in " + dataPath);
+      }
+    }
+
+    /// <summary>
+    ///   Indexes the given plugins in the current game's Data folder.
+    /// </summary>
+    /// <param name="plugins">The file names of the plugins, in load order.</param>
+    /// <param name="progress">Told after each plugin is read; returning <c>false</c> stops the indexing.</param>
+    /// <returns>The index of the given plugins.</returns>
+    internal static ReferenceIndex ForLoadOrder(IList<string> plugins, NativeMethods.RefProgressDelegate progress)
+    {
+      var rlyLayout = new RecordLayout();
+      try
+      {
+        return new ReferenceIndex(Program.GameMode.PluginsPath, plugins, rlyLayout, progress);
+      }
+      finally
+      {
+        rlyLayout.Dispose();
+      }
+    }
+
+    internal void Dispose()
+    {
+      if (m_ptrIndex != IntPtr.Zero)
+      {
+        NativeMethods.refClose(m_ptrIndex);
+        m_ptrIndex = IntPtr.Zero;
+      }
+    }
+
+    /// <summary>
+    ///   Determines whether the index still matches a load order.
+    /// </summary>
+    /// <param name="plugins">The file names of the plugins, in load order.</param>
+    /// <returns><c>true</c> if the index holds the given plugins in the given order, and none of them was written
+    ///   since they were indexed; <c>false</c> otherwise.</returns>
+    internal bool IsCurrent(IList<string> plugins)
+    {
+      if (plugins.Count != m_strPlugins.Length)
+      {
+        return false;
+      }
+      for (var i = 0; i < m_strPlugins.Length; i++)
+      {
+        if (!plugins[i].Equals(m_strPlugins[i], StringComparison.OrdinalIgnoreCase) || (GetStamp(i) != m_dtmStamps[i]))
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    private DateTime GetStamp(int plugin)
+    {
+      var fifPlugin = new FileInfo(Path.Combine(m_strDataPath, m_strPlugins[plugin]));
+      return fifPlugin.Exists ? fifPlugin.LastWriteTimeUtc : DateTime.MinValue;
+    }
+
+    /// <summary>
+    ///   Determines whether a plugin could be read.
+    /// </summary>
+    /// <param name="plugin">The position of the plugin in the load order.</param>
+    /// <returns><c>true</c> if the plugin's references are indexed; <c>false</c> if it is missing or damaged.</returns>
+    internal bool IsReadable(int plugin)
+    {
+      return NativeMethods.refPluginState(m_ptrIndex, plugin) >= 0;
+    }
+
+    /// <summary>
+    ///   Gets every record referring to a record.
+    /// </summary>
+    /// <param name="plugin">The position in the load order of the plugin referring to the record.</param>
+    /// <param name="formId">The form id of the record, as that plugin refers to it.</param>
+    /// <returns>The records referring to the record, in load order.</returns>
+    internal Reference[] GetReferences(int plugin, UInt32 formId)
+    {
+      var intCount = NativeMethods.refFind(m_ptrIndex, plugin, formId, null, null, 0);
+      var intPlugins = new int[intCount];
+      var uintFormIds = new UInt32[intCount];
+      NativeMethods.refFind(m_ptrIndex, plugin, formId, intPlugins, uintFormIds, intCount);
+      var refReferences = new Reference[intCount];
+      for (var i = 0; i < intCount; i++)
+      {
+        refReferences[i].Plugin = intPlugins[i];
+        refReferences[i].FormId = uintFormIds[i];
+      }
+      return refReferences;
+    }
+
+    /// <summary>
+    ///   Determines whether any record refers to a record, and so whether it is safe to delete.
+    /// </summary>
+    /// <param name="plugin">The position in the load order of the plugin referring to the record.</param>
+    /// <param name="formId">The form id of the record, as that plugin refers to it.</param>
+    /// <returns><c>true</c> if some record refers to the record; <c>false</c> otherwise.</returns>
+    internal bool IsReferenced(int plugin, UInt32 formId)
+    {
+      return NativeMethods.refFind(m_ptrIndex, plugin, formId, null, null, 0) > 0;
+    }
+  }
+}
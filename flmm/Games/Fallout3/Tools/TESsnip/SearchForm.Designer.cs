@@ -32,6 +32,9 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip {
             this.rbFormID = new System.Windows.Forms.RadioButton();
             this.rbAll = new System.Windows.Forms.RadioButton();
             this.label1 = new System.Windows.Forms.Label();
+            this.rbName = new System.Windows.Forms.RadioButton();
+            this.tbType = new System.Windows.Forms.TextBox();
+            this.label2 = new System.Windows.Forms.Label();
             this.SuspendLayout();
             // 
             // tbSearch
@@ -44,7 +47,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip {
             // cbPartial
             // 
             this.cbPartial.AutoSize = true;
-            this.cbPartial.Location = new System.Drawing.Point(12, 107);
+            this.cbPartial.Location = new System.Drawing.Point(12, 130);
             this.cbPartial.Name = "cbPartial";
             this.cbPartial.Size = new System.Drawing.Size(120, 17);
             this.cbPartial.TabIndex = 1;
@@ -54,7 +57,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip {
             // cbSelectedNode
             // 
             this.cbSelectedNode.AutoSize = true;
-            this.cbSelectedNode.Location = new System.Drawing.Point(12, 130);
+            this.cbSelectedNode.Location = new System.Drawing.Point(12, 153);
             this.cbSelectedNode.Name = "cbSelectedNode";
             this.cbSelectedNode.Size = new System.Drawing.Size(176, 17);
             this.cbSelectedNode.TabIndex = 2;
@@ -63,7 +66,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip {
             // 
             // bFind
             // 
-            this.bFind.Location = new System.Drawing.Point(142, 153);
+            this.bFind.Location = new System.Drawing.Point(142, 176);
             this.bFind.Name = "bFind";
             this.bFind.Size = new System.Drawing.Size(75, 23);
             this.bFind.TabIndex = 3;
@@ -73,7 +76,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip {
             // 
             // bReset
             // 
-            this.bReset.Location = new System.Drawing.Point(12, 153);
+            this.bReset.Location = new System.Drawing.Point(12, 176);
             this.bReset.Name = "bReset";
             this.bReset.Size = new System.Drawing.Size(75, 23);
             this.bReset.TabIndex = 4;
@@ -108,7 +111,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip {
             // rbAll
             // 
             this.rbAll.AutoSize = true;
-            this.rbAll.Location = new System.Drawing.Point(12, 84);
+            this.rbAll.Location = new System.Drawing.Point(12, 107);
             this.rbAll.Name = "rbAll";
             this.rbAll.Size = new System.Drawing.Size(91, 17);
             this.rbAll.TabIndex = 7;
@@ -125,11 +128,42 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip {
             this.label1.TabIndex = 8;
             this.label1.Text = "Search type";
             // 
+            // rbName
+            // 
+            this.rbName.AutoSize = true;
+            this.rbName.Location = new System.Drawing.Point(12, 84);
+            this.rbName.Name = "rbName";
+            this.rbName.Size = new System.Drawing.Size(76, 17);
+            this.rbName.TabIndex = 9;
+            this.rbName.TabStop = true;
+            this.rbName.Text = "Full names";
+            this.rbName.UseVisualStyleBackColor = true;
+            // 
+            // tbType
+            // 
+            this.tbType.Location = new System.Drawing.Point(142, 107);
+            this.tbType.MaxLength = 4;
+            this.tbType.Name = "tbType";
+            this.tbType.Size = new System.Drawing.Size(75, 20);
+            this.tbType.TabIndex = 10;
+            // 
+            // label2
+            // 
+            this.label2.AutoSize = true;
+            this.label2.Location = new System.Drawing.Point(139, 91);
+            this.label2.Name = "label2";
+            this.label2.Size = new System.Drawing.Size(64, 13);
+            this.label2.TabIndex = 11;
+            this.label2.Text = "Record type";
+            // 
             // SearchForm
             // 
             this.AutoScaleDimensions = new System.Drawing.SizeF(6F, 13F);
             this.AutoScaleMode = System.Windows.Forms.AutoScaleMode.Font;
-            this.ClientSize = new System.Drawing.Size(229, 187);
+            this.ClientSize = new System.Drawing.Size(229, 210);
+            this.Controls.Add(this.label2);
+            this.Controls.Add(this.tbType);
+            this.Controls.Add(this.rbName);
             this.Controls.Add(this.label1);
             this.Controls.Add(this.rbAll);
             this.Controls.Add(this.rbFormID);
@@ -159,5 +193,8 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip {
         private System.Windows.Forms.RadioButton rbFormID;
         private System.Windows.Forms.RadioButton rbAll;
         private System.Windows.Forms.Label label1;
+        private System.Windows.Forms.RadioButton rbName;
+        private System.Windows.Forms.TextBox tbType;
+        private System.Windows.Forms.Label label2;
     }
 }
\ No newline at end of file
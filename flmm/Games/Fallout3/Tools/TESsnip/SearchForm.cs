@@ -9,6 +9,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
   partial class SearchForm : Form
   {
     private TreeView tv;
+    private SearchIndex index;
     private TreeNode[] foundNodes;
     private int pos;
     private string searchString;
@@ -22,87 +23,27 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       }
     }
 
-    public SearchForm(TreeView list)
+    public SearchForm(TreeView list, SearchIndex index)
     {
       InitializeComponent();
       Icon = Resources.fomm02;
       bReset.Enabled = false;
       tv = list;
+      this.index = index;
     }
 
-    private void RecurseFullSearch(List<TreeNode> matches, TreeNode node)
-    {
-      var rec = node.Tag as Record;
-      if (rec != null)
-      {
-        foreach (var sr in rec.SubRecords)
-        {
-          if (cbPartial.Checked)
-          {
-            if (sr.GetStrData().ToLowerInvariant().Contains(searchString))
-            {
-              matches.Add(node);
-            }
-          }
-          else
-          {
-            if (sr.GetStrData().ToLowerInvariant() == searchString)
-            {
-              matches.Add(node);
-            }
-          }
-        }
-      }
-      else
-      {
-        for (var i = 0; i < node.Nodes.Count; i++)
-        {
-          RecurseFullSearch(matches, node.Nodes[i]);
-        }
-      }
-    }
-
-    private void RecurseSearch(List<TreeNode> matches, TreeNode node)
+    private bool PerformSearch()
     {
-      var rec = node.Tag as Record;
-      if (rec != null)
-      {
-        if (rbFormID.Checked)
-        {
-          if (rec.FormID == searchID)
-          {
-            matches.Add(node);
-          }
-        }
-        else if (rec.descriptiveName != null)
-        {
-          if (cbPartial.Checked)
-          {
-            if (rec.descriptiveName.ToLowerInvariant().Contains(searchString))
-            {
-              matches.Add(node);
-            }
-          }
-          else
-          {
-            if (rec.descriptiveName.ToLowerInvariant().Substring(2, rec.descriptiveName.Length - 3) == searchString)
-            {
-              matches.Add(node);
-            }
-          }
-        }
-      }
-      else
+      uint searchType = 0;
+      if (tbType.Text.Length > 0)
       {
-        for (var i = 0; i < node.Nodes.Count; i++)
+        if (tbType.Text.Length != 4)
         {
-          RecurseSearch(matches, node.Nodes[i]);
+          MessageBox.Show("Invalid record type");
+          return false;
         }
+        searchType = RecordLayout.TypeOf(tbType.Text.ToUpperInvariant());
       }
-    }
-
-    private bool PerformSearch()
-    {
       if (rbFormID.Checked)
       {
         if (!uint.TryParse(tbSearch.Text, NumberStyles.AllowHexSpecifier, null, out searchID))
@@ -113,38 +54,47 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       }
       else
       {
-        searchString = tbSearch.Text.ToLowerInvariant();
+        searchString = tbSearch.Text;
+      }
+      if (cbSelectedNode.Checked && tv.SelectedNode == null)
+      {
+        MessageBox.Show("No node selected");
+        return false;
       }
-      var matches = new List<TreeNode>();
 
-      if (cbSelectedNode.Checked)
+      List<TreeNode> found;
+      try
       {
-        if (tv.SelectedNode == null)
+        index.Refresh(tv);
+        if (rbFormID.Checked)
         {
-          MessageBox.Show("No node selected");
-          return false;
+          found = index.FindFormId(tv, searchID, searchType);
+        }
+        else if (rbName.Checked)
+        {
+          found = index.FindText(tv, SearchIndex.Field.Name, searchString, cbPartial.Checked, searchType);
         }
-        if (rbAll.Checked)
+        else if (rbAll.Checked)
         {
-          RecurseFullSearch(matches, tv.SelectedNode);
+          found = index.FindText(tv, SearchIndex.Field.AllSubrecords, searchString, cbPartial.Checked, searchType);
         }
         else
         {
-          RecurseSearch(matches, tv.SelectedNode);
+          found = index.FindText(tv, SearchIndex.Field.EditorId, searchString, cbPartial.Checked, searchType);
         }
       }
-      else
+      catch (fommException ex)
       {
-        for (var i = 0; i < tv.Nodes.Count; i++)
+        MessageBox.Show(ex.Message, "Error");
+        return false;
+      }
+
+      var matches = new List<TreeNode>();
+      foreach (var node in found)
+      {
+        if (!cbSelectedNode.Checked || IsUnder(node, tv.SelectedNode))
         {
-          if (rbAll.Checked)
-          {
-            RecurseFullSearch(matches, tv.Nodes[i]);
-          }
-          else
-          {
-            RecurseSearch(matches, tv.Nodes[i]);
-          }
+          matches.Add(node);
         }
       }
 
@@ -157,6 +107,18 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       return true;
     }
 
+    private static bool IsUnder(TreeNode node, TreeNode parent)
+    {
+      for (; node != null; node = node.Parent)
+      {
+        if (node == parent)
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
     private void bFind_Click(object sender, EventArgs e)
     {
       if (foundNodes == null)
@@ -168,6 +130,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
           bReset.Enabled = true;
           bFind.Text = "Next";
           tbSearch.Enabled = false;
+          tbType.Enabled = false;
           tv.SelectedNode = foundNodes[0];
           pos = 0;
         }
@@ -191,6 +154,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       bReset.Enabled = false;
       bFind.Text = "Find";
       tbSearch.Enabled = true;
+      tbType.Enabled = true;
     }
 
     private void cbFormID_CheckedChanged(object sender, EventArgs e)
@@ -0,0 +1,254 @@
+using System;
+using System.Collections.Generic;
+using System.Windows.Forms;
+
+namespace Fomm.Games.Fallout3.Tools.TESsnip
+{
+  /// <summary>
+  ///   Finds records in the plugins TESsnip has open without formatting their data for every search.
+  /// </summary>
+  /// <remarks>
+  ///   The form id, type, editor id, full name and subrecord strings of each plugin's records are handed to the
+  ///   native srchAdd once, and searched natively from then on. TESsnip marks a plugin dirty whenever it edits it,
+  ///   and only dirty plugins are indexed again before a search, so searching never walks the plugin trees.
+  /// </remarks>
+  internal class SearchIndex
+  {
+    /// <summary>
+    ///   The fields text can be searched for in.
+    /// </summary>
+    internal enum Field
+    {
+      EditorId = 0,
+      Name = 1,
+      AllSubrecords = 2
+    }
+
+    private class PluginEntry
+    {
+      public IntPtr Index;
+      public TreeNode[] Nodes;
+    }
+
+    private readonly Dictionary<TreeNode, PluginEntry> m_dicPlugins = new Dictionary<TreeNode, PluginEntry>();
+    private readonly Dictionary<TreeNode, bool> m_dicDirty = new Dictionary<TreeNode, bool>();
+
+    /// <summary>
+    ///   Marks the plugin holding a node as edited, so it is indexed again before the next search.
+    /// </summary>
+    /// <param name="p_tndNode">The tree node of the plugin, or of any group or record in it.</param>
+    internal void MarkDirty(TreeNode p_tndNode)
+    {
+      while (p_tndNode.Parent != null)
+      {
+        p_tndNode = p_tndNode.Parent;
+      }
+      m_dicDirty[p_tndNode] = true;
+    }
+
+    /// <summary>
+    ///   Indexes every plugin in a tree that isn't indexed or was marked dirty, and forgets plugins no longer in it.
+    /// </summary>
+    /// <param name="p_tvwPlugins">The tree of plugins.</param>
+    internal void Refresh(TreeView p_tvwPlugins)
+    {
+      var setRoots = new Dictionary<TreeNode, bool>();
+      foreach (TreeNode tndPlugin in p_tvwPlugins.Nodes)
+      {
+        setRoots[tndPlugin] = true;
+        if (!m_dicPlugins.ContainsKey(tndPlugin) || m_dicDirty.ContainsKey(tndPlugin))
+        {
+          Index(tndPlugin);
+        }
+      }
+      foreach (var tndGone in new List<TreeNode>(m_dicPlugins.Keys))
+      {
+        if (!setRoots.ContainsKey(tndGone))
+        {
+          NativeMethods.srchClose(m_dicPlugins[tndGone].Index);
+          m_dicPlugins.Remove(tndGone);
+        }
+      }
+      m_dicDirty.Clear();
+    }
+
+    /// <summary>
+    ///   Indexes a plugin, replacing any index it already has.
+    /// </summary>
+    /// <param name="p_tndPlugin">The tree node of the plugin.</param>
+    private void Index(TreeNode p_tndPlugin)
+    {
+      PluginEntry pleEntry;
+      if (m_dicPlugins.TryGetValue(p_tndPlugin, out pleEntry))
+      {
+        NativeMethods.srchClose(pleEntry.Index);
+        m_dicPlugins.Remove(p_tndPlugin);
+      }
+      m_dicDirty.Remove(p_tndPlugin);
+      var lstNodes = new List<TreeNode>();
+      CollectRecords(p_tndPlugin, lstNodes);
+      pleEntry = new PluginEntry();
+      pleEntry.Nodes = lstNodes.ToArray();
+      pleEntry.Index = NativeMethods.srchOpen();
+      if (pleEntry.Index == IntPtr.Zero)
+      {
+        throw new fommException("Unable to index " + p_tndPlugin.Text);
+      }
+      var bteText = new byte[4096];
+      var booIndexed = true;
+      for (var i = 0; i < lstNodes.Count && booIndexed; i++)
+      {
+        booIndexed = AddRecord(pleEntry.Index, (Record) lstNodes[i].Tag, ref bteText);
+      }
+      if (!booIndexed || !NativeMethods.srchBuild(pleEntry.Index))
+      {
+        NativeMethods.srchClose(pleEntry.Index);
+        throw new fommException("Unable to index " + p_tndPlugin.Text);
+      }
+      m_dicPlugins[p_tndPlugin] = pleEntry;
+    }
+
+    /// <summary>
+    ///   Hands a record to the native index.
+    /// </summary>
+    /// <returns><c>true</c> if the record was added; <c>false</c> if there wasn't the memory.</returns>
+    private static bool AddRecord(IntPtr p_ptrIndex, Record p_recRecord, ref byte[] p_bteText)
+    {
+      var intLength = 0;
+      byte[] bteName = null;
+      foreach (var srcSubrecord in p_recRecord.SubRecords)
+      {
+        var bteData = srcSubrecord.GetReadonlyData();
+        var intEnd = Array.IndexOf(bteData, (byte) 0);
+        if (intEnd < 0)
+        {
+          intEnd = bteData.Length;
+        }
+        if ((bteName == null) && (srcSubrecord.Name == "FULL"))
+        {
+          bteName = new byte[intEnd];
+          Array.Copy(bteData, bteName, intEnd);
+        }
+        if (intLength + intEnd + 1 > p_bteText.Length)
+        {
+          Array.Resize(ref p_bteText, Math.Max(p_bteText.Length * 2, intLength + intEnd + 1));
+        }
+        Array.Copy(bteData, 0, p_bteText, intLength, intEnd);
+        p_bteText[intLength + intEnd] = 0;
+        intLength += intEnd + 1;
+      }
+      //the editor id is as the tree shows it, which TESsnip keeps up to date as EDIDs are edited
+      var strDescriptiveName = p_recRecord.descriptiveName;
+      byte[] bteEditorId = null;
+      if ((strDescriptiveName != null) && (strDescriptiveName.Length >= 3))
+      {
+        bteEditorId = ToBytes(strDescriptiveName.Substring(2, strDescriptiveName.Length - 3));
+      }
+      return NativeMethods.srchAdd(p_ptrIndex, p_recRecord.FormID, RecordLayout.TypeOf(p_recRecord.Name), bteEditorId,
+                                   bteEditorId == null ? -1 : bteEditorId.Length, bteName,
+                                   bteName == null ? -1 : bteName.Length, p_bteText, intLength);
+    }
+
+    private static void CollectRecords(TreeNode p_tndNode, List<TreeNode> p_lstNodes)
+    {
+      if (p_tndNode.Tag is Record)
+      {
+        p_lstNodes.Add(p_tndNode);
+        return;
+      }
+      foreach (TreeNode tndChild in p_tndNode.Nodes)
+      {
+        CollectRecords(tndChild, p_lstNodes);
+      }
+    }
+
+    /// <summary>
+    ///   Converts text to the bytes the editor reads it from, a byte to a char.
+    /// </summary>
+    /// <returns>The bytes, or <c>null</c> if the text holds a char no byte reads as.</returns>
+    private static byte[] ToBytes(string p_strText)
+    {
+      var bteText = new byte[p_strText.Length];
+      for (var i = 0; i < p_strText.Length; i++)
+      {
+        if (p_strText[i] > 0xff)
+        {
+          return null;
+        }
+        bteText[i] = (byte) p_strText[i];
+      }
+      return bteText;
+    }
+
+    /// <summary>
+    ///   Finds the records with a form id in the plugins of a tree.
+    /// </summary>
+    /// <param name="p_tvwPlugins">The tree of plugins, which must have been refreshed.</param>
+    /// <param name="p_uintFormId">The form id to find.</param>
+    /// <param name="p_uintType">The record type to find, as made by <see cref="RecordLayout.TypeOf" />, or 0.</param>
+    /// <returns>The tree nodes of the records found, in tree order.</returns>
+    internal List<TreeNode> FindFormId(TreeView p_tvwPlugins, uint p_uintFormId, uint p_uintType)
+    {
+      var lstFound = new List<TreeNode>();
+      foreach (TreeNode tndPlugin in p_tvwPlugins.Nodes)
+      {
+        var pleEntry = m_dicPlugins[tndPlugin];
+        var intRecords = new int[NativeMethods.srchFindFormId(pleEntry.Index, p_uintFormId, p_uintType, null, 0)];
+        NativeMethods.srchFindFormId(pleEntry.Index, p_uintFormId, p_uintType, intRecords, intRecords.Length);
+        foreach (var intRecord in intRecords)
+        {
+          lstFound.Add(pleEntry.Nodes[intRecord]);
+        }
+      }
+      return lstFound;
+    }
+
+    /// <summary>
+    ///   Finds the records whose text matches, ignoring case, in the plugins of a tree.
+    /// </summary>
+    /// <param name="p_tvwPlugins">The tree of plugins, which must have been refreshed.</param>
+    /// <param name="p_fldField">The field to look in.</param>
+    /// <param name="p_strText">The text to find.</param>
+    /// <param name="p_booPartial">Whether the field need only contain the text.</param>
+    /// <param name="p_uintType">The record type to find, as made by <see cref="RecordLayout.TypeOf" />, or 0.</param>
+    /// <returns>The tree nodes of the records found, in tree order.</returns>
+    internal List<TreeNode> FindText(TreeView p_tvwPlugins, Field p_fldField, string p_strText, bool p_booPartial,
+                                     uint p_uintType)
+    {
+      var lstFound = new List<TreeNode>();
+      var bteText = ToBytes(p_strText);
+      if (bteText == null)
+      {
+        return lstFound;
+      }
+      foreach (TreeNode tndPlugin in p_tvwPlugins.Nodes)
+      {
+        var pleEntry = m_dicPlugins[tndPlugin];
+        var intCount = NativeMethods.srchFindText(pleEntry.Index, (int) p_fldField, bteText, bteText.Length,
+                                                  p_booPartial, p_uintType, null, 0);
+        if (intCount < 0)
+        {
+          throw new fommException("The search text is too long.");
+        }
+        var intRecords = new int[intCount];
+        NativeMethods.srchFindText(pleEntry.Index, (int) p_fldField, bteText, bteText.Length, p_booPartial,
+                                   p_uintType, intRecords, intRecords.Length);
+        foreach (var intRecord in intRecords)
+        {
+          lstFound.Add(pleEntry.Nodes[intRecord]);
+        }
+      }
+      return lstFound;
+    }
+
+    internal void Dispose()
+    {
+      foreach (var pleEntry in m_dicPlugins.Values)
+      {
+        NativeMethods.srchClose(pleEntry.Index);
+      }
+      m_dicPlugins.Clear();
+      m_dicDirty.Clear();
+    }
+  }
+}
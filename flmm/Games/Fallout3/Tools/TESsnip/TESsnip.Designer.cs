@@ -49,7 +49,9 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip {
       this.sanitizeToolStripMenuItem = new System.Windows.Forms.ToolStripMenuItem();
       this.stripEDIDsToolStripMenuItem = new System.Windows.Forms.ToolStripMenuItem();
       this.findDuplicatedFormIDToolStripMenuItem = new System.Windows.Forms.ToolStripMenuItem();
+      this.findReferencesToolStripMenuItem = new System.Windows.Forms.ToolStripMenuItem();
       this.dumpEDIDListToolStripMenuItem = new System.Windows.Forms.ToolStripMenuItem();
+      this.exportRecordTableToolStripMenuItem = new System.Windows.Forms.ToolStripMenuItem();
       this.cleanEspToolStripMenuItem = new System.Windows.Forms.ToolStripMenuItem();
       this.findNonconformingRecordToolStripMenuItem = new System.Windows.Forms.ToolStripMenuItem();
       this.compileScriptToolStripMenuItem = new System.Windows.Forms.ToolStripMenuItem();
@@ -66,6 +68,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip {
       this.columnHeader1 = new System.Windows.Forms.ColumnHeader();
       this.columnHeader2 = new System.Windows.Forms.ColumnHeader();
       this.SaveEdidListDialog = new System.Windows.Forms.SaveFileDialog();
+      this.SaveRecordTableDialog = new System.Windows.Forms.SaveFileDialog();
       this.menuStrip1.SuspendLayout();
       this.splitContainer1.Panel1.SuspendLayout();
       this.splitContainer1.Panel2.SuspendLayout();
@@ -285,7 +288,9 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip {
             this.sanitizeToolStripMenuItem,
             this.stripEDIDsToolStripMenuItem,
             this.findDuplicatedFormIDToolStripMenuItem,
+            this.findReferencesToolStripMenuItem,
             this.dumpEDIDListToolStripMenuItem,
+            this.exportRecordTableToolStripMenuItem,
             this.cleanEspToolStripMenuItem,
             this.findNonconformingRecordToolStripMenuItem,
             this.compileScriptToolStripMenuItem,
@@ -318,6 +323,13 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip {
       this.findDuplicatedFormIDToolStripMenuItem.Text = "Find duplicated FormID";
       this.findDuplicatedFormIDToolStripMenuItem.Click += new System.EventHandler(this.findDuplicatedFormIDToolStripMenuItem_Click);
       // 
+      // findReferencesToolStripMenuItem
+      // 
+      this.findReferencesToolStripMenuItem.Name = "findReferencesToolStripMenuItem";
+      this.findReferencesToolStripMenuItem.Size = new System.Drawing.Size(221, 22);
+      this.findReferencesToolStripMenuItem.Text = "Find references in load order";
+      this.findReferencesToolStripMenuItem.Click += new System.EventHandler(this.findReferencesToolStripMenuItem_Click);
+      // 
       // dumpEDIDListToolStripMenuItem
       // 
       this.dumpEDIDListToolStripMenuItem.Name = "dumpEDIDListToolStripMenuItem";
@@ -325,6 +337,13 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip {
       this.dumpEDIDListToolStripMenuItem.Text = "Dump EDID list";
       this.dumpEDIDListToolStripMenuItem.Click += new System.EventHandler(this.dumpEDIDListToolStripMenuItem_Click);
       // 
+      // exportRecordTableToolStripMenuItem
+      // 
+      this.exportRecordTableToolStripMenuItem.Name = "exportRecordTableToolStripMenuItem";
+      this.exportRecordTableToolStripMenuItem.Size = new System.Drawing.Size(221, 22);
+      this.exportRecordTableToolStripMenuItem.Text = "Export record table";
+      this.exportRecordTableToolStripMenuItem.Click += new System.EventHandler(this.exportRecordTableToolStripMenuItem_Click);
+      // 
       // cleanEspToolStripMenuItem
       // 
       this.cleanEspToolStripMenuItem.Name = "cleanEspToolStripMenuItem";
@@ -475,6 +494,13 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip {
       this.SaveEdidListDialog.RestoreDirectory = true;
       this.SaveEdidListDialog.Title = "Save file as";
       // 
+      // SaveRecordTableDialog
+      // 
+      this.SaveRecordTableDialog.DefaultExt = "csv";
+      this.SaveRecordTableDialog.Filter = "CSV file (*.csv)|*.csv";
+      this.SaveRecordTableDialog.RestoreDirectory = true;
+      this.SaveRecordTableDialog.Title = "Save file as";
+      // 
       // TESsnip
       // 
       this.AutoScaleDimensions = new System.Drawing.SizeF(6F, 13F);
@@ -533,9 +559,12 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip {
         private System.Windows.Forms.ToolStripMenuItem sanitizeToolStripMenuItem;
         private System.Windows.Forms.ToolStripMenuItem stripEDIDsToolStripMenuItem;
         private System.Windows.Forms.ToolStripMenuItem findDuplicatedFormIDToolStripMenuItem;
+        private System.Windows.Forms.ToolStripMenuItem findReferencesToolStripMenuItem;
         private System.Windows.Forms.ToolStripMenuItem useNewSubrecordEditorToolStripMenuItem;
         private System.Windows.Forms.ToolStripMenuItem dumpEDIDListToolStripMenuItem;
         private System.Windows.Forms.SaveFileDialog SaveEdidListDialog;
+        private System.Windows.Forms.ToolStripMenuItem exportRecordTableToolStripMenuItem;
+        private System.Windows.Forms.SaveFileDialog SaveRecordTableDialog;
         private System.Windows.Forms.ToolStripMenuItem reloadXmlToolStripMenuItem;
         private System.Windows.Forms.ToolStripMenuItem lookupFormidsToolStripMenuItem;
         private System.Windows.Forms.ToolStripMenuItem cleanEspToolStripMenuItem;
@@ -21,6 +21,8 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
     private bool SelectedSubrecord;
     private Record parentRecord;
     private SearchForm searchForm;
+    private readonly SearchIndex searchIndex = new SearchIndex();
+    private ReferenceIndex referenceIndex;
     private SubrecordStructure[] SubrecordStructs;
     private Plugin[] FormIDLookup;
     private uint[] Fixups;
@@ -127,6 +129,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
         return;
       }
       PluginTree.Nodes.Clear();
+      searchIndex.Dispose();
       Clipboard = null;
       ClipboardNode = null;
       GC.Collect();
@@ -485,11 +488,13 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
         {
           return;
         }
+        searchIndex.MarkDirty(PluginTree.SelectedNode);
         parentRecord.SubRecords.RemoveAt(listView1.SelectedIndices[0]);
         listView1.Items.RemoveAt(listView1.SelectedIndices[0]);
       }
       else
       {
+        searchIndex.MarkDirty(PluginTree.SelectedNode);
         if (PluginTree.SelectedNode.Parent != null)
         {
           var parent = (BaseRecord) PluginTree.SelectedNode.Parent.Tag;
@@ -589,6 +594,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       try
       {
         node.AddRecord(Clipboard);
+        searchIndex.MarkDirty(PluginTree.SelectedNode);
         Clipboard = Clipboard.Clone();
         if (ClipboardNode != null)
         {
@@ -647,6 +653,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       {
         var r = (Record) PluginTree.SelectedNode.Tag;
         HeaderEditor.Display(r);
+        searchIndex.MarkDirty(PluginTree.SelectedNode);
         PluginTree.SelectedNode.Text = r.DescriptiveName;
         tbInfo.Text = ((BaseRecord) PluginTree.SelectedNode.Tag).GetDesc();
       }
@@ -710,6 +717,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
         if (re != null)
         {
           re.ShowDialog();
+          searchIndex.MarkDirty(PluginTree.SelectedNode);
           tbInfo.Text = sr.GetFormattedData(SubrecordStructs[listView1.SelectedIndices[0]], LookupFormIDI);
           if (sr.Name == "EDID" && listView1.SelectedIndices[0] == 0)
           {
@@ -728,6 +736,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
 
         if (!HexDataEdit.Canceled)
         {
+          searchIndex.MarkDirty(PluginTree.SelectedNode);
           sr.SetData(HexDataEdit.result);
           sr.Name = HexDataEdit.resultName;
           listView1.SelectedItems[0].Text = sr.Name;
@@ -743,6 +752,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
 
         if (!DataEdit.Canceled)
         {
+          searchIndex.MarkDirty(PluginTree.SelectedNode);
           sr.SetData(DataEdit.result);
           sr.Name = DataEdit.resultName;
           listView1.SelectedItems[0].Text = sr.Name;
@@ -768,6 +778,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       var node = (BaseRecord) PluginTree.SelectedNode.Tag;
       var p = new Record();
       node.AddRecord(p);
+      searchIndex.MarkDirty(PluginTree.SelectedNode);
       var tn = new TreeNode(p.Name);
       tn.Tag = p;
       PluginTree.SelectedNode.Nodes.Add(tn);
@@ -783,6 +794,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       var node = (BaseRecord) PluginTree.SelectedNode.Tag;
       var p = new SubRecord();
       node.AddRecord(p);
+      searchIndex.MarkDirty(PluginTree.SelectedNode);
       PluginTree_AfterSelect(null, null);
     }
 
@@ -795,7 +807,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       else
       {
         spellsToolStripMenuItem.Enabled = false;
-        searchForm = new SearchForm(PluginTree);
+        searchForm = new SearchForm(PluginTree, searchIndex);
         searchForm.FormClosed += searchForm_FormClosed;
         searchForm.Show();
       }
@@ -814,6 +826,12 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
         searchForm.Close();
       }
       PluginTree.Nodes.Clear();
+      searchIndex.Dispose();
+      if (referenceIndex != null)
+      {
+        referenceIndex.Dispose();
+        referenceIndex = null;
+      }
       Clipboard = null;
       ClipboardNode = null;
       parentRecord = null;
@@ -910,6 +928,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       {
         return;
       }
+      searchIndex.MarkDirty(PluginTree.SelectedNode);
       PluginTree_AfterSelect(null, null);
     }
 
@@ -975,6 +994,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
         return;
       }
 
+      searchIndex.MarkDirty(tn);
       tn.Nodes.Clear();
       p.Records.Clear();
       p.AddRecord(toParse.Dequeue());
@@ -1122,6 +1142,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
         tn = tn.Parent;
       }
       var p = (Plugin) tn.Tag;
+      searchIndex.MarkDirty(tn);
       foreach (var r in p.Records)
       {
         StripEDIDspublic(r);
@@ -1170,6 +1191,125 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       ids.Clear();
     }
 
+    private void findReferencesToolStripMenuItem_Click(object sender, EventArgs e)
+    {
+      if (PluginTree.SelectedNode == null || !(PluginTree.SelectedNode.Tag is Record))
+      {
+        MessageBox.Show("No record selected", "Error");
+        return;
+      }
+      var r = (Record) PluginTree.SelectedNode.Tag;
+      var tn = PluginTree.SelectedNode;
+      while (!(tn.Tag is Plugin))
+      {
+        tn = tn.Parent;
+      }
+      var p = (Plugin) tn.Tag;
+      var plugins =
+        new List<string>(Program.GameMode.PluginManager.SortPluginList(Program.GameMode.PluginManager.ActivePluginList));
+      var position = -1;
+      for (var i = 0; i < plugins.Count; i++)
+      {
+        plugins[i] = Path.GetFileName(plugins[i]);
+        if (position < 0 && plugins[i].Equals(p.Name, StringComparison.OrdinalIgnoreCase))
+        {
+          position = i;
+        }
+      }
+      if (position < 0)
+      {
+        plugins.Add(p.Name);
+        position = plugins.Count - 1;
+      }
+      //the index is only built again when the load order changes or one of its plugins is saved
+      if (referenceIndex == null || !referenceIndex.IsCurrent(plugins))
+      {
+        if (referenceIndex != null)
+        {
+          referenceIndex.Dispose();
+          referenceIndex = null;
+        }
+        referenceIndex = BuildReferenceIndex(plugins);
+        if (referenceIndex == null)
+        {
+          return;
+        }
+      }
+      if (!referenceIndex.IsReadable(position))
+      {
+        MessageBox.Show("Save the plugin to the Data folder first", "Error");
+        return;
+      }
+      var references = referenceIndex.GetReferences(position, r.FormID);
+      var sb = new StringBuilder();
+      sb.AppendLine(references.Length + " records refer to " + r.DescriptiveName);
+      foreach (var reference in references)
+      {
+        sb.AppendLine(plugins[reference.Plugin] + ": " + reference.FormId.ToString("X8"));
+      }
+      tbInfo.Text = sb.ToString();
+    }
+
+    private BackgroundWorkerProgressDialog ReferenceProgress;
+    private IList<string> ReferencePlugins;
+    private ReferenceIndex ReferenceResult;
+
+    /// <summary>
+    ///   Indexes the references between the given plugins on a background thread, showing the progress.
+    /// </summary>
+    /// <param name="plugins">The file names of the plugins, in load order.</param>
+    /// <returns>The index of the given plugins, or <c>null</c> if the user cancelled.</returns>
+    private ReferenceIndex BuildReferenceIndex(IList<string> plugins)
+    {
+      ReferencePlugins = plugins;
+      Exception error;
+      using (ReferenceProgress = new BackgroundWorkerProgressDialog(BuildReferenceIndexWork))
+      {
+        ReferenceProgress.Text = "Finding references";
+        ReferenceProgress.ShowItemProgress = false;
+        ReferenceProgress.OverallMessage = "Reading plugins...";
+        ReferenceProgress.OverallProgressMaximum = plugins.Count;
+        ReferenceProgress.ShowDialog(this);
+        error = ReferenceProgress.Error;
+      }
+      ReferenceProgress = null;
+      ReferencePlugins = null;
+      var index = ReferenceResult;
+      ReferenceResult = null;
+      if (error != null)
+      {
+        throw new fommException(error.Message);
+      }
+      return index;
+    }
+
+    /// <summary>
+    ///   Runs refOpen on the progress dialog's background thread.
+    /// </summary>
+    private void BuildReferenceIndexWork()
+    {
+      NativeMethods.RefProgressDelegate progress = BuildReferenceIndexProgress;
+      try
+      {
+        ReferenceResult = ReferenceIndex.ForLoadOrder(ReferencePlugins, progress);
+      }
+      catch (fommException)
+      {
+        //a cancelled index fails to open, which isn't an error
+        if (!ReferenceProgress.Cancelled())
+        {
+          throw;
+        }
+      }
+      GC.KeepAlive(progress);
+    }
+
+    private bool BuildReferenceIndexProgress(int done, int total)
+    {
+      ReferenceProgress.OverallProgress = done;
+      return !ReferenceProgress.Cancelled();
+    }
+
     private void DumpEdidsInternal(Rec r, StreamWriter sw)
     {
       if (r is Record)
@@ -1219,6 +1359,167 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       sw.Close();
     }
 
+    private static string CsvField(string text)
+    {
+      if (text.IndexOfAny(new[]
+      {
+        ',', '"', '\r', '\n'
+      }) < 0)
+      {
+        return text;
+      }
+      return "\"" + text.Replace("\"", "\"\"") + "\"";
+    }
+
+    private void exportRecordTableToolStripMenuItem_Click(object sender, EventArgs e)
+    {
+      if (PluginTree.SelectedNode == null || PluginTree.SelectedNode.Tag is Plugin)
+      {
+        MessageBox.Show("Spell works only on records or top level record groups", "Error");
+        return;
+      }
+      string type;
+      if (PluginTree.SelectedNode.Tag is Record)
+      {
+        type = ((Record) PluginTree.SelectedNode.Tag).Name;
+      }
+      else
+      {
+        var gr = (GroupRecord) PluginTree.SelectedNode.Tag;
+        if (gr.groupType != 0)
+        {
+          MessageBox.Show("Spell works only on records or top level record groups", "Error");
+          return;
+        }
+        type = gr.ContentsType;
+      }
+      RecordStructure rs;
+      if (!RecordStructure.Loaded || !RecordStructure.Records.TryGetValue(type, out rs))
+      {
+        MessageBox.Show("There is no record structure for " + type + " records", "Error");
+        return;
+      }
+      var tn = PluginTree.SelectedNode;
+      while (!(tn.Tag is Plugin))
+      {
+        tn = tn.Parent;
+      }
+      //the table is decoded from the plugin as it was last saved, not from the records being edited
+      var path = Path.Combine(Program.GameMode.PluginsPath, ((Plugin) tn.Tag).Name);
+      if (!File.Exists(path))
+      {
+        MessageBox.Show("Save the plugin to the Data folder first", "Error");
+        return;
+      }
+      if (SaveRecordTableDialog.ShowDialog() != DialogResult.OK)
+      {
+        return;
+      }
+
+      var columns = new List<UInt32>();
+      var elements = new List<ElementStructure>();
+      var sb = new StringBuilder("FormID");
+      for (var i = 0; i < rs.subrecords.Length; i++)
+      {
+        for (var j = 0; j < rs.subrecords[i].elements.Length; j++)
+        {
+          columns.Add(RecordTable.Column(i, j));
+          elements.Add(rs.subrecords[i].elements[j]);
+          sb.Append(",").Append(CsvField(rs.subrecords[i].name + "." + rs.subrecords[i].elements[j].name));
+        }
+      }
+
+      PluginIndex plugin = null;
+      var layout = new RecordLayout();
+      RecordTable table = null;
+      try
+      {
+        plugin = new PluginIndex(path);
+        table = new RecordTable(plugin, layout, type, columns);
+        var cells = new string[columns.Count][];
+        for (var c = 0; c < columns.Count; c++)
+        {
+          var present = table.GetPresent(c);
+          cells[c] = new string[present.Length];
+          switch (elements[c].type)
+          {
+            case ElementValueType.String:
+            case ElementValueType.fstring:
+              cells[c] = table.GetStrings(c);
+              break;
+            case ElementValueType.Float:
+              var floats = table.GetFloats(c);
+              for (var r = 0; r < floats.Length; r++)
+              {
+                cells[c][r] = present[r] ? floats[r].ToString(CultureInfo.InvariantCulture) : null;
+              }
+              break;
+            case ElementValueType.Int:
+            case ElementValueType.Short:
+            case ElementValueType.Byte:
+              var ints = table.GetInts(c);
+              for (var r = 0; r < ints.Length; r++)
+              {
+                cells[c][r] = present[r] ? ints[r].ToString(CultureInfo.InvariantCulture) : null;
+              }
+              break;
+            default:
+              //form ids are shown in hex; blobs are their sizes
+              var values = table.GetValues(c);
+              for (var r = 0; r < values.Length; r++)
+              {
+                if (present[r])
+                {
+                  cells[c][r] = elements[c].type == ElementValueType.FormID
+                                  ? values[r].ToString("X8")
+                                  : values[r].ToString(CultureInfo.InvariantCulture);
+                }
+              }
+              break;
+          }
+        }
+
+        var sw = new StreamWriter(SaveRecordTableDialog.FileName, false, Encoding.Default);
+        sw.WriteLine(sb.ToString());
+        for (var r = 0; r < table.FormIds.Length; r++)
+        {
+          sb.Length = 0;
+          sb.Append(table.FormIds[r].ToString("X8"));
+          for (var c = 0; c < columns.Count; c++)
+          {
+            sb.Append(",");
+            if (cells[c][r] != null)
+            {
+              sb.Append(CsvField(cells[c][r]));
+            }
+          }
+          sw.WriteLine(sb.ToString());
+        }
+        sw.Close();
+        tbInfo.Text = table.FormIds.Length + " " + type + " records exported";
+      }
+      catch (TESParserException ex)
+      {
+        MessageBox.Show(ex.Message, "Error");
+      }
+      catch (fommException ex)
+      {
+        MessageBox.Show(ex.Message, "Error");
+      }
+      finally
+      {
+        if (table != null)
+        {
+          table.Dispose();
+        }
+        if (plugin != null)
+        {
+          plugin.Dispose();
+        }
+        layout.Dispose();
+      }
+    }
+
     private void cleanRecurse(Rec r, uint match, uint mask, Dictionary<uint, Record> lookup)
     {
       var r2 = r as Record;
@@ -1354,6 +1655,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       {
         tn = tn.Parent;
       }
+      searchIndex.MarkDirty(tn);
       tn.Nodes.Clear();
       CreatePluginTree(FormIDLookup[FormIDLookup.Length - 1], tn);
     }
@@ -1433,6 +1735,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
 
           srs.InsertRange(i, r.SubRecords);
 
+          searchIndex.MarkDirty(PluginTree.SelectedNode);
           PluginTree_AfterSelect(null, null);
         }
         return;
@@ -1452,6 +1755,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       }
       else
       {
+        searchIndex.MarkDirty(tn);
         PluginTree_AfterSelect(null, null);
       }
     }
@@ -1466,6 +1770,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       {
         tn = tn.Parent;
       }
+      searchIndex.MarkDirty(tn);
       foreach (var rec in ((Plugin) tn.Tag).Records)
       {
         var gr = rec as GroupRecord;
@@ -1872,6 +2177,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       f.ShowDialog();
       var with = tb.Text;
 
+      searchIndex.MarkDirty(tn);
       var recs = new Queue<Rec>(p.Records);
       while (recs.Count > 0)
       {
@@ -2191,6 +2497,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
           0, 0, 0, 0, 0, 0, 0, 0
         });
         brcTES4.AddRecord(sbrMaster);
+        searchIndex.MarkDirty(tndRoot);
         PluginTree_AfterSelect(null, null);
       }
     }
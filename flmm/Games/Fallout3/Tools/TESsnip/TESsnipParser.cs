@@ -19,63 +19,82 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
     public abstract long Size { get; }
     public abstract long Size2 { get; }
 
-    private static byte[] input;
-    private static byte[] output;
-    private static MemoryStream ms;
-    private static BinaryReader compReader;
-    private static Inflater inf;
+    //a plugin is only ever read on one thread, but any thread can be reading one
+    [ThreadStatic] private static byte[] input;
+    [ThreadStatic] private static MemoryStream ms;
+    [ThreadStatic] private static BinaryReader compReader;
+    [ThreadStatic] private static Inflater inf;
+    [ThreadStatic] private static PluginIndex inflated;
+    [ThreadStatic] private static int entries;
 
-    protected static BinaryReader Decompress(BinaryReader br, int size, int outsize)
+    //groups and records are read in file order, so counting them gives each the index the plugin index knows it by
+    protected static int NextEntry()
     {
-      if (input.Length < size)
+      return entries++;
+    }
+
+    protected static BinaryReader Decompress(BinaryReader br, int size, int outsize, long offset, int index)
+    {
+      //the data goes straight into the buffer behind the reader
+      ms.SetLength(outsize);
+      ms.Position = 0;
+      var bteOutput = ms.GetBuffer();
+
+      //records inflated up front only need copying out
+      if ((inflated != null) && inflated.ReadInflated(index, offset, bteOutput, outsize))
       {
-        input = new byte[size];
+        br.BaseStream.Position += size;
+        return compReader;
       }
-      if (output.Length < outsize)
+
+      if (input.Length < size)
       {
-        output = new byte[outsize];
+        input = new byte[size];
       }
       br.Read(input, 0, size);
 
-      inf.SetInput(input, 0, size);
-      try
+      //the native inflater handles well formed records; anything it rejects goes through the managed one, which is
+      //more forgiving about truncated streams
+      if (!NativeMethods.zInflateBuffer(input, size, bteOutput, outsize, 1))
       {
-        inf.Inflate(output);
-      }
-      catch (SharpZipBaseException e)
-      {
-        //we ignore adler checksum mismatches, as I have a notion that they aren't always correctly
-        // stored in the records.
-        if (!e.Message.StartsWith("Adler"))
+        inf.SetInput(input, 0, size);
+        try
+        {
+          inf.Inflate(bteOutput, 0, outsize);
+        }
+        catch (SharpZipBaseException e)
         {
-          throw e;
+          //we ignore adler checksum mismatches, as I have a notion that they aren't always correctly
+          // stored in the records.
+          if (!e.Message.StartsWith("Adler"))
+          {
+            throw e;
+          }
         }
+        inf.Reset();
       }
-      inf.Reset();
-
-      ms.Position = 0;
-      ms.Write(output, 0, outsize);
-      ms.Position = 0;
 
       return compReader;
     }
 
-    protected static void InitDecompressor()
+    protected static void InitDecompressor(PluginIndex pdxInflated)
     {
+      inflated = pdxInflated;
+      entries = 0;
       inf = new Inflater(false);
-      ms = new MemoryStream();
+      ms = new MemoryStream(0x4000);
       compReader = new BinaryReader(ms);
       input = new byte[0x1000];
-      output = new byte[0x4000];
     }
 
     protected static void CloseDecompressor()
     {
       compReader.Close();
       compReader = null;
+      ms = null;
+      inflated = null;
       inf = null;
       input = null;
-      output = null;
     }
 
     public abstract string GetDesc();
@@ -169,11 +188,11 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       Records.Add(r);
     }
 
-    private void LoadPlugin(BinaryReader br, bool headerOnly)
+    private void LoadPlugin(BinaryReader br, bool headerOnly, PluginIndex pdxInflated)
     {
       var IsOblivion = false;
 
-      InitDecompressor();
+      InitDecompressor(pdxInflated);
 
       var s = ReadRecName(br);
       if (s != "TES4")
@@ -246,7 +265,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       var br = new BinaryReader(new MemoryStream(data));
       try
       {
-        LoadPlugin(br, false);
+        LoadPlugin(br, false, null);
       }
       finally
       {
@@ -259,13 +278,31 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       Name = Path.GetFileName(FilePath);
       var fi = new FileInfo(FilePath);
       var br = new BinaryReader(fi.OpenRead());
+      PluginIndex pdxInflated = null;
       try
       {
-        LoadPlugin(br, headerOnly);
+        //compressed records are inflated across all cores a window at a time as the walk reaches them; if the
+        // plugin can't be indexed, the walk inflates them one at a time instead
+        if (!headerOnly)
+        {
+          try
+          {
+            pdxInflated = new PluginIndex(FilePath);
+          }
+          catch (TESParserException)
+          {
+            pdxInflated = null;
+          }
+        }
+        LoadPlugin(br, headerOnly, pdxInflated);
       }
       finally
       {
         br.Close();
+        if (pdxInflated != null)
+        {
+          pdxInflated.Dispose();
+        }
       }
     }
 
@@ -372,6 +409,33 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       return false;
     }
 
+    //maps each form id to the first record with it, as the records stand now; it isn't kept up to date as records
+    //are added or removed
+    public Dictionary<UInt32, Record> IndexFormIds()
+    {
+      var dicRecords = new Dictionary<UInt32, Record>();
+      IndexFormIds(Records, dicRecords);
+      return dicRecords;
+    }
+
+    private static void IndexFormIds(List<Rec> p_lstRecords, Dictionary<UInt32, Record> p_dicRecords)
+    {
+      foreach (var rec in p_lstRecords)
+      {
+        if (rec is GroupRecord)
+        {
+          IndexFormIds(((GroupRecord) rec).Records, p_dicRecords);
+        }
+        else if (rec is Record)
+        {
+          if (!p_dicRecords.ContainsKey(((Record) rec).FormID))
+          {
+            p_dicRecords.Add(((Record) rec).FormID, (Record) rec);
+          }
+        }
+      }
+    }
+
     public Int32 GetMasterIndex(string p_strPluginName)
     {
       var lstMaster = Masters;
@@ -469,6 +533,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
 
     internal GroupRecord(uint Size, BinaryReader br, bool Oblivion)
     {
+      NextEntry();
       Name = "GRUP";
       data = br.ReadBytes(4);
       groupType = br.ReadUInt32();
@@ -712,6 +777,8 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
 
     internal Record(string name, uint Size, BinaryReader br, bool Oblivion)
     {
+      var intEntry = NextEntry();
+      var lngOffset = br.BaseStream.Position - 8;
       Name = name;
       Flags1 = br.ReadUInt32();
       FormID = br.ReadUInt32();
@@ -724,7 +791,7 @@ namespace Fomm.Games.Fallout3.Tools.TESsnip
       {
         Flags1 ^= 0x00040000;
         var newSize = br.ReadUInt32();
-        br = Decompress(br, (int) (Size - 4), (int) newSize);
+        br = Decompress(br, (int) (Size - 4), (int) newSize, lngOffset, intEntry);
         Size = newSize;
       }
       uint AmountRead = 0;
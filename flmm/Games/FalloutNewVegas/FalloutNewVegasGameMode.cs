@@ -338,6 +338,8 @@ namespace Fomm.Games.FalloutNewVegas
                                                 LaunchTESsnipToolWithSelectedPlugins));
       RightClickTools.Add(new Command<MainForm>("Open in CREditor...", "Open the selected plugins in TESsnip.",
                                                 LaunchCREditorToolWithSelectedPlugins));
+      RightClickTools.Add(new Command<MainForm>("Merge Plugins...", "Merges the selected plugins into one.",
+                                                LaunchMergeToolWithSelectedPlugins));
 
       LoadOrderTools.Add(new Command<MainForm>("Launch LOOT (Auto Sort)", "LOOT load order sorting tool.",
                                                LaunchSortPlugins));
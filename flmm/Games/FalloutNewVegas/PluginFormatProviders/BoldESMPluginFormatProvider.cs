@@ -19,7 +19,7 @@ namespace Fomm.Games.FalloutNewVegas.PluginFormatProviders
     public override bool HasFormat(string p_strPluginName)
     {
       return Properties.Settings.Default.falloutNewVegasBoldifyESMs &&
-             Plugin.GetIsEsm(Path.Combine(Program.GameMode.PluginsPath, p_strPluginName));
+             PluginHeaderCache.Current.IsMaster(Path.Combine(Program.GameMode.PluginsPath, p_strPluginName));
     }
   }
 }
\ No newline at end of file
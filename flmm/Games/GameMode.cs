@@ -331,15 +331,26 @@ class Script : GenericBaseScript {
       if (PluginManager.IsPluginActive(Path.Combine(Program.GameMode.PluginsPath, name)))
       {
         // Get the list of masters of the queried plugin
-        var plgPlugin = new Plugin(Path.Combine(Program.GameMode.PluginsPath, name), true);
         var masters = new List<string>();
-        foreach (var sr in ((Record) plgPlugin.Records[0]).SubRecords)
+        var phdHeader = PluginHeaderCache.Current.GetHeader(name);
+        if (phdHeader != null)
         {
-          switch (sr.Name)
+          foreach (var master in phdHeader.Masters)
           {
-            case "MAST":
-              masters.Add(sr.GetStrData().ToLower());
-              break;
+            masters.Add(master.ToLower());
+          }
+        }
+        else
+        {
+          var plgPlugin = new Plugin(Path.Combine(Program.GameMode.PluginsPath, name), true);
+          foreach (var sr in ((Record) plgPlugin.Records[0]).SubRecords)
+          {
+            switch (sr.Name)
+            {
+              case "MAST":
+                masters.Add(sr.GetStrData().ToLower());
+                break;
+            }
           }
         }
 
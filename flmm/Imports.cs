@@ -22,6 +22,25 @@ namespace Fomm
     [DllImport("ShaderDisasm", CharSet = CharSet.Ansi)]
     public static extern IntPtr ddsShrink(byte[] data, int len, out int oSize);
 
+    [StructLayout(LayoutKind.Sequential)]
+    public struct DdsInfo
+    {
+      public int width;
+      public int height;
+      public int depth;
+      public int mipCount;
+      public int arraySize;
+      public int format;
+      public int dxgiFormat;
+      public int bitsPerPixel;
+      public int dataOffset;
+      public uint expectedSize;
+      public int flags;
+    }
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern bool ddsProbe(byte[] data, int len, out DdsInfo info);
+
     [DllImport("ShaderDisasm", CharSet = CharSet.Ansi)]
     public static extern void ddsClose();
 
@@ -35,6 +54,18 @@ namespace Fomm
     public static extern void ddsBlt(IntPtr source, int sL, int sT, int sW, int sH, IntPtr dest, int dL, int dT, int dW,
                                      int dH);
 
+    [StructLayout(LayoutKind.Sequential)]
+    public struct BltOperation
+    {
+      public IntPtr source;
+      public int sL, sT, sW, sH;
+      public int dL, dT, dW, dH;
+      public int filter;
+    }
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int ddsBltBatch(IntPtr dest, [In] BltOperation[] ops, int count);
+
     [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
     public static extern IntPtr ddsSave(IntPtr ptr, int format, int mipmaps, out int length);
 
@@ -53,6 +84,341 @@ namespace Fomm
     [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
     public static extern void ddsSetData(IntPtr tex, byte[] data, int len);
 
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern IntPtr ddsLockEx(IntPtr tex, bool readOnly, out int pitch, out int width, out int height);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern bool ddsGetData(IntPtr tex, byte[] dest, int len, int pitch);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern bool ddsSetDataPitch(IntPtr tex, byte[] data, int len, int pitch);
+
+    public delegate void TrimProgressDelegate(int done, int total);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi)]
+    public static extern int TrimBsa(string inPath, string outPath, int options, TrimProgressDelegate progress);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi)]
+    public static extern int TrimEsp(string inPath, string outPath, int options, TrimProgressDelegate progress);
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct BsaEntry
+    {
+      public ulong hash;
+      public IntPtr data;
+      public int storedSize;
+      public int size;
+      public bool compressed;
+    }
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern IntPtr bsaOpen(string path);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern void bsaClose(IntPtr bsa);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int bsaFileCount(IntPtr bsa);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int bsaFind(IntPtr bsa, string path);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern bool bsaFileInfo(IntPtr bsa, int index, out BsaEntry entry);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern IntPtr bsaView(IntPtr bsa, int index, out int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern bool bsaRead(IntPtr bsa, int index, byte[] dest, int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int bsaFileName(IntPtr bsa, int index, StringBuilder buffer, int length);
+
+    public delegate void PackProgressDelegate(int done, int total);
+
+    [StructLayout(LayoutKind.Sequential, CharSet = CharSet.Ansi)]
+    public struct BsaPackEntry
+    {
+      public string name;
+      public string source;
+      public bool compress;
+    }
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi)]
+    public static extern int bsaPack(string outPath, BsaPackEntry[] entries, int count, int archiveFlags, int fileFlags,
+                                     int ratio, int level, int options, out long saved,
+                                     PackProgressDelegate progress);
+
+    public delegate bool ExtractProgressDelegate(int done, int total);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi)]
+    public static extern int bsaExtract(IntPtr bsa, int[] indices, int count, string outDir, int budget,
+                                        ExtractProgressDelegate progress);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern void bsaHashBatch(string[] paths, int count, int options, [Out] ulong[] hashes);
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct BsaProblem
+    {
+      public int kind;
+      public int folder;
+      public int file;
+    }
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int bsaValidate(string path, int options, [Out] BsaProblem[] problems, int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int bsaRepair(string path, string outPath, int options);
+
+    [StructLayout(LayoutKind.Sequential, CharSet = CharSet.Ansi)]
+    public struct BsaEditEntry
+    {
+      public string name;
+      public string source;
+      public bool compress;
+    }
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int bsaEdit(string path, BsaEditEntry[] edits, int count, int ratio, int level, int slack,
+                                     out long unused);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int bsaCompact(string path, string outPath, out long reclaimed);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern bool zInflateBuffer(byte[] input, int inLength, byte[] output, int outLength, int flags);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern IntPtr vfsOpen(string dataPath, string archives, string snapshot, int flags);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern void vfsClose(IntPtr vfs);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int vfsSourceCount(IntPtr vfs);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int vfsSourceName(IntPtr vfs, int source, StringBuilder buffer, int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int vfsPathCount(IntPtr vfs);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int vfsFind(IntPtr vfs, string path);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int vfsPathName(IntPtr vfs, int path, StringBuilder buffer, int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int vfsWinner(IntPtr vfs, int path);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int vfsProviders(IntPtr vfs, int path, [Out] int[] sources, int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int vfsOverrides(IntPtr vfs, int source, [Out] int[] paths, int length);
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct EspEntry
+    {
+      public uint type;
+      public uint formId;
+      public uint flags;
+      public uint offset;
+      public uint size;
+      public int parent;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct EspSubrecord
+    {
+      public uint type;
+      public uint offset;
+      public uint size;
+    }
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern IntPtr espOpen(string path);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern void espClose(IntPtr esp);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int espEntryCount(IntPtr esp);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int espRecordCount(IntPtr esp);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern bool espEntryInfo(IntPtr esp, int index, out EspEntry entry);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int espMasterCount(IntPtr esp);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int espMasterName(IntPtr esp, int index, StringBuilder buffer, int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int espFind(IntPtr esp, uint formId);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int espFindEditorId(IntPtr esp, uint type, string editorId);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int espFindOffset(IntPtr esp, uint offset);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int espInflateWindow(IntPtr esp, int index);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int espRecordData(IntPtr esp, int index, byte[] dest, int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int espSubrecords(IntPtr esp, int index, [Out] EspSubrecord[] subrecords, int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int espMerge(string dataPath, string[] plugins, int count, string outPath, IntPtr layouts,
+                                      string mapPath);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern IntPtr layoutOpen(byte[] blob, int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern void layoutClose(IntPtr layouts);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern IntPtr ovrOpen(string dataPath, string[] plugins, int count, string snapshot, uint noteType,
+                                        string noteEditorId, uint noteSubrecord);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern void ovrClose(IntPtr ovr);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int ovrPluginCount(IntPtr ovr);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int ovrPluginState(IntPtr ovr, int plugin);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int ovrNote(IntPtr ovr, int plugin, [Out] byte[] buffer, int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int ovrRecordCount(IntPtr ovr);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int ovrFind(IntPtr ovr, int plugin, uint formId, [Out] int[] plugins, int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int ovrOverrides(IntPtr ovr, int plugin, [Out] uint[] formIds, int length);
+
+    public delegate bool RefProgressDelegate(int done, int total);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi)]
+    public static extern IntPtr refOpen(string dataPath, string[] plugins, int count, IntPtr layouts,
+                                        RefProgressDelegate progress);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern void refClose(IntPtr refs);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int refPluginState(IntPtr refs, int plugin);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int refReferenceCount(IntPtr refs);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int refFind(IntPtr refs, int plugin, uint formId, [Out] int[] plugins, [Out] uint[] formIds,
+                                     int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern IntPtr tableOpen(IntPtr esp, IntPtr layouts, uint type, uint[] columns, int count);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern void tableClose(IntPtr table);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int tableRowCount(IntPtr table);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int tableFormIds(IntPtr table, [Out] uint[] formIds, int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int tableColumn(IntPtr table, int column, [Out] uint[] values, [Out] byte[] present,
+                                         int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int tableStrings(IntPtr table, [Out] byte[] buffer, int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern IntPtr srchOpen();
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern void srchClose(IntPtr index);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern bool srchAdd(IntPtr index, uint formId, uint type, byte[] editorId, int editorIdLength,
+                                      byte[] name, int nameLength, byte[] text, int textLength);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern bool srchBuild(IntPtr index);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int srchRecordCount(IntPtr index);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int srchFindFormId(IntPtr index, uint formId, uint type, [Out] int[] records, int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int srchFindText(IntPtr index, int field, byte[] text, int textLength, bool partial, uint type,
+                                          [Out] int[] records, int length);
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct MetaInfo
+    {
+      public ulong size;
+      public ulong time;
+      public uint flags;
+      public uint recordCount;
+      public int masterCount;
+      public int state;
+    }
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern IntPtr metaOpen(string dataPath, string snapshot);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern void metaClose(IntPtr cache);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int metaRefresh(IntPtr cache);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int metaPluginCount(IntPtr cache);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int metaFind(IntPtr cache, string name);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern bool metaPluginInfo(IntPtr cache, int index, out MetaInfo info);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int metaPluginName(IntPtr cache, int index, StringBuilder buffer, int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int metaAuthor(IntPtr cache, int index, StringBuilder buffer, int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int metaDescription(IntPtr cache, int index, StringBuilder buffer, int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern int metaMasterName(IntPtr cache, int index, int master, StringBuilder buffer, int length);
+
+    [DllImport("ShaderDisasm", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
+    public static extern bool metaHash(IntPtr cache, int index, out ulong hash);
+
     [DllImport("kernel32", CharSet = CharSet.Ansi), SuppressUnmanagedCodeSecurity]
     public static extern int GetPrivateProfileIntA(string section, string value, int def, string path);
 
@@ -415,6 +415,19 @@ namespace fomm.Scripting
       return (byte[]) ExecuteMethod(() => Script.TextureManager.SaveTexture(p_ptrTexture, p_intFormat, p_booMipmaps));
     }
 
+    /// <summary>
+    /// Saves the specified texture, generating mipmaps with the given filter.
+    /// </summary>
+    /// <param name="p_ptrTexture">The pointer to the texture to save.</param>
+    /// <param name="p_intFormat">The format in which to save the texture.</param>
+    /// <param name="p_mpoMipmaps">How to build the mipmaps.</param>
+    /// <returns>The saved texture.</returns>
+    /// <seealso cref="TextureManager.SaveTexture(IntPtr, int, MipmapOptions)"/>
+    public static byte[] SaveTexture(IntPtr p_ptrTexture, int p_intFormat, MipmapOptions p_mpoMipmaps)
+    {
+      return (byte[]) ExecuteMethod(() => Script.TextureManager.SaveTexture(p_ptrTexture, p_intFormat, p_mpoMipmaps));
+    }
+
     /// <summary>
     /// Copies part of one texture to another.
     /// </summary>
@@ -430,6 +443,29 @@ namespace fomm.Scripting
         () => Script.TextureManager.CopyTexture(p_ptrSource, p_rctSourceRect, p_ptrDestination, p_rctDestinationRect));
     }
 
+    /// <summary>
+    /// Copies many areas of textures into one texture in a single operation.
+    /// </summary>
+    /// <param name="p_ptrDestination">A pointer to the texture to which to make the copies.</param>
+    /// <param name="p_tcpCopies">The copies to make.</param>
+    /// <returns>The number of copies that were made.</returns>
+    /// <seealso cref="TextureManager.CopyTextures(IntPtr, System.Collections.Generic.IList{TextureCopy})"/>
+    public static int CopyTextures(IntPtr p_ptrDestination, TextureCopy[] p_tcpCopies)
+    {
+      return (int) (ExecuteMethod(() => Script.TextureManager.CopyTextures(p_ptrDestination, p_tcpCopies)) ?? 0);
+    }
+
+    /// <summary>
+    /// Describes the given texture without loading it.
+    /// </summary>
+    /// <param name="p_bteTexture">The texture file to describe.</param>
+    /// <returns>The texture's description, or <lang langref="null"/> if the data isn't a DDS texture.</returns>
+    /// <seealso cref="TextureManager.GetTextureInfo(byte[])"/>
+    public static TextureInfo GetTextureInfo(byte[] p_bteTexture)
+    {
+      return (TextureInfo) ExecuteMethod(() => Script.TextureManager.GetTextureInfo(p_bteTexture));
+    }
+
     /// <summary>
     /// Gets the dimensions of the specified texture.
     /// </summary>
@@ -483,6 +519,32 @@ namespace fomm.Scripting
       ExecuteMethod(() => Script.TextureManager.SetTextureData(p_ptrTexture, p_bteData));
     }
 
+    /// <summary>
+    /// Copies the data of the specified texture into the given buffer.
+    /// </summary>
+    /// <param name="p_ptrTexture">A pointer to the texture whose data is to be retrieved.</param>
+    /// <param name="p_bteBuffer">The buffer into which to copy the texture data.</param>
+    /// <param name="p_intPitch">The number of bytes between the starts of two rows in the buffer.</param>
+    /// <returns><lang langref="true"/> if the data was copied; <lang langref="false"/> otherwise.</returns>
+    /// <seealso cref="TextureManager.GetTextureData(IntPtr, byte[], int)"/>
+    public static bool GetTextureData(IntPtr p_ptrTexture, byte[] p_bteBuffer, int p_intPitch)
+    {
+      return (bool) (ExecuteMethod(() => Script.TextureManager.GetTextureData(p_ptrTexture, p_bteBuffer, p_intPitch)) ?? false);
+    }
+
+    /// <summary>
+    /// Sets the data for the specified texture from a buffer with the given pitch.
+    /// </summary>
+    /// <param name="p_ptrTexture">A pointer to the texture whose data is to be set.</param>
+    /// <param name="p_bteData">The data to which to set the texture.</param>
+    /// <param name="p_intPitch">The number of bytes between the starts of two rows in the data.</param>
+    /// <returns><lang langref="true"/> if the data was set; <lang langref="false"/> otherwise.</returns>
+    /// <seealso cref="TextureManager.SetTextureData(IntPtr, byte[], int)"/>
+    public static bool SetTextureData(IntPtr p_ptrTexture, byte[] p_bteData, int p_intPitch)
+    {
+      return (bool) (ExecuteMethod(() => Script.TextureManager.SetTextureData(p_ptrTexture, p_bteData, p_intPitch)) ?? false);
+    }
+
     /// <summary>
     /// Releases the specified texture.
     /// </summary>